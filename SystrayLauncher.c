@@ -15,6 +15,8 @@
 #include <shlobj.h>
 #include <shlwapi.h>
 #include <dwmapi.h>
+#include <psapi.h>
+#include <wincodec.h>
 #include <math.h>
 
 #ifndef DWMWA_CLOAKED
@@ -29,6 +31,12 @@
 // WebView2 headers required from SDK
 #include "WebView2.h"
 #include "resource.h"
+#include "lifecycle.h"
+#include "webview_stats.h"
+#include "occlusion.h"
+#include "config.h"
+#include "prefs_json.h"
+#include "webmsg.h"
 
 #define WINDOW_SIZE_PERCENTAGE 0.9
 #define RESOLUTION_CHANGE_DEBOUNCE_MS 1000
@@ -36,6 +44,7 @@
 #define APP_NAME L"SystrayLauncher"
 #define MUTEX_NAME L"SystrayLauncher_SingleInstance_Mutex_9F8A7B6C"
 #define TRAY_ICON_ID 100
+#define SITE_MAX 8
 #define WM_TRAYICON (WM_APP + 1)
 #define ID_TRAY_MENU_REFRESH 1
 #define ID_TRAY_MENU_CLEAR_CACHE 2
@@ -43,24 +52,32 @@
 #define ID_TRAY_MENU_CONFIGURE 5
 #define ID_TRAY_MENU_EXIT 4
 #define ID_TRAY_MENU_RESTART 6
+#define ID_TRAY_MENU_SAVE_STATS 7
 
 // Registry settings
 #define REG_COMPANY L"JPIT"
 #define REG_APPNAME L"SystrayLauncher"
 #define REG_KEY_PATH L"SOFTWARE\\JPIT\\SystrayLauncher"
-#define REG_VALUE_URL L"URL"
-#define REG_VALUE_TITLE L"WindowTitle"
-#define REG_VALUE_ONHIDEJS L"OnHideJS"
-#define REG_VALUE_ONSHOWJS L"OnShowJS"
-#define REG_VALUE_SLEEP L"SleepWhenInactive"
-#define REG_VALUE_SPELLCHECK L"SpellcheckLanguages"
-#define REG_VALUE_NEWWINDOW L"OpenNewWindowsExternally"
-#define REG_VALUE_CONFIGURED L"Configured"
-
-#define ID_TIMER_INITIAL_HIDE_JS 2
-#define INITIAL_HIDE_JS_DELAY_MS 2000
+// Each subkey of this one configures an additional site (see Site)
+#define REG_SITES_SUBKEY L"Sites"
+
+// The onShow/onHide hooks are defined once per document as the show() and
+// hide() methods of this window property (RegisterJsHooks); transitions only
+// call them.
+#define JS_HOOKS_NAME L"__systrayLauncherHooks"
 #define ID_TIMER_VISIBILITY_CHECK 3
-#define VISIBILITY_CHECK_INTERVAL_MS 250
+// While a window is shown, WinEvent hooks (foreground, show/hide, z-order,
+// end of a move or resize, minimize, cloak) mark its occlusion dirty, and
+// one check runs OCCLUSION_COALESCE_MS after the first event of a burst.
+// The slow safety poll catches what the hooks miss (windows moved by code
+// rather than dragged). A page whose resume failed is checked again every
+// RESUME_RETRY_INTERVAL_MS until it wakes. The statistics compare the
+// wakeups with what the old OCCLUSION_POLL_BEFORE_MS poll would have cost.
+#define OCCLUSION_COALESCE_MS 50
+#define ID_TIMER_OCCLUSION_SAFETY 14
+#define OCCLUSION_SAFETY_POLL_MS 5000
+#define OCCLUSION_POLL_BEFORE_MS 250
+#define RESUME_RETRY_INTERVAL_MS 250
 #define ID_TIMER_CFG_SHOW_FALLBACK 4
 #define CFG_SHOW_FALLBACK_DELAY_MS 350
 #define ID_TIMER_WEBVIEW_PREWARM 5
@@ -72,6 +89,32 @@
 #define ID_TIMER_POWER_RESUME 8
 #define POWER_RESUME_KICK_DELAY_MS 2000
 #define ID_TIMER_WEBVIEW_LIVENESS 9
+#define ID_TIMER_WEBVIEW_DWELL 10
+// With "sleep when inactive" on, the page is suspended only once the window
+// has stayed hidden or covered this long (SuspendDelay setting, seconds), so
+// a quick reopen finds it still running. 0 suspends at once. On the way it
+// stops rendering after StopRenderDelay and lowers its memory target after
+// TrimMemoryDelay, both also counted from the hide; a step not due before
+// the suspend is skipped. Defaults and limits are in config.h.
+#define ID_TIMER_WEBVIEW_DISCARD 11
+// Opt-in (DiscardAfter setting, hours; 0 = never): a page left suspended
+// and untouched this long after the window hid has its WebView torn down,
+// and the browser process with it once no site needs it. The next hover or
+// open rebuilds it.
+#define ID_TIMER_PARTIAL_DELAY 15
+// Opt-in (PartialPercent setting; 0 = off): a shown window with less than
+// this percentage of its area uncovered for PartialDelay seconds stops
+// rendering and lowers its memory target, with the last frame painted in
+// the uncovered part. It still counts as shown for onShowJs/onHideJs.
+#define ID_TIMER_OPEN_FRAME 12
+#define ID_TIMER_SNAPSHOT_FADE 13
+// A page opened from a tier that stopped rendering (or a rebuild) is
+// covered by the snapshot taken when it was last hidden, until it answers
+// again; then the snapshot fades out over SNAPSHOT_FADE_STEPS timer steps.
+// An open not answered within OPEN_FRAME_TIMEOUT_MS stops waiting.
+#define OPEN_FRAME_TIMEOUT_MS 5000
+#define SNAPSHOT_FADE_STEP_MS 15
+#define SNAPSHOT_FADE_STEPS 10
 // Each composition kick after a power resume is verified with a script ping;
 // if the runtime does not answer within this window the kick is retried (the
 // graphics stack can lag badly after hibernate), and after
@@ -80,9 +123,9 @@
 #define POWER_RESUME_KICK_RETRY_MS 4000
 #define POWER_RESUME_MAX_KICKS 3
 
-// After a suspend-resume failure the resume is retried on every activation
-// tick (4x/s); if it keeps failing this long the runtime is torn down and
-// rebuilt instead.
+// After a suspend-resume failure the resume is retried every
+// RESUME_RETRY_INTERVAL_MS while the window is shown; if it keeps failing
+// this long the runtime is torn down and rebuilt instead.
 #define RESUME_FAILURE_RECREATE_THRESHOLD 12
 
 // Rate limit for automatic WebView rebuilds after unexpected browser-process
@@ -102,17 +145,18 @@
 #define WM_APP_SPELLCHECK_CHANGED (WM_APP + 2)
 #define WM_APP_WEBVIEW_RECREATE (WM_APP + 3)
 
+// Posted by the registry watcher with a heap-allocated Configuration (lParam)
+// read after the settings key changed; the main window applies the delta.
+#define WM_APP_CONFIG_CHANGED (WM_APP + 4)
+
+// A burst of registry writes is read once the key has been quiet this long.
+#define CONFIG_WATCH_SETTLE_MS 300
+
+// Registry backend: one settings key under HKCU (see RegistryConfigStore_Init).
 typedef struct {
-    wchar_t url[2048];
-    wchar_t windowTitle[256];
-    wchar_t onHideJs[4096];
-    wchar_t onShowJs[4096];
-    BOOL sleepWhenInactive;
-    BOOL openNewWindowsExternally;
-    // Comma-separated BCP-47 tags (e.g. L"en-US,pl"); empty = don't manage
-    // the WebView2 profile's spell-check settings at all.
-    wchar_t spellcheckLanguages[512];
-} Configuration;
+    ConfigStore base;
+    wchar_t keyPath[MAX_PATH];
+} RegistryConfigStore;
 
 typedef enum {
     JS_VISIBILITY_UNKNOWN = -1,
@@ -120,51 +164,116 @@ typedef enum {
     JS_VISIBILITY_SHOWN = 1
 } JsVisibility;
 
+// WebView2 calls that go through the site's ControllerShadow.
+typedef enum {
+    WV_CALL_RESUME,
+    WV_CALL_TRY_SUSPEND,
+    WV_CALL_PUT_BOUNDS,
+    WV_CALL_PUT_IS_VISIBLE,
+    WV_CALL_PUT_MEMORY_TARGET,
+    WV_CALL_COUNT
+} WebViewCall;
+
+typedef enum {
+    SHADOW_UNKNOWN = -1,
+    SHADOW_OFF = 0,
+    SHADOW_ON = 1
+} ShadowFlag;
+
+// What the controller and the runtime were last told, so a call that would
+// only repeat it is skipped instead of crossing to the browser process.
+// Dropped back to unknown whenever the real state may have moved without us
+// (new controller, power transition, crash). UI thread only.
+typedef struct {
+    RECT bounds;
+    BOOL boundsKnown;
+    ShadowFlag visible;
+    ShadowFlag running;                // ON after Resume, OFF after a completed TrySuspend
+    ShadowFlag memoryLow;              // Memory target level LOW; only we change it
+    LONG issued[WV_CALL_COUNT];
+    LONG elided[WV_CALL_COUNT];
+    LONG events;                       // Lifecycle events dispatched
+    LONG quietEvents;                  // ...that needed no WebView2 work at all
+    LONG suspends;                     // Completed TrySuspends
+    LONG graceReopens;                 // Shown again from a hidden tier, before the suspend
+    LONG discards;                     // WebViews torn down after a long idle
+    ULONGLONG sinceTick;               // When counting started
+} ControllerShadow;
+
+// One hosted web app: its tray icon, window, WebView and the show/hide/sleep
+// state that goes with them. Every site is hosted in the same WebView2
+// environment (g_webViewEnv), so N sites share one browser process and one
+// user data folder. g_sites[0] is the primary site, configured at the root of
+// the settings key; any others come from its Sites subkeys.
+typedef struct {
+    int index;
+    wchar_t name[64];                  // Sites subkey; empty for the primary site
+    RegistryConfigStore registryStore;
+    ConfigStore* store;                // Where this site's settings are saved
+    Configuration config;
+    BOOL isConfigured;                 // First-launch setup has completed
+    HWND hwnd;
+    NOTIFYICONDATAW nid;
+    ICoreWebView2Controller* webViewController;
+    ICoreWebView2* webView;
+    volatile LONG isInitialized;
+    volatile LONG webViewCreatePending;  // Controller requested, not yet created
+    volatile LONG resetUrlOnNextShow;
+    volatile LONG openNewWindowsExternally;
+    volatile LONG resumeFailureCount;
+    volatile LONG webViewPingOutstanding;
+    LONGLONG navigateStartQpc;         // Our last Navigate, until NavigationCompleted
+    LONGLONG rebuildStartQpc;          // Rebuild after a discard, until its load completes
+    ULONGLONG idleSinceTick;           // Last hidden or hovered (discard countdown)
+    Lifecycle lifecycle;               // Suspend/render state (lifecycle.h)
+    ControllerShadow shadow;           // Last applied controller/runtime state
+    int tier;                          // WvTier for the usage stats; -1 untracked
+    ULONGLONG tierSinceTick;
+    ULONGLONG tierStartCpuMs;          // Runtime CPU time as the tier began
+    BOOL tierSampled;                  // ...if it could be read
+    HBITMAP snapshot;                  // The page as last shown (CapturePreview), for cold opens
+    int snapshotWidth;
+    int snapshotHeight;
+    BOOL snapshotLoadTried;            // The disk copy was read (or found missing) once
+    BOOL snapshotCapturePending;
+    unsigned snapshotGeneration;       // Bumped when the WebView closes; late captures are dropped
+    BYTE snapshotAlpha;                // Opacity of the snapshot over the client area; 0 = off
+    LONGLONG openStartQpc;             // ShowMainWindow, until the page answers again
+    BOOL occlusionTracked;             // Shown: the occlusion hooks count this window
+    BOOL occlusionCheckPending;        // ID_TIMER_VISIBILITY_CHECK armed
+    BOOL partialCounting;              // Shown below PartialPercent; ID_TIMER_PARTIAL_DELAY armed
+    BOOL partialDue;                   // ...for PartialDelay: throttled as if covered
+    JsVisibility jsVisibility;
+    wchar_t* jsHooksScriptId;          // The hooks' document-created script; NULL none
+    unsigned jsHooksGeneration;        // Bumped per registration; stale ones remove themselves
+    BOOL jsHooksSyncPending;           // Run the hook for the current state once the page loads
+} Site;
+
 // Globals
-static Configuration g_config;
-static HWND g_hwnd = NULL;
+static Site g_sites[SITE_MAX];
+static int g_siteCount = 0;
 static HWND g_hwndOwner = NULL;  // Invisible owner window to prevent taskbar appearance
-static ICoreWebView2Controller* g_webViewController = NULL;
-static ICoreWebView2* g_webView = NULL;
 static ICoreWebView2Environment* g_webViewEnv = NULL;
-static NOTIFYICONDATAW g_nid = {0};
 static UINT g_WM_TASKBARCREATED = 0;
 static HANDLE g_hMutex = NULL;
 static wchar_t g_iniPath[MAX_PATH];
-static wchar_t g_initialUrl[2048];
 static UINT_PTR g_timerId = 0;
 static int g_lastScreenWidth = 0;
 static int g_lastScreenHeight = 0;
 static float g_lastDpiX = 0.0f;
 static float g_lastDpiY = 0.0f;
-static volatile LONG g_isInitialized = FALSE;
-static volatile LONG g_webViewDesiredActive = FALSE;
-static volatile LONG g_webViewDesiredVisible = FALSE;
-static volatile LONG g_webViewPrewarmActive = FALSE;
-static volatile LONG g_webViewSuspendPending = FALSE;
-static volatile LONG g_webViewSuspended = FALSE;
-static volatile LONG g_resetUrlOnNextShow = FALSE;
-static volatile LONG g_sleepWhenInactive = FALSE;
-static volatile LONG g_openNewWindowsExternally = FALSE;
-static volatile LONG g_initialPreloadComplete = FALSE;
 static volatile LONG g_webViewRecreatePending = FALSE;
-static volatile LONG g_webViewCreatePending = FALSE;
-static volatile LONG g_resumeFailureCount = 0;
-// Post-power-resume recovery: set when the machine goes down or comes back up
-// and cleared once the WebView has answered a liveness ping (or been rebuilt).
-// While set, the page is kept warm so we never snapshot an unverified page.
-static volatile LONG g_powerResumePending = FALSE;
-static volatile LONG g_webViewPingOutstanding = FALSE;
-static int g_powerKickCount = 0;
+static volatile LONG g_webViewCreatePending = FALSE;  // Environment requested, not yet created
 static ULONGLONG g_rebuildBurstStartTick = 0;
 static LONG g_rebuildBurstCount = 0;
 static EventRegistrationToken g_browserExitedToken;
 static BOOL g_browserExitedRegistered = FALSE;
+static ULONGLONG g_envDiscardedTick = 0;  // When the last discard released the environment
 static HINSTANCE g_hInstance;
-static JsVisibility g_jsVisibility = JS_VISIBILITY_UNKNOWN;
 static wchar_t g_webView2Version[128] = L"Unknown";
 
 // Config dialog WebView2 globals
+static Site* g_cfgSite = NULL;  // The site being configured
 static HWND g_cfgHwnd = NULL;
 static ICoreWebView2Environment* g_cfgEnv = NULL;
 static ICoreWebView2Controller* g_cfgController = NULL;
@@ -173,6 +282,16 @@ static BOOL g_cfgSaved = FALSE;
 static BOOL g_cfgWindowShown = FALSE;
 static int g_cfgShowFallbackTries = 0;
 
+// Registry watcher thread (see StartConfigWatcher)
+static HANDLE g_configWatchThread = NULL;
+static HANDLE g_configWatchStop = NULL;
+
+// WebView2 call statistics (webview_stats.h); UI thread only
+static WvHistogram g_wvStats[WVS_COUNT];
+static WvTierStats g_wvTierStats[WVS_TIER_COUNT];
+static LARGE_INTEGER g_wvStatsFreq;
+static ULONGLONG g_wvStatsStartTick = 0;
+
 // Dynamic WebView2 loading
 static WCHAR g_extractedDllPath[MAX_PATH] = {0};
 typedef HRESULT (STDAPICALLTYPE *PFN_CreateCoreWebView2EnvironmentWithOptions)(
@@ -182,59 +301,94 @@ static PFN_CreateCoreWebView2EnvironmentWithOptions fnCreateEnvironment = NULL;
 
 // Forward declarations
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-void LoadConfiguration(const wchar_t* iniPath, Configuration* config);
 void CreateDefaultIni(const wchar_t* iniPath);
-void ParseConfigLine(wchar_t* line, Configuration* config);
-void ShowMainWindow(void);
-void HideMainWindow(void);
-void CreateTrayIcon(HWND hwnd);
-void ShowContextMenu(HWND hwnd);
-void RefreshTrayIcon(void);
+void ShowMainWindow(Site* site);
+void HideMainWindow(Site* site);
+void CreateTrayIcon(Site* site);
+void ShowContextMenu(Site* site);
+void RefreshTrayIcon(Site* site);
 void CaptureDisplaySettings(void);
 BOOL HasDisplaySettingsChanged(void);
 void DebugPrint(const wchar_t* format, ...);
-static void NormalizeSpellcheckLanguages(const wchar_t* in, wchar_t* out, size_t outLen);
-static void PatchSpellcheckPreferences(void);
+static void PatchProfilePreferences(void);
 static void GetMainUserDataFolder(wchar_t path[MAX_PATH]);
-static void CreateMainWebViewEnvironment(HWND hwnd);
+static void CreateMainWebViewEnvironment(void);
+static void CreateSiteWebView(Site* site);
+static BOOL IsWebViewCreatePending(void);
+static void CloseSiteWebView(Site* site);
 static void BeginMainWebViewRecreate(void);
-static void FinishMainWebViewRecreate(HWND hwnd);
-static void HandleUnexpectedBrowserExit(HWND hwnd);
-static void RebuildMainWebViewIfDead(void);
-static void KickWebViewAfterPowerResume(HWND hwnd);
-static void SendMainWebViewLivenessPing(void);
-static void CheckMainWebViewLiveness(HWND hwnd);
+static void FinishMainWebViewRecreate(void);
+static void HandleUnexpectedBrowserExit(void);
+static void ReleaseMainWebViewEnvironment(void);
+static void EndOpenCover(Site* site, HRESULT hr);
+static void DropSiteSnapshot(Site* site);
+static void RebuildMainWebViewIfDead(Site* site);
+static void SendMainWebViewLivenessPing(Site* site);
+static void CheckMainWebViewLiveness(Site* site);
+static void DispatchLifecycle(Site* site, LifecycleEvent event);
 static void RestartApplication(void);
+static void RemoveTrayIcons(void);
 static void RegisterBrowserExitedOnCurrentEnv(void);
 static void UnregisterBrowserExitedFromCurrentEnv(void);
-static void RegisterMainProcessFailedHandler(ICoreWebView2* webview2);
-void ReloadTargetPage(void);
-void ClearWebViewCacheAndReload(void);
-void ExecuteJavaScript(const wchar_t* js);
-static BOOL IsWebViewReady(void);
+static void RegisterMainProcessFailedHandler(Site* site, ICoreWebView2* webview2);
+void ReloadTargetPage(Site* site);
+void ClearWebViewCacheAndReload(Site* site);
+void ExecuteJavaScript(Site* site, const wchar_t* js);
+static void RegisterJsHooks(Site* site, BOOL defineNow);
+static void NavigateSite(Site* site, const wchar_t* url);
+static void SaveWebViewStats(void);
+static BOOL IsWebViewReady(Site* site);
 static BOOL IsWindowActuallyVisible(HWND hwnd);
-static void UpdateJsVisibilityState(HWND hwnd);
-static void StartVisibilityTimer(HWND hwnd);
-static void StopVisibilityTimer(HWND hwnd);
-static void ActivateMainWebView(void);
-static void DeactivateMainWebView(void);
-static void ResumeMainWebViewRuntime(void);
-static void SetMainWebViewControllerVisible(BOOL visible);
-static void PrewarmMainWebView(void);
-static void ResetTargetPageIfNeeded(void);
-static void OnMainNavigationCompleted(void);
-static void RegisterMainNavigationCompletedHandler(ICoreWebView2* webview2);
-static void RegisterMainNewWindowRequestedHandler(ICoreWebView2* webview2);
+static void UpdateJsVisibilityState(Site* site);
+static void ResetPartialVisibility(Site* site);
+static void BeginPartialCover(Site* site);
+static void EndPartialCover(Site* site);
+static void StartOcclusionTracking(Site* site);
+static void StopOcclusionTracking(Site* site);
+static void SyncMainWebViewBounds(Site* site);
+static void ResetTargetPageIfNeeded(Site* site);
+static void RegisterMainNavigationCompletedHandler(Site* site, ICoreWebView2* webview2);
+static void RegisterMainNewWindowRequestedHandler(Site* site, ICoreWebView2* webview2);
 static void GetTargetWindowRect(int* x, int* y, int* w, int* h);
 
 // Registry and config dialog functions
-static BOOL LoadConfigFromRegistry(Configuration* config);
-static BOOL SaveConfigToRegistry(const Configuration* config);
-static BOOL IsFirstLaunch(void);
-static void MarkAsConfigured(void);
-static void ApplyConfiguration(void);
+static void ApplyConfiguration(Site* site, DWORD changed);
+static void CommitConfiguration(Site* site, Configuration* next, DWORD changed);
+static void NormalizeConfigSpellcheckLanguages(Configuration* config);
+static void StartConfigWatcher(void);
+static void StopConfigWatcher(void);
 static BOOL load_webview2_loader(void);
-static void ShowConfigWebViewDialog(void);
+static void ShowConfigWebViewDialog(Site* site);
+
+// --- WebView2 call statistics ----------------------------------------------
+//
+// Wrap a cross-process call as
+//     LONGLONG t = wvstats_start();
+//     hr = ...->Call(...);
+//     wvstats_end(WVS_CALL, t, hr);
+// and keep t in the completion handler to time the async part the same way.
+// Costs two QueryPerformanceCounter reads per call.
+
+static LONGLONG wvstats_start(void) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+// Record a call that began at start; a start of 0 means "not timed".
+static void wvstats_end(WvStatKind kind, LONGLONG start, HRESULT hr) {
+    if (!start) return;
+    if (!g_wvStatsFreq.QuadPart) {
+        QueryPerformanceFrequency(&g_wvStatsFreq);
+        g_wvStatsStartTick = GetTickCount64();
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LONGLONG ticks = now.QuadPart > start ? now.QuadPart - start : 0;
+    uint64_t us = (uint64_t)ticks * 1000000u / (uint64_t)g_wvStatsFreq.QuadPart;
+    wvstats_record(&g_wvStats[kind], us, FAILED(hr));
+}
 
 // WebView2 Callbacks
 HRESULT STDMETHODCALLTYPE EnvCompletedHandler_QueryInterface(
@@ -251,7 +405,6 @@ HRESULT STDMETHODCALLTYPE EnvCompletedHandler_Invoke(
 typedef struct {
     ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
-    HWND hwnd;
     wchar_t* userDataPath;
 } EnvCompletedHandler;
 
@@ -269,7 +422,7 @@ HRESULT STDMETHODCALLTYPE ControllerCompletedHandler_Invoke(
 typedef struct {
     ICoreWebView2CreateCoreWebView2ControllerCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
-    HWND hwnd;
+    Site* site;
 } ControllerCompletedHandler;
 
 HRESULT STDMETHODCALLTYPE ClearBrowsingDataCompletedHandler_QueryInterface(
@@ -286,6 +439,7 @@ HRESULT STDMETHODCALLTYPE ClearBrowsingDataCompletedHandler_Invoke(
 typedef struct {
     ICoreWebView2ClearBrowsingDataCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
+    Site* site;
 } ClearBrowsingDataCompletedHandler;
 
 // ExecuteScript completion handler (fire-and-forget)
@@ -303,12 +457,24 @@ HRESULT STDMETHODCALLTYPE ExecuteScriptCompletedHandler_Invoke(
 typedef struct {
     ICoreWebView2ExecuteScriptCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
+    LONGLONG startQpc;  // Timed call (see wvstats_end); 0 for the config dialog
 } ExecuteScriptCompletedHandler;
 
 typedef struct {
     ICoreWebView2ExecuteScriptCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
-} LivenessPingHandler;
+    Site* site;
+    LONGLONG startQpc;
+} LivenessPingHandler;  // Also the open frame probe (FrameProbeHandler_Invoke)
+
+typedef struct {
+    ICoreWebView2CapturePreviewCompletedHandlerVtbl* lpVtbl;
+    LONG refCount;
+    Site* site;
+    IStream* stream;    // Receives the PNG
+    LONGLONG startQpc;
+    unsigned generation;  // site->snapshotGeneration when started
+} CapturePreviewHandler;
 
 // WebView suspend completion handler
 HRESULT STDMETHODCALLTYPE TrySuspendCompletedHandler_QueryInterface(
@@ -322,9 +488,31 @@ HRESULT STDMETHODCALLTYPE TrySuspendCompletedHandler_Invoke(
     ICoreWebView2TrySuspendCompletedHandler* This,
     HRESULT errorCode, BOOL result);
 
+// AddScriptToExecuteOnDocumentCreated completion handler (the JS hooks)
+HRESULT STDMETHODCALLTYPE AddScriptCompletedHandler_QueryInterface(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This,
+    REFIID riid, void** ppvObject);
+ULONG STDMETHODCALLTYPE AddScriptCompletedHandler_AddRef(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This);
+ULONG STDMETHODCALLTYPE AddScriptCompletedHandler_Release(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This);
+HRESULT STDMETHODCALLTYPE AddScriptCompletedHandler_Invoke(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This,
+    HRESULT errorCode, LPCWSTR id);
+
+typedef struct {
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandlerVtbl* lpVtbl;
+    LONG refCount;
+    Site* site;
+    ICoreWebView2* webView;  // The script's WebView; the site may have moved on
+    unsigned generation;     // site->jsHooksGeneration when registered
+} AddScriptCompletedHandler;
+
 typedef struct {
     ICoreWebView2TrySuspendCompletedHandlerVtbl* lpVtbl;
     LONG refCount;
+    Site* site;
+    LONGLONG startQpc;
 } TrySuspendCompletedHandler;
 
 // Navigation completed handler (settles the initial preload / sleep state)
@@ -342,89 +530,38 @@ HRESULT STDMETHODCALLTYPE NavCompletedHandler_Invoke(
 typedef struct {
     ICoreWebView2NavigationCompletedEventHandlerVtbl* lpVtbl;
     LONG refCount;
+    Site* site;
 } NavCompletedHandler;
 
 // Configuration functions
-void LoadConfiguration(const wchar_t* iniPath, Configuration* config) {
-    wcscpy_s(config->url, 2048, L"https://www.google.com/");
-    wcscpy_s(config->windowTitle, 256, L"Systray Launcher");
-    config->onHideJs[0] = L'\0';
-    config->onShowJs[0] = L'\0';
-    config->sleepWhenInactive = FALSE;
-    config->openNewWindowsExternally = FALSE;
-    config->spellcheckLanguages[0] = L'\0';
-
-    if (!PathFileExistsW(iniPath)) {
-        CreateDefaultIni(iniPath);
-        return;
-    }
 
-    FILE* file = NULL;
-    if (_wfopen_s(&file, iniPath, L"r, ccs=UTF-8") != 0 || !file) {
-        // Fallback: try ANSI
-        char pathA[MAX_PATH];
-        wcstombs(pathA, iniPath, MAX_PATH);
-        FILE* fileA = NULL;
-        if (fopen_s(&fileA, pathA, "r") == 0 && fileA) {
-            char lineA[4096];
-            while (fgets(lineA, sizeof(lineA), fileA)) {
-                wchar_t lineW[4096];
-                MultiByteToWideChar(CP_ACP, 0, lineA, -1, lineW, 4096);
-                ParseConfigLine(lineW, config);
-            }
-            fclose(fileA);
-        }
+static BOOL HasJsHooks(const Configuration* config) {
+    return config->onShowJs[0] != L'\0' || config->onHideJs[0] != L'\0';
+}
+
+// Parse a whole INI file image: skips a UTF-8 BOM and converts UTF-16 files
+// (as saved by Notepad's "Unicode" option) to UTF-8 first.
+static void ini_parse_file(const BYTE* data, size_t size, const char* profile, ConfigBuilder* b) {
+    if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+        ini_parse((const char*)data + 3, size - 3, profile, b);
         return;
     }
-
-    wchar_t line[4096];
-    while (fgetws(line, sizeof(line)/sizeof(wchar_t), file)) {
-        ParseConfigLine(line, config);
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        int wlen = (int)((size - 2) / sizeof(wchar_t));
+        const wchar_t* wtext = (const wchar_t*)(data + 2);
+        int n = wlen ? WideCharToMultiByte(CP_UTF8, 0, wtext, wlen, NULL, 0, NULL, NULL) : 0;
+        char* utf8 = (char*)malloc(n > 0 ? (size_t)n : 1);
+        if (!utf8) return;
+        if (n > 0) WideCharToMultiByte(CP_UTF8, 0, wtext, wlen, utf8, n, NULL, NULL);
+        ini_parse(utf8, n > 0 ? (size_t)n : 0, profile, b);
+        free(utf8);
+        return;
     }
-    fclose(file);
-}
-
-void ParseConfigLine(wchar_t* line, Configuration* config) {
-    while (iswspace(*line)) line++;
-    if (line[0] == L'#' || line[0] == L';' || line[0] == L'\0' || line[0] == L'\n') return;
-
-    wchar_t* equals = wcschr(line, L'=');
-    if (!equals) return;
-    *equals = L'\0';
-
-    wchar_t* key = line;
-    wchar_t* value = equals + 1;
-
-    // Trim key
-    while (iswspace(*key)) key++;
-    size_t keyLen = wcslen(key);
-    while (keyLen > 0 && iswspace(key[keyLen - 1])) key[--keyLen] = L'\0';
-    for (wchar_t* p = key; *p; ++p) *p = towlower(*p);
-
-    // Trim value
-    while (iswspace(*value)) value++;
-    size_t valLen = wcslen(value);
-    while (valLen > 0 && iswspace(value[valLen - 1])) value[--valLen] = L'\0';
-    if (valLen > 0 && value[valLen-1] == L'\n') value[--valLen] = L'\0';
-    if (valLen > 0 && value[valLen-1] == L'\r') value[--valLen] = L'\0';
-
-    if (wcscmp(key, L"url") == 0) {
-        wcscpy_s(config->url, 2048, value);
-    } else if (wcscmp(key, L"windowtitle") == 0) {
-        wcscpy_s(config->windowTitle, 256, value);
-    } else if (wcscmp(key, L"onhidejs") == 0) {
-        wcscpy_s(config->onHideJs, 4096, value);
-    } else if (wcscmp(key, L"onshowjs") == 0) {
-        wcscpy_s(config->onShowJs, 4096, value);
-    } else if (wcscmp(key, L"sleepwheninactive") == 0) {
-        wchar_t c = towlower(value[0]);
-        config->sleepWhenInactive = (c == L'1' || c == L't' || c == L'y');
-    } else if (wcscmp(key, L"spellchecklanguages") == 0) {
-        wcscpy_s(config->spellcheckLanguages, 512, value);
-    } else if (wcscmp(key, L"opennewwindowsexternally") == 0) {
-        wchar_t c = towlower(value[0]);
-        config->openNewWindowsExternally = (c == L'1' || c == L't' || c == L'y');
+    if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+        DebugPrint(L"[WARNING] Ignoring big-endian UTF-16 INI file\n");
+        return;
     }
+    ini_parse((const char*)data, size, profile, b);
 }
 
 void CreateDefaultIni(const wchar_t* iniPath) {
@@ -440,163 +577,241 @@ void CreateDefaultIni(const wchar_t* iniPath) {
     }
 }
 
-// Registry functions
-static BOOL LoadConfigFromRegistry(Configuration* config) {
-    HKEY hKey;
-    LONG result = RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, KEY_READ, &hKey);
-    if (result != ERROR_SUCCESS) {
-        return FALSE;
-    }
-
-    DWORD dataSize;
-    DWORD dataType;
+// Config stores
 
-    // Load URL
-    dataSize = sizeof(config->url);
-    if (RegQueryValueExW(hKey, REG_VALUE_URL, NULL, &dataType, (LPBYTE)config->url, &dataSize) != ERROR_SUCCESS) {
-        wcscpy_s(config->url, 2048, L"https://www.google.com/");
-    }
-
-    // Load Window Title
-    dataSize = sizeof(config->windowTitle);
-    if (RegQueryValueExW(hKey, REG_VALUE_TITLE, NULL, &dataType, (LPBYTE)config->windowTitle, &dataSize) != ERROR_SUCCESS) {
-        wcscpy_s(config->windowTitle, 256, L"Systray Launcher");
+// Returns whether the key held any known value.
+static BOOL RegistryConfigStore_EnumValues(HKEY hKey, ConfigBuilder* b, BOOL* configured) {
+    DWORD maxName = 0, maxData = 0;
+    if (RegQueryInfoKeyW(hKey, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                         &maxName, &maxData, NULL, NULL) != ERROR_SUCCESS) {
+        return FALSE;
     }
-
-    // Load OnHideJS
-    dataSize = sizeof(config->onHideJs);
-    if (RegQueryValueExW(hKey, REG_VALUE_ONHIDEJS, NULL, &dataType, (LPBYTE)config->onHideJs, &dataSize) != ERROR_SUCCESS) {
-        config->onHideJs[0] = L'\0';
+    BOOL any = FALSE;
+    wchar_t* name = NULL;
+    BYTE* data = NULL;
+    BOOL grow = TRUE;
+    for (DWORD i = 0; ; ) {
+        if (grow) {
+            wchar_t* newName = (wchar_t*)realloc(name, (maxName + 1) * sizeof(wchar_t));
+            if (newName) name = newName;
+            BYTE* newData = (BYTE*)realloc(data, maxData + sizeof(wchar_t));
+            if (newData) data = newData;
+            if (!newName || !newData) break;
+            grow = FALSE;
+        }
+        DWORD nameLen = maxName + 1;
+        DWORD size = maxData;
+        DWORD type = 0;
+        LONG result = RegEnumValueW(hKey, i, name, &nameLen, NULL, &type, data, &size);
+        if (result == ERROR_MORE_DATA) {
+            // A value grew since RegQueryInfoKeyW
+            maxName = maxName * 2 + 64;
+            maxData = size > maxData ? size : maxData * 2 + 64;
+            grow = TRUE;
+            continue;
+        }
+        if (result != ERROR_SUCCESS) break;  // ERROR_NO_MORE_ITEMS
+        int value = config_value_lookup(name);
+        if (value >= 0) {
+            config_builder_put(b, value, type, data, size, configured);
+            any = TRUE;
+        }
+        i++;
     }
+    free(name);
+    free(data);
+    return any;
+}
 
-    // Load OnShowJS
-    dataSize = sizeof(config->onShowJs);
-    if (RegQueryValueExW(hKey, REG_VALUE_ONSHOWJS, NULL, &dataType, (LPBYTE)config->onShowJs, &dataSize) != ERROR_SUCCESS) {
-        config->onShowJs[0] = L'\0';
+static BOOL RegistryConfigStore_Load(ConfigStore* This, ConfigBuilder* b, BOOL* configured) {
+    RegistryConfigStore* store = (RegistryConfigStore*)This;
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, store->keyPath, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+        return FALSE;
     }
 
-    // Load SleepWhenInactive (default disabled)
-    DWORD sleepVal = 0;
-    dataSize = sizeof(sleepVal);
-    if (RegQueryValueExW(hKey, REG_VALUE_SLEEP, NULL, &dataType, (LPBYTE)&sleepVal, &dataSize) == ERROR_SUCCESS) {
-        config->sleepWhenInactive = (sleepVal != 0);
-    } else {
-        config->sleepWhenInactive = FALSE;
+    // Once the first save has written every value, a single
+    // RegQueryMultipleValuesW call reads them all. It fails as a whole when
+    // one is missing (older installs, hand-made keys); enumerating the key
+    // once covers that. A key holding none of them loads as no settings, so
+    // the caller falls back to the INI file.
+    VALENTW vals[CFG_VALUE_COUNT];
+    for (int i = 0; i < CFG_VALUE_COUNT; i++) {
+        vals[i].ve_valuename = (LPWSTR)k_cfgValueNames[i];
     }
-
-    // Load OpenNewWindowsExternally (default disabled)
-    DWORD newWinVal = 0;
-    dataSize = sizeof(newWinVal);
-    if (RegQueryValueExW(hKey, REG_VALUE_NEWWINDOW, NULL, &dataType, (LPBYTE)&newWinVal, &dataSize) == ERROR_SUCCESS) {
-        config->openNewWindowsExternally = (newWinVal != 0);
-    } else {
-        config->openNewWindowsExternally = FALSE;
+    DWORD bufSize = 4096;
+    BYTE* buf = NULL;
+    LONG result;
+    for (;;) {
+        BYTE* grown = (BYTE*)realloc(buf, bufSize);
+        if (!grown) {
+            result = ERROR_OUTOFMEMORY;
+            break;
+        }
+        buf = grown;
+        DWORD size = bufSize;
+        result = RegQueryMultipleValuesW(hKey, vals, CFG_VALUE_COUNT, (LPWSTR)buf, &size);
+        if (result != ERROR_MORE_DATA || size <= bufSize) break;
+        bufSize = size;
     }
-
-    // Load SpellcheckLanguages (empty = spell-check settings not managed)
-    dataSize = sizeof(config->spellcheckLanguages);
-    if (RegQueryValueExW(hKey, REG_VALUE_SPELLCHECK, NULL, &dataType, (LPBYTE)config->spellcheckLanguages, &dataSize) != ERROR_SUCCESS) {
-        config->spellcheckLanguages[0] = L'\0';
+    BOOL any;
+    if (result == ERROR_SUCCESS) {
+        for (int i = 0; i < CFG_VALUE_COUNT; i++) {
+            config_builder_put(b, i, vals[i].ve_type, (const BYTE*)vals[i].ve_valueptr,
+                               vals[i].ve_valuelen, configured);
+        }
+        any = TRUE;
     } else {
-        // REG_SZ data is not guaranteed to be null-terminated
-        config->spellcheckLanguages[511] = L'\0';
+        any = RegistryConfigStore_EnumValues(hKey, b, configured);
     }
-
+    free(buf);
     RegCloseKey(hKey);
-    return TRUE;
+    return any;
+}
+
+static LONG RegistryConfigStore_WriteValue(void* ctx, const wchar_t* name, DWORD type,
+                                           const BYTE* data, DWORD size) {
+    return RegSetValueExW((HKEY)ctx, name, 0, type, data, size);
 }
 
-static BOOL SaveConfigToRegistry(const Configuration* config) {
+static BOOL RegistryConfigStore_Save(ConfigStore* This, const Configuration* config, DWORD changed) {
+    RegistryConfigStore* store = (RegistryConfigStore*)This;
+    if (!changed) return TRUE;
+
     HKEY hKey;
     DWORD disposition;
-    LONG result = RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL,
+    LONG result = RegCreateKeyExW(HKEY_CURRENT_USER, store->keyPath, 0, NULL,
                                    REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, &disposition);
     if (result != ERROR_SUCCESS) {
         return FALSE;
     }
+    BOOL ok = config_write_values(config, changed, RegistryConfigStore_WriteValue, hKey);
+    RegCloseKey(hKey);
+    return ok;
+}
 
-    // Save URL
-    RegSetValueExW(hKey, REG_VALUE_URL, 0, REG_SZ,
-                   (const BYTE*)config->url, (DWORD)((wcslen(config->url) + 1) * sizeof(wchar_t)));
-
-    // Save Window Title
-    RegSetValueExW(hKey, REG_VALUE_TITLE, 0, REG_SZ,
-                   (const BYTE*)config->windowTitle, (DWORD)((wcslen(config->windowTitle) + 1) * sizeof(wchar_t)));
+static void RegistryConfigStore_MarkConfigured(ConfigStore* This) {
+    RegistryConfigStore* store = (RegistryConfigStore*)This;
+    HKEY hKey;
+    DWORD disposition;
+    LONG result = RegCreateKeyExW(HKEY_CURRENT_USER, store->keyPath, 0, NULL,
+                                   REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, &disposition);
+    if (result == ERROR_SUCCESS) {
+        DWORD configured = 1;
+        RegSetValueExW(hKey, REG_VALUE_CONFIGURED, 0, REG_DWORD, (const BYTE*)&configured, sizeof(configured));
+        RegCloseKey(hKey);
+    }
+}
 
-    // Save OnHideJS
-    RegSetValueExW(hKey, REG_VALUE_ONHIDEJS, 0, REG_SZ,
-                   (const BYTE*)config->onHideJs, (DWORD)((wcslen(config->onHideJs) + 1) * sizeof(wchar_t)));
+static const ConfigStoreVtbl k_registryConfigStoreVtbl = {
+    RegistryConfigStore_Load,
+    RegistryConfigStore_Save,
+    RegistryConfigStore_MarkConfigured
+};
 
-    // Save OnShowJS
-    RegSetValueExW(hKey, REG_VALUE_ONSHOWJS, 0, REG_SZ,
-                   (const BYTE*)config->onShowJs, (DWORD)((wcslen(config->onShowJs) + 1) * sizeof(wchar_t)));
+// The primary site is configured at HKCU\SOFTWARE\JPIT\SystrayLauncher
+// (site NULL or empty), another one at ...\SystrayLauncher\Sites\<site>.
+static void RegistryConfigStore_Init(RegistryConfigStore* store, const wchar_t* site) {
+    store->base.lpVtbl = &k_registryConfigStoreVtbl;
+    if (site && site[0]) {
+        swprintf_s(store->keyPath, MAX_PATH, L"%s\\%s\\%s", REG_KEY_PATH, REG_SITES_SUBKEY, site);
+    } else {
+        wcscpy_s(store->keyPath, MAX_PATH, REG_KEY_PATH);
+    }
+}
 
-    // Save SleepWhenInactive
-    DWORD sleepVal = config->sleepWhenInactive ? 1 : 0;
-    RegSetValueExW(hKey, REG_VALUE_SLEEP, 0, REG_DWORD,
-                   (const BYTE*)&sleepVal, sizeof(sleepVal));
+// INI file backend (SystrayLauncher.ini next to the executable). Read-only:
+// it seeds the first launch and migrations, while saves go to the registry.
+// The file is mapped and parsed in place; a missing file is created with the
+// defaults. profile selects the [profile NAME] section read with the other
+// keys (see ini_parse).
+#define INI_FILE_MAX (16 * 1024 * 1024)
 
-    // Save OpenNewWindowsExternally
-    DWORD newWinVal = config->openNewWindowsExternally ? 1 : 0;
-    RegSetValueExW(hKey, REG_VALUE_NEWWINDOW, 0, REG_DWORD,
-                   (const BYTE*)&newWinVal, sizeof(newWinVal));
+typedef struct {
+    ConfigStore base;
+    const wchar_t* path;
+    const wchar_t* profile;  // NULL = no profile section
+} FileConfigStore;
+
+static BOOL FileConfigStore_Load(ConfigStore* This, ConfigBuilder* b, BOOL* configured) {
+    (void)configured;
+    FileConfigStore* store = (FileConfigStore*)This;
+    if (!PathFileExistsW(store->path)) {
+        CreateDefaultIni(store->path);
+        return TRUE;
+    }
 
-    // Save SpellcheckLanguages
-    RegSetValueExW(hKey, REG_VALUE_SPELLCHECK, 0, REG_SZ,
-                   (const BYTE*)config->spellcheckLanguages,
-                   (DWORD)((wcslen(config->spellcheckLanguages) + 1) * sizeof(wchar_t)));
+    char profile[256];
+    if (store->profile &&
+        WideCharToMultiByte(CP_UTF8, 0, store->profile, -1, profile, sizeof(profile), NULL, NULL) <= 0) {
+        return TRUE;
+    }
 
-    RegCloseKey(hKey);
+    HANDLE file = CreateFileW(store->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return TRUE;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || size.QuadPart > INI_FILE_MAX) {
+        if (size.QuadPart > INI_FILE_MAX) DebugPrint(L"[WARNING] Ignoring oversized INI file\n");
+        CloseHandle(file);
+        return TRUE;
+    }
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const BYTE* view = mapping ? (const BYTE*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view) {
+        ini_parse_file(view, (size_t)size.QuadPart, store->profile ? profile : NULL, b);
+        UnmapViewOfFile(view);
+    }
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
     return TRUE;
 }
 
-static BOOL IsFirstLaunch(void) {
-    HKEY hKey;
-    LONG result = RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, KEY_READ, &hKey);
-    if (result != ERROR_SUCCESS) {
-        return TRUE;  // Key doesn't exist = first launch
-    }
-
-    DWORD configured = 0;
-    DWORD dataSize = sizeof(configured);
-    result = RegQueryValueExW(hKey, REG_VALUE_CONFIGURED, NULL, NULL, (LPBYTE)&configured, &dataSize);
-    RegCloseKey(hKey);
-
-    return (result != ERROR_SUCCESS || configured == 0);
+static BOOL FileConfigStore_Save(ConfigStore* This, const Configuration* config, DWORD changed) {
+    (void)This; (void)config;
+    return changed == 0;
 }
 
-static void MarkAsConfigured(void) {
-    HKEY hKey;
-    DWORD disposition;
-    LONG result = RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL,
-                                   REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, &disposition);
-    if (result == ERROR_SUCCESS) {
-        DWORD configured = 1;
-        RegSetValueExW(hKey, REG_VALUE_CONFIGURED, 0, REG_DWORD, (const BYTE*)&configured, sizeof(configured));
-        RegCloseKey(hKey);
-    }
+static void FileConfigStore_MarkConfigured(ConfigStore* This) {
+    (void)This;
 }
 
-static void ApplyConfiguration(void) {
-    // Update initial URL
-    wcscpy_s(g_initialUrl, 2048, g_config.url);
+static const ConfigStoreVtbl k_fileConfigStoreVtbl = {
+    FileConfigStore_Load,
+    FileConfigStore_Save,
+    FileConfigStore_MarkConfigured
+};
+
+static void FileConfigStore_Init(FileConfigStore* store, const wchar_t* path, const wchar_t* profile) {
+    store->base.lpVtbl = &k_fileConfigStoreVtbl;
+    store->path = path;
+    store->profile = profile;
+}
 
-    // Sync the "sleep when inactive" setting
-    InterlockedExchange(&g_sleepWhenInactive, g_config.sleepWhenInactive ? TRUE : FALSE);
+// Push the settings selected by changed (CFG_CHANGED_* bits) to the parts of
+// the site that depend on them. Settings that are only read at browser start
+// (spell-check, managed prefs) need nothing here, so an unrelated edit never
+// touches the WebView.
+static void ApplyConfiguration(Site* site, DWORD changed) {
+    const Configuration* config = &site->config;
 
     // Sync the new-window handling setting (read live by the handler, so a
     // toggle applies without restarting the WebView)
-    InterlockedExchange(&g_openNewWindowsExternally, g_config.openNewWindowsExternally ? TRUE : FALSE);
-
-    // Update window title
-    if (g_hwnd) {
-        SetWindowTextW(g_hwnd, g_config.windowTitle);
+    if (changed & CFG_CHANGED_OPEN_NEW_WINDOWS_EXTERNALLY) {
+        InterlockedExchange(&site->openNewWindowsExternally, config->openNewWindowsExternally ? TRUE : FALSE);
     }
 
-    // Update tray icon tooltip
-    if (g_nid.hWnd) {
-        wcscpy_s(g_nid.szTip, sizeof(g_nid.szTip)/sizeof(wchar_t), g_config.windowTitle);
-        Shell_NotifyIconW(NIM_MODIFY, &g_nid);
+    if (changed & CFG_CHANGED_WINDOW_TITLE) {
+        // Update window title
+        if (site->hwnd) {
+            SetWindowTextW(site->hwnd, config->windowTitle);
+        }
+
+        // Update tray icon tooltip
+        if (site->nid.hWnd) {
+            wcsncpy_s(site->nid.szTip, sizeof(site->nid.szTip)/sizeof(wchar_t), config->windowTitle, _TRUNCATE);
+            Shell_NotifyIconW(NIM_MODIFY, &site->nid);
+        }
     }
 
     // Navigate to the new URL right away when the window is visible. When it
@@ -604,24 +819,199 @@ static void ApplyConfiguration(void) {
     // preload still holds the previous page, and the flag is otherwise only
     // set by hide transitions - without it, the first Open after saving a new
     // URL (before the window was ever shown) would present the stale page.
-    if (g_webView && g_hwnd) {
-        if (IsWindowVisible(g_hwnd)) {
-            g_webView->lpVtbl->Navigate(g_webView, g_config.url);
+    if (changed & CFG_CHANGED_URL) DropSiteSnapshot(site);
+    if ((changed & CFG_CHANGED_URL) && site->webView && site->hwnd) {
+        if (IsWindowVisible(site->hwnd)) {
+            NavigateSite(site, config->url);
         } else {
-            InterlockedExchange(&g_resetUrlOnNextShow, TRUE);
+            InterlockedExchange(&site->resetUrlOnNextShow, TRUE);
         }
     }
 
-    // Re-apply the correct active/sleep state for the (possibly changed)
-    // setting: disabling sleep while hidden wakes the runtime back up;
-    // enabling it suspends the already-loaded page.
-    if (g_hwnd && IsWebViewReady()) {
-        if (IsWindowActuallyVisible(g_hwnd)) {
-            ActivateMainWebView();
-        } else {
-            DeactivateMainWebView();
+    // Sync the "sleep when inactive" setting and re-apply the matching
+    // active/sleep state: disabling sleep while hidden wakes the runtime
+    // back up; enabling it suspends the already-loaded page.
+    if (changed & CFG_CHANGED_SLEEP_WHEN_INACTIVE) {
+        site->lifecycle.sleep = config->sleepWhenInactive ? 1 : 0;
+        DispatchLifecycle(site, LC_EVENT_SLEEP_CHANGED);
+    }
+
+    // A tier already running keeps its dwell time; the new delays apply from
+    // the next step down.
+    if (changed & CFG_CHANGED_SUSPEND_DELAY) {
+        site->lifecycle.grace = config->suspendDelay > 0;
+    }
+
+    // Turning the discard off cancels one that is pending; a new time
+    // applies from the next suspend.
+    if ((changed & CFG_CHANGED_DISCARD_AFTER) && !config->discardAfter && site->hwnd) {
+        KillTimer(site->hwnd, ID_TIMER_WEBVIEW_DISCARD);
+    }
+
+    // New hooks replace the old ones in the current page as well as in those
+    // loaded later; they run from the next transition.
+    if (changed & (CFG_CHANGED_ON_HIDE_JS | CFG_CHANGED_ON_SHOW_JS)) {
+        RegisterJsHooks(site, TRUE);
+    }
+
+    // A new partial-visibility policy starts its delay over; turning it off
+    // brings a page it throttled back.
+    if ((changed & (CFG_CHANGED_PARTIAL_PERCENT | CFG_CHANGED_PARTIAL_DELAY)) && site->hwnd) {
+        ResetPartialVisibility(site);
+        UpdateJsVisibilityState(site);
+    }
+}
+
+// Make next the site's live configuration (taking over its reference) and
+// apply the changed settings. Shared by the config dialog and the registry
+// watcher.
+static void CommitConfiguration(Site* site, Configuration* next, DWORD changed) {
+    config_release(&site->config);
+    site->config = *next;
+    next->blob = NULL;
+    ApplyConfiguration(site, changed);
+
+    // Spell-check languages are only read when the browser process starts,
+    // so a change needs the WebViews rebuilt. They are a setting of the
+    // shared profile, taken from the primary site. Prompt on its window's
+    // thread once the current message (e.g. the dialog's save) is done.
+    if ((changed & CFG_CHANGED_SPELLCHECK_LANGUAGES) && site->index == 0 &&
+        site->hwnd && site->webViewController) {
+        PostMessageW(site->hwnd, WM_APP_SPELLCHECK_CHANGED, 0, 0);
+    }
+}
+
+// Sanitize hand-edited registry/INI languages so the JSON patch and Chromium
+// both see well-formed tags. The normalized list is never longer than the raw
+// one. Safe off the UI thread for a config that is not shared yet.
+static void NormalizeConfigSpellcheckLanguages(Configuration* config) {
+    size_t rawLen = config_str_len(config, CFG_STR_SPELLCHECK_LANGUAGES);
+    if (rawLen == 0) return;
+    ConfigBuilder b;
+    config_builder_init(&b, config);
+    wchar_t* langs = config_builder_reserve(&b, rawLen);
+    if (langs) {
+        config_normalize_languages(config->spellcheckLanguages, langs, rawLen + 1);
+        config_builder_commit(&b, CFG_STR_SPELLCHECK_LANGUAGES, wcslen(langs));
+    }
+    config_builder_finish(&b, config);
+}
+
+typedef struct {
+    int count;
+    struct {
+        HWND hwnd;
+        ConfigStore* store;
+        Configuration seen;  // Last configuration read (or handed over at start)
+    } site[SITE_MAX];
+} ConfigWatch;
+
+// Wait for change notifications on the settings key (site subkeys included)
+// without polling. Each notification re-arms the watch and restarts the
+// settle timeout, so a burst of writes (a policy push touches several values)
+// is read once. Every site is re-read then, and only a read that differs from
+// that site's previous one is posted to its window, which diffs it against
+// the live settings - our own saves end up as no-ops there.
+static DWORD WINAPI ConfigWatchThreadProc(LPVOID param) {
+    ConfigWatch* watch = (ConfigWatch*)param;
+    HKEY hKey = NULL;
+    HANDLE changeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    // Create the key if need be: a first run configured only through the INI
+    // file has none yet, and settings written there later must still apply.
+    LONG result = changeEvent ? RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL,
+                                                REG_OPTION_NON_VOLATILE, KEY_NOTIFY, NULL,
+                                                &hKey, NULL)
+                              : ERROR_OUTOFMEMORY;
+    if (result != ERROR_SUCCESS) {
+        hKey = NULL;
+        DebugPrint(L"[WARNING] Registry watcher could not open the settings key (%ld); live reload off\n",
+                   result);
+    } else {
+        HANDLE waits[2] = { g_configWatchStop, changeEvent };
+        BOOL armed = FALSE;
+        BOOL pending = FALSE;
+        for (;;) {
+            if (!armed) {
+                if (RegNotifyChangeKeyValue(hKey, TRUE,
+                        REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                        changeEvent, TRUE) != ERROR_SUCCESS) {
+                    DebugPrint(L"[WARNING] Registry watcher could not re-arm; live reload stopped\n");
+                    break;
+                }
+                armed = TRUE;
+            }
+            DWORD wait = WaitForMultipleObjects(2, waits, FALSE,
+                                                pending ? CONFIG_WATCH_SETTLE_MS : INFINITE);
+            if (wait == WAIT_OBJECT_0 + 1) {
+                armed = FALSE;  // A notification fires once
+                pending = TRUE;
+                continue;
+            }
+            if (wait != WAIT_TIMEOUT) break;  // Stop requested
+            pending = FALSE;
+
+            for (int i = 0; i < watch->count; i++) {
+                Configuration next = {0};
+                if (!config_store_load(watch->site[i].store, &next, NULL)) continue;
+                NormalizeConfigSpellcheckLanguages(&next);
+                DWORD changed = config_diff(&watch->site[i].seen, &next);
+                if (!changed) {
+                    config_release(&next);
+                    continue;
+                }
+                config_release(&watch->site[i].seen);
+                config_snapshot(&watch->site[i].seen, &next);
+
+                Configuration* post = (Configuration*)malloc(sizeof(Configuration));
+                if (post) *post = next;
+                if (!post || !PostMessageW(watch->site[i].hwnd, WM_APP_CONFIG_CHANGED, 0, (LPARAM)post)) {
+                    config_release(&next);
+                    free(post);
+                }
+            }
         }
     }
+    if (hKey) RegCloseKey(hKey);
+    if (changeEvent) CloseHandle(changeEvent);
+    for (int i = 0; i < watch->count; i++) config_release(&watch->site[i].seen);
+    free(watch);
+    return 0;
+}
+
+// Start watching the settings key; each site's changes are posted to its
+// window. Sites added or removed while running apply at the next start.
+static void StartConfigWatcher(void) {
+    if (g_configWatchThread) return;
+    ConfigWatch* watch = (ConfigWatch*)calloc(1, sizeof(ConfigWatch));
+    if (!watch) return;
+    for (int i = 0; i < g_siteCount; i++) {
+        watch->site[i].hwnd = g_sites[i].hwnd;
+        watch->site[i].store = g_sites[i].store;
+        config_snapshot(&watch->site[i].seen, &g_sites[i].config);
+    }
+    watch->count = g_siteCount;
+
+    g_configWatchStop = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (g_configWatchStop) {
+        g_configWatchThread = CreateThread(NULL, 0, ConfigWatchThreadProc, watch, 0, NULL);
+    }
+    if (!g_configWatchThread) {
+        DebugPrint(L"[WARNING] Could not start the registry watcher\n");
+        if (g_configWatchStop) CloseHandle(g_configWatchStop);
+        g_configWatchStop = NULL;
+        for (int i = 0; i < watch->count; i++) config_release(&watch->site[i].seen);
+        free(watch);
+    }
+}
+
+static void StopConfigWatcher(void) {
+    if (!g_configWatchThread) return;
+    SetEvent(g_configWatchStop);
+    WaitForSingleObject(g_configWatchThread, 5000);
+    CloseHandle(g_configWatchThread);
+    CloseHandle(g_configWatchStop);
+    g_configWatchThread = NULL;
+    g_configWatchStop = NULL;
 }
 
 // Dynamic WebView2 loader extraction
@@ -658,51 +1048,6 @@ static BOOL load_webview2_loader(void) {
 }
 
 // JSON helpers
-static BOOL json_get_string(const char *json, const char *key, char *out, size_t outLen) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\"", key);
-    const char *p = strstr(json, search);
-    if (!p) return FALSE;
-    p += strlen(search);
-    while (*p == ' ' || *p == ':') p++;
-    if (*p != '"') return FALSE;
-    p++;
-    size_t i = 0;
-    while (*p && i < outLen - 1) {
-        if (*p == '"') break;
-        if (*p == '\\' && *(p + 1)) {
-            p++;
-            switch (*p) {
-                case '"':  out[i++] = '"';  break;
-                case '\\': out[i++] = '\\'; break;
-                case 'n':  out[i++] = '\n'; break;
-                case 'r':  out[i++] = '\r'; break;
-                case 't':  out[i++] = '\t'; break;
-                default:   out[i++] = *p;   break;
-            }
-        } else {
-            out[i++] = *p;
-        }
-        p++;
-    }
-    out[i] = '\0';
-    return TRUE;
-}
-
-static BOOL json_get_bool(const char *json, const char *key, BOOL defVal) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\"", key);
-    const char *p = strstr(json, search);
-    if (!p) return defVal;
-    p += strlen(search);
-    while (*p == ' ' || *p == ':') p++;
-    if (strncmp(p, "true", 4) == 0) return TRUE;
-    if (strncmp(p, "false", 5) == 0) return FALSE;
-    if (*p == '1') return TRUE;
-    if (*p == '0') return FALSE;
-    return defVal;
-}
-
 static void json_escape_wstring(const wchar_t *in, wchar_t *out, size_t outLen) {
     size_t j = 0;
     for (size_t i = 0; in[i] && j < outLen - 2; i++) {
@@ -785,27 +1130,42 @@ static void cfg_sync_controller_bounds(void) {
 }
 
 static void webview_push_init_config(void) {
-    wchar_t eUrl[4096], eTitle[512], eHide[8192], eShow[8192], eSpell[1024];
-    json_escape_wstring(g_config.url, eUrl, 4096);
-    json_escape_wstring(g_config.windowTitle, eTitle, 512);
-    json_escape_wstring(g_config.onHideJs, eHide, 8192);
-    json_escape_wstring(g_config.onShowJs, eShow, 8192);
-    json_escape_wstring(g_config.spellcheckLanguages, eSpell, 1024);
-
-    // Sized for every field at maximum, fully escaped, plus the JSON scaffold.
-    // A fixed 16K buffer used to silently truncate the script for large JS
-    // hooks, which broke onInit and left the dialog blank.
-    const size_t scriptCch = 4096 + 512 + 8192 + 8192 + 1024 + 256;
-    wchar_t* script = (wchar_t*)malloc(scriptCch * sizeof(wchar_t));
-    if (!script) return;
+    if (!g_cfgSite) return;
+    const Configuration* config = &g_cfgSite->config;
+
+    // Escaping at most doubles each field, so one allocation sized from the
+    // actual lengths holds the escaped fields and the script around them.
+    static const CfgStr fields[] = {
+        CFG_STR_URL, CFG_STR_WINDOW_TITLE, CFG_STR_ON_HIDE_JS, CFG_STR_ON_SHOW_JS,
+        CFG_STR_SPELLCHECK_LANGUAGES
+    };
+    enum { FIELD_COUNT = sizeof(fields) / sizeof(fields[0]) };
+    size_t escCch[FIELD_COUNT];
+    size_t total = 0;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        escCch[i] = config_str_len(config, fields[i]) * 2 + 2;
+        total += escCch[i];
+    }
+    const size_t scriptCch = total + 256;
+    wchar_t* mem = (wchar_t*)malloc((total + scriptCch) * sizeof(wchar_t));
+    if (!mem) return;
+    wchar_t* esc[FIELD_COUNT];
+    wchar_t* p = mem;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        esc[i] = p;
+        json_escape_wstring(config_str(config, fields[i]), esc[i], escCch[i]);
+        p += escCch[i];
+    }
+
+    wchar_t* script = p;
     int written = swprintf(script, scriptCch,
-        L"window.onInit({\"config\":{\"url\":\"%s\",\"windowTitle\":\"%s\",\"onHideJs\":\"%s\",\"onShowJs\":\"%s\",\"sleepWhenInactive\":%s,\"spellcheckLanguages\":\"%s\",\"openNewWindowsExternally\":%s}})",
-        eUrl, eTitle, eHide, eShow, g_config.sleepWhenInactive ? L"true" : L"false", eSpell,
-        g_config.openNewWindowsExternally ? L"true" : L"false");
+        L"window.onInit({\"config\":{\"url\":\"%s\",\"windowTitle\":\"%s\",\"onHideJs\":\"%s\",\"onShowJs\":\"%s\",\"sleepWhenInactive\":%s,\"spellcheckLanguages\":\"%s\",\"openNewWindowsExternally\":%s,\"suspendDelay\":%lu}})",
+        esc[0], esc[1], esc[2], esc[3], config->sleepWhenInactive ? L"true" : L"false", esc[4],
+        config->openNewWindowsExternally ? L"true" : L"false", (unsigned long)config->suspendDelay);
     if (written > 0) {
         webview_cfg_execute_script(script);
     }
-    free(script);
+    free(mem);
 }
 
 // Minimal COM handler struct for config dialog (shared by all cfg handlers)
@@ -979,118 +1339,102 @@ static HRESULT STDMETHODCALLTYPE CfgMsgReceived_Invoke(
     args->lpVtbl->TryGetWebMessageAsString(args, &wMsg);
     if (!wMsg) return S_OK;
 
-    int len = WideCharToMultiByte(CP_UTF8, 0, wMsg, -1, NULL, 0, NULL, NULL);
-    char *msg = malloc(len);
-    WideCharToMultiByte(CP_UTF8, 0, wMsg, -1, msg, len, NULL, NULL);
-    CoTaskMemFree(wMsg);
-
-    char action[64] = {0};
-    json_get_string(msg, "action", action, sizeof(action));
-
-    if (strcmp(action, "getInit") == 0) {
-        webview_push_init_config();
-    } else if (strcmp(action, "saveSettings") == 0) {
-        char url[4096] = {0}, title[512] = {0}, hideJs[8192] = {0}, showJs[8192] = {0};
-        char spellLangs[512] = {0};
-        json_get_string(msg, "url", url, sizeof(url));
-        json_get_string(msg, "windowTitle", title, sizeof(title));
-        json_get_string(msg, "onHideJs", hideJs, sizeof(hideJs));
-        json_get_string(msg, "onShowJs", showJs, sizeof(showJs));
-        json_get_string(msg, "spellcheckLanguages", spellLangs, sizeof(spellLangs));
-
-        wchar_t prevSpellLangs[512];
-        wcscpy_s(prevSpellLangs, 512, g_config.spellcheckLanguages);
-
-        MultiByteToWideChar(CP_UTF8, 0, url, -1, g_config.url, 2048);
-        MultiByteToWideChar(CP_UTF8, 0, title, -1, g_config.windowTitle, 256);
-        MultiByteToWideChar(CP_UTF8, 0, hideJs, -1, g_config.onHideJs, 4096);
-        MultiByteToWideChar(CP_UTF8, 0, showJs, -1, g_config.onShowJs, 4096);
-        wchar_t rawSpellLangs[512] = {0};
-        MultiByteToWideChar(CP_UTF8, 0, spellLangs, -1, rawSpellLangs, 512);
-        NormalizeSpellcheckLanguages(rawSpellLangs, g_config.spellcheckLanguages, 512);
-        g_config.sleepWhenInactive = json_get_bool(msg, "sleepWhenInactive", FALSE);
-        g_config.openNewWindowsExternally = json_get_bool(msg, "openNewWindowsExternally", FALSE);
-
-        SaveConfigToRegistry(&g_config);
-        MarkAsConfigured();
-        ApplyConfiguration();
-
-        // Spell-check languages are only read when the browser process
-        // starts, so a change needs the main WebView rebuilt. Prompt on the
-        // main window's thread once this dialog has closed itself.
-        if (wcscmp(prevSpellLangs, g_config.spellcheckLanguages) != 0 &&
-            g_hwnd && g_webViewController) {
-            PostMessageW(g_hwnd, WM_APP_SPELLCHECK_CHANGED, 0, 0);
-        }
+    // The message table holds views into wMsg, so it is freed last.
+    WebMessage m;
+    MsgArena arena;
+    msg_arena_init(&arena);
+    if (!json_msg_parse(wMsg, wcslen(wMsg), &m)) {
+        DebugPrint(L"[WARNING] Ignoring malformed config dialog message\n");
+    }
 
-        g_cfgSaved = TRUE;
-        PostMessage(g_cfgHwnd, WM_CLOSE, 0, 0);
-    } else if (strcmp(action, "close") == 0) {
-        PostMessage(g_cfgHwnd, WM_CLOSE, 0, 0);
-    } else if (strcmp(action, "resize") == 0) {
-        char hStr[32] = {0};
-        json_get_string(msg, "height", hStr, sizeof(hStr));
-        int contentHeight = atoi(hStr);
-        if (contentHeight <= 0) {
-            // Try parsing as bare number (not quoted)
-            const char *hp = strstr(msg, "\"height\"");
-            if (hp) {
-                hp += 8;
-                while (*hp == ' ' || *hp == ':') hp++;
-                contentHeight = atoi(hp);
+    switch (json_msg_action(&m)) {
+        case CFG_ACTION_GET_INIT:
+            webview_push_init_config();
+            break;
+        case CFG_ACTION_SAVE_SETTINGS: {
+            Site* site = g_cfgSite;
+            if (!site) break;
+
+            // The site's config stays current until the result is committed.
+            Configuration next = {0};
+            if (!cfg_msg_settings(&m, &site->config, &arena, &next)) break;
+
+            // Only changed values are written, except on first launch when
+            // the store does not hold a configuration yet.
+            DWORD changed = config_diff(&site->config, &next);
+            site->store->lpVtbl->Save(site->store, &next, site->isConfigured ? changed : CFG_CHANGED_ALL);
+            if (!site->isConfigured) {
+                site->store->lpVtbl->MarkConfigured(site->store);
+                site->isConfigured = TRUE;
             }
+            CommitConfiguration(site, &next, changed);
+            DebugPrint(L"[INFO] Configuration saved (changed fields: 0x%02lx)\n", (unsigned long)changed);
+
+            g_cfgSaved = TRUE;
+            PostMessage(g_cfgHwnd, WM_CLOSE, 0, 0);
+            break;
         }
-        if (contentHeight > 0 && g_cfgHwnd) {
-            // The page reports its height in CSS pixels; convert to the
-            // physical pixels window sizes use.
-            int physHeight = MulDiv(contentHeight, (int)GetWindowDpi(g_cfgHwnd), 96);
-            RECT clientRect = {0}, windowRect = {0};
-            GetClientRect(g_cfgHwnd, &clientRect);
-            GetWindowRect(g_cfgHwnd, &windowRect);
-            int chromeH = (windowRect.bottom - windowRect.top) - (clientRect.bottom - clientRect.top);
-            int newWindowH = physHeight + chromeH;
-            int windowW = windowRect.right - windowRect.left;
-
-            // Keep the dialog inside the work area of its monitor. Sizing
-            // with SWP_NOMOVE kept the top edge where a 380px-tall window
-            // had been centered, so tall content grew past the bottom of
-            // the screen; clamp the size (the page scrolls when it cannot
-            // fit) and position the window explicitly.
-            MONITORINFO mi = { sizeof(mi) };
-            RECT work;
-            HMONITOR mon = MonitorFromWindow(g_cfgHwnd, MONITOR_DEFAULTTONEAREST);
-            if (!mon || !GetMonitorInfoW(mon, &mi)) {
-                SystemParametersInfoW(SPI_GETWORKAREA, 0, &work, 0);
-            } else {
-                work = mi.rcWork;
-            }
-            int workW = work.right - work.left;
-            int workH = work.bottom - work.top;
-            if (newWindowH > workH) newWindowH = workH;
-            if (windowW > workW) windowW = workW;
-
-            // Always center on the measured height, clamped into the work
-            // area. The page reports its height through a ResizeObserver
-            // that fires more than once (a short first measurement, then the
-            // real height): re-centering every time keeps the dialog
-            // centered instead of anchoring its top edge and letting later
-            // growth push it to the bottom of the screen.
-            int posX = work.left + (workW - windowW) / 2;
-            int posY = work.top + (workH - newWindowH) / 2;
-            UINT flags = SWP_NOZORDER;
-            if (g_cfgWindowShown) {
-                flags |= SWP_NOACTIVATE;
-            } else {
-                flags |= SWP_SHOWWINDOW;
-                KillTimer(g_cfgHwnd, ID_TIMER_CFG_SHOW_FALLBACK);
+        case CFG_ACTION_CLOSE:
+            PostMessage(g_cfgHwnd, WM_CLOSE, 0, 0);
+            break;
+        case CFG_ACTION_RESIZE: {
+            int contentHeight = json_msg_int(&m, MSG_FIELD_HEIGHT, 0);
+            if (contentHeight > 0 && g_cfgHwnd) {
+                // The page reports its height in CSS pixels; convert to the
+                // physical pixels window sizes use.
+                int physHeight = MulDiv(contentHeight, (int)GetWindowDpi(g_cfgHwnd), 96);
+                RECT clientRect = {0}, windowRect = {0};
+                GetClientRect(g_cfgHwnd, &clientRect);
+                GetWindowRect(g_cfgHwnd, &windowRect);
+                int chromeH = (windowRect.bottom - windowRect.top) - (clientRect.bottom - clientRect.top);
+                int newWindowH = physHeight + chromeH;
+                int windowW = windowRect.right - windowRect.left;
+
+                // Keep the dialog inside the work area of its monitor. Sizing
+                // with SWP_NOMOVE kept the top edge where a 380px-tall window
+                // had been centered, so tall content grew past the bottom of
+                // the screen; clamp the size (the page scrolls when it cannot
+                // fit) and position the window explicitly.
+                MONITORINFO mi = { sizeof(mi) };
+                RECT work;
+                HMONITOR mon = MonitorFromWindow(g_cfgHwnd, MONITOR_DEFAULTTONEAREST);
+                if (!mon || !GetMonitorInfoW(mon, &mi)) {
+                    SystemParametersInfoW(SPI_GETWORKAREA, 0, &work, 0);
+                } else {
+                    work = mi.rcWork;
+                }
+                int workW = work.right - work.left;
+                int workH = work.bottom - work.top;
+                if (newWindowH > workH) newWindowH = workH;
+                if (windowW > workW) windowW = workW;
+
+                // Always center on the measured height, clamped into the work
+                // area. The page reports its height through a ResizeObserver
+                // that fires more than once (a short first measurement, then the
+                // real height): re-centering every time keeps the dialog
+                // centered instead of anchoring its top edge and letting later
+                // growth push it to the bottom of the screen.
+                int posX = work.left + (workW - windowW) / 2;
+                int posY = work.top + (workH - newWindowH) / 2;
+                UINT flags = SWP_NOZORDER;
+                if (g_cfgWindowShown) {
+                    flags |= SWP_NOACTIVATE;
+                } else {
+                    flags |= SWP_SHOWWINDOW;
+                    KillTimer(g_cfgHwnd, ID_TIMER_CFG_SHOW_FALLBACK);
+                }
+                SetWindowPos(g_cfgHwnd, NULL, posX, posY, windowW, newWindowH, flags);
+                g_cfgWindowShown = TRUE;
+                cfg_sync_controller_bounds();
             }
-            SetWindowPos(g_cfgHwnd, NULL, posX, posY, windowW, newWindowH, flags);
-            g_cfgWindowShown = TRUE;
-            cfg_sync_controller_bounds();
+            break;
         }
+        default:
+            break;
     }
 
-    free(msg);
+    msg_arena_free(&arena);
+    CoTaskMemFree(wMsg);
     return S_OK;
 }
 
@@ -1156,6 +1500,7 @@ static LRESULT CALLBACK CfgWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 
         case WM_DESTROY:
             g_cfgHwnd = NULL;
+            g_cfgSite = NULL;
             g_cfgWindowShown = FALSE;
             KillTimer(hwnd, ID_TIMER_CFG_SHOW_FALLBACK);
             return 0;
@@ -1163,7 +1508,7 @@ static LRESULT CALLBACK CfgWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
     return DefWindowProcW(hwnd, msg, wParam, lParam);
 }
 
-static void ShowConfigWebViewDialog(void) {
+static void ShowConfigWebViewDialog(Site* site) {
     if (g_cfgHwnd != NULL) {
         SetForegroundWindow(g_cfgHwnd);
         return;
@@ -1206,12 +1551,18 @@ static void ShowConfigWebViewDialog(void) {
     int posX = workArea.left + ((workArea.right - workArea.left) - width) / 2;
     int posY = workArea.top + ((workArea.bottom - workArea.top) - height) / 2;
 
-    g_cfgHwnd = CreateWindowExW(0, L"SystrayLauncherCfgWnd", L"Configuration",
+    // With several sites, name the one being configured.
+    wchar_t title[160] = L"Configuration";
+    if (g_siteCount > 1) {
+        _snwprintf_s(title, 160, _TRUNCATE, L"Configuration - %s", site->config.windowTitle);
+    }
+    g_cfgHwnd = CreateWindowExW(0, L"SystrayLauncherCfgWnd", title,
         WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
         posX, posY, width, height,
         NULL, NULL, g_hInstance, NULL);
 
     if (!g_cfgHwnd) return;
+    g_cfgSite = site;
     g_cfgWindowShown = FALSE;
     g_cfgShowFallbackTries = 0;
     SetTimer(g_cfgHwnd, ID_TIMER_CFG_SHOW_FALLBACK, CFG_SHOW_FALLBACK_DELAY_MS, NULL);
@@ -1257,235 +1608,146 @@ static void ShowConfigWebViewDialog(void) {
 // prefs are written together.
 // ---------------------------------------------------------------------------
 
-// Normalize a comma-separated list of spell-check language tags: trim
-// whitespace, drop tokens with characters other than letters/digits/hyphens
-// (they would be invalid tags and must not reach the JSON patch), dedupe, and
-// fix the usual BCP-47 casing (en-us -> en-US, pt-br -> pt-BR) so the tags
-// match Chromium's dictionary names.
-static void NormalizeSpellcheckLanguages(const wchar_t* in, wchar_t* out, size_t outLen) {
-    size_t o = 0;
-    if (outLen == 0) return;
-    out[0] = L'\0';
-    if (!in) return;
-
-    const wchar_t* p = in;
-    while (*p) {
-        while (*p == L',' || *p == L';' || iswspace(*p)) p++;
-        if (!*p) break;
-
-        wchar_t token[32];
-        size_t t = 0;
-        BOOL valid = TRUE;
-        while (*p && *p != L',' && *p != L';' && !iswspace(*p)) {
-            wchar_t c = (*p == L'_') ? L'-' : *p;
-            if (!iswalnum(c) && c != L'-') valid = FALSE;
-            if (t < 31) token[t++] = c; else valid = FALSE;
-            p++;
-        }
-        token[t] = L'\0';
-        if (!valid || t == 0) continue;
-
-        // Casing per subtag: primary lowercase, 2-letter region UPPER,
-        // 4-letter script Titlecase.
-        size_t start = 0;
-        for (size_t i = 0; i <= t && valid; i++) {
-            if (token[i] == L'-' || token[i] == L'\0') {
-                size_t len = i - start;
-                if (len == 0) { valid = FALSE; break; }
-                if (start == 0) {
-                    for (size_t j = start; j < i; j++) token[j] = towlower(token[j]);
-                } else if (len == 2) {
-                    for (size_t j = start; j < i; j++) token[j] = towupper(token[j]);
-                } else if (len == 4) {
-                    token[start] = towupper(token[start]);
-                    for (size_t j = start + 1; j < i; j++) token[j] = towlower(token[j]);
-                } else {
-                    for (size_t j = start; j < i; j++) token[j] = towlower(token[j]);
-                }
-                start = i + 1;
-            }
-        }
-        if (!valid) continue;
-
-        // Skip duplicates
-        BOOL dup = FALSE;
-        const wchar_t* q = out;
-        while (*q) {
-            const wchar_t* e = wcschr(q, L',');
-            size_t len = e ? (size_t)(e - q) : wcslen(q);
-            if (len == t && wcsncmp(q, token, t) == 0) { dup = TRUE; break; }
-            q = e ? e + 1 : q + len;
-        }
-        if (dup) continue;
-
-        size_t need = t + (o > 0 ? 1 : 0);
-        if (o + need + 1 > outLen) break;
-        if (o > 0) out[o++] = L',';
-        wmemcpy(out + o, token, t);
-        o += t;
-        out[o] = L'\0';
-    }
-}
-
 static void GetMainUserDataFolder(wchar_t path[MAX_PATH]) {
     path[0] = L'\0';
     SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, path);
     PathAppendW(path, APP_NAME L"\\WebView2Data");
 }
 
-// --- Minimal JSON surgery (string- and nesting-aware, never guesses) -------
+// --- Patch fingerprint --------------------------------------------------------
+//
+// A sidecar next to the Preferences file records the file's size and
+// last-write time as of our last patch (or last check), a hash of its
+// content, and a hash of the edit set that was applied. The patch runs at
+// every startup and every WebView rebuild; when the file has not been touched
+// since and the edits are the same, the fingerprint alone proves the patch is
+// still in place and the multi-MB read is skipped. If the file was rewritten
+// but hashes the same, the parse is skipped. Any other mismatch, or a
+// missing/unreadable sidecar, falls back to the full patch. The patchers and
+// the hash are in prefs_json.h.
+
+#define PREFS_FINGERPRINT_SUFFIX L".stl_fp"
+#define PREFS_FINGERPRINT_MAGIC 0x32465053  // "SPF2"
 
-static const char* json_skip_ws(const char* p, const char* end) {
-    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
-    return p;
+typedef struct {
+    DWORD magic;
+    DWORD recordSize;
+    ULONGLONG fileSize;
+    FILETIME lastWrite;
+    ULONGLONG contentHash;
+    ULONGLONG editHash;
+} PrefsFingerprint;
+
+static BOOL GetPrefsFileStamp(const wchar_t* path, ULONGLONG* size, FILETIME* lastWrite) {
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) return FALSE;
+    *size = ((ULONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+    *lastWrite = fad.ftLastWriteTime;
+    return TRUE;
 }
 
-// p points at the opening quote; returns one past the closing quote.
-static const char* json_skip_string(const char* p, const char* end) {
-    p++;
-    while (p < end) {
-        if (*p == '\\') { p += 2; continue; }
-        if (*p == '"') return p + 1;
-        p++;
+static BOOL ReadPrefsFingerprint(const wchar_t* prefsPath, PrefsFingerprint* fp) {
+    wchar_t fpPath[MAX_PATH];
+    if (swprintf_s(fpPath, MAX_PATH, L"%s" PREFS_FINGERPRINT_SUFFIX, prefsPath) <= 0) return FALSE;
+    FILE* f = NULL;
+    if (_wfopen_s(&f, fpPath, L"rb") != 0 || !f) return FALSE;
+    size_t got = fread(fp, 1, sizeof(*fp), f);
+    fclose(f);
+    if (got != sizeof(*fp) || fp->magic != PREFS_FINGERPRINT_MAGIC ||
+        fp->recordSize != sizeof(*fp)) {
+        return FALSE;
     }
-    return NULL;
+    return TRUE;
 }
 
-// Returns one past the end of the value starting at p (string, object,
-// array, number, bool or null), or NULL if the input is malformed/truncated.
-static const char* json_skip_value(const char* p, const char* end) {
-    p = json_skip_ws(p, end);
-    if (p >= end) return NULL;
-    if (*p == '"') return json_skip_string(p, end);
-    if (*p == '{' || *p == '[') {
-        int depth = 0;
-        while (p < end) {
-            if (*p == '"') {
-                p = json_skip_string(p, end);
-                if (!p) return NULL;
-                continue;
-            }
-            if (*p == '{' || *p == '[') {
-                depth++;
-            } else if (*p == '}' || *p == ']') {
-                depth--;
-                if (depth == 0) return p + 1;
-            }
-            p++;
-        }
-        return NULL;
-    }
-    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
-           *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
-        p++;
+// Record the current state of the Preferences file (whose content hashes to
+// contentHash) as patched with the edit set that hashes to editHash.
+static void WritePrefsFingerprint(const wchar_t* prefsPath, ULONGLONG contentHash,
+                                  ULONGLONG editHash) {
+    PrefsFingerprint fp;
+    ZeroMemory(&fp, sizeof(fp));
+    fp.magic = PREFS_FINGERPRINT_MAGIC;
+    fp.recordSize = sizeof(fp);
+    fp.contentHash = contentHash;
+    fp.editHash = editHash;
+    if (!GetPrefsFileStamp(prefsPath, &fp.fileSize, &fp.lastWrite)) return;
+
+    wchar_t fpPath[MAX_PATH];
+    if (swprintf_s(fpPath, MAX_PATH, L"%s" PREFS_FINGERPRINT_SUFFIX, prefsPath) <= 0) return;
+    FILE* f = NULL;
+    if (_wfopen_s(&f, fpPath, L"wb") != 0 || !f) return;
+    size_t written = fwrite(&fp, 1, sizeof(fp), f);
+    fclose(f);
+    if (written != sizeof(fp)) DeleteFileW(fpPath);
+}
+
+// TRUE when the file still has the size and last-write time recorded in fp,
+// i.e. nobody has written it since our last patch or check.
+static BOOL PrefsFileStampMatches(const wchar_t* prefsPath, const PrefsFingerprint* fp) {
+    ULONGLONG size;
+    FILETIME lastWrite;
+    if (!GetPrefsFileStamp(prefsPath, &size, &lastWrite)) return FALSE;
+    return fp->fileSize == size && CompareFileTime(&fp->lastWrite, &lastWrite) == 0;
+}
+
+// Files up to this size are patched in memory (one read, one gather); larger
+// ones are streamed through the temp file with bounded memory.
+#define PREFS_IN_MEMORY_MAX (32 * 1024 * 1024)
+
+// Swap the fully written temp file in for the Preferences file.
+static void ReplacePreferencesFile(const wchar_t* tmpPath, const wchar_t* prefsPath,
+                                   ULONGLONG contentHash, ULONGLONG editHash) {
+    if (MoveFileExW(tmpPath, prefsPath, MOVEFILE_REPLACE_EXISTING)) {
+        WritePrefsFingerprint(prefsPath, contentHash, editHash);
+        DebugPrint(L"[INFO] Applied managed preferences to WebView2 profile (spell-check: %s)\n",
+                   g_sites[0].config.spellcheckLanguages);
+    } else {
+        DeleteFileW(tmpPath);
+        DebugPrint(L"[WARNING] Failed to update WebView2 Preferences file\n");
     }
-    return p;
 }
 
-// obj points at '{'. Looks up "key" among this object's own members (not in
-// nested objects). Returns the value start and sets *valEnd, or NULL.
-static const char* json_object_find(const char* obj, const char* end,
-                                    const char* key, const char** valEnd) {
-    if (obj >= end || *obj != '{') return NULL;
-    size_t klen = strlen(key);
-    const char* p = obj + 1;
-    for (;;) {
-        p = json_skip_ws(p, end);
-        if (p >= end || *p == '}') return NULL;
-        if (*p != '"') return NULL;
-        const char* ks = p + 1;
-        const char* kq = json_skip_string(p, end);
-        if (!kq) return NULL;
-        const char* ke = kq - 1;
-        p = json_skip_ws(kq, end);
-        if (p >= end || *p != ':') return NULL;
-        const char* vs = json_skip_ws(p + 1, end);
-        const char* ve = json_skip_value(vs, end);
-        if (!ve) return NULL;
-        if ((size_t)(ke - ks) == klen && strncmp(ks, key, klen) == 0) {
-            *valEnd = ve;
-            return vs;
-        }
-        p = json_skip_ws(ve, end);
-        if (p >= end) return NULL;
-        if (*p == ',') { p++; continue; }
-        return NULL;
+// Patch a Preferences file above PREFS_IN_MEMORY_MAX by streaming it into the
+// temp file. Takes ownership of f.
+static void PatchLargePreferences(FILE* f, const wchar_t* prefsPath, const wchar_t* tmpPath,
+                                  const JsonEdit* edits, int count, ULONGLONG editHash) {
+    FILE* wf = NULL;
+    if (_wfopen_s(&wf, tmpPath, L"wb") != 0 || !wf) {
+        fclose(f);
+        return;
+    }
+    int changed = 0;
+    uint64_t inHash = 0, outHash = 0;
+    BOOL ok = json_stream_apply_edits(f, wf, edits, count, &changed, &inHash, &outHash);
+    fclose(f);
+    if (fclose(wf) != 0) ok = FALSE;
+
+    if (!ok) {
+        DeleteFileW(tmpPath);
+        DebugPrint(L"[WARNING] Could not stream-patch WebView2 Preferences; patch skipped\n");
+    } else if (!changed) {
+        DeleteFileW(tmpPath);
+        DebugPrint(L"[INFO] Managed preferences already up to date\n");
+        WritePrefsFingerprint(prefsPath, inHash, editHash);
+    } else {
+        ReplacePreferencesFile(tmpPath, prefsPath, outHash, editHash);
     }
 }
 
-// Replace [from,to) in buf with insert; returns a new heap buffer.
-static char* str_splice(const char* buf, size_t len, const char* from,
-                        const char* to, const char* insert, size_t* newLen) {
-    size_t pre = (size_t)(from - buf);
-    size_t post = len - (size_t)(to - buf);
-    size_t ins = strlen(insert);
-    char* result = (char*)malloc(pre + ins + post + 1);
-    if (!result) return NULL;
-    memcpy(result, buf, pre);
-    memcpy(result + pre, insert, ins);
-    memcpy(result + pre + ins, to, post);
-    result[pre + ins + post] = '\0';
-    *newLen = pre + ins + post;
-    return result;
-}
-
-// Ensure root.<parentKey>.<childKey> == valueJson. Returns a new heap buffer
-// (and updates *newLen), or NULL when the document isn't a JSON object we can
-// understand - the caller then leaves the file untouched. New keys are
-// inserted at the end of their object so they win under Chromium's
-// last-key-wins JSON parsing even in pathological duplicate-key files.
-static char* json_set_nested(const char* json, size_t len,
-                             const char* parentKey, const char* childKey,
-                             const char* valueJson, size_t* newLen) {
-    const char* end = json + len;
-    const char* root = json_skip_ws(json, end);
-    if (root >= end || *root != '{') return NULL;
-    const char* rootEnd = json_skip_value(root, end);
-    if (!rootEnd) return NULL;
-
-    char insert[2048];
-    const char* pve = NULL;
-    const char* pv = json_object_find(root, rootEnd, parentKey, &pve);
-    if (pv && *pv == '{') {
-        const char* cve = NULL;
-        const char* cv = json_object_find(pv, pve, childKey, &cve);
-        if (cv) {
-            return str_splice(json, len, cv, cve, valueJson, newLen);
-        }
-        const char* inner = json_skip_ws(pv + 1, pve);
-        BOOL emptyObj = (inner < pve && *inner == '}');
-        snprintf(insert, sizeof(insert), "%s\"%s\":%s",
-                 emptyObj ? "" : ",", childKey, valueJson);
-        return str_splice(json, len, pve - 1, pve - 1, insert, newLen);
-    }
-    if (pv) {
-        // Parent exists but is not an object: replace it wholesale.
-        snprintf(insert, sizeof(insert), "{\"%s\":%s}", childKey, valueJson);
-        return str_splice(json, len, pv, pve, insert, newLen);
-    }
-    const char* innerRoot = json_skip_ws(root + 1, rootEnd);
-    BOOL rootEmpty = (innerRoot < rootEnd && *innerRoot == '}');
-    snprintf(insert, sizeof(insert), "%s\"%s\":{\"%s\":%s}",
-             rootEmpty ? "" : ",", parentKey, childKey, valueJson);
-    return str_splice(json, len, rootEnd - 1, rootEnd - 1, insert, newLen);
-}
-
-// Write the configured spell-check languages into the WebView2 profile's
-// Preferences file. Must only run while the browser process for the main
-// user data folder is not running (app startup, or after BrowserProcessExited).
-static void PatchSpellcheckPreferences(void) {
-    if (g_config.spellcheckLanguages[0] == L'\0') return;
+// Append the spell-check edits for the configured languages to edits[count..]
+// and return the new count. dictJson and acceptJson hold the values.
+static int AppendSpellcheckEdits(const Configuration* config, JsonEdit* edits, int count,
+                                 char dictJson[1200], char acceptJson[600]) {
+    if (config->spellcheckLanguages[0] == L'\0') return count;
 
     char langs[512];
-    if (WideCharToMultiByte(CP_UTF8, 0, g_config.spellcheckLanguages, -1,
+    if (WideCharToMultiByte(CP_UTF8, 0, config->spellcheckLanguages, -1,
                             langs, sizeof(langs), NULL, NULL) <= 0) {
-        return;
+        return count;
     }
 
     // "en-US,pl" -> ["en-US","pl"] for spellcheck.dictionaries, and a quoted
     // string for intl.accept_languages / intl.selected_languages.
-    char dictJson[1200];
-    char acceptJson[600];
     size_t d = 0;
     dictJson[d++] = '[';
     const char* tok = langs;
@@ -1493,7 +1755,7 @@ static void PatchSpellcheckPreferences(void) {
     while (*tok) {
         const char* comma = strchr(tok, ',');
         size_t tlen = comma ? (size_t)(comma - tok) : strlen(tok);
-        if (d + tlen + 4 >= sizeof(dictJson)) break;
+        if (d + tlen + 4 >= 1200) break;
         if (!first) dictJson[d++] = ',';
         dictJson[d++] = '"';
         memcpy(dictJson + d, tok, tlen);
@@ -1504,44 +1766,184 @@ static void PatchSpellcheckPreferences(void) {
     }
     dictJson[d++] = ']';
     dictJson[d] = '\0';
-    snprintf(acceptJson, sizeof(acceptJson), "\"%s\"", langs);
+    snprintf(acceptJson, 600, "\"%s\"", langs);
+
+    edits[count].path = "spellcheck.dictionaries";
+    edits[count++].value = dictJson;
+    edits[count].path = "intl.accept_languages";
+    edits[count++].value = acceptJson;
+    edits[count].path = "intl.selected_languages";
+    edits[count++].value = acceptJson;
+    return count;
+}
 
-    wchar_t prefsDir[MAX_PATH];
-    GetMainUserDataFolder(prefsDir);
-    // The runtime nests the actual browser profile in an "EBWebView"
-    // subfolder of the user data folder, so the Preferences file lives at
-    // <UDF>\EBWebView\Default\Preferences - not directly under the UDF.
-    PathAppendW(prefsDir, L"EBWebView");
-    PathAppendW(prefsDir, L"Default");
-    wchar_t prefsPath[MAX_PATH];
-    wcscpy_s(prefsPath, MAX_PATH, prefsDir);
-    PathAppendW(prefsPath, L"Preferences");
+// A managed value is spliced into the file verbatim, so it has to parse as
+// exactly one JSON value (json_check_value in prefs_json.h).
+static BOOL IsManagedPrefValue(const char* v) {
+    return json_check_value(v, v + strlen(v)) ? TRUE : FALSE;
+}
 
-    FILE* f = NULL;
-    if (_wfopen_s(&f, prefsPath, L"rb") != 0 || !f) {
-        // Profile doesn't exist yet (first run): seed a minimal Preferences
-        // file; Chromium fills in defaults for everything else.
-        SHCreateDirectoryExW(NULL, prefsDir, NULL);
-        FILE* nf = NULL;
-        if (_wfopen_s(&nf, prefsPath, L"wb") == 0 && nf) {
-            fprintf(nf,
-                "{\"intl\":{\"accept_languages\":%s,\"selected_languages\":%s},"
-                "\"spellcheck\":{\"dictionaries\":%s}}",
-                acceptJson, acceptJson, dictJson);
-            fclose(nf);
-            DebugPrint(L"[INFO] Seeded WebView2 Preferences with spell-check languages: %s\n",
-                       g_config.spellcheckLanguages);
+// Parse the ManagedPreferences lines ("path=json" sets root.<path>, "!path"
+// removes it) into edits[count..] and return the new count. The UTF-8 paths
+// and values are stored in text. Malformed entries, and entries whose path
+// clashes with one already in the set (spell-check included), are skipped.
+static int AppendManagedPrefEdits(const Configuration* config, JsonEdit* edits, int count,
+                                  char* text, size_t textCap) {
+    size_t used = 0;
+    const wchar_t* line = config->managedPrefs;
+    while (*line) {
+        const wchar_t* eol = wcschr(line, L'\n');
+        size_t lineLen = eol ? (size_t)(eol - line) : wcslen(line);
+        const wchar_t* next = eol ? eol + 1 : line + lineLen;
+        while (lineLen > 0 && iswspace(*line)) { line++; lineLen--; }
+        while (lineLen > 0 && iswspace(line[lineLen - 1])) lineLen--;
+        if (lineLen == 0 || *line == L'#') {
+            line = next;
+            continue;
         }
+        if (count == JSON_EDIT_MAX || used + 1 >= textCap) {
+            DebugPrint(L"[WARNING] Too many managed preferences; the rest are ignored\n");
+            break;
+        }
+
+        int n = WideCharToMultiByte(CP_UTF8, 0, line, (int)lineLen,
+                                    text + used, (int)(textCap - used - 1), NULL, NULL);
+        if (n <= 0) {
+            DebugPrint(L"[WARNING] Managed preferences exceed %u bytes; the rest are ignored\n",
+                       (unsigned)textCap);
+            break;
+        }
+        char* entry = text + used;
+        entry[n] = '\0';
+        used += (size_t)n + 1;
+        line = next;
+
+        char* path = entry;
+        char* value = NULL;
+        if (*path == '!') {
+            path++;
+        } else {
+            char* eq = strchr(path, '=');
+            if (!eq) {
+                DebugPrint(L"[WARNING] Ignoring managed preference without a value: %hs\n", entry);
+                continue;
+            }
+            value = eq + 1;
+            while (eq > path && (eq[-1] == ' ' || eq[-1] == '\t')) eq--;
+            *eq = '\0';
+            while (*value == ' ' || *value == '\t') value++;
+            if (!IsManagedPrefValue(value)) {
+                DebugPrint(L"[WARNING] Ignoring managed preference %hs: not a JSON value\n", path);
+                continue;
+            }
+        }
+        // Path segments become raw JSON keys when a member is created.
+        BOOL pathOk = *path != '\0';
+        for (const char* c = path; *c; c++) {
+            if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) pathOk = FALSE;
+        }
+        edits[count].path = path;
+        edits[count].value = value;
+        JsonEditPath paths[JSON_EDIT_MAX];
+        if (!pathOk || !json_edit_paths_prepare(edits, count + 1, paths)) {
+            DebugPrint(L"[WARNING] Ignoring managed preference %hs: bad or conflicting path\n", path);
+            continue;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Identifies the edit set in the fingerprint.
+static ULONGLONG HashPrefEdits(const JsonEdit* edits, int count) {
+    PrefsHash hs;
+    prefs_hash_init(&hs);
+    for (int i = 0; i < count; i++) {
+        prefs_hash_update(&hs, edits[i].path, strlen(edits[i].path) + 1);
+        if (edits[i].value) {
+            prefs_hash_update(&hs, "=", 1);
+            prefs_hash_update(&hs, edits[i].value, strlen(edits[i].value) + 1);
+        } else {
+            prefs_hash_update(&hs, "!", 1);
+        }
+    }
+    return prefs_hash_final(&hs);
+}
+
+// Write the configured spell-check languages and managed preferences into the
+// WebView2 profile's Preferences file, all in one pass. Must only run while
+// the browser process for the main user data folder is not running (app
+// startup, or after BrowserProcessExited). The profile is shared by every
+// site, so these come from the primary site's configuration.
+static void PatchProfilePreferences(void) {
+    const Configuration* config = &g_sites[0].config;
+    JsonEdit edits[JSON_EDIT_MAX];
+    char dictJson[1200];
+    char acceptJson[600];
+    char managedText[16384];
+    int editCount = AppendSpellcheckEdits(config, edits, 0, dictJson, acceptJson);
+    editCount = AppendManagedPrefEdits(config, edits, editCount, managedText, sizeof(managedText));
+    if (editCount == 0) return;
+    ULONGLONG editHash = HashPrefEdits(edits, editCount);
+
+    wchar_t prefsDir[MAX_PATH];
+    GetMainUserDataFolder(prefsDir);
+    // The runtime nests the actual browser profile in an "EBWebView"
+    // subfolder of the user data folder, so the Preferences file lives at
+    // <UDF>\EBWebView\Default\Preferences - not directly under the UDF.
+    PathAppendW(prefsDir, L"EBWebView");
+    PathAppendW(prefsDir, L"Default");
+    wchar_t prefsPath[MAX_PATH];
+    wcscpy_s(prefsPath, MAX_PATH, prefsDir);
+    PathAppendW(prefsPath, L"Preferences");
+
+    PrefsFingerprint fp;
+    BOOL haveFp = ReadPrefsFingerprint(prefsPath, &fp) && fp.editHash == editHash;
+    if (haveFp && PrefsFileStampMatches(prefsPath, &fp)) {
+        DebugPrint(L"[INFO] Managed preferences unchanged since last patch (fingerprint match)\n");
+        return;
+    }
+
+    FILE* f = NULL;
+    if (_wfopen_s(&f, prefsPath, L"rb") != 0 || !f) {
+        // Profile doesn't exist yet (first run): seed a minimal Preferences
+        // file holding just our values; Chromium fills in defaults for
+        // everything else.
+        char* seed = NULL;
+        size_t seedLen = 0;
+        if (!json_apply_edits("{}", 2, edits, editCount, &seed, &seedLen) || !seed) return;
+        SHCreateDirectoryExW(NULL, prefsDir, NULL);
+        FILE* nf = NULL;
+        if (_wfopen_s(&nf, prefsPath, L"wb") == 0 && nf) {
+            size_t written = fwrite(seed, 1, seedLen, nf);
+            fclose(nf);
+            if (written == seedLen) {
+                WritePrefsFingerprint(prefsPath, prefs_content_hash(seed, seedLen), editHash);
+            }
+            DebugPrint(L"[INFO] Seeded WebView2 Preferences with %d managed values\n", editCount);
+        }
+        free(seed);
+        return;
+    }
+
+    // Write to a temp file and swap it in so a crash can't corrupt the profile.
+    wchar_t tmpPath[MAX_PATH];
+    if (swprintf_s(tmpPath, MAX_PATH, L"%s.stl_tmp", prefsPath) <= 0) {
+        fclose(f);
         return;
     }
 
-    fseek(f, 0, SEEK_END);
-    long fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    if (fsize <= 0 || fsize > 32 * 1024 * 1024) {
+    _fseeki64(f, 0, SEEK_END);
+    __int64 fsize = _ftelli64(f);
+    _fseeki64(f, 0, SEEK_SET);
+    if (fsize <= 0) {
         fclose(f);
         return;
     }
+    if (fsize > PREFS_IN_MEMORY_MAX) {
+        PatchLargePreferences(f, prefsPath, tmpPath, edits, editCount, editHash);
+        return;
+    }
     char* buf = (char*)malloc((size_t)fsize + 1);
     if (!buf) {
         fclose(f);
@@ -1551,61 +1953,39 @@ static void PatchSpellcheckPreferences(void) {
     fclose(f);
     buf[got] = '\0';
 
-    struct {
-        const char* parent;
-        const char* child;
-        const char* value;
-    } patches[] = {
-        { "spellcheck", "dictionaries", dictJson },
-        { "intl", "accept_languages", acceptJson },
-        { "intl", "selected_languages", acceptJson },
-    };
-
-    char* cur = buf;
-    size_t curLen = got;
-    BOOL ok = TRUE;
-    for (int i = 0; i < 3; i++) {
-        size_t nextLen = 0;
-        char* next = json_set_nested(cur, curLen, patches[i].parent,
-                                     patches[i].child, patches[i].value, &nextLen);
-        if (!next) {
-            ok = FALSE;
-            break;
-        }
-        if (cur != buf) free(cur);
-        cur = next;
-        curLen = nextLen;
+    // Rewritten (or copied back) but byte-identical to what we last left:
+    // the patch is still in place, no need to parse it.
+    ULONGLONG hash = prefs_content_hash(buf, got);
+    if (haveFp && hash == fp.contentHash) {
+        DebugPrint(L"[INFO] Managed preferences unchanged since last patch (content match)\n");
+        WritePrefsFingerprint(prefsPath, hash, editHash);
+        free(buf);
+        return;
     }
 
-    if (!ok) {
-        DebugPrint(L"[WARNING] Could not parse WebView2 Preferences; spell-check patch skipped\n");
-        if (cur != buf) free(cur);
+    char* cur = NULL;
+    size_t curLen = 0;
+    if (!json_apply_edits(buf, got, edits, editCount, &cur, &curLen)) {
+        DebugPrint(L"[WARNING] Could not parse WebView2 Preferences; patch skipped\n");
         free(buf);
         return;
     }
 
-    if (curLen == got && memcmp(cur, buf, got) == 0) {
-        DebugPrint(L"[INFO] Spell-check preferences already up to date\n");
-        free(cur);
+    if (!cur) {
+        DebugPrint(L"[INFO] Managed preferences already up to date\n");
+        WritePrefsFingerprint(prefsPath, hash, editHash);
         free(buf);
         return;
     }
 
-    // Write to a temp file and swap it in so a crash can't corrupt the profile.
-    wchar_t tmpPath[MAX_PATH];
-    if (swprintf_s(tmpPath, MAX_PATH, L"%s.stl_tmp", prefsPath) > 0) {
-        FILE* wf = NULL;
-        if (_wfopen_s(&wf, tmpPath, L"wb") == 0 && wf) {
-            size_t written = fwrite(cur, 1, curLen, wf);
-            fclose(wf);
-            if (written == curLen &&
-                MoveFileExW(tmpPath, prefsPath, MOVEFILE_REPLACE_EXISTING)) {
-                DebugPrint(L"[INFO] Applied spell-check languages to WebView2 profile: %s\n",
-                           g_config.spellcheckLanguages);
-            } else {
-                DeleteFileW(tmpPath);
-                DebugPrint(L"[WARNING] Failed to update WebView2 Preferences file\n");
-            }
+    FILE* wf = NULL;
+    if (_wfopen_s(&wf, tmpPath, L"wb") == 0 && wf) {
+        size_t written = fwrite(cur, 1, curLen, wf);
+        if (fclose(wf) == 0 && written == curLen) {
+            ReplacePreferencesFile(tmpPath, prefsPath, prefs_content_hash(cur, curLen), editHash);
+        } else {
+            DeleteFileW(tmpPath);
+            DebugPrint(L"[WARNING] Failed to update WebView2 Preferences file\n");
         }
     }
     free(cur);
@@ -1615,10 +1995,10 @@ static void PatchSpellcheckPreferences(void) {
 // --- WebView rebuild (applies new spell-check languages without an app
 // restart: Chromium only reads the prefs at browser-process startup) --------
 
-// Create the WebView2 environment for the main window. The controller and
-// WebView are then built by the completion handlers (EnvCompletedHandler et
-// al). Used both from WM_CREATE and when rebuilding after a language change.
-static void CreateMainWebViewEnvironment(HWND hwnd) {
+// Create the WebView2 environment shared by every site. The sites'
+// controllers and WebViews are then built by the completion handlers
+// (EnvCompletedHandler et al). Used both at startup and for every rebuild.
+static void CreateMainWebViewEnvironment(void) {
     wchar_t userDataPath[MAX_PATH];
     GetMainUserDataFolder(userDataPath);
     SHCreateDirectoryExW(NULL, userDataPath, NULL);
@@ -1639,7 +2019,6 @@ static void CreateMainWebViewEnvironment(HWND hwnd) {
     };
     envHandler->lpVtbl = &envVtbl;
     envHandler->refCount = 1;
-    envHandler->hwnd = hwnd;
     envHandler->userDataPath = _wcsdup(userDataPath);
 
     HRESULT hr = fnCreateEnvironment(NULL, userDataPath, NULL,
@@ -1651,6 +2030,86 @@ static void CreateMainWebViewEnvironment(HWND hwnd) {
     }
 }
 
+// Ask the shared environment for a controller in the site's window; the
+// ControllerCompletedHandler sets up the site's WebView.
+static void CreateSiteWebView(Site* site) {
+    if (!g_webViewEnv || !site->hwnd) return;
+    if (InterlockedExchange(&site->webViewCreatePending, TRUE) == TRUE) return;
+
+    ControllerCompletedHandler* handler =
+        (ControllerCompletedHandler*)calloc(1, sizeof(ControllerCompletedHandler));
+    if (!handler) {
+        InterlockedExchange(&site->webViewCreatePending, FALSE);
+        return;
+    }
+
+    static ICoreWebView2CreateCoreWebView2ControllerCompletedHandlerVtbl controllerVtbl = {
+        ControllerCompletedHandler_QueryInterface,
+        ControllerCompletedHandler_AddRef,
+        ControllerCompletedHandler_Release,
+        ControllerCompletedHandler_Invoke
+    };
+    handler->lpVtbl = &controllerVtbl;
+    handler->refCount = 1;
+    handler->site = site;
+
+    HRESULT hr = g_webViewEnv->lpVtbl->CreateCoreWebView2Controller(g_webViewEnv, site->hwnd,
+        (ICoreWebView2CreateCoreWebView2ControllerCompletedHandler*)handler);
+    handler->lpVtbl->Release((ICoreWebView2CreateCoreWebView2ControllerCompletedHandler*)handler);
+    if (FAILED(hr)) {
+        InterlockedExchange(&site->webViewCreatePending, FALSE);
+        DebugPrint(L"[WARNING] CreateCoreWebView2Controller call failed. HRESULT: 0x%08X\n", hr);
+    }
+}
+
+// The environment, or any site's controller, is still being created.
+static BOOL IsWebViewCreatePending(void) {
+    if (InterlockedCompareExchange(&g_webViewCreatePending, TRUE, TRUE) == TRUE) return TRUE;
+    for (int i = 0; i < g_siteCount; i++) {
+        if (InterlockedCompareExchange(&g_sites[i].webViewCreatePending, TRUE, TRUE) == TRUE) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// Drop the site's WebView and reset its lifecycle state. The shared browser
+// process only exits once every site's controller is closed.
+static void CloseSiteWebView(Site* site) {
+    if (site->hwnd) {
+        KillTimer(site->hwnd, ID_TIMER_WEBVIEW_PREWARM);
+        KillTimer(site->hwnd, ID_TIMER_WEBVIEW_PRELOAD);
+        KillTimer(site->hwnd, ID_TIMER_POWER_RESUME);
+        KillTimer(site->hwnd, ID_TIMER_WEBVIEW_LIVENESS);
+    }
+
+    InterlockedExchange(&site->isInitialized, FALSE);
+    InterlockedExchange(&site->resumeFailureCount, 0);
+    InterlockedExchange(&site->webViewPingOutstanding, FALSE);
+    site->jsVisibility = JS_VISIBILITY_UNKNOWN;
+    // The hooks' script goes with the WebView; one still being added is
+    // dropped when it completes.
+    site->jsHooksGeneration++;
+    free(site->jsHooksScriptId);
+    site->jsHooksScriptId = NULL;
+    site->jsHooksSyncPending = FALSE;
+    // Likewise a capture in flight: its page is gone, and the next WebView
+    // must be able to start its own.
+    site->snapshotGeneration++;
+    site->snapshotCapturePending = FALSE;
+    DispatchLifecycle(site, LC_EVENT_CLOSED);
+
+    if (site->webView) {
+        site->webView->lpVtbl->Release(site->webView);
+        site->webView = NULL;
+    }
+    if (site->webViewController) {
+        site->webViewController->lpVtbl->Close(site->webViewController);
+        site->webViewController->lpVtbl->Release(site->webViewController);
+        site->webViewController = NULL;
+    }
+}
+
 typedef struct {
     ICoreWebView2BrowserProcessExitedEventHandlerVtbl* lpVtbl;
     LONG refCount;
@@ -1687,7 +2146,7 @@ static HRESULT STDMETHODCALLTYPE BrowserExitedHandler_Invoke(
     ICoreWebView2BrowserProcessExitedEventArgs* args) {
     (void)This; (void)sender; (void)args;
     DebugPrint(L"[INFO] WebView2 browser process exited\n");
-    if (g_hwnd) PostMessageW(g_hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
+    if (g_sites[0].hwnd) PostMessageW(g_sites[0].hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
     return S_OK;
 }
 
@@ -1738,18 +2197,33 @@ static void UnregisterBrowserExitedFromCurrentEnv(void) {
     g_browserExitedRegistered = FALSE;
 }
 
-// Tear down the main WebView so its browser process exits; the Preferences
-// patch and the rebuild happen in FinishMainWebViewRecreate once the
-// BrowserProcessExited event fires (the file is only flushed - and unlocked
-// for our purposes - when that process is gone). A fallback timer covers
-// runtimes where the event can't be observed.
+// Drop our hold on the shared environment. The browser process exits once
+// every controller in it is closed as well; with the event unregistered
+// first, that exit does not look like a crash.
+static void ReleaseMainWebViewEnvironment(void) {
+    if (!g_webViewEnv) return;
+    UnregisterBrowserExitedFromCurrentEnv();
+    g_webViewEnv->lpVtbl->Release(g_webViewEnv);
+    g_webViewEnv = NULL;
+}
+
+// Tear down every site's WebView so the shared browser process exits; the
+// Preferences patch and the rebuild happen in FinishMainWebViewRecreate once
+// the BrowserProcessExited event fires (the file is only flushed - and
+// unlocked for our purposes - when that process is gone). A fallback timer
+// covers runtimes where the event can't be observed.
 static void BeginMainWebViewRecreate(void) {
-    if (!g_hwnd) return;
+    HWND hwnd = g_sites[0].hwnd;
+    if (!hwnd) return;
     if (InterlockedCompareExchange(&g_webViewRecreatePending, TRUE, TRUE) == TRUE) return;
 
-    if (!g_webViewController) {
+    BOOL running = FALSE;
+    for (int i = 0; i < g_siteCount; i++) {
+        if (g_sites[i].webViewController) running = TRUE;
+    }
+    if (!running) {
         // Nothing is running; the startup path will patch and create as usual.
-        PatchSpellcheckPreferences();
+        PatchProfilePreferences();
         return;
     }
 
@@ -1757,91 +2231,39 @@ static void BeginMainWebViewRecreate(void) {
 
     // BrowserProcessExited is already registered on the environment (done
     // when the environment was created); its handler will post the rebuild.
-    SetTimer(g_hwnd, ID_TIMER_WEBVIEW_RECREATE, WEBVIEW_RECREATE_FALLBACK_MS, NULL);
-
-    KillTimer(g_hwnd, ID_TIMER_INITIAL_HIDE_JS);
-    KillTimer(g_hwnd, ID_TIMER_WEBVIEW_PREWARM);
-    KillTimer(g_hwnd, ID_TIMER_WEBVIEW_PRELOAD);
-    KillTimer(g_hwnd, ID_TIMER_POWER_RESUME);
-    KillTimer(g_hwnd, ID_TIMER_WEBVIEW_LIVENESS);
-
-    InterlockedExchange(&g_isInitialized, FALSE);
-    InterlockedExchange(&g_initialPreloadComplete, FALSE);
-    InterlockedExchange(&g_webViewSuspendPending, FALSE);
-    InterlockedExchange(&g_webViewSuspended, FALSE);
-    InterlockedExchange(&g_webViewPrewarmActive, FALSE);
-    InterlockedExchange(&g_powerResumePending, FALSE);
-    InterlockedExchange(&g_webViewPingOutstanding, FALSE);
-    g_powerKickCount = 0;
-    g_jsVisibility = JS_VISIBILITY_UNKNOWN;
+    SetTimer(hwnd, ID_TIMER_WEBVIEW_RECREATE, WEBVIEW_RECREATE_FALLBACK_MS, NULL);
 
-    if (g_webView) {
-        g_webView->lpVtbl->Release(g_webView);
-        g_webView = NULL;
+    for (int i = 0; i < g_siteCount; i++) {
+        CloseSiteWebView(&g_sites[i]);
     }
-    if (g_webViewController) {
-        g_webViewController->lpVtbl->Close(g_webViewController);
-        g_webViewController->lpVtbl->Release(g_webViewController);
-        g_webViewController = NULL;
-    }
-    DebugPrint(L"[INFO] Main WebView closed; waiting for browser process exit\n");
+    DebugPrint(L"[INFO] WebViews closed; waiting for browser process exit\n");
 }
 
-static void FinishMainWebViewRecreate(HWND hwnd) {
+static void FinishMainWebViewRecreate(void) {
     if (InterlockedExchange(&g_webViewRecreatePending, FALSE) != TRUE) return;
-    KillTimer(hwnd, ID_TIMER_WEBVIEW_RECREATE);
+    if (g_sites[0].hwnd) KillTimer(g_sites[0].hwnd, ID_TIMER_WEBVIEW_RECREATE);
 
-    if (g_webViewEnv) {
-        UnregisterBrowserExitedFromCurrentEnv();
-        g_webViewEnv->lpVtbl->Release(g_webViewEnv);
-        g_webViewEnv = NULL;
-    }
+    ReleaseMainWebViewEnvironment();
 
-    DebugPrint(L"[INFO] Rebuilding main WebView with updated spell-check languages\n");
-    PatchSpellcheckPreferences();
-    CreateMainWebViewEnvironment(hwnd);
+    DebugPrint(L"[INFO] Browser process gone; patching Preferences and rebuilding WebViews\n");
+    PatchProfilePreferences();
+    CreateMainWebViewEnvironment();
 }
 
 // The browser process died without the app asking for it (crash, kill, out
-// of memory, runtime servicing) or stopped honoring resume requests. Drop
-// every stale COM object and build a fresh WebView.
-static void HandleUnexpectedBrowserExit(HWND hwnd) {
-    if (InterlockedCompareExchange(&g_webViewCreatePending, TRUE, TRUE) == TRUE) return;
+// of memory, runtime servicing) or stopped honoring resume requests. Every
+// site runs in that process, so drop all their stale COM objects and build
+// fresh WebViews.
+static void HandleUnexpectedBrowserExit(void) {
+    if (IsWebViewCreatePending()) return;
 
     DebugPrint(L"[WARNING] WebView2 browser gone or unresponsive; rebuilding\n");
 
-    KillTimer(hwnd, ID_TIMER_INITIAL_HIDE_JS);
-    KillTimer(hwnd, ID_TIMER_WEBVIEW_PREWARM);
-    KillTimer(hwnd, ID_TIMER_WEBVIEW_PRELOAD);
-    KillTimer(hwnd, ID_TIMER_WEBVIEW_RECREATE);
-    KillTimer(hwnd, ID_TIMER_POWER_RESUME);
-    KillTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS);
-
-    InterlockedExchange(&g_isInitialized, FALSE);
-    InterlockedExchange(&g_initialPreloadComplete, FALSE);
-    InterlockedExchange(&g_webViewSuspendPending, FALSE);
-    InterlockedExchange(&g_webViewSuspended, FALSE);
-    InterlockedExchange(&g_webViewPrewarmActive, FALSE);
-    InterlockedExchange(&g_resumeFailureCount, 0);
-    InterlockedExchange(&g_powerResumePending, FALSE);
-    InterlockedExchange(&g_webViewPingOutstanding, FALSE);
-    g_powerKickCount = 0;
-    g_jsVisibility = JS_VISIBILITY_UNKNOWN;
-
-    if (g_webView) {
-        g_webView->lpVtbl->Release(g_webView);
-        g_webView = NULL;
-    }
-    if (g_webViewController) {
-        g_webViewController->lpVtbl->Close(g_webViewController);
-        g_webViewController->lpVtbl->Release(g_webViewController);
-        g_webViewController = NULL;
-    }
-    if (g_webViewEnv) {
-        UnregisterBrowserExitedFromCurrentEnv();
-        g_webViewEnv->lpVtbl->Release(g_webViewEnv);
-        g_webViewEnv = NULL;
+    if (g_sites[0].hwnd) KillTimer(g_sites[0].hwnd, ID_TIMER_WEBVIEW_RECREATE);
+    for (int i = 0; i < g_siteCount; i++) {
+        CloseSiteWebView(&g_sites[i]);
     }
+    ReleaseMainWebViewEnvironment();
 
     ULONGLONG now = GetTickCount64();
     if (g_rebuildBurstStartTick == 0 ||
@@ -1854,22 +2276,81 @@ static void HandleUnexpectedBrowserExit(HWND hwnd) {
         return;
     }
 
-    PatchSpellcheckPreferences();
-    CreateMainWebViewEnvironment(hwnd);
+    PatchProfilePreferences();
+    CreateMainWebViewEnvironment();
+}
+
+// Long-idle discard: the same teardown as after a lost browser process,
+// without the rebuild or the failure count. Once no site has a WebView left
+// the environment goes too, so the browser process and its helpers exit.
+static void DiscardSiteWebView(Site* site) {
+    DebugPrint(L"[INFO] Discarding WebView of site %d after %lu h hidden\n",
+               site->index, (unsigned long)site->config.discardAfter);
+    site->shadow.discards++;
+    CloseSiteWebView(site);
+    for (int i = 0; i < g_siteCount; i++) {
+        if (g_sites[i].lifecycle.state != LC_STATE_DISCARDED) return;
+    }
+    ReleaseMainWebViewEnvironment();
+    g_envDiscardedTick = GetTickCount64();
+}
+
+// Bring a discarded site back: a controller in the running environment, or
+// a new environment when every site was discarded (its completion builds
+// controllers for the sites no longer in DISCARDED). Timed up to the first
+// NavigationCompleted as WVS_DISCARD_REBUILD.
+//
+// The discard released the environment without waiting for the browser
+// process, and BrowserProcessExited went with it. Preferences may only be
+// patched once that process is gone, so a rebuild within
+// WEBVIEW_RECREATE_FALLBACK_MS of the discard goes through the recreate wait
+// for the rest of that time, as if the event had never arrived;
+// FinishMainWebViewRecreate then patches and creates.
+static void RecreateDiscardedWebView(Site* site) {
+    if (site->webViewController || !site->hwnd) return;
+
+    DebugPrint(L"[INFO] Rebuilding discarded WebView of site %d\n", site->index);
+    site->rebuildStartQpc = wvstats_start();
+    if (g_webViewEnv) {
+        CreateSiteWebView(site);
+        return;
+    }
+    if (InterlockedCompareExchange(&g_webViewCreatePending, TRUE, TRUE) == TRUE ||
+        InterlockedCompareExchange(&g_webViewRecreatePending, TRUE, TRUE) == TRUE) {
+        return;
+    }
+    ULONGLONG sinceDiscard = GetTickCount64() - g_envDiscardedTick;
+    if (sinceDiscard < WEBVIEW_RECREATE_FALLBACK_MS && g_sites[0].hwnd) {
+        InterlockedExchange(&g_webViewRecreatePending, TRUE);
+        SetTimer(g_sites[0].hwnd, ID_TIMER_WEBVIEW_RECREATE,
+                 (UINT)(WEBVIEW_RECREATE_FALLBACK_MS - sinceDiscard), NULL);
+        DebugPrint(L"[INFO] Browser process may still be exiting; rebuilding in %lu ms\n",
+                   (unsigned long)(WEBVIEW_RECREATE_FALLBACK_MS - sinceDiscard));
+        return;
+    }
+    PatchProfilePreferences();
+    CreateMainWebViewEnvironment();
 }
 
-// Recovery entry point for the tray actions: if the WebView is gone (rebuild
-// limiter tripped, or creation failed earlier) a Refresh/Open builds it anew.
-static void RebuildMainWebViewIfDead(void) {
-    if (g_webView || g_webViewController || g_webViewEnv) return;
-    if (!g_hwnd) return;
-    if (InterlockedCompareExchange(&g_webViewCreatePending, TRUE, TRUE) == TRUE) return;
+// Recovery entry point for the tray actions: if the site's WebView is gone
+// (rebuild limiter tripped, or creation failed earlier) a Refresh/Open builds
+// it anew - in the running environment when there still is one.
+static void RebuildMainWebViewIfDead(Site* site) {
+    if (site->webView || site->webViewController) return;
+    if (!site->hwnd) return;
+    // Not dead, discarded: the SHOW that follows rebuilds it.
+    if (site->lifecycle.state == LC_STATE_DISCARDED) return;
+    if (IsWebViewCreatePending()) return;
     if (InterlockedCompareExchange(&g_webViewRecreatePending, TRUE, TRUE) == TRUE) return;
 
     g_rebuildBurstCount = 0;
     DebugPrint(L"[INFO] Rebuilding missing WebView from tray action\n");
-    PatchSpellcheckPreferences();
-    CreateMainWebViewEnvironment(g_hwnd);
+    if (g_webViewEnv) {
+        CreateSiteWebView(site);
+        return;
+    }
+    PatchProfilePreferences();
+    CreateMainWebViewEnvironment();
 }
 
 // WebView2 Handler Implementations
@@ -1906,6 +2387,7 @@ ULONG STDMETHODCALLTYPE EnvCompletedHandler_Release(
 HRESULT STDMETHODCALLTYPE EnvCompletedHandler_Invoke(
     ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler* This,
     HRESULT result, ICoreWebView2Environment* environment) {
+    (void)This;
 
     if (FAILED(result)) {
         InterlockedExchange(&g_webViewCreatePending, FALSE);
@@ -1921,7 +2403,8 @@ HRESULT STDMETHODCALLTYPE EnvCompletedHandler_Invoke(
     }
 
     // Keep the environment for the BrowserProcessExited event (deliberate
-    // rebuilds and crash recovery both depend on it).
+    // rebuilds and crash recovery both depend on it) and for the controllers
+    // of sites rebuilt later on their own.
     if (g_webViewEnv) {
         UnregisterBrowserExitedFromCurrentEnv();
         g_webViewEnv->lpVtbl->Release(g_webViewEnv);
@@ -1930,27 +2413,13 @@ HRESULT STDMETHODCALLTYPE EnvCompletedHandler_Invoke(
     environment->lpVtbl->AddRef(environment);
     RegisterBrowserExitedOnCurrentEnv();
 
-    EnvCompletedHandler* handler = (EnvCompletedHandler*)This;
-    HWND hwnd = handler->hwnd;
-
-    ControllerCompletedHandler* controllerHandler = (ControllerCompletedHandler*)calloc(1, sizeof(ControllerCompletedHandler));
-    if (!controllerHandler) return E_OUTOFMEMORY;
-
-    static ICoreWebView2CreateCoreWebView2ControllerCompletedHandlerVtbl controllerVtbl = {
-        ControllerCompletedHandler_QueryInterface,
-        ControllerCompletedHandler_AddRef,
-        ControllerCompletedHandler_Release,
-        ControllerCompletedHandler_Invoke
-    };
-
-    controllerHandler->lpVtbl = &controllerVtbl;
-    controllerHandler->refCount = 1;
-    controllerHandler->hwnd = hwnd;
-
-    environment->lpVtbl->CreateCoreWebView2Controller(environment, hwnd,
-        (ICoreWebView2CreateCoreWebView2ControllerCompletedHandler*)controllerHandler);
-    
-    controllerHandler->lpVtbl->Release((ICoreWebView2CreateCoreWebView2ControllerCompletedHandler*)controllerHandler);
+    // One controller per site, all in this environment's browser process;
+    // discarded sites wait until they are wanted.
+    for (int i = 0; i < g_siteCount; i++) {
+        Site* s = &g_sites[i];
+        if (!s->webViewController && s->lifecycle.state != LC_STATE_DISCARDED) CreateSiteWebView(s);
+    }
+    InterlockedExchange(&g_webViewCreatePending, FALSE);
     return S_OK;
 }
 
@@ -1987,23 +2456,33 @@ HRESULT STDMETHODCALLTYPE ControllerCompletedHandler_Invoke(
     ICoreWebView2CreateCoreWebView2ControllerCompletedHandler* This,
     HRESULT result, ICoreWebView2Controller* controller) {
 
-    InterlockedExchange(&g_webViewCreatePending, FALSE);
+    ControllerCompletedHandler* handler = (ControllerCompletedHandler*)This;
+    Site* site = handler->site;
+    HWND hwnd = site->hwnd;
+    InterlockedExchange(&site->webViewCreatePending, FALSE);
 
     if (FAILED(result)) {
         MessageBoxW(NULL, L"WebView2 controller creation failed", L"Error", MB_OK | MB_ICONERROR);
         return result;
     }
 
-    ControllerCompletedHandler* handler = (ControllerCompletedHandler*)This;
-    HWND hwnd = handler->hwnd;
+    site->webViewController = controller;
+    site->webViewController->lpVtbl->AddRef(site->webViewController);
 
-    g_webViewController = controller;
-    g_webViewController->lpVtbl->AddRef(g_webViewController);
+    // Transparent until the page draws, so an open shows the snapshot the
+    // window paints underneath rather than a white rectangle.
+    ICoreWebView2Controller2* controller2 = NULL;
+    if (SUCCEEDED(controller->lpVtbl->QueryInterface(controller, &IID_ICoreWebView2Controller2,
+                                                     (void**)&controller2)) && controller2) {
+        COREWEBVIEW2_COLOR transparent = { 0, 255, 255, 255 };
+        controller2->lpVtbl->put_DefaultBackgroundColor(controller2, transparent);
+        controller2->lpVtbl->Release(controller2);
+    }
 
     ICoreWebView2* webview2 = NULL;
     controller->lpVtbl->get_CoreWebView2(controller, &webview2);
     if (webview2) {
-        g_webView = webview2;
+        site->webView = webview2;
         
         BOOL initiallyVisible = IsWindowActuallyVisible(hwnd);
 
@@ -2016,38 +2495,26 @@ HRESULT STDMETHODCALLTYPE ControllerCompletedHandler_Invoke(
             SetWindowPos(hwnd, NULL, wx, wy, ww, wh, SWP_NOZORDER | SWP_NOACTIVATE);
         }
 
-        RECT bounds;
-        GetClientRect(hwnd, &bounds);
-        controller->lpVtbl->put_Bounds(controller, bounds);
-
-        // Requirement (c): keep the WebView rendering (IsVisible = TRUE) during
-        // the preload even though the host window stays hidden. This is the
-        // documented way to keep a WebView "warm" — the page loads and renders
-        // off-screen so it is ready to display instantly. We only turn
-        // rendering off (IsVisible = FALSE) at the moment we suspend for sleep.
-        controller->lpVtbl->put_IsVisible(controller, TRUE);
+        // Renders the preload off-screen (see the CREATED rule in lifecycle.h).
+        DispatchLifecycle(site, LC_EVENT_CREATED);
 
-        // Settle the sleep state only once the initial navigation finishes so
-        // we never suspend a half-loaded page (see OnMainNavigationCompleted).
-        RegisterMainNavigationCompletedHandler(webview2);
-        RegisterMainNewWindowRequestedHandler(webview2);
-        RegisterMainProcessFailedHandler(webview2);
+        RegisterMainNavigationCompletedHandler(site, webview2);
+        RegisterMainNewWindowRequestedHandler(site, webview2);
+        RegisterMainProcessFailedHandler(site, webview2);
+        RegisterJsHooks(site, FALSE);
 
-        webview2->lpVtbl->Navigate(webview2, g_initialUrl);
+        NavigateSite(site, site->config.url);
 
-        InterlockedExchange(&g_resumeFailureCount, 0);
-        InterlockedExchange(&g_isInitialized, TRUE);
-        InterlockedExchange(&g_webViewDesiredVisible, TRUE);
-        ResumeMainWebViewRuntime();
+        InterlockedExchange(&site->resumeFailureCount, 0);
+        InterlockedExchange(&site->isInitialized, TRUE);
+        if (initiallyVisible) DispatchLifecycle(site, LC_EVENT_SHOW);
 
-        if (initiallyVisible && InterlockedExchange(&g_resetUrlOnNextShow, FALSE) == TRUE) {
-            ResetTargetPageIfNeeded();
+        if (initiallyVisible && InterlockedExchange(&site->resetUrlOnNextShow, FALSE) == TRUE) {
+            ResetTargetPageIfNeeded(site);
         }
 
-        // Schedule initial JS sync after WebView is ready.
-        if (g_config.onHideJs[0] != L'\0' || g_config.onShowJs[0] != L'\0') {
-            SetTimer(hwnd, ID_TIMER_INITIAL_HIDE_JS, INITIAL_HIDE_JS_DELAY_MS, NULL);
-        }
+        // Initial JS sync once the page has loaded (NavCompletedHandler_Invoke).
+        site->jsHooksSyncPending = HasJsHooks(&site->config);
     }
 
     return S_OK;
@@ -2090,7 +2557,7 @@ HRESULT STDMETHODCALLTYPE ClearBrowsingDataCompletedHandler_Invoke(
     } else {
         DebugPrint(L"[INFO] Cleared WebView2 cache data\n");
     }
-    ReloadTargetPage();
+    ReloadTargetPage(((ClearBrowsingDataCompletedHandler*)This)->site);
     return S_OK;
 }
 
@@ -2128,12 +2595,62 @@ HRESULT STDMETHODCALLTYPE ExecuteScriptCompletedHandler_Invoke(
     ICoreWebView2ExecuteScriptCompletedHandler* This,
     HRESULT errorCode, LPCWSTR resultObjectAsJson) {
     (void)resultObjectAsJson;  // Unused
+    wvstats_end(WVS_EXECUTE_SCRIPT_DONE, ((ExecuteScriptCompletedHandler*)This)->startQpc, errorCode);
     if (FAILED(errorCode)) {
         DebugPrint(L"[WARNING] ExecuteScript failed. HRESULT: 0x%08X\n", errorCode);
     }
     return S_OK;
 }
 
+HRESULT STDMETHODCALLTYPE AddScriptCompletedHandler_QueryInterface(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This,
+    REFIID riid, void** ppvObject) {
+    if (IsEqualIID(riid, &IID_IUnknown) ||
+        IsEqualIID(riid, &IID_ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler)) {
+        *ppvObject = This;
+        This->lpVtbl->AddRef(This);
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE AddScriptCompletedHandler_AddRef(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This) {
+    AddScriptCompletedHandler* handler = (AddScriptCompletedHandler*)This;
+    return InterlockedIncrement(&handler->refCount);
+}
+
+ULONG STDMETHODCALLTYPE AddScriptCompletedHandler_Release(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This) {
+    AddScriptCompletedHandler* handler = (AddScriptCompletedHandler*)This;
+    ULONG refCount = InterlockedDecrement(&handler->refCount);
+    if (refCount == 0) {
+        handler->webView->lpVtbl->Release(handler->webView);
+        free(handler);
+    }
+    return refCount;
+}
+
+// Keep the script's id for the next re-registration, unless the hooks were
+// registered again (or the WebView closed) while this one was in flight.
+HRESULT STDMETHODCALLTYPE AddScriptCompletedHandler_Invoke(
+    ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler* This,
+    HRESULT errorCode, LPCWSTR id) {
+    AddScriptCompletedHandler* handler = (AddScriptCompletedHandler*)This;
+    Site* site = handler->site;
+    if (FAILED(errorCode) || !id) {
+        DebugPrint(L"[WARNING] AddScriptToExecuteOnDocumentCreated failed. HRESULT: 0x%08X\n", errorCode);
+        return S_OK;
+    }
+    if (handler->generation != site->jsHooksGeneration) {
+        handler->webView->lpVtbl->RemoveScriptToExecuteOnDocumentCreated(handler->webView, id);
+        return S_OK;
+    }
+    site->jsHooksScriptId = _wcsdup(id);
+    return S_OK;
+}
+
 HRESULT STDMETHODCALLTYPE TrySuspendCompletedHandler_QueryInterface(
     ICoreWebView2TrySuspendCompletedHandler* This,
     REFIID riid, void** ppvObject) {
@@ -2166,23 +2683,21 @@ ULONG STDMETHODCALLTYPE TrySuspendCompletedHandler_Release(
 HRESULT STDMETHODCALLTYPE TrySuspendCompletedHandler_Invoke(
     ICoreWebView2TrySuspendCompletedHandler* This,
     HRESULT errorCode, BOOL result) {
-    (void)This;
-    InterlockedExchange(&g_webViewSuspendPending, FALSE);
+    TrySuspendCompletedHandler* handler = (TrySuspendCompletedHandler*)This;
+    Site* site = handler->site;
+    wvstats_end(WVS_TRY_SUSPEND_DONE, handler->startQpc,
+                SUCCEEDED(errorCode) && !result ? E_FAIL : errorCode);
 
     if (SUCCEEDED(errorCode) && result) {
-        InterlockedExchange(&g_webViewSuspended, TRUE);
         DebugPrint(L"[INFO] WebView2 suspend request completed\n");
+        site->shadow.running = SHADOW_OFF;
+        site->shadow.suspends++;
+        DispatchLifecycle(site, LC_EVENT_SUSPEND_DONE);
     } else {
-        InterlockedExchange(&g_webViewSuspended, FALSE);
         DebugPrint(L"[WARNING] WebView2 suspend request failed. HRESULT: 0x%08X, result: %d\n",
                    errorCode, result);
-    }
-
-    if (InterlockedCompareExchange(&g_webViewDesiredActive, TRUE, TRUE) == TRUE) {
-        BOOL desiredVisible =
-            InterlockedCompareExchange(&g_webViewDesiredVisible, TRUE, TRUE) == TRUE;
-        ResumeMainWebViewRuntime();
-        SetMainWebViewControllerVisible(desiredVisible);
+        site->shadow.running = SHADOW_ON;
+        DispatchLifecycle(site, LC_EVENT_SUSPEND_FAILED);
     }
 
     return S_OK;
@@ -2221,8 +2736,10 @@ ULONG STDMETHODCALLTYPE LivenessPingHandler_Release(
 HRESULT STDMETHODCALLTYPE LivenessPingHandler_Invoke(
     ICoreWebView2ExecuteScriptCompletedHandler* This,
     HRESULT errorCode, LPCWSTR resultObjectAsJson) {
-    (void)This; (void)errorCode; (void)resultObjectAsJson;
-    InterlockedExchange(&g_webViewPingOutstanding, FALSE);
+    (void)resultObjectAsJson;
+    LivenessPingHandler* handler = (LivenessPingHandler*)This;
+    wvstats_end(WVS_PING_DONE, handler->startQpc, errorCode);
+    InterlockedExchange(&handler->site->webViewPingOutstanding, FALSE);
     return S_OK;
 }
 
@@ -2258,14 +2775,36 @@ ULONG STDMETHODCALLTYPE NavCompletedHandler_Release(
 HRESULT STDMETHODCALLTYPE NavCompletedHandler_Invoke(
     ICoreWebView2NavigationCompletedEventHandler* This,
     ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args) {
-    (void)This;
     (void)sender;
-    (void)args;
-    OnMainNavigationCompleted();
+    Site* site = ((NavCompletedHandler*)This)->site;
+
+    BOOL success = TRUE;
+    if (args) args->lpVtbl->get_IsSuccess(args, &success);
+    wvstats_end(WVS_NAVIGATE_DONE, site->navigateStartQpc, success ? S_OK : E_FAIL);
+    site->navigateStartQpc = 0;
+    wvstats_end(WVS_DISCARD_REBUILD, site->rebuildStartQpc, success ? S_OK : E_FAIL);
+    site->rebuildStartQpc = 0;
+    EndOpenCover(site, success ? S_OK : E_FAIL);
+
+    DispatchLifecycle(site, LC_EVENT_NAV_COMPLETED);
+
+    // Initial JS sync: the page has loaded, with the hooks defined, so run
+    // the one for the window's state even if an earlier transition already
+    // ran it in the document this one replaced. Occlusion tracking is only
+    // useful while the window is shown (ShowMainWindow starts it): a hidden
+    // window cannot become visible on its own.
+    if (site->jsHooksSyncPending) {
+        site->jsHooksSyncPending = FALSE;
+        site->jsVisibility = JS_VISIBILITY_UNKNOWN;
+        UpdateJsVisibilityState(site);
+        if (IsWindowVisible(site->hwnd)) {
+            StartOcclusionTracking(site);
+        }
+    }
     return S_OK;
 }
 
-static void RegisterMainNavigationCompletedHandler(ICoreWebView2* webview2) {
+static void RegisterMainNavigationCompletedHandler(Site* site, ICoreWebView2* webview2) {
     if (!webview2) return;
 
     NavCompletedHandler* handler =
@@ -2280,6 +2819,7 @@ static void RegisterMainNavigationCompletedHandler(ICoreWebView2* webview2) {
     };
     handler->lpVtbl = &navVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
     EventRegistrationToken token;
     HRESULT hr = webview2->lpVtbl->add_NavigationCompleted(
@@ -2300,6 +2840,7 @@ static void RegisterMainNavigationCompletedHandler(ICoreWebView2* webview2) {
 typedef struct {
     ICoreWebView2NewWindowRequestedEventHandlerVtbl* lpVtbl;
     LONG refCount;
+    Site* site;
 } NewWindowHandler;
 
 static HRESULT STDMETHODCALLTYPE NewWindowHandler_QueryInterface(
@@ -2330,9 +2871,10 @@ static ULONG STDMETHODCALLTYPE NewWindowHandler_Release(
 static HRESULT STDMETHODCALLTYPE NewWindowHandler_Invoke(
     ICoreWebView2NewWindowRequestedEventHandler* This,
     ICoreWebView2* sender, ICoreWebView2NewWindowRequestedEventArgs* args) {
-    (void)This; (void)sender;
+    (void)sender;
+    Site* site = ((NewWindowHandler*)This)->site;
 
-    if (InterlockedCompareExchange(&g_openNewWindowsExternally, TRUE, TRUE) != TRUE) {
+    if (InterlockedCompareExchange(&site->openNewWindowsExternally, TRUE, TRUE) != TRUE) {
         return S_OK;
     }
 
@@ -2351,7 +2893,7 @@ static HRESULT STDMETHODCALLTYPE NewWindowHandler_Invoke(
     return S_OK;
 }
 
-static void RegisterMainNewWindowRequestedHandler(ICoreWebView2* webview2) {
+static void RegisterMainNewWindowRequestedHandler(Site* site, ICoreWebView2* webview2) {
     if (!webview2) return;
 
     NewWindowHandler* handler = (NewWindowHandler*)calloc(1, sizeof(NewWindowHandler));
@@ -2365,6 +2907,7 @@ static void RegisterMainNewWindowRequestedHandler(ICoreWebView2* webview2) {
     };
     handler->lpVtbl = &newWindowVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
     EventRegistrationToken token;
     HRESULT hr = webview2->lpVtbl->add_NewWindowRequested(
@@ -2383,6 +2926,7 @@ static void RegisterMainNewWindowRequestedHandler(ICoreWebView2* webview2) {
 typedef struct {
     ICoreWebView2ProcessFailedEventHandlerVtbl* lpVtbl;
     LONG refCount;
+    Site* site;
 } ProcessFailedHandler;
 
 static HRESULT STDMETHODCALLTYPE ProcessFailedHandler_QueryInterface(
@@ -2413,7 +2957,8 @@ static ULONG STDMETHODCALLTYPE ProcessFailedHandler_Release(
 static HRESULT STDMETHODCALLTYPE ProcessFailedHandler_Invoke(
     ICoreWebView2ProcessFailedEventHandler* This,
     ICoreWebView2* sender, ICoreWebView2ProcessFailedEventArgs* args) {
-    (void)This; (void)sender;
+    (void)sender;
+    Site* site = ((ProcessFailedHandler*)This)->site;
 
     COREWEBVIEW2_PROCESS_FAILED_KIND kind =
         COREWEBVIEW2_PROCESS_FAILED_KIND_BROWSER_PROCESS_EXITED;
@@ -2424,20 +2969,16 @@ static HRESULT STDMETHODCALLTYPE ProcessFailedHandler_Invoke(
         case COREWEBVIEW2_PROCESS_FAILED_KIND_BROWSER_PROCESS_EXITED:
             // Everything behind the controller is gone; rebuild from scratch
             // (the BrowserProcessExited event posts the same message, the
-            // handler dedupes).
-            if (g_hwnd) PostMessageW(g_hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
+            // handler dedupes). The browser process is shared, so every site
+            // goes down with it and the primary window drives the rebuild.
+            DispatchLifecycle(site, LC_EVENT_BROWSER_FAILED);
             break;
 
         case COREWEBVIEW2_PROCESS_FAILED_KIND_RENDER_PROCESS_EXITED:
         case COREWEBVIEW2_PROCESS_FAILED_KIND_RENDER_PROCESS_UNRESPONSIVE:
             // The browser process is fine; only the page died. Reload it in
             // place, falling back to a fresh navigation.
-            if (g_webView) {
-                ResumeMainWebViewRuntime();
-                if (FAILED(g_webView->lpVtbl->Reload(g_webView))) {
-                    ReloadTargetPage();
-                }
-            }
+            DispatchLifecycle(site, LC_EVENT_RENDERER_FAILED);
             break;
 
         default:
@@ -2448,7 +2989,7 @@ static HRESULT STDMETHODCALLTYPE ProcessFailedHandler_Invoke(
     return S_OK;
 }
 
-static void RegisterMainProcessFailedHandler(ICoreWebView2* webview2) {
+static void RegisterMainProcessFailedHandler(Site* site, ICoreWebView2* webview2) {
     if (!webview2) return;
 
     ProcessFailedHandler* handler =
@@ -2463,6 +3004,7 @@ static void RegisterMainProcessFailedHandler(ICoreWebView2* webview2) {
     };
     handler->lpVtbl = &failVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
     EventRegistrationToken token;
     HRESULT hr = webview2->lpVtbl->add_ProcessFailed(
@@ -2474,9 +3016,19 @@ static void RegisterMainProcessFailedHandler(ICoreWebView2* webview2) {
     handler->lpVtbl->Release((ICoreWebView2ProcessFailedEventHandler*)handler);
 }
 
+// Navigate the site's WebView; NavigationCompleted closes the timing.
+static void NavigateSite(Site* site, const wchar_t* url) {
+    if (!site->webView) return;
+
+    site->navigateStartQpc = wvstats_start();
+    HRESULT hr = site->webView->lpVtbl->Navigate(site->webView, url);
+    wvstats_end(WVS_NAVIGATE, site->navigateStartQpc, hr);
+    if (FAILED(hr)) site->navigateStartQpc = 0;
+}
+
 // Helper to execute JavaScript in WebView2
-void ExecuteJavaScript(const wchar_t* js) {
-    if (!g_webView || !js || js[0] == L'\0') return;
+void ExecuteJavaScript(Site* site, const wchar_t* js) {
+    if (!site->webView || !js || js[0] == L'\0') return;
 
     ExecuteScriptCompletedHandler* handler =
         (ExecuteScriptCompletedHandler*)calloc(1, sizeof(ExecuteScriptCompletedHandler));
@@ -2491,9 +3043,11 @@ void ExecuteJavaScript(const wchar_t* js) {
 
     handler->lpVtbl = &executeScriptVtbl;
     handler->refCount = 1;
+    handler->startQpc = wvstats_start();
 
-    HRESULT hr = g_webView->lpVtbl->ExecuteScript(
-        g_webView, js, (ICoreWebView2ExecuteScriptCompletedHandler*)handler);
+    HRESULT hr = site->webView->lpVtbl->ExecuteScript(
+        site->webView, js, (ICoreWebView2ExecuteScriptCompletedHandler*)handler);
+    wvstats_end(WVS_EXECUTE_SCRIPT, handler->startQpc, hr);
     if (FAILED(hr)) {
         DebugPrint(L"[WARNING] ExecuteScript call failed. HRESULT: 0x%08X\n", hr);
     }
@@ -2501,16 +3055,81 @@ void ExecuteJavaScript(const wchar_t* js) {
     handler->lpVtbl->Release((ICoreWebView2ExecuteScriptCompletedHandler*)handler);
 }
 
-static BOOL IsWebViewReady(void) {
-    return InterlockedCompareExchange(&g_isInitialized, TRUE, TRUE) == TRUE && g_webView != NULL;
+// The hooks as the bodies of JS_HOOKS_NAME's show() and hide(), so the page
+// compiles them once rather than on every transition. Each body gets lines
+// of its own in case it ends in a // comment. Caller frees.
+static wchar_t* BuildJsHooksScript(const Configuration* config) {
+    static const wchar_t format[] =
+        L"Object.defineProperty(window, '" JS_HOOKS_NAME L"', {configurable: true, value: {\n"
+        L"show: function () {\n%s\n},\nhide: function () {\n%s\n}}});";
+    size_t cch = sizeof(format) / sizeof(format[0]) +
+                 config_str_len(config, CFG_STR_ON_SHOW_JS) + config_str_len(config, CFG_STR_ON_HIDE_JS);
+    wchar_t* script = (wchar_t*)malloc(cch * sizeof(wchar_t));
+    if (!script) return NULL;
+    if (swprintf(script, cch, format, config->onShowJs, config->onHideJs) < 0) {
+        free(script);
+        return NULL;
+    }
+    return script;
+}
+
+// Define the hooks in every new document of the site's WebView, replacing
+// the previous definition. defineNow also defines them in the current
+// document, which would otherwise keep the old ones until it is reloaded.
+static void RegisterJsHooks(Site* site, BOOL defineNow) {
+    if (!site->webView) return;
+
+    site->jsHooksGeneration++;
+    if (site->jsHooksScriptId) {
+        site->webView->lpVtbl->RemoveScriptToExecuteOnDocumentCreated(site->webView,
+                                                                      site->jsHooksScriptId);
+        free(site->jsHooksScriptId);
+        site->jsHooksScriptId = NULL;
+    }
+    if (!HasJsHooks(&site->config)) return;
+
+    wchar_t* script = BuildJsHooksScript(&site->config);
+    if (!script) return;
+
+    AddScriptCompletedHandler* handler =
+        (AddScriptCompletedHandler*)calloc(1, sizeof(AddScriptCompletedHandler));
+    if (handler) {
+        static ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandlerVtbl addScriptVtbl = {
+            AddScriptCompletedHandler_QueryInterface,
+            AddScriptCompletedHandler_AddRef,
+            AddScriptCompletedHandler_Release,
+            AddScriptCompletedHandler_Invoke
+        };
+        handler->lpVtbl = &addScriptVtbl;
+        handler->refCount = 1;
+        handler->site = site;
+        handler->webView = site->webView;
+        handler->webView->lpVtbl->AddRef(handler->webView);
+        handler->generation = site->jsHooksGeneration;
+
+        HRESULT hr = site->webView->lpVtbl->AddScriptToExecuteOnDocumentCreated(
+            site->webView, script,
+            (ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler*)handler);
+        if (FAILED(hr)) {
+            DebugPrint(L"[WARNING] AddScriptToExecuteOnDocumentCreated call failed. HRESULT: 0x%08X\n", hr);
+        }
+        handler->lpVtbl->Release((ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler*)handler);
+    }
+
+    if (defineNow) ExecuteJavaScript(site, script);
+    free(script);
 }
 
-static ICoreWebView2_3* QueryMainWebView3(void) {
-    if (!g_webView) return NULL;
+static BOOL IsWebViewReady(Site* site) {
+    return InterlockedCompareExchange(&site->isInitialized, TRUE, TRUE) == TRUE && site->webView != NULL;
+}
+
+static ICoreWebView2_3* QueryMainWebView3(Site* site) {
+    if (!site->webView) return NULL;
 
     ICoreWebView2_3* webView3 = NULL;
-    HRESULT hr = g_webView->lpVtbl->QueryInterface(
-        g_webView, &IID_ICoreWebView2_3, (void**)&webView3);
+    HRESULT hr = site->webView->lpVtbl->QueryInterface(
+        site->webView, &IID_ICoreWebView2_3, (void**)&webView3);
     if (FAILED(hr) || !webView3) {
         DebugPrint(L"[WARNING] WebView2 suspend/resume API is not available. HRESULT: 0x%08X\n", hr);
         return NULL;
@@ -2519,76 +3138,266 @@ static ICoreWebView2_3* QueryMainWebView3(void) {
     return webView3;
 }
 
-static void SyncMainWebViewBounds(void) {
-    if (!g_webViewController || !g_hwnd) return;
+static void ResetControllerShadow(Site* site) {
+    site->shadow.boundsKnown = FALSE;
+    site->shadow.visible = SHADOW_UNKNOWN;
+    site->shadow.running = SHADOW_UNKNOWN;
+}
+
+// Returns TRUE when the call has to be made; counts it either way.
+static BOOL shadow_needs_call(Site* site, WebViewCall call, BOOL changed) {
+    if (changed) {
+        site->shadow.issued[call]++;
+        return TRUE;
+    }
+    site->shadow.elided[call]++;
+    return FALSE;
+}
+
+static void PutMainWebViewBounds(Site* site, RECT bounds) {
+    ControllerShadow* shadow = &site->shadow;
+    BOOL changed = !shadow->boundsKnown || !EqualRect(&shadow->bounds, &bounds);
+    if (!shadow_needs_call(site, WV_CALL_PUT_BOUNDS, changed)) return;
+
+    LONGLONG t = wvstats_start();
+    HRESULT hr = site->webViewController->lpVtbl->put_Bounds(site->webViewController, bounds);
+    wvstats_end(WVS_PUT_BOUNDS, t, hr);
+    if (SUCCEEDED(hr)) {
+        shadow->bounds = bounds;
+        shadow->boundsKnown = TRUE;
+    }
+}
+
+static void PutMainWebViewVisible(Site* site, BOOL visible) {
+    ShadowFlag wanted = visible ? SHADOW_ON : SHADOW_OFF;
+    if (!shadow_needs_call(site, WV_CALL_PUT_IS_VISIBLE, site->shadow.visible != wanted)) return;
+
+    LONGLONG t = wvstats_start();
+    HRESULT hr = site->webViewController->lpVtbl->put_IsVisible(site->webViewController, visible);
+    wvstats_end(WVS_PUT_IS_VISIBLE, t, hr);
+    site->shadow.visible = SUCCEEDED(hr) ? wanted : SHADOW_UNKNOWN;
+}
+
+static void SyncMainWebViewBounds(Site* site) {
+    if (!site->webViewController || !site->hwnd) return;
 
     RECT bounds;
-    GetClientRect(g_hwnd, &bounds);
-    g_webViewController->lpVtbl->put_Bounds(g_webViewController, bounds);
+    GetClientRect(site->hwnd, &bounds);
+    PutMainWebViewBounds(site, bounds);
+}
+
+// LOW lets the runtime drop caches and page memory out while the page keeps
+// running. Needs ICoreWebView2_19; on older runtimes the tier only waits.
+static void PutMainWebViewMemoryLow(Site* site, BOOL low) {
+    ShadowFlag wanted = low ? SHADOW_ON : SHADOW_OFF;
+    if (!site->webView) return;
+    if (!shadow_needs_call(site, WV_CALL_PUT_MEMORY_TARGET, site->shadow.memoryLow != wanted)) return;
+
+    ICoreWebView2_19* webView19 = NULL;
+    HRESULT hr = site->webView->lpVtbl->QueryInterface(
+        site->webView, &IID_ICoreWebView2_19, (void**)&webView19);
+    if (FAILED(hr) || !webView19) {
+        site->shadow.memoryLow = wanted;  // Nothing to change; don't ask again
+        return;
+    }
+
+    LONGLONG t = wvstats_start();
+    hr = webView19->lpVtbl->put_MemoryUsageTargetLevel(webView19, low
+        ? COREWEBVIEW2_MEMORY_USAGE_TARGET_LEVEL_LOW : COREWEBVIEW2_MEMORY_USAGE_TARGET_LEVEL_NORMAL);
+    wvstats_end(WVS_PUT_MEMORY_TARGET, t, hr);
+    webView19->lpVtbl->Release(webView19);
+    if (FAILED(hr)) {
+        DebugPrint(L"[WARNING] WebView2 memory target level change failed. HRESULT: 0x%08X\n", hr);
+    }
+    site->shadow.memoryLow = SUCCEEDED(hr) ? wanted : SHADOW_UNKNOWN;
+}
+
+// Suspend/resume churn as a rate; the hide grace period exists to keep it low.
+static void FormatSuspendRate(const Site* site, wchar_t* out, size_t cch) {
+    const ControllerShadow* shadow = &site->shadow;
+    ULONGLONG ms = GetTickCount64() - shadow->sinceTick;
+    double hours = (ms < 60000 ? 60000 : ms) / 3600000.0;
+    swprintf_s(out, cch, L"%.1f suspends/h, %.1f resumes/h, %ld reopens before the suspend, %ld discards",
+               shadow->suspends / hours, shadow->issued[WV_CALL_RESUME] / hours, shadow->graceReopens,
+               shadow->discards);
+}
+
+// Totals since start: issued calls should stop growing while the window just
+// sits open, however many visibility ticks go by.
+static void LogWebViewCallCounts(Site* site) {
+    const ControllerShadow* shadow = &site->shadow;
+    DebugPrint(L"[INFO] Site %d WebView2 calls (issued/skipped): Resume %ld/%ld, TrySuspend %ld/%ld, "
+               L"put_Bounds %ld/%ld, put_IsVisible %ld/%ld, put_MemoryUsageTargetLevel %ld/%ld; "
+               L"%ld of %ld lifecycle events were no-ops\n",
+               site->index,
+               shadow->issued[WV_CALL_RESUME], shadow->elided[WV_CALL_RESUME],
+               shadow->issued[WV_CALL_TRY_SUSPEND], shadow->elided[WV_CALL_TRY_SUSPEND],
+               shadow->issued[WV_CALL_PUT_BOUNDS], shadow->elided[WV_CALL_PUT_BOUNDS],
+               shadow->issued[WV_CALL_PUT_IS_VISIBLE], shadow->elided[WV_CALL_PUT_IS_VISIBLE],
+               shadow->issued[WV_CALL_PUT_MEMORY_TARGET], shadow->elided[WV_CALL_PUT_MEMORY_TARGET],
+               shadow->quietEvents, shadow->events);
+}
+
+// How long the site stays in the hidden tier it has just entered. The
+// delays all count from the hide and are capped at SuspendDelay, so a tier
+// that would only begin after the suspend gets no time at all.
+static UINT HiddenTierDwellMs(const Site* site) {
+    const Configuration* config = &site->config;
+    DWORD suspend = config->suspendDelay;
+    DWORD stopRender = config->stopRenderDelay < suspend ? config->stopRenderDelay : suspend;
+    DWORD trimMemory = config->trimMemoryDelay < suspend ? config->trimMemoryDelay : suspend;
+    if (trimMemory < stopRender) trimMemory = stopRender;
+
+    switch (site->lifecycle.state) {
+        case LC_STATE_COOLING:    return stopRender * 1000;
+        case LC_STATE_UNRENDERED: return (trimMemory - stopRender) * 1000;
+        default:                  return (suspend - trimMemory) * 1000;
+    }
 }
 
-static void SetMainWebViewControllerVisible(BOOL visible) {
-    if (!g_webViewController) return;
+// Working set and CPU time summed over every process of the shared WebView2
+// runtime (browser, renderers, GPU, utilities). FALSE when the runtime is
+// too old to list its processes (ICoreWebView2Environment8).
+static BOOL SampleWebViewRuntimeUsage(ULONGLONG* workingSetKb, ULONGLONG* cpuMs) {
+    if (!g_webViewEnv) {
+        // No runtime at all (every site discarded, or between rebuilds)
+        *workingSetKb = 0;
+        *cpuMs = 0;
+        return TRUE;
+    }
+
+    ICoreWebView2Environment8* env8 = NULL;
+    HRESULT hr = g_webViewEnv->lpVtbl->QueryInterface(
+        g_webViewEnv, &IID_ICoreWebView2Environment8, (void**)&env8);
+    if (FAILED(hr) || !env8) return FALSE;
+
+    ICoreWebView2ProcessInfoCollection* infos = NULL;
+    hr = env8->lpVtbl->GetProcessInfos(env8, &infos);
+    env8->lpVtbl->Release(env8);
+    if (FAILED(hr) || !infos) return FALSE;
+
+    UINT count = 0;
+    infos->lpVtbl->get_Count(infos, &count);
+    ULONGLONG workingSet = 0, cpu100ns = 0;
+    for (UINT i = 0; i < count; i++) {
+        ICoreWebView2ProcessInfo* info = NULL;
+        if (FAILED(infos->lpVtbl->GetValueAtIndex(infos, i, &info)) || !info) continue;
+        INT32 pid = 0;
+        info->lpVtbl->get_ProcessId(info, &pid);
+        info->lpVtbl->Release(info);
+
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+        if (!process) continue;  // Exited since the list was taken
+        PROCESS_MEMORY_COUNTERS pmc;
+        if (GetProcessMemoryInfo(process, &pmc, sizeof(pmc))) workingSet += pmc.WorkingSetSize;
+        FILETIME created, exited, kernel, user;
+        if (GetProcessTimes(process, &created, &exited, &kernel, &user)) {
+            cpu100ns += ((ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+                        ((ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime);
+        }
+        CloseHandle(process);
+    }
+    infos->lpVtbl->Release(infos);
+
+    *workingSetKb = workingSet / 1024;
+    *cpuMs = cpu100ns / 10000;
+    return TRUE;
+}
 
-    if (visible) {
-        SyncMainWebViewBounds();
+static int TierOfState(LifecycleState state) {
+    switch (state) {
+        case LC_STATE_SHOWN:      return WVS_TIER_SHOWN;
+        case LC_STATE_LOADING:
+        case LC_STATE_WARM:
+        case LC_STATE_PREWARM:
+        case LC_STATE_COOLING:
+        case LC_STATE_CAPTURING:  return WVS_TIER_HIDDEN_WARM;
+        case LC_STATE_UNRENDERED: return WVS_TIER_UNRENDERED;
+        case LC_STATE_TRIMMED:    return WVS_TIER_LOW_MEMORY;
+        case LC_STATE_SUSPENDING:
+        case LC_STATE_SUSPENDED:  return WVS_TIER_SUSPENDED;
+        case LC_STATE_DISCARDED:  return WVS_TIER_DISCARDED;
+        case LC_STATE_PARTIAL:    return WVS_TIER_PARTIAL;
+        default:                  return -1;  // No WebView, or mid power recovery
     }
-    g_webViewController->lpVtbl->put_IsVisible(g_webViewController, visible);
 }
 
-static void ResumeMainWebViewRuntime(void) {
-    LONG previousDesired = InterlockedExchange(&g_webViewDesiredActive, TRUE);
-    if (!IsWebViewReady() || !g_webViewController) return;
+// Close the site's current tier into g_wvTierStats when its lifecycle state
+// moves to another one, or (split) to count the visit so far and start a new
+// one. One runtime usage sample per call; CPU is the difference between the
+// samples at both ends of a visit (processes that exited in between take
+// their time with them, so it reads low rather than high).
+static void TrackWebViewTier(Site* site, BOOL split) {
+    int tier = TierOfState(site->lifecycle.state);
+    if (tier == site->tier && !split) return;
 
-    BOOL needsResume =
-        previousDesired == FALSE ||
-        InterlockedCompareExchange(&g_webViewSuspendPending, FALSE, FALSE) == TRUE ||
-        InterlockedCompareExchange(&g_webViewSuspended, FALSE, FALSE) == TRUE;
+    ULONGLONG now = GetTickCount64();
+    ULONGLONG workingSetKb = 0, cpuMs = 0;
+    BOOL sampled = SampleWebViewRuntimeUsage(&workingSetKb, &cpuMs);
+    if (site->tier >= 0) {
+        WvTierStats* stats = &g_wvTierStats[site->tier];
+        ULONGLONG ms = now - site->tierSinceTick;
+        stats->visits++;
+        stats->timeMs += ms;
+        if (sampled && site->tierSampled) {
+            stats->samples++;
+            stats->sampledMs += ms;
+            stats->cpuMs += cpuMs > site->tierStartCpuMs ? cpuMs - site->tierStartCpuMs : 0;
+            stats->workingSetSumKb += workingSetKb;
+            if (workingSetKb > stats->workingSetMaxKb) stats->workingSetMaxKb = workingSetKb;
+        }
+    }
+    site->tier = tier;
+    site->tierSinceTick = now;
+    site->tierStartCpuMs = cpuMs;
+    site->tierSampled = sampled;
+}
 
-    if (!needsResume) return;
+// Returns FALSE when the runtime refused to resume. A runtime that stays
+// unresumable (seen after the machine comes back from hibernation) gets torn
+// down and rebuilt instead of leaving a frozen, white page on screen.
+static BOOL ResumeMainWebViewRuntime(Site* site) {
+    if (!shadow_needs_call(site, WV_CALL_RESUME, site->shadow.running != SHADOW_ON)) return TRUE;
 
-    ICoreWebView2_3* webView3 = QueryMainWebView3();
-    if (!webView3) return;
+    ICoreWebView2_3* webView3 = QueryMainWebView3(site);
+    if (!webView3) return TRUE;
 
+    LONGLONG t = wvstats_start();
     HRESULT hr = webView3->lpVtbl->Resume(webView3);
+    wvstats_end(WVS_RESUME, t, hr);
     webView3->lpVtbl->Release(webView3);
 
     if (SUCCEEDED(hr)) {
-        InterlockedExchange(&g_webViewSuspendPending, FALSE);
-        InterlockedExchange(&g_webViewSuspended, FALSE);
-        InterlockedExchange(&g_resumeFailureCount, 0);
-        return;
+        site->shadow.running = SHADOW_ON;
+        InterlockedExchange(&site->resumeFailureCount, 0);
+        return TRUE;
     }
 
-    // Keep the suspended flags set so every later activation retries the
-    // resume. A runtime that stays unresumable (seen after the machine comes
-    // back from hibernation) gets torn down and rebuilt instead of leaving a
-    // frozen, white page on screen.
     DebugPrint(L"[WARNING] WebView2 resume failed. HRESULT: 0x%08X\n", hr);
-    LONG failures = InterlockedIncrement(&g_resumeFailureCount);
-    if (failures >= RESUME_FAILURE_RECREATE_THRESHOLD && g_hwnd) {
-        InterlockedExchange(&g_resumeFailureCount, 0);
-        PostMessageW(g_hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
+    LONG failures = InterlockedIncrement(&site->resumeFailureCount);
+    if (failures >= RESUME_FAILURE_RECREATE_THRESHOLD && g_sites[0].hwnd) {
+        InterlockedExchange(&site->resumeFailureCount, 0);
+        PostMessageW(g_sites[0].hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
     }
+    return FALSE;
 }
 
-static void SuspendMainWebViewRuntime(void) {
-    InterlockedExchange(&g_webViewDesiredActive, FALSE);
-    if (!IsWebViewReady() || !g_webViewController) return;
-
-    if (InterlockedCompareExchange(&g_webViewSuspendPending, FALSE, FALSE) == TRUE ||
-        InterlockedCompareExchange(&g_webViewSuspended, FALSE, FALSE) == TRUE) {
-        return;
+// Returns FALSE when the request could not be made; the completion handler
+// reports the outcome otherwise.
+static BOOL SuspendMainWebViewRuntime(Site* site) {
+    if (!shadow_needs_call(site, WV_CALL_TRY_SUSPEND, site->shadow.running != SHADOW_OFF)) {
+        DispatchLifecycle(site, LC_EVENT_SUSPEND_DONE);  // Already asleep
+        return TRUE;
     }
 
-    ICoreWebView2_3* webView3 = QueryMainWebView3();
-    if (!webView3) return;
+    ICoreWebView2_3* webView3 = QueryMainWebView3(site);
+    if (!webView3) return FALSE;
 
     TrySuspendCompletedHandler* handler =
         (TrySuspendCompletedHandler*)calloc(1, sizeof(TrySuspendCompletedHandler));
     if (!handler) {
         webView3->lpVtbl->Release(webView3);
-        return;
+        return FALSE;
     }
 
     static ICoreWebView2TrySuspendCompletedHandlerVtbl suspendVtbl = {
@@ -2600,100 +3409,30 @@ static void SuspendMainWebViewRuntime(void) {
 
     handler->lpVtbl = &suspendVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
-    InterlockedExchange(&g_webViewSuspendPending, TRUE);
+    handler->startQpc = wvstats_start();
     HRESULT hr = webView3->lpVtbl->TrySuspend(
         webView3, (ICoreWebView2TrySuspendCompletedHandler*)handler);
+    wvstats_end(WVS_TRY_SUSPEND, handler->startQpc, hr);
     if (FAILED(hr)) {
-        InterlockedExchange(&g_webViewSuspendPending, FALSE);
         DebugPrint(L"[WARNING] WebView2 TrySuspend call failed. HRESULT: 0x%08X\n", hr);
+    } else {
+        site->shadow.running = SHADOW_UNKNOWN;  // Until the completion says otherwise
     }
 
     handler->lpVtbl->Release((ICoreWebView2TrySuspendCompletedHandler*)handler);
     webView3->lpVtbl->Release(webView3);
-}
-
-// Bring the WebView to the foreground state: runtime resumed + rendered, and
-// the controller sized to the now-visible host window.
-static void ActivateMainWebView(void) {
-    InterlockedExchange(&g_webViewPrewarmActive, FALSE);
-    if (g_hwnd) {
-        KillTimer(g_hwnd, ID_TIMER_WEBVIEW_PREWARM);
-        KillTimer(g_hwnd, ID_TIMER_WEBVIEW_PRELOAD);
-    }
-
-    InterlockedExchange(&g_webViewDesiredVisible, TRUE);
-    ResumeMainWebViewRuntime();
-    SetMainWebViewControllerVisible(TRUE);
-}
-
-// Move the WebView to the background (host window hidden).
-//
-// When the sleep setting is enabled and the initial preload has finished we
-// stop rendering (IsVisible = FALSE) and suspend the runtime to save CPU.
-// Otherwise — sleeping disabled (the default), or the preload is still in
-// progress — we keep the page warm: rendering stays on so the off-screen page
-// is ready to display instantly. The host window is hidden either way, so
-// nothing is shown to the user.
-static void DeactivateMainWebView(void) {
-    BOOL sleepEnabled = InterlockedCompareExchange(&g_sleepWhenInactive, TRUE, TRUE) == TRUE;
-    BOOL preloaded = InterlockedCompareExchange(&g_initialPreloadComplete, TRUE, TRUE) == TRUE;
-    BOOL recovery = InterlockedCompareExchange(&g_powerResumePending, TRUE, TRUE) == TRUE;
-    BOOL prewarming = InterlockedCompareExchange(&g_webViewPrewarmActive, TRUE, TRUE) == TRUE;
-
-    // Never put the page to sleep while post-resume recovery is unverified
-    // (a possibly-broken page must not be frozen into a suspend snapshot) or
-    // while a tray-hover prewarm is keeping it warm. The steady-state hidden
-    // ticks used to cancel both within 250 ms.
-    if (sleepEnabled && preloaded && !recovery && !prewarming) {
-        InterlockedExchange(&g_webViewPrewarmActive, FALSE);
-        if (g_hwnd) {
-            KillTimer(g_hwnd, ID_TIMER_WEBVIEW_PREWARM);
-        }
-        InterlockedExchange(&g_webViewDesiredVisible, FALSE);
-        SetMainWebViewControllerVisible(FALSE);
-        SuspendMainWebViewRuntime();
-    } else {
-        InterlockedExchange(&g_webViewDesiredVisible, TRUE);
-        ResumeMainWebViewRuntime();
-        SetMainWebViewControllerVisible(TRUE);
-    }
-}
-
-// Pre-emptively wake a suspended WebView when the user hovers the tray icon, so
-// a live, rendered copy of the page is ready before they open the window. Only
-// relevant while the sleep setting is enabled — otherwise nothing is suspended.
-static void PrewarmMainWebView(void) {
-    if (!g_hwnd) return;
-    if (InterlockedCompareExchange(&g_sleepWhenInactive, TRUE, TRUE) != TRUE) return;
-
-    // Hovering delivers a continuous WM_MOUSEMOVE stream. While a prewarm is
-    // already active the page is warm; just re-arm the timeout instead of
-    // redoing the occlusion scan and cross-process resume/show calls for
-    // every mouse move.
-    if (InterlockedCompareExchange(&g_webViewPrewarmActive, TRUE, TRUE) == TRUE) {
-        SetTimer(g_hwnd, ID_TIMER_WEBVIEW_PREWARM, WEBVIEW_PREWARM_MS, NULL);
-        return;
-    }
-
-    if (!IsWebViewReady()) return;
-    if (IsWindowActuallyVisible(g_hwnd)) return;
-
-    InterlockedExchange(&g_webViewPrewarmActive, TRUE);
-    InterlockedExchange(&g_webViewDesiredVisible, TRUE);
-    ResumeMainWebViewRuntime();
-    SetMainWebViewControllerVisible(TRUE);  // render warm while the host stays hidden
-
-    SetTimer(g_hwnd, ID_TIMER_WEBVIEW_PREWARM, WEBVIEW_PREWARM_MS, NULL);
-    DebugPrint(L"[INFO] WebView2 prewarmed (warm render) from tray hover for %d ms\n", WEBVIEW_PREWARM_MS);
+    return SUCCEEDED(hr);
 }
 
 // Ask the runtime to run a trivial script; the completion handler clearing
-// g_webViewPingOutstanding is the "pong". A synchronous call failure is
+// the site's webViewPingOutstanding is the "pong". A synchronous call failure is
 // treated as no answer (the flag stays set) so the liveness check escalates.
-static void SendMainWebViewLivenessPing(void) {
-    if (!IsWebViewReady()) return;
-    if (InterlockedCompareExchange(&g_webViewPingOutstanding, TRUE, TRUE) == TRUE) return;
+static void SendMainWebViewLivenessPing(Site* site) {
+    if (InterlockedCompareExchange(&site->webViewPingOutstanding, TRUE, TRUE) == TRUE) return;
+    InterlockedExchange(&site->webViewPingOutstanding, TRUE);
+    if (!IsWebViewReady(site)) return;  // Nothing to ask; the check rebuilds
 
     LivenessPingHandler* handler =
         (LivenessPingHandler*)calloc(1, sizeof(LivenessPingHandler));
@@ -2707,10 +3446,12 @@ static void SendMainWebViewLivenessPing(void) {
     };
     handler->lpVtbl = &pingVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
-    InterlockedExchange(&g_webViewPingOutstanding, TRUE);
-    HRESULT hr = g_webView->lpVtbl->ExecuteScript(g_webView, L"1",
+    handler->startQpc = wvstats_start();
+    HRESULT hr = site->webView->lpVtbl->ExecuteScript(site->webView, L"1",
         (ICoreWebView2ExecuteScriptCompletedHandler*)handler);
+    wvstats_end(WVS_PING, handler->startQpc, hr);
     if (FAILED(hr)) {
         DebugPrint(L"[WARNING] Liveness ping could not be sent. HRESULT: 0x%08X\n", hr);
     }
@@ -2718,215 +3459,770 @@ static void SendMainWebViewLivenessPing(void) {
     handler->lpVtbl->Release((ICoreWebView2ExecuteScriptCompletedHandler*)handler);
 }
 
-// After the machine resumes from sleep/hibernate the GPU-side composition
-// surfaces backing the WebView can be gone and the runtime may stop answering
-// altogether; a page in that state presents as a permanently white container.
-// The graphics stack can take many seconds to come back after hibernate, so
-// this runs as a short sequence rather than a single attempt: wake the page,
-// re-assert the bounds, drop and re-add the visual tree, then verify with a
-// script ping. CheckMainWebViewLiveness re-arms the kick on silence, or
-// rebuilds the WebView when the runtime keeps ignoring us. Until recovery
-// completes, DeactivateMainWebView keeps the page warm so a possibly-broken
-// page is never frozen into a suspend snapshot.
-static void KickWebViewAfterPowerResume(HWND hwnd) {
-    if (!IsWebViewReady() || !g_webViewController) {
-        // Nothing to kick; force the liveness check down the rebuild path.
-        InterlockedExchange(&g_webViewPingOutstanding, TRUE);
-        SetTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS, POWER_RESUME_LIVENESS_MS, NULL);
-        return;
-    }
+// Runs POWER_RESUME_LIVENESS_MS after each kick. A cleared ping flag means
+// the runtime answered; silence means it is wedged, and the lifecycle table
+// decides between another kick and a rebuild.
+static void CheckMainWebViewLiveness(Site* site) {
+    if (site->lifecycle.state != LC_STATE_RECOVERING) return;
 
-    DebugPrint(L"[INFO] System resumed; refreshing WebView2 composition (attempt %d)\n",
-               g_powerKickCount);
-    ResumeMainWebViewRuntime();
-    SyncMainWebViewBounds();
-    g_webViewController->lpVtbl->put_IsVisible(g_webViewController, FALSE);
-    g_webViewController->lpVtbl->put_IsVisible(g_webViewController, TRUE);
-    g_webViewController->lpVtbl->NotifyParentWindowPositionChanged(g_webViewController);
+    // Clearing the flag lets the next kick ping again (a late pong is harmless).
+    if (InterlockedExchange(&site->webViewPingOutstanding, FALSE) != TRUE) {
+        DebugPrint(L"[INFO] WebView2 responsive after power resume\n");
+        DispatchLifecycle(site, LC_EVENT_LIVENESS_OK);
+    } else {
+        DispatchLifecycle(site, LC_EVENT_LIVENESS_SILENT);
+    }
+}
 
-    SendMainWebViewLivenessPing();
-    SetTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS, POWER_RESUME_LIVENESS_MS, NULL);
+// Last-frame snapshot. The page is captured while it still renders, just
+// before it stops (LC_STATE_CAPTURING in lifecycle.h); the PNG goes to
+// %LOCALAPPDATA%\SystrayLauncher for the next cold start, and a decoded copy
+// stays in memory. Opening the window from a tier that no longer renders
+// paints that bitmap (WM_PAINT) under the WebView, whose background is
+// transparent until the page draws, and fades it out once the page answers
+// again.
+//
+// The file is named after the site, not its place among the Sites subkeys,
+// which shifts as sites are added or removed: snapshot.png for the primary
+// site, snapshot-<name>-<hash>.png for the others. The name keeps only
+// characters any file system takes; the hash (FNV-1a of the whole name,
+// case-folded as the registry compares it) keeps apart names that reduce to
+// the same text.
+static void GetSnapshotPath(const Site* site, wchar_t* path) {
+    wchar_t file[64];
+    path[0] = L'\0';
+    SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, path);
+    PathAppendW(path, APP_NAME);
+    if (!site->name[0]) {
+        wcscpy_s(file, 64, L"snapshot.png");
+    } else {
+        wchar_t safe[33];
+        size_t n = 0;
+        DWORD hash = 2166136261u;
+        for (const wchar_t* c = site->name; *c; c++) {
+            hash = (hash ^ (DWORD)towlower(*c)) * 16777619u;
+            if (n < 32) {
+                BOOL plain = (*c >= L'a' && *c <= L'z') || (*c >= L'A' && *c <= L'Z') ||
+                             (*c >= L'0' && *c <= L'9') || *c == L'-' || *c == L'_';
+                safe[n++] = plain ? *c : L'_';
+            }
+        }
+        safe[n] = L'\0';
+        swprintf_s(file, 64, L"snapshot-%s-%08lx.png", safe, hash);
+    }
+    PathAppendW(path, file);
 }
 
-// Runs POWER_RESUME_LIVENESS_MS after each kick. A cleared ping flag means
-// the runtime answered: recovery is done and the normal visibility/sleep
-// state can settle. Silence means the runtime is wedged: retry the kick a
-// few times, then tear the WebView down and rebuild it.
-static void CheckMainWebViewLiveness(HWND hwnd) {
-    if (InterlockedCompareExchange(&g_powerResumePending, TRUE, TRUE) != TRUE) return;
-
-    if (InterlockedCompareExchange(&g_webViewPingOutstanding, TRUE, TRUE) != TRUE) {
-        InterlockedExchange(&g_powerResumePending, FALSE);
-        g_powerKickCount = 0;
-        DebugPrint(L"[INFO] WebView2 responsive after power resume\n");
-        if (IsWindowActuallyVisible(hwnd)) {
-            ActivateMainWebView();
-        } else {
-            DeactivateMainWebView();
+// PNG stream to a top-down 32 bpp DIB section (WIC).
+static HBITMAP DecodeSnapshotPng(IStream* png, int* width, int* height) {
+    IWICImagingFactory* factory = NULL;
+    IWICBitmapDecoder* decoder = NULL;
+    IWICBitmapFrameDecode* frame = NULL;
+    IWICFormatConverter* converter = NULL;
+    HBITMAP bitmap = NULL;
+    UINT w = 0, h = 0;
+
+    HRESULT hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+                                  &IID_IWICImagingFactory, (void**)&factory);
+    if (SUCCEEDED(hr)) {
+        hr = factory->lpVtbl->CreateDecoderFromStream(factory, png, NULL,
+                                                      WICDecodeMetadataCacheOnDemand, &decoder);
+    }
+    if (SUCCEEDED(hr)) hr = decoder->lpVtbl->GetFrame(decoder, 0, &frame);
+    if (SUCCEEDED(hr)) hr = factory->lpVtbl->CreateFormatConverter(factory, &converter);
+    if (SUCCEEDED(hr)) {
+        hr = converter->lpVtbl->Initialize(converter, (IWICBitmapSource*)frame,
+                                           &GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone,
+                                           NULL, 0.0, WICBitmapPaletteTypeCustom);
+    }
+    if (SUCCEEDED(hr)) hr = converter->lpVtbl->GetSize(converter, &w, &h);
+    if (SUCCEEDED(hr) && w && h && w <= 16384 && h <= 16384) {
+        BITMAPINFO bmi = {0};
+        bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth = (LONG)w;
+        bmi.bmiHeader.biHeight = -(LONG)h;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void* bits = NULL;
+        bitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+        if (bitmap && FAILED(converter->lpVtbl->CopyPixels(converter, NULL, w * 4, w * h * 4, (BYTE*)bits))) {
+            DeleteObject(bitmap);
+            bitmap = NULL;
         }
+    }
+
+    if (converter) converter->lpVtbl->Release(converter);
+    if (frame) frame->lpVtbl->Release(frame);
+    if (decoder) decoder->lpVtbl->Release(decoder);
+    if (factory) factory->lpVtbl->Release(factory);
+    if (!bitmap) {
+        DebugPrint(L"[WARNING] Could not decode the page snapshot. HRESULT: 0x%08X\n", hr);
+        return NULL;
+    }
+    *width = (int)w;
+    *height = (int)h;
+    return bitmap;
+}
+
+static void SetSiteSnapshot(Site* site, HBITMAP bitmap, int width, int height) {
+    if (site->snapshot) DeleteObject(site->snapshot);
+    site->snapshot = bitmap;
+    site->snapshotWidth = width;
+    site->snapshotHeight = height;
+}
+
+// Forget the snapshot, on disk too (the URL changed: it shows the wrong page).
+static void DropSiteSnapshot(Site* site) {
+    wchar_t path[MAX_PATH];
+    SetSiteSnapshot(site, NULL, 0, 0);
+    site->snapshotAlpha = 0;
+    GetSnapshotPath(site, path);
+    DeleteFileW(path);
+}
+
+// Replace the disk copy with the PNG just captured, via a temporary file so
+// a crash mid-write leaves the previous one.
+static void WriteSnapshotFile(Site* site, IStream* png) {
+    STATSTG stat;
+    HGLOBAL mem = NULL;
+    if (FAILED(png->lpVtbl->Stat(png, &stat, STATFLAG_NONAME)) ||
+        FAILED(GetHGlobalFromStream(png, &mem)) || !stat.cbSize.QuadPart ||
+        stat.cbSize.QuadPart > MAXDWORD) {
         return;
     }
 
-    // Allow the next kick to ping again (a late pong is harmless).
-    InterlockedExchange(&g_webViewPingOutstanding, FALSE);
+    wchar_t path[MAX_PATH], tmpPath[MAX_PATH];
+    GetSnapshotPath(site, path);
+    swprintf_s(tmpPath, MAX_PATH, L"%s.tmp", path);
 
-    if (IsWebViewReady() && g_powerKickCount < POWER_RESUME_MAX_KICKS) {
-        DebugPrint(L"[WARNING] WebView2 not answering after power resume; retrying\n");
-        SetTimer(hwnd, ID_TIMER_POWER_RESUME, POWER_RESUME_KICK_RETRY_MS, NULL);
+    BOOL ok = FALSE;
+    const void* data = GlobalLock(mem);
+    HANDLE file = data ? CreateFileW(tmpPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                     FILE_ATTRIBUTE_NORMAL, NULL) : INVALID_HANDLE_VALUE;
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD size = (DWORD)stat.cbSize.QuadPart, written = 0;
+        ok = WriteFile(file, data, size, &written, NULL) && written == size;
+        CloseHandle(file);
+    }
+    if (data) GlobalUnlock(mem);
+    if (ok) ok = MoveFileExW(tmpPath, path, MOVEFILE_REPLACE_EXISTING);
+    if (!ok) {
+        DebugPrint(L"[WARNING] Could not save the page snapshot to %s (error %lu)\n", path, GetLastError());
+        DeleteFileW(tmpPath);
+    }
+}
+
+// Cold start, or a snapshot dropped earlier: read the disk copy, once.
+static void LoadSnapshotFile(Site* site) {
+    site->snapshotLoadTried = TRUE;
+    wchar_t path[MAX_PATH];
+    GetSnapshotPath(site, path);
+
+    IStream* png = NULL;
+    if (FAILED(SHCreateStreamOnFileEx(path, STGM_READ | STGM_SHARE_DENY_WRITE, FILE_ATTRIBUTE_NORMAL,
+                                      FALSE, NULL, &png))) {
         return;
     }
+    int width = 0, height = 0;
+    HBITMAP bitmap = DecodeSnapshotPng(png, &width, &height);
+    png->lpVtbl->Release(png);
+    if (bitmap) SetSiteSnapshot(site, bitmap, width, height);
+}
+
+static HRESULT STDMETHODCALLTYPE CapturePreviewHandler_QueryInterface(
+    ICoreWebView2CapturePreviewCompletedHandler* This, REFIID riid, void** ppvObject) {
+    if (IsEqualIID(riid, &IID_IUnknown) ||
+        IsEqualIID(riid, &IID_ICoreWebView2CapturePreviewCompletedHandler)) {
+        *ppvObject = This;
+        This->lpVtbl->AddRef(This);
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE CapturePreviewHandler_AddRef(
+    ICoreWebView2CapturePreviewCompletedHandler* This) {
+    return InterlockedIncrement(&((CapturePreviewHandler*)This)->refCount);
+}
+
+static ULONG STDMETHODCALLTYPE CapturePreviewHandler_Release(
+    ICoreWebView2CapturePreviewCompletedHandler* This) {
+    CapturePreviewHandler* handler = (CapturePreviewHandler*)This;
+    ULONG refCount = InterlockedDecrement(&handler->refCount);
+    if (refCount == 0) {
+        handler->stream->lpVtbl->Release(handler->stream);
+        free(handler);
+    }
+    return refCount;
+}
 
-    DebugPrint(L"[WARNING] WebView2 unresponsive after power resume; forcing rebuild\n");
-    InterlockedExchange(&g_powerResumePending, FALSE);
-    g_powerKickCount = 0;
-    PostMessageW(hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
+static HRESULT STDMETHODCALLTYPE CapturePreviewHandler_Invoke(
+    ICoreWebView2CapturePreviewCompletedHandler* This, HRESULT errorCode) {
+    CapturePreviewHandler* handler = (CapturePreviewHandler*)This;
+    Site* site = handler->site;
+    wvstats_end(WVS_CAPTURE_PREVIEW_DONE, handler->startQpc, errorCode);
+    if (handler->generation != site->snapshotGeneration) return S_OK;  // WebView closed since
+    site->snapshotCapturePending = FALSE;
+    if (FAILED(errorCode)) {
+        DebugPrint(L"[WARNING] Page snapshot failed. HRESULT: 0x%08X\n", errorCode);
+    } else {
+        LARGE_INTEGER zero = {0};
+        handler->stream->lpVtbl->Seek(handler->stream, zero, STREAM_SEEK_SET, NULL);
+        int width = 0, height = 0;
+        HBITMAP bitmap = DecodeSnapshotPng(handler->stream, &width, &height);
+        if (bitmap) {
+            SetSiteSnapshot(site, bitmap, width, height);
+            site->snapshotLoadTried = TRUE;  // Newer than the disk copy
+            if (site->snapshotAlpha && site->hwnd) InvalidateRect(site->hwnd, NULL, FALSE);
+            WriteSnapshotFile(site, handler->stream);
+        }
+    }
+    // The page was kept rendering for the capture; it can step down now.
+    DispatchLifecycle(site, LC_EVENT_SNAPSHOT_DONE);
+    return S_OK;
 }
 
-// Called when a navigation completes. The first completion marks the initial
-// preload as done, after which it is safe to suspend on hide without cutting a
-// page load short.
-static void OnMainNavigationCompleted(void) {
-    InterlockedExchange(&g_initialPreloadComplete, TRUE);
+// Start a capture. FALSE when none could be started, so no SNAPSHOT_DONE
+// will follow; a capture already in flight reports for both.
+static BOOL CaptureMainWebViewSnapshot(Site* site) {
+    if (site->snapshotCapturePending) return TRUE;
+    if (!IsWebViewReady(site)) return FALSE;
+
+    IStream* png = NULL;
+    if (FAILED(CreateStreamOnHGlobal(NULL, TRUE, &png))) return FALSE;
+    CapturePreviewHandler* handler = (CapturePreviewHandler*)calloc(1, sizeof(CapturePreviewHandler));
+    if (!handler) {
+        png->lpVtbl->Release(png);
+        return FALSE;
+    }
+
+    static ICoreWebView2CapturePreviewCompletedHandlerVtbl captureVtbl = {
+        CapturePreviewHandler_QueryInterface,
+        CapturePreviewHandler_AddRef,
+        CapturePreviewHandler_Release,
+        CapturePreviewHandler_Invoke
+    };
+    handler->lpVtbl = &captureVtbl;
+    handler->refCount = 1;
+    handler->site = site;
+    handler->stream = png;
+    handler->generation = site->snapshotGeneration;
+
+    handler->startQpc = wvstats_start();
+    HRESULT hr = site->webView->lpVtbl->CapturePreview(site->webView,
+        COREWEBVIEW2_CAPTURE_PREVIEW_IMAGE_FORMAT_PNG, png,
+        (ICoreWebView2CapturePreviewCompletedHandler*)handler);
+    wvstats_end(WVS_CAPTURE_PREVIEW, handler->startQpc, hr);
+    if (SUCCEEDED(hr)) {
+        site->snapshotCapturePending = TRUE;
+    } else {
+        DebugPrint(L"[WARNING] Page snapshot could not be started. HRESULT: 0x%08X\n", hr);
+    }
+
+    handler->lpVtbl->Release((ICoreWebView2CapturePreviewCompletedHandler*)handler);
+    return SUCCEEDED(hr);
+}
 
-    if (!g_hwnd) return;
-    if (IsWindowActuallyVisible(g_hwnd)) return;  // shown: stay active
-    if (InterlockedCompareExchange(&g_webViewPrewarmActive, TRUE, TRUE) == TRUE) return;  // hover prewarm in progress
+// Carry out the WebView2 work the lifecycle table asked for, in bit order.
+// Calls that can fail report back as follow-up events.
+static void RunLifecycleCommands(Site* site, unsigned cmds) {
+    HWND hwnd = site->hwnd;
+    ICoreWebView2Controller* controller = site->webViewController;
 
-    if (InterlockedCompareExchange(&g_sleepWhenInactive, TRUE, TRUE) == TRUE) {
+    if ((cmds & LC_CMD_STOP_TIMERS) && hwnd) {
+        KillTimer(hwnd, ID_TIMER_WEBVIEW_PREWARM);
+        KillTimer(hwnd, ID_TIMER_WEBVIEW_PRELOAD);
+        KillTimer(hwnd, ID_TIMER_WEBVIEW_DWELL);
+        KillTimer(hwnd, ID_TIMER_WEBVIEW_DISCARD);
+    }
+    if ((cmds & LC_CMD_ARM_PREWARM) && hwnd) {
+        SetTimer(hwnd, ID_TIMER_WEBVIEW_PREWARM, WEBVIEW_PREWARM_MS, NULL);
+        DebugPrint(L"[INFO] WebView2 prewarmed (warm render) from tray hover for %d ms\n", WEBVIEW_PREWARM_MS);
+    }
+    if ((cmds & LC_CMD_ARM_SETTLE) && hwnd) {
         // Let the freshly-loaded page render for a short moment before
         // suspending, so the suspended snapshot is complete and resumes
         // instantly when the user opens or hovers.
-        SetTimer(g_hwnd, ID_TIMER_WEBVIEW_PRELOAD, WEBVIEW_PRELOAD_SETTLE_MS, NULL);
-    } else {
-        // Sleep disabled: keep the page warm and running for instant opens.
-        DeactivateMainWebView();
+        SetTimer(hwnd, ID_TIMER_WEBVIEW_PRELOAD, WEBVIEW_PRELOAD_SETTLE_MS, NULL);
+    }
+    if ((cmds & LC_CMD_ARM_DWELL) && hwnd) {
+        SetTimer(hwnd, ID_TIMER_WEBVIEW_DWELL, HiddenTierDwellMs(site), NULL);
+    }
+    if ((cmds & LC_CMD_ARM_KICK) && hwnd) {
+        // Give the graphics stack a moment to come back up before the first
+        // kick. Several resume broadcasts can arrive for a single resume;
+        // restarting the sequence is idempotent.
+        KillTimer(hwnd, ID_TIMER_POWER_RESUME);
+        KillTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS);
+        InterlockedExchange(&site->webViewPingOutstanding, FALSE);
+        SetTimer(hwnd, ID_TIMER_POWER_RESUME, POWER_RESUME_KICK_DELAY_MS, NULL);
+    }
+    if ((cmds & LC_CMD_RETRY_KICK) && hwnd) {
+        DebugPrint(L"[WARNING] WebView2 not answering after power resume; retrying\n");
+        SetTimer(hwnd, ID_TIMER_POWER_RESUME, POWER_RESUME_KICK_RETRY_MS, NULL);
+    }
+    if ((cmds & LC_CMD_ARM_DISCARD) && hwnd && site->config.discardAfter) {
+        ULONGLONG due = site->idleSinceTick + (ULONGLONG)site->config.discardAfter * 3600000;
+        ULONGLONG now = GetTickCount64();
+        SetTimer(hwnd, ID_TIMER_WEBVIEW_DISCARD, due > now ? (UINT)(due - now) : 0, NULL);
+    }
+    if ((cmds & LC_CMD_RESUME) && !ResumeMainWebViewRuntime(site)) {
+        cmds &= ~(LC_CMD_RENDER | LC_CMD_SNAPSHOT);  // Still frozen; the next wake-up retries
+        DispatchLifecycle(site, LC_EVENT_RESUME_FAILED);
+    }
+    if ((cmds & LC_CMD_RENDER) && controller) {
+        SyncMainWebViewBounds(site);
+        PutMainWebViewMemoryLow(site, FALSE);
+        PutMainWebViewVisible(site, TRUE);
+    }
+    if ((cmds & LC_CMD_REATTACH) && controller) {
+        // The GPU-side composition surfaces can be gone after a resume:
+        // re-assert the bounds, then drop and re-add the visual tree. The
+        // whole point is to repeat calls, so the shadow is forgotten first.
+        DebugPrint(L"[INFO] System resumed; refreshing WebView2 composition (attempt %d)\n",
+                   site->lifecycle.kicks);
+        ResetControllerShadow(site);
+        SyncMainWebViewBounds(site);
+        PutMainWebViewVisible(site, FALSE);
+        PutMainWebViewVisible(site, TRUE);
+        LONGLONG t = wvstats_start();
+        HRESULT hr = controller->lpVtbl->NotifyParentWindowPositionChanged(controller);
+        wvstats_end(WVS_NOTIFY_PARENT, t, hr);
+    }
+    if ((cmds & LC_CMD_SNAPSHOT) && !CaptureMainWebViewSnapshot(site)) {
+        DispatchLifecycle(site, LC_EVENT_SNAPSHOT_DONE);
+    }
+    if ((cmds & LC_CMD_UNRENDER) && controller) {
+        PutMainWebViewVisible(site, FALSE);
+    }
+    if (cmds & LC_CMD_MEMORY_LOW) {
+        PutMainWebViewMemoryLow(site, TRUE);
+    }
+    if ((cmds & LC_CMD_SUSPEND) && !SuspendMainWebViewRuntime(site)) {
+        DispatchLifecycle(site, LC_EVENT_SUSPEND_FAILED);
+    }
+    if ((cmds & LC_CMD_RELOAD) && site->webView) {
+        LONGLONG t = wvstats_start();
+        HRESULT hr = site->webView->lpVtbl->Reload(site->webView);
+        wvstats_end(WVS_RELOAD, t, hr);
+        if (FAILED(hr)) ReloadTargetPage(site);
+    }
+    if ((cmds & LC_CMD_PING) && hwnd) {
+        SendMainWebViewLivenessPing(site);
+        SetTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS, POWER_RESUME_LIVENESS_MS, NULL);
+    }
+    if ((cmds & LC_CMD_REBUILD) && g_sites[0].hwnd) {
+        // Every site runs in the one browser process; the primary window
+        // drives the rebuild (the handler dedupes repeated requests).
+        DebugPrint(L"[WARNING] Rebuilding WebView2 for site %d\n", site->index);
+        PostMessageW(g_sites[0].hwnd, WM_APP_WEBVIEW_RECREATE, 0, 0);
+    }
+    // Both close or create the controller (and dispatch CLOSED/CREATED), so
+    // they come last.
+    if (cmds & LC_CMD_DISCARD) {
+        DiscardSiteWebView(site);
+    }
+    if (cmds & LC_CMD_RECREATE) {
+        RecreateDiscardedWebView(site);
     }
 }
 
-// Data structure for occlusion check enumeration
+// Feed one event to the site's lifecycle table and run what it returns.
+static void DispatchLifecycle(Site* site, LifecycleEvent event) {
+    switch (event) {
+        // The controller or runtime may have changed behind our back: let
+        // the next calls through. A kick resumes even a runtime we think is
+        // running, since that is exactly what it is there to check.
+        case LC_EVENT_CREATED:
+            // A new WebView starts at the normal memory target; nothing else
+            // moves it, so the other resets leave it known.
+            site->shadow.memoryLow = SHADOW_OFF;
+            ResetControllerShadow(site);
+            break;
+        case LC_EVENT_CLOSED:
+        case LC_EVENT_POWER_RESUME:
+        case LC_EVENT_KICK_DUE:
+        case LC_EVENT_RENDERER_FAILED:
+        case LC_EVENT_BROWSER_FAILED:
+            ResetControllerShadow(site);
+            break;
+        default:
+            break;
+    }
+
+    LifecycleState before = site->lifecycle.state;
+    unsigned cmds = lifecycle_step(&site->lifecycle, event);
+    // A capture on the way to PARTIAL still counts as shown.
+    BOOL wasShown = before == LC_STATE_SHOWN || before == LC_STATE_PARTIAL ||
+                    (before == LC_STATE_CAPTURING && site->lifecycle.visible);
+    BOOL isShown = site->lifecycle.state == LC_STATE_SHOWN || site->lifecycle.state == LC_STATE_PARTIAL ||
+                   (site->lifecycle.state == LC_STATE_CAPTURING && site->lifecycle.visible);
+    if (event == LC_EVENT_HOVER || (wasShown && !isShown)) {
+        site->idleSinceTick = GetTickCount64();
+    }
+    site->shadow.events++;
+    if (!cmds) site->shadow.quietEvents++;
+    if (site->lifecycle.state != before) {
+        DebugPrint(L"[INFO] Site %d: %hs -> %hs on %hs\n", site->index,
+                   lifecycle_state_name(before), lifecycle_state_name(site->lifecycle.state),
+                   lifecycle_event_name(event));
+        if (before == LC_STATE_SHOWN) LogWebViewCallCounts(site);
+        TrackWebViewTier(site, FALSE);
+        if (site->lifecycle.state == LC_STATE_PARTIAL) BeginPartialCover(site);
+        else if (before == LC_STATE_PARTIAL) EndPartialCover(site);
+        if ((before == LC_STATE_COOLING || before == LC_STATE_CAPTURING ||
+             before == LC_STATE_UNRENDERED || before == LC_STATE_TRIMMED) &&
+            site->lifecycle.state == LC_STATE_SHOWN) {
+            site->shadow.graceReopens++;
+        }
+        if (site->lifecycle.state == LC_STATE_SUSPENDED) {
+            wchar_t rate[128];
+            FormatSuspendRate(site, rate, 128);
+            DebugPrint(L"[INFO] Site %d: %s\n", site->index, rate);
+        }
+    }
+    if (cmds) RunLifecycleCommands(site, cmds);
+}
+
+// Snapshot of the top-level windows above the one being checked, front to
+// back, handed to the rectangle engine in occlusion.h. The buffer persists
+// and only grows, so a check allocates nothing once warmed up.
 typedef struct {
     HWND targetHwnd;
-    HRGN visibleRgn;
-} OcclusionCheckData;
+    OccWindow* windows;
+    size_t count;
+    size_t capacity;
+    BOOL truncated;
+    UINT64 fingerprint;  // Every window above target: hwnd, state, rect, cloak
+} OcclusionSnapshot;
+
+static OcclusionSnapshot g_occlusionSnapshot;
+static OccRegion g_occlusionRegion;
+
+// Last answer per window, reused while the z-order fingerprint holds. Checks
+// come in bursts (a hook event, the safety poll, ShowMainWindow and a config
+// reload can all land in one pass of the message loop) and most find the
+// desktop as it was.
+typedef struct {
+    HWND hwnd;
+    UINT64 fingerprint;
+    double visibleFraction;
+} OcclusionCacheEntry;
+
+static OcclusionCacheEntry g_occlusionCache[SITE_MAX];
+static int g_occlusionCacheNext;  // Slot to reuse when all are taken
 
-// Callback for EnumWindows - subtracts each window above target from visible region
+// Callback for EnumWindows - records each window above target
 static BOOL CALLBACK OcclusionEnumProc(HWND hwnd, LPARAM lParam) {
-    OcclusionCheckData* data = (OcclusionCheckData*)lParam;
+    OcclusionSnapshot* snap = (OcclusionSnapshot*)lParam;
 
     // Stop when we reach our own window (windows below us don't occlude us)
-    if (hwnd == data->targetHwnd) {
+    if (hwnd == snap->targetHwnd) {
         return FALSE;
     }
 
-    // Skip invisible or minimized windows
-    if (!IsWindowVisible(hwnd) || IsIconic(hwnd)) {
+    // Skip invisible or minimized windows; showing, hiding or restoring one
+    // still changes the fingerprint.
+    BOOL visible = IsWindowVisible(hwnd);
+    BOOL iconic = visible && IsIconic(hwnd);
+    snap->fingerprint = occ_fingerprint_mix(snap->fingerprint,
+                                            (UINT64)(UINT_PTR)hwnd << 2 | visible << 1 | iconic);
+    if (!visible || iconic) {
         return TRUE;
     }
 
-    // Skip DWM-cloaked windows: suspended UWP apps, the lock-screen host and
+    RECT windowRect;
+    if (!GetWindowRect(hwnd, &windowRect)) {
+        return TRUE;
+    }
+
+    if (snap->count == snap->capacity) {
+        size_t capacity = snap->capacity ? snap->capacity * 2 : 256;
+        OccWindow* windows = (OccWindow*)realloc(snap->windows, capacity * sizeof(OccWindow));
+        if (!windows) {
+            snap->truncated = TRUE;
+            return FALSE;
+        }
+        snap->windows = windows;
+        snap->capacity = capacity;
+    }
+
+    OccWindow* w = &snap->windows[snap->count++];
+    w->rect.left = windowRect.left;
+    w->rect.top = windowRect.top;
+    w->rect.right = windowRect.right;
+    w->rect.bottom = windowRect.bottom;
+    w->flags = 0;
+
+    // Flag DWM-cloaked windows: suspended UWP apps, the lock-screen host and
     // ghost ApplicationFrameHost shells report IsWindowVisible=TRUE while
     // drawing nothing. Counting them as occluders makes the app believe the
     // window is covered and suspend a WebView the user is looking at.
     DWORD cloaked = 0;
     if (SUCCEEDED(DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked,
                                         sizeof(cloaked))) && cloaked != 0) {
-        return TRUE;
+        w->flags |= OCC_CLOAKED;
     }
+    snap->fingerprint = occ_fingerprint_mix(occ_fingerprint_rect(snap->fingerprint, &w->rect),
+                                            w->flags);
 
-    // Skip windows with no area
-    RECT windowRect;
-    if (!GetWindowRect(hwnd, &windowRect)) {
-        return TRUE;
-    }
-    if (windowRect.right <= windowRect.left || windowRect.bottom <= windowRect.top) {
-        return TRUE;
-    }
+    return TRUE;
+}
 
-    // Subtract this window's rect from our visible region
-    HRGN windowRgn = CreateRectRgnIndirect(&windowRect);
-    if (windowRgn) {
-        CombineRgn(data->visibleRgn, data->visibleRgn, windowRgn, RGN_DIFF);
-        DeleteObject(windowRgn);
+static OcclusionCacheEntry* FindOcclusionCacheEntry(HWND hwnd) {
+    for (int i = 0; i < SITE_MAX; i++) {
+        if (g_occlusionCache[i].hwnd == hwnd) return &g_occlusionCache[i];
     }
-
-    return TRUE;
+    for (int i = 0; i < SITE_MAX; i++) {
+        if (!g_occlusionCache[i].hwnd) return &g_occlusionCache[i];
+    }
+    OcclusionCacheEntry* entry = &g_occlusionCache[g_occlusionCacheNext];
+    g_occlusionCacheNext = (g_occlusionCacheNext + 1) % SITE_MAX;
+    return entry;
 }
 
-// Check if ANY part of the window is visible (not fully covered by other windows)
-static BOOL IsWindowActuallyVisible(HWND hwnd) {
-    if (!hwnd) return FALSE;
-    if (!IsWindowVisible(hwnd)) return FALSE;
-    if (IsIconic(hwnd)) return FALSE;
+// Share of the window's area not covered by other windows: 0 when hidden,
+// minimized or fully covered, 1 when nothing is on top. Parts off-screen
+// count as uncovered.
+static double WindowVisibleFraction(HWND hwnd) {
+    if (!hwnd) return 0;
+    if (!IsWindowVisible(hwnd)) return 0;
+    if (IsIconic(hwnd)) return 0;
 
     RECT ourRect;
-    if (!GetWindowRect(hwnd, &ourRect)) return FALSE;
+    if (!GetWindowRect(hwnd, &ourRect)) return 0;
     if (!MonitorFromRect(&ourRect, MONITOR_DEFAULTTONULL)) {
         // Monitors are still being re-enumerated (common right after resume
         // from hibernate, or during docking changes). Assume visible rather
         // than suspending a WebView the user may be looking at.
-        return TRUE;
+        return 1;
     }
 
-    // Create a region representing our window
-    HRGN visibleRgn = CreateRectRgnIndirect(&ourRect);
-    if (!visibleRgn) return FALSE;
-
-    OcclusionCheckData data;
-    data.targetHwnd = hwnd;
-    data.visibleRgn = visibleRgn;
+    LONGLONG t = wvstats_start();
+    OccRect target = { ourRect.left, ourRect.top, ourRect.right, ourRect.bottom };
+    OcclusionSnapshot* snap = &g_occlusionSnapshot;
+    snap->targetHwnd = hwnd;
+    snap->count = 0;
+    snap->truncated = FALSE;
+    snap->fingerprint = occ_fingerprint_rect(occ_fingerprint_mix(OCC_FINGERPRINT_SEED, (UINT_PTR)hwnd),
+                                             &target);
 
     // EnumWindows enumerates top-level windows in z-order (top to bottom)
-    // We subtract each window above us until we reach our own window
-    EnumWindows(OcclusionEnumProc, (LPARAM)&data);
+    // We record each window above us until we reach our own window
+    EnumWindows(OcclusionEnumProc, (LPARAM)snap);
 
-    // Check if any part of our window is still visible
-    RECT boundingBox;
-    int rgnType = GetRgnBox(visibleRgn, &boundingBox);
-    DeleteObject(visibleRgn);
+    // A snapshot cut short by a failed allocation can't prove we're covered
+    if (snap->truncated) {
+        wvstats_end(WVS_OCCLUSION_CHECK, t, S_OK);
+        return 1;
+    }
 
-    // NULLREGION means our window is completely covered
-    return (rgnType != NULLREGION);
+    OcclusionCacheEntry* cached = FindOcclusionCacheEntry(hwnd);
+    if (cached->hwnd == hwnd && cached->fingerprint == snap->fingerprint) {
+        wvstats_end(WVS_OCCLUSION_CACHED, t, S_OK);
+        return cached->visibleFraction;
+    }
+
+    // Too fragmented to measure means visible and counted whole
+    OccRegion* rgn = &g_occlusionRegion;
+    double fraction = 0;
+    if (occ_any_visible(target, snap->windows, snap->count, rgn)) {
+        double area = (double)(ourRect.right - ourRect.left) * (ourRect.bottom - ourRect.top);
+        fraction = rgn->overflowed ? 1 : occ_region_area(rgn) / area;
+    }
+    cached->hwnd = hwnd;
+    cached->fingerprint = snap->fingerprint;
+    cached->visibleFraction = fraction;
+    wvstats_end(WVS_OCCLUSION_CHECK, t, S_OK);
+
+    return fraction;
 }
 
-static void StartVisibilityTimer(HWND hwnd) {
-    SetTimer(hwnd, ID_TIMER_VISIBILITY_CHECK, VISIBILITY_CHECK_INTERVAL_MS, NULL);
-    DebugPrint(L"[INFO] Started visibility check timer\n");
+// Check if ANY part of the window is visible (not fully covered by other windows)
+static BOOL IsWindowActuallyVisible(HWND hwnd) {
+    return WindowVisibleFraction(hwnd) > 0;
 }
 
-static void StopVisibilityTimer(HWND hwnd) {
-    KillTimer(hwnd, ID_TIMER_VISIBILITY_CHECK);
-    DebugPrint(L"[INFO] Stopped visibility check timer\n");
+// Events that can change what covers a window. One out-of-context hook per
+// range, shared by all sites and installed only while any window is shown.
+// Not EVENT_OBJECT_LOCATIONCHANGE: it fires for every cursor and caret move
+// in the session, each one a wakeup before the filter can drop it; a drag
+// ends in MOVESIZEEND, and the safety poll covers the rest.
+static const DWORD k_occlusionEvents[][2] = {
+    { EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND },
+    { EVENT_SYSTEM_MOVESIZEEND, EVENT_SYSTEM_MOVESIZEEND },
+    { EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND },
+    { EVENT_OBJECT_DESTROY, EVENT_OBJECT_REORDER },  // Destroy, show, hide, z-order
+    { EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED },
+};
+#define OCCLUSION_HOOK_COUNT (sizeof(k_occlusionEvents) / sizeof(k_occlusionEvents[0]))
+
+// Wakeups are hook callbacks plus checks (coalesced, safety poll, resume
+// retries), over the time any window was shown; windowEvents are the
+// callbacks left after the filter, the ones that schedule a check.
+static struct {
+    HWINEVENTHOOK hooks[OCCLUSION_HOOK_COUNT];
+    int tracked;                 // Sites being tracked
+    ULONG callbacks;
+    ULONG windowEvents;
+    ULONG checks;
+    ULONGLONG trackedMs;         // Closed tracking spans
+    ULONGLONG trackedSinceTick;  // Start of the current one
+} g_occlusion;
+
+static ULONGLONG OcclusionTrackedMs(void) {
+    ULONGLONG ms = g_occlusion.trackedMs;
+    if (g_occlusion.tracked) ms += GetTickCount64() - g_occlusion.trackedSinceTick;
+    return ms;
 }
 
-static void UpdateJsVisibilityState(HWND hwnd) {
-    if (!IsWebViewReady()) return;
+// The baseline is the number of checks the old poll would have run over
+// the same shown time.
+static void FormatOcclusionRate(wchar_t* out, size_t cch) {
+    ULONGLONG ms = OcclusionTrackedMs();
+    double minutes = ms / 60000.0;
+    if (minutes < 1.0 / 60) minutes = 1.0 / 60;
+    ULONG wakeups = g_occlusion.callbacks + g_occlusion.checks;
+    ULONGLONG before = ms / OCCLUSION_POLL_BEFORE_MS;
+    swprintf_s(out, cch, L"%lu wakeups in %.1f min shown, %.1f/min (%lu hook callbacks, "
+               L"%lu of them top-level windows; %lu checks); a %d ms poll would have woken %llu times, "
+               L"%.1f/min",
+               wakeups, ms / 60000.0, wakeups / minutes, g_occlusion.callbacks,
+               g_occlusion.windowEvents, g_occlusion.checks, OCCLUSION_POLL_BEFORE_MS, before,
+               before / minutes);
+}
 
-    JsVisibility newState = IsWindowActuallyVisible(hwnd) ? JS_VISIBILITY_SHOWN : JS_VISIBILITY_HIDDEN;
-    if (newState == g_jsVisibility) {
-        if (newState == JS_VISIBILITY_SHOWN) {
-            ActivateMainWebView();
-        } else {
-            DeactivateMainWebView();
+static void ScheduleOcclusionCheck(Site* site, UINT delayMs) {
+    if (site->occlusionCheckPending) return;
+    site->occlusionCheckPending = TRUE;
+    SetTimer(site->hwnd, ID_TIMER_VISIBILITY_CHECK, delayMs, NULL);
+}
+
+static void CALLBACK OcclusionEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject,
+                                        LONG idChild, DWORD eventThread, DWORD eventTime) {
+    (void)hook; (void)event; (void)eventThread; (void)eventTime;
+    g_occlusion.callbacks++;
+    // Carets, cursors and child controls report too; only whole top-level
+    // windows can cover ours.
+    if (idObject != OBJID_WINDOW || idChild != CHILDID_SELF || !hwnd) return;
+    if (GetAncestor(hwnd, GA_ROOT) != hwnd) return;
+    g_occlusion.windowEvents++;
+
+    for (int i = 0; i < g_siteCount; i++) {
+        if (g_sites[i].occlusionTracked) ScheduleOcclusionCheck(&g_sites[i], OCCLUSION_COALESCE_MS);
+    }
+}
+
+static void StartOcclusionTracking(Site* site) {
+    if (site->occlusionTracked || !site->hwnd) return;
+    site->occlusionTracked = TRUE;
+    if (g_occlusion.tracked++ == 0) {
+        for (size_t i = 0; i < OCCLUSION_HOOK_COUNT; i++) {
+            g_occlusion.hooks[i] = SetWinEventHook(k_occlusionEvents[i][0], k_occlusionEvents[i][1], NULL,
+                                                   OcclusionEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+        }
+        g_occlusion.trackedSinceTick = GetTickCount64();
+    }
+    SetTimer(site->hwnd, ID_TIMER_OCCLUSION_SAFETY, OCCLUSION_SAFETY_POLL_MS, NULL);
+    DebugPrint(L"[INFO] Started occlusion tracking for site %d\n", site->index);
+}
+
+static void StopOcclusionTracking(Site* site) {
+    if (!site->occlusionTracked) return;
+    site->occlusionTracked = FALSE;
+    site->occlusionCheckPending = FALSE;
+    KillTimer(site->hwnd, ID_TIMER_VISIBILITY_CHECK);
+    KillTimer(site->hwnd, ID_TIMER_OCCLUSION_SAFETY);
+    if (--g_occlusion.tracked == 0) {
+        for (size_t i = 0; i < OCCLUSION_HOOK_COUNT; i++) {
+            if (g_occlusion.hooks[i]) UnhookWinEvent(g_occlusion.hooks[i]);
+            g_occlusion.hooks[i] = NULL;
         }
+        g_occlusion.trackedMs += GetTickCount64() - g_occlusion.trackedSinceTick;
+        wchar_t rate[256];
+        FormatOcclusionRate(rate, 256);
+        DebugPrint(L"[INFO] Stopped occlusion tracking: %s\n", rate);
+    }
+}
+
+// A coalesced, safety-poll or retry check of a tracked window.
+static void RunOcclusionCheck(Site* site) {
+    site->occlusionCheckPending = FALSE;
+    g_occlusion.checks++;
+    UpdateJsVisibilityState(site);
+    // Once the window is withdrawn only ShowMainWindow can bring it back,
+    // and that restarts tracking.
+    if (!IsWindowVisible(site->hwnd)) {
+        StopOcclusionTracking(site);
         return;
     }
+    if (InterlockedCompareExchange(&site->resumeFailureCount, 0, 0) > 0) {
+        ScheduleOcclusionCheck(site, RESUME_RETRY_INTERVAL_MS);
+    }
+}
 
-    if (newState == JS_VISIBILITY_SHOWN) {
-        ActivateMainWebView();
+static void ResetPartialVisibility(Site* site) {
+    site->partialDue = FALSE;
+    if (!site->partialCounting) return;
+    site->partialCounting = FALSE;
+    if (site->hwnd) KillTimer(site->hwnd, ID_TIMER_PARTIAL_DELAY);
+}
+
+// Partial-visibility policy: TRUE once less than PartialPercent of the
+// window has shown for PartialDelay seconds. The first check below the line
+// arms a timer that checks again when the delay is up.
+static BOOL IsPartialVisibilityDue(Site* site, double visibleFraction) {
+    DWORD percent = site->config.partialPercent;
+    if (!percent || visibleFraction <= 0 || visibleFraction * 100 >= percent) {
+        ResetPartialVisibility(site);
+        return FALSE;
     }
+    if (!site->partialCounting) {
+        site->partialCounting = TRUE;
+        if (site->config.partialDelay) {
+            SetTimer(site->hwnd, ID_TIMER_PARTIAL_DELAY, site->config.partialDelay * 1000, NULL);
+        } else {
+            site->partialDue = TRUE;
+        }
+    }
+    return site->partialDue;
+}
 
-    g_jsVisibility = newState;
+static void UpdateJsVisibilityState(Site* site) {
+    HWND hwnd = site->hwnd;
+    if (!IsWebViewReady(site)) return;
+
+    // The page is woken before onShowJs runs and put to sleep only after
+    // onHideJs; repeats of an unchanged state cost nothing (lifecycle.h).
+    // A window that only peeks out still counts as shown for the hooks.
+    double visibleFraction = WindowVisibleFraction(hwnd);
+    JsVisibility newState = visibleFraction > 0 ? JS_VISIBILITY_SHOWN : JS_VISIBILITY_HIDDEN;
     if (newState == JS_VISIBILITY_SHOWN) {
-        if (g_config.onShowJs[0] != L'\0') {
-            ExecuteJavaScript(g_config.onShowJs);
-            DebugPrint(L"[INFO] Executed onShowJs (window visible)\n");
-        }
+        BOOL partial = IsPartialVisibilityDue(site, visibleFraction);
+        DispatchLifecycle(site, partial ? LC_EVENT_PARTIAL : LC_EVENT_SHOW);
     } else {
-        if (g_config.onHideJs[0] != L'\0') {
-            ExecuteJavaScript(g_config.onHideJs);
-            DebugPrint(L"[INFO] Executed onHideJs (window fully covered/hidden)\n");
+        ResetPartialVisibility(site);
+    }
+
+    if (newState != site->jsVisibility) {
+        site->jsVisibility = newState;
+        if (newState == JS_VISIBILITY_SHOWN) {
+            if (site->config.onShowJs[0] != L'\0') {
+                ExecuteJavaScript(site, L"window." JS_HOOKS_NAME L"?.show()");
+                DebugPrint(L"[INFO] Executed onShowJs (window visible)\n");
+            }
+        } else {
+            if (site->config.onHideJs[0] != L'\0') {
+                ExecuteJavaScript(site, L"window." JS_HOOKS_NAME L"?.hide()");
+                DebugPrint(L"[INFO] Executed onHideJs (window fully covered/hidden)\n");
+            }
         }
-        DeactivateMainWebView();
+    }
+
+    if (newState == JS_VISIBILITY_HIDDEN) {
+        DispatchLifecycle(site, LC_EVENT_HIDE);
     }
 }
 
@@ -2963,15 +4259,17 @@ BOOL HasDisplaySettingsChanged(void) {
     return changed;
 }
 
-static void ResetTargetPageIfNeeded(void) {
-    if (!g_webView || !g_initialUrl[0]) return;
+static void ResetTargetPageIfNeeded(Site* site) {
+    if (!site->webView || !site->config.url[0]) return;
 
     LPWSTR currentUrl = NULL;
-    HRESULT hr = g_webView->lpVtbl->get_Source(g_webView, &currentUrl);
+    LONGLONG t = wvstats_start();
+    HRESULT hr = site->webView->lpVtbl->get_Source(site->webView, &currentUrl);
+    wvstats_end(WVS_GET_SOURCE, t, hr);
     if (SUCCEEDED(hr) && currentUrl) {
-        if (wcscmp(currentUrl, g_initialUrl) != 0) {
-            g_webView->lpVtbl->Navigate(g_webView, g_initialUrl);
-            DebugPrint(L"[INFO] Reset URL to initial on show: %s (was: %s)\n", g_initialUrl, currentUrl);
+        if (wcscmp(currentUrl, site->config.url) != 0) {
+            NavigateSite(site, site->config.url);
+            DebugPrint(L"[INFO] Reset URL to initial on show: %s (was: %s)\n", site->config.url, currentUrl);
         } else {
             DebugPrint(L"[INFO] URL unchanged, skipping navigation on show\n");
         }
@@ -2979,8 +4277,8 @@ static void ResetTargetPageIfNeeded(void) {
         return;
     }
 
-    g_webView->lpVtbl->Navigate(g_webView, g_initialUrl);
-    DebugPrint(L"[INFO] Reset URL to initial on show (couldn't check current): %s\n", g_initialUrl);
+    NavigateSite(site, site->config.url);
+    DebugPrint(L"[INFO] Reset URL to initial on show (couldn't check current): %s\n", site->config.url);
 }
 
 // Compute the centered, 90%-of-work-area rectangle used for the main window.
@@ -3000,58 +4298,188 @@ static void GetTargetWindowRect(int* x, int* y, int* w, int* h) {
     *y = workArea.top + (workHeight - windowHeight) / 2;
 }
 
+// The page is back: record how long the open took and start fading the
+// snapshot out. hr is E_FAIL when OPEN_FRAME_TIMEOUT_MS ran out instead.
+static void EndOpenCover(Site* site, HRESULT hr) {
+    if (!site->openStartQpc) return;
+    wvstats_end(WVS_OPEN_TO_FRAME, site->openStartQpc, hr);
+    site->openStartQpc = 0;
+    if (!site->hwnd) return;
+    KillTimer(site->hwnd, ID_TIMER_OPEN_FRAME);
+    if (site->snapshotAlpha) SetTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE, SNAPSHOT_FADE_STEP_MS, NULL);
+}
+
+// A script answered by the renderer means it is running again; its next
+// frame is at most a vsync away, well within the fade.
+static HRESULT STDMETHODCALLTYPE FrameProbeHandler_Invoke(
+    ICoreWebView2ExecuteScriptCompletedHandler* This,
+    HRESULT errorCode, LPCWSTR resultObjectAsJson) {
+    (void)resultObjectAsJson;
+    EndOpenCover(((LivenessPingHandler*)This)->site, errorCode);
+    return S_OK;
+}
+
+static void SendOpenFrameProbe(Site* site) {
+    LivenessPingHandler* handler =
+        (LivenessPingHandler*)calloc(1, sizeof(LivenessPingHandler));
+    if (!handler) return;
+
+    static ICoreWebView2ExecuteScriptCompletedHandlerVtbl probeVtbl = {
+        LivenessPingHandler_QueryInterface,
+        LivenessPingHandler_AddRef,
+        LivenessPingHandler_Release,
+        FrameProbeHandler_Invoke
+    };
+    handler->lpVtbl = &probeVtbl;
+    handler->refCount = 1;
+    handler->site = site;
+
+    LONGLONG t = wvstats_start();
+    HRESULT hr = site->webView->lpVtbl->ExecuteScript(site->webView, L"1",
+        (ICoreWebView2ExecuteScriptCompletedHandler*)handler);
+    wvstats_end(WVS_EXECUTE_SCRIPT, t, hr);
+    if (FAILED(hr)) EndOpenCover(site, hr);
+
+    handler->lpVtbl->Release((ICoreWebView2ExecuteScriptCompletedHandler*)handler);
+}
+
+// Start timing an open; when the page is not rendering, cover the client
+// area with the snapshot until it is (EndOpenCover).
+static void BeginOpenCover(Site* site) {
+    site->openStartQpc = wvstats_start();
+    SetTimer(site->hwnd, ID_TIMER_OPEN_FRAME, OPEN_FRAME_TIMEOUT_MS, NULL);
+
+    switch (site->lifecycle.state) {
+        case LC_STATE_SHOWN:
+        case LC_STATE_WARM:
+        case LC_STATE_PREWARM:
+        case LC_STATE_COOLING:
+        case LC_STATE_CAPTURING:
+            return;  // Still rendering: the live page is there at once
+        default:
+            break;
+    }
+    if (!site->snapshot && !site->snapshotLoadTried) LoadSnapshotFile(site);
+    if (!site->snapshot) return;
+
+    KillTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE);
+    site->snapshotAlpha = 255;
+    InvalidateRect(site->hwnd, NULL, FALSE);
+}
+
+static void CancelOpenCover(Site* site) {
+    site->openStartQpc = 0;
+    site->snapshotAlpha = 0;
+    KillTimer(site->hwnd, ID_TIMER_OPEN_FRAME);
+    KillTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE);
+}
+
+// PARTIAL stops rendering a window that still shows a little: paint the
+// snapshot (the one captured on the way in, once it lands) where it shows.
+static void BeginPartialCover(Site* site) {
+    if (!site->hwnd) return;
+    if (!site->snapshot && !site->snapshotLoadTried) LoadSnapshotFile(site);
+    KillTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE);
+    site->snapshotAlpha = 255;
+    InvalidateRect(site->hwnd, NULL, FALSE);
+}
+
+// Rendering again (fade the cover out over the live page) or hidden; an
+// open in progress ends its own cover.
+static void EndPartialCover(Site* site) {
+    if (!site->hwnd || site->openStartQpc || !site->snapshotAlpha) return;
+    if (site->lifecycle.state == LC_STATE_SHOWN) {
+        SetTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE, SNAPSHOT_FADE_STEP_MS, NULL);
+    } else {
+        site->snapshotAlpha = 0;
+        InvalidateRect(site->hwnd, NULL, TRUE);
+    }
+}
+
+static void StepSnapshotFade(Site* site) {
+    BYTE step = (BYTE)((255 + SNAPSHOT_FADE_STEPS - 1) / SNAPSHOT_FADE_STEPS);
+    site->snapshotAlpha = site->snapshotAlpha > step ? (BYTE)(site->snapshotAlpha - step) : 0;
+    if (!site->snapshotAlpha) KillTimer(site->hwnd, ID_TIMER_SNAPSHOT_FADE);
+    // The last step lets the class brush erase what is left.
+    InvalidateRect(site->hwnd, NULL, site->snapshotAlpha == 0);
+}
+
+// WM_PAINT while covering: the snapshot, stretched to the client area if
+// the window size changed since, blended over the background as it fades.
+// The WebView's own surface composes above whatever is painted here.
+static void PaintSiteSnapshot(Site* site, HDC hdc) {
+    RECT rc;
+    GetClientRect(site->hwnd, &rc);
+    if (site->snapshotAlpha < 255) FillRect(hdc, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+
+    HDC mem = CreateCompatibleDC(hdc);
+    HGDIOBJ old = SelectObject(mem, site->snapshot);
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, site->snapshotAlpha, 0 };
+    AlphaBlend(hdc, 0, 0, rc.right, rc.bottom, mem, 0, 0,
+               site->snapshotWidth, site->snapshotHeight, blend);
+    SelectObject(mem, old);
+    DeleteDC(mem);
+}
+
 // Window management
-void ShowMainWindow(void) {
-    if (!g_hwnd) return;
+void ShowMainWindow(Site* site) {
+    if (!site->hwnd) return;
 
-    RebuildMainWebViewIfDead();
+    RebuildMainWebViewIfDead(site);
+    if (!IsWindowVisible(site->hwnd) || IsIconic(site->hwnd)) BeginOpenCover(site);
 
     int x, y, windowWidth, windowHeight;
     GetTargetWindowRect(&x, &y, &windowWidth, &windowHeight);
 
-    SetWindowPos(g_hwnd, HWND_TOP, x, y, windowWidth, windowHeight,
+    SetWindowPos(site->hwnd, HWND_TOP, x, y, windowWidth, windowHeight,
                  SWP_SHOWWINDOW | SWP_FRAMECHANGED);
-    ShowWindow(g_hwnd, SW_RESTORE);
-    SetForegroundWindow(g_hwnd);
+    ShowWindow(site->hwnd, SW_RESTORE);
+    SetForegroundWindow(site->hwnd);
 
-    ActivateMainWebView();
+    DispatchLifecycle(site, LC_EVENT_SHOW);
 
-    if (InterlockedExchange(&g_resetUrlOnNextShow, FALSE) == TRUE) {
-        if (IsWebViewReady()) {
-            ResetTargetPageIfNeeded();
+    if (InterlockedExchange(&site->resetUrlOnNextShow, FALSE) == TRUE) {
+        if (IsWebViewReady(site)) {
+            ResetTargetPageIfNeeded(site);
         } else {
-            InterlockedExchange(&g_resetUrlOnNextShow, TRUE);
+            InterlockedExchange(&site->resetUrlOnNextShow, TRUE);
         }
     }
+    // A page that is (re)loading ends the open at its NavigationCompleted.
+    if (site->openStartQpc && IsWebViewReady(site) && !site->navigateStartQpc) {
+        SendOpenFrameProbe(site);
+    }
 
-    // Start polling for visibility changes while window is shown
-    StartVisibilityTimer(g_hwnd);
-    UpdateJsVisibilityState(g_hwnd);
+    // Track occlusion changes while the window is shown
+    StartOcclusionTracking(site);
+    UpdateJsVisibilityState(site);
 
     DebugPrint(L"[INFO] Main window shown at %dx%d, size %dx%d\n", x, y, windowWidth, windowHeight);
 }
 
-void HideMainWindow(void) {
-    if (!g_hwnd) return;
+void HideMainWindow(Site* site) {
+    if (!site->hwnd) return;
 
-    // Stop visibility polling when window is hidden
-    StopVisibilityTimer(g_hwnd);
+    // Nothing can uncover a hidden window; stop tracking it
+    StopOcclusionTracking(site);
+    CancelOpenCover(site);
 
-    ShowWindow(g_hwnd, SW_HIDE);
-    UpdateJsVisibilityState(g_hwnd);
-    InterlockedExchange(&g_resetUrlOnNextShow, TRUE);
+    ShowWindow(site->hwnd, SW_HIDE);
+    UpdateJsVisibilityState(site);
+    InterlockedExchange(&site->resetUrlOnNextShow, TRUE);
 
     DebugPrint(L"[INFO] Main window hidden\n");
 }
 
-// Tray icon functions
-void CreateTrayIcon(HWND hwnd) {
-    ZeroMemory(&g_nid, sizeof(g_nid));
-    g_nid.cbSize = sizeof(NOTIFYICONDATAW);
-    g_nid.hWnd = hwnd;
-    g_nid.uID = TRAY_ICON_ID;
-    g_nid.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP;
-    g_nid.uCallbackMessage = WM_TRAYICON;
+// Tray icon functions. Each site has its own icon; the uID tells them apart.
+void CreateTrayIcon(Site* site) {
+    NOTIFYICONDATAW* nid = &site->nid;
+    ZeroMemory(nid, sizeof(*nid));
+    nid->cbSize = sizeof(NOTIFYICONDATAW);
+    nid->hWnd = site->hwnd;
+    nid->uID = TRAY_ICON_ID + site->index;
+    nid->uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP;
+    nid->uCallbackMessage = WM_TRAYICON;
     
     // Load icon from resources with proper DPI scaling
     HDC hdcScreen = GetDC(NULL);
@@ -3059,54 +4487,71 @@ void CreateTrayIcon(HWND hwnd) {
     ReleaseDC(NULL, hdcScreen);
     
     int iconSize = (dpiX >= 120) ? 32 : 16;
-    g_nid.hIcon = (HICON)LoadImageW(g_hInstance, MAKEINTRESOURCEW(IDI_TRAYICON),
-                                     IMAGE_ICON, iconSize, iconSize, LR_DEFAULTCOLOR);
+    nid->hIcon = (HICON)LoadImageW(g_hInstance, MAKEINTRESOURCEW(IDI_TRAYICON),
+                                    IMAGE_ICON, iconSize, iconSize, LR_DEFAULTCOLOR);
 
-    if (!g_nid.hIcon) {
-        g_nid.hIcon = LoadIconW(NULL, (LPCWSTR)IDI_APPLICATION);
+    if (!nid->hIcon) {
+        nid->hIcon = LoadIconW(NULL, (LPCWSTR)IDI_APPLICATION);
     }
     
-    wcscpy_s(g_nid.szTip, sizeof(g_nid.szTip)/sizeof(wchar_t), g_config.windowTitle);
-    Shell_NotifyIconW(NIM_ADD, &g_nid);
-    DebugPrint(L"[INFO] Tray icon created with size %dx%d for DPI %d\n", iconSize, iconSize, dpiX);
+    wcsncpy_s(nid->szTip, sizeof(nid->szTip)/sizeof(wchar_t), site->config.windowTitle, _TRUNCATE);
+    Shell_NotifyIconW(NIM_ADD, nid);
+    DebugPrint(L"[INFO] Tray icon %u created with size %dx%d for DPI %d\n",
+               nid->uID, iconSize, iconSize, dpiX);
 }
 
-void RefreshTrayIcon(void) {
-    if (!g_nid.hWnd) return;
+void RefreshTrayIcon(Site* site) {
+    if (!site->nid.hWnd) return;
     
     // Delete old icon
-    if (g_nid.hIcon) {
-        DestroyIcon(g_nid.hIcon);
-        g_nid.hIcon = NULL;
+    if (site->nid.hIcon) {
+        DestroyIcon(site->nid.hIcon);
+        site->nid.hIcon = NULL;
     }
-    Shell_NotifyIconW(NIM_DELETE, &g_nid);
+    Shell_NotifyIconW(NIM_DELETE, &site->nid);
     
     // Recreate with new DPI settings
-    CreateTrayIcon(g_nid.hWnd);
+    CreateTrayIcon(site);
     DebugPrint(L"[INFO] Tray icon refreshed\n");
 }
 
-void ReloadTargetPage(void) {
-    if (!g_webView) return;
+static void RemoveTrayIcons(void) {
+    for (int i = 0; i < g_siteCount; i++) {
+        NOTIFYICONDATAW* nid = &g_sites[i].nid;
+        if (!nid->hWnd) continue;
+        if (nid->hIcon) {
+            DestroyIcon(nid->hIcon);
+            nid->hIcon = NULL;
+        }
+        Shell_NotifyIconW(NIM_DELETE, nid);
+    }
+}
+
+void ReloadTargetPage(Site* site) {
+    if (!site->webView) return;
 
-    if (g_initialUrl[0]) {
-        g_webView->lpVtbl->Navigate(g_webView, g_initialUrl);
-        DebugPrint(L"[INFO] Reloaded target URL: %s\n", g_initialUrl);
+    if (site->config.url[0]) {
+        NavigateSite(site, site->config.url);
+        DebugPrint(L"[INFO] Reloaded target URL: %s\n", site->config.url);
     } else {
-        g_webView->lpVtbl->Reload(g_webView);
+        LONGLONG t = wvstats_start();
+        HRESULT hr = site->webView->lpVtbl->Reload(site->webView);
+        wvstats_end(WVS_RELOAD, t, hr);
         DebugPrint(L"[INFO] Reloaded current page\n");
     }
 }
 
-void ClearWebViewCacheAndReload(void) {
-    if (!g_webView) return;
+// The cache belongs to the profile every site shares, so this clears it for
+// all of them; only the site whose menu was used is reloaded.
+void ClearWebViewCacheAndReload(Site* site) {
+    if (!site->webView) return;
 
     ICoreWebView2_13* webview13 = NULL;
-    HRESULT hr = g_webView->lpVtbl->QueryInterface(
-        g_webView, &IID_ICoreWebView2_13, (void**)&webview13);
+    HRESULT hr = site->webView->lpVtbl->QueryInterface(
+        site->webView, &IID_ICoreWebView2_13, (void**)&webview13);
     if (FAILED(hr) || !webview13) {
         DebugPrint(L"[WARNING] WebView2 profile interface not available. HRESULT: 0x%08X\n", hr);
-        ReloadTargetPage();
+        ReloadTargetPage(site);
         return;
     }
 
@@ -3115,7 +4560,7 @@ void ClearWebViewCacheAndReload(void) {
     webview13->lpVtbl->Release(webview13);
     if (FAILED(hr) || !profile) {
         DebugPrint(L"[WARNING] Failed to get WebView2 profile. HRESULT: 0x%08X\n", hr);
-        ReloadTargetPage();
+        ReloadTargetPage(site);
         return;
     }
 
@@ -3124,7 +4569,7 @@ void ClearWebViewCacheAndReload(void) {
     profile->lpVtbl->Release(profile);
     if (FAILED(hr) || !profile2) {
         DebugPrint(L"[WARNING] WebView2 profile2 interface not available. HRESULT: 0x%08X\n", hr);
-        ReloadTargetPage();
+        ReloadTargetPage(site);
         return;
     }
 
@@ -3132,7 +4577,7 @@ void ClearWebViewCacheAndReload(void) {
         (ClearBrowsingDataCompletedHandler*)calloc(1, sizeof(ClearBrowsingDataCompletedHandler));
     if (!handler) {
         profile2->lpVtbl->Release(profile2);
-        ReloadTargetPage();
+        ReloadTargetPage(site);
         return;
     }
 
@@ -3145,6 +4590,7 @@ void ClearWebViewCacheAndReload(void) {
 
     handler->lpVtbl = &clearBrowsingDataVtbl;
     handler->refCount = 1;
+    handler->site = site;
 
     COREWEBVIEW2_BROWSING_DATA_KINDS dataKinds =
         COREWEBVIEW2_BROWSING_DATA_KINDS_DISK_CACHE |
@@ -3155,7 +4601,7 @@ void ClearWebViewCacheAndReload(void) {
         profile2, dataKinds, (ICoreWebView2ClearBrowsingDataCompletedHandler*)handler);
     if (FAILED(hr)) {
         DebugPrint(L"[WARNING] Failed to clear WebView2 cache. HRESULT: 0x%08X\n", hr);
-        ReloadTargetPage();
+        ReloadTargetPage(site);
     }
 
     handler->lpVtbl->Release((ICoreWebView2ClearBrowsingDataCompletedHandler*)handler);
@@ -3171,9 +4617,13 @@ static void RestartApplication(void) {
         return;
     }
 
+    // Same arguments (e.g. --profile), in a copy CreateProcessW may modify
+    wchar_t* cmdLine = _wcsdup(GetCommandLineW());
     STARTUPINFOW si = { sizeof(si) };
     PROCESS_INFORMATION pi = {0};
-    if (!CreateProcessW(exePath, NULL, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
+    BOOL started = cmdLine && CreateProcessW(exePath, cmdLine, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    free(cmdLine);
+    if (!started) {
         MessageBoxW(NULL, L"Failed to restart the application.", APP_NAME,
                     MB_OK | MB_ICONERROR);
         return;
@@ -3182,15 +4632,94 @@ static void RestartApplication(void) {
     CloseHandle(pi.hThread);
 
     // Same shutdown path as tray Exit.
-    if (g_nid.hIcon) {
-        DestroyIcon(g_nid.hIcon);
-        g_nid.hIcon = NULL;
-    }
-    Shell_NotifyIconW(NIM_DELETE, &g_nid);
+    RemoveTrayIcons();
     PostQuitMessage(0);
 }
 
-void ShowContextMenu(HWND hwnd) {
+// Write every call histogram to %LOCALAPPDATA%\SystrayLauncher\webview2-stats.bin
+// (decode with webview_stats_decode, see webview_stats.h) and show a summary.
+static void SaveWebViewStats(void) {
+    wchar_t path[MAX_PATH] = L"";
+    SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, path);
+    PathAppendW(path, APP_NAME);
+    CreateDirectoryW(path, NULL);
+    PathAppendW(path, L"webview2-stats.bin");
+
+    WvStatsFileHeader header = {0};
+    header.magic = WVS_FILE_MAGIC;
+    header.version = WVS_FILE_VERSION;
+    header.kindCount = WVS_COUNT;
+    header.bucketCount = WVS_BUCKETS;
+    header.elapsedMs = g_wvStatsStartTick ? GetTickCount64() - g_wvStatsStartTick : 0;
+    header.tierCount = WVS_TIER_COUNT;
+
+    // Count the time up to now of the tier each site is in.
+    for (int i = 0; i < g_siteCount; i++) TrackWebViewTier(&g_sites[i], TRUE);
+
+    BOOL ok = FALSE;
+    HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD written = 0;
+        ok = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header);
+        for (int i = 0; ok && i < WVS_COUNT; i++) {
+            WvStatsRecord rec;
+            wvstats_make_record(&rec, (WvStatKind)i, &g_wvStats[i]);
+            ok = WriteFile(file, &rec, sizeof(rec), &written, NULL) && written == sizeof(rec);
+        }
+        for (int i = 0; ok && i < WVS_TIER_COUNT; i++) {
+            WvTierRecord rec;
+            wvstats_make_tier_record(&rec, (WvTier)i, &g_wvTierStats[i]);
+            ok = WriteFile(file, &rec, sizeof(rec), &written, NULL) && written == sizeof(rec);
+        }
+        CloseHandle(file);
+    }
+    if (!ok) {
+        DebugPrint(L"[WARNING] Could not write WebView2 statistics to %s (error %lu)\n", path, GetLastError());
+        MessageBoxW(NULL, L"Failed to save WebView2 statistics.", APP_NAME, MB_ICONERROR | MB_OK);
+        return;
+    }
+
+    wchar_t summary[4096];
+    int n = swprintf_s(summary, 4096, L"Saved to %s\n\n", path);
+    for (int i = 0; i < WVS_COUNT && n > 0 && n < 3800; i++) {
+        const WvHistogram* h = &g_wvStats[i];
+        if (!h->count) continue;
+        n += swprintf_s(summary + n, 4096 - n, L"%hs: %u calls, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                        wvstats_kind_name((WvStatKind)i), h->count,
+                        wvstats_quantile(h, 0.50) / 1000.0, wvstats_quantile(h, 0.99) / 1000.0,
+                        h->maxUs / 1000.0);
+    }
+    if (n > 0 && n < 3800 && OcclusionTrackedMs()) {
+        wchar_t rate[256];
+        FormatOcclusionRate(rate, 256);
+        n += swprintf_s(summary + n, 4096 - n, L"\nOcclusion tracking: %s\n", rate);
+    }
+    ULONG occlusionHits = g_wvStats[WVS_OCCLUSION_CACHED].count;
+    ULONG occlusionChecks = occlusionHits + g_wvStats[WVS_OCCLUSION_CHECK].count;
+    if (n > 0 && n < 3800 && occlusionChecks) {
+        n += swprintf_s(summary + n, 4096 - n, L"Occlusion cache: %lu of %lu checks hit (%.0f%%)\n",
+                        occlusionHits, occlusionChecks, 100.0 * occlusionHits / occlusionChecks);
+    }
+    const wchar_t* sep = L"\n";
+    for (int i = 0; i < WVS_TIER_COUNT && n > 0 && n < 3800; i++) {
+        const WvTierStats* t = &g_wvTierStats[i];
+        if (!t->samples || !t->sampledMs) continue;
+        n += swprintf_s(summary + n, 4096 - n, L"%s%hs: %.1f min, CPU %.2f%%, working set %.0f MB\n",
+                        sep, wvstats_tier_name((WvTier)i), t->timeMs / 60000.0,
+                        100.0 * t->cpuMs / t->sampledMs, t->workingSetSumKb / 1024.0 / t->samples);
+        sep = L"";
+    }
+    for (int i = 0; i < g_siteCount && n > 0 && n < 3800; i++) {
+        wchar_t rate[128];
+        FormatSuspendRate(&g_sites[i], rate, 128);
+        n += swprintf_s(summary + n, 4096 - n, L"\n%.64s: %s", g_sites[i].config.windowTitle, rate);
+    }
+    MessageBoxW(NULL, summary, APP_NAME, MB_ICONINFORMATION | MB_OK);
+}
+
+void ShowContextMenu(Site* site) {
+    HWND hwnd = site->hwnd;
     POINT pt;
     GetCursorPos(&pt);
 
@@ -3199,11 +4728,16 @@ void ShowContextMenu(HWND hwnd) {
     swprintf_s(versionLabel, 160, L"WebView2: %s", g_webView2Version);
 
     HMENU hMenu = CreatePopupMenu();
+    if (g_siteCount > 1) {
+        // Several icons look alike; name the site this menu acts on.
+        AppendMenuW(hMenu, MF_STRING | MF_GRAYED, 0, site->config.windowTitle);
+    }
     AppendMenuW(hMenu, MF_STRING | MF_GRAYED, 0, versionLabel);
     AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
     AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_REFRESH, L"Refresh");
     AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_CLEAR_CACHE, L"Refresh + Clear Cache");
     AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_RESTART, L"Restart");
+    AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_SAVE_STATS, L"Save WebView2 Statistics");
     AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
     AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_OPEN, L"Open");
     AppendMenuW(hMenu, MF_STRING, ID_TRAY_MENU_CONFIGURE, L"Configure");
@@ -3221,21 +4755,54 @@ void ShowContextMenu(HWND hwnd) {
 
 // Window procedure
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    // Every site window runs this procedure; the Site it belongs to arrives
+    // as the CreateWindowEx parameter and is kept in the user data slot.
+    Site* site = (Site*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    if (uMsg == WM_NCCREATE) {
+        site = (Site*)((CREATESTRUCTW*)lParam)->lpCreateParams;
+        site->hwnd = hwnd;
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)site);
+    }
+    if (!site) return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+
     switch (uMsg) {
         case WM_CREATE:
-            CaptureDisplaySettings();
-            CreateMainWebViewEnvironment(hwnd);
+            if (site->index == 0) CaptureDisplaySettings();
+            // The first window starts the shared environment; its completion
+            // creates a controller for every site window that exists by then.
+            if (g_webViewEnv) {
+                CreateSiteWebView(site);
+            } else if (InterlockedCompareExchange(&g_webViewCreatePending, TRUE, TRUE) != TRUE) {
+                CreateMainWebViewEnvironment();
+            }
             return 0;
             
         case WM_SIZE:
             if (wParam == SIZE_MINIMIZED) {
-                DeactivateMainWebView();
-            } else if (IsWindowVisible(hwnd)) {
-                ActivateMainWebView();
+                DispatchLifecycle(site, LC_EVENT_HIDE);
+            } else {
+                SyncMainWebViewBounds(site);
+                if (IsWindowVisible(hwnd)) DispatchLifecycle(site, LC_EVENT_SHOW);
             }
             return 0;
             
+        case WM_ERASEBKGND:
+            if (site->snapshotAlpha && site->snapshot) return 1;  // WM_PAINT covers it all
+            break;
+
+        case WM_PAINT:
+            if (site->snapshotAlpha && site->snapshot) {
+                PAINTSTRUCT ps;
+                HDC hdc = BeginPaint(hwnd, &ps);
+                PaintSiteSnapshot(site, hdc);
+                EndPaint(hwnd, &ps);
+                return 0;
+            }
+            break;
+
         case WM_DISPLAYCHANGE:
+            // Broadcast to every site window; one debounce refreshes all icons.
+            if (site->index != 0) return 0;
             DebugPrint(L"[INFO] Display change event received...\n");
             if (g_timerId) KillTimer(hwnd, g_timerId);
             g_timerId = SetTimer(hwnd, 1, RESOLUTION_CHANGE_DEBOUNCE_MS, NULL);
@@ -3257,54 +4824,47 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 KillTimer(hwnd, g_timerId);
                 g_timerId = 0;
                 if (HasDisplaySettingsChanged()) {
-                    RefreshTrayIcon();
+                    for (int i = 0; i < g_siteCount; i++) RefreshTrayIcon(&g_sites[i]);
                     CaptureDisplaySettings();
                 }
-            } else if (wParam == ID_TIMER_INITIAL_HIDE_JS) {
-                KillTimer(hwnd, ID_TIMER_INITIAL_HIDE_JS);
-                // Initial JS sync. Occlusion polling is only useful while the
-                // window is shown (ShowMainWindow starts it): a hidden window
-                // cannot become visible on its own, so polling it would burn
-                // EnumWindows/DWM/WebView calls 4x per second forever.
-                UpdateJsVisibilityState(hwnd);
-                if (IsWindowVisible(hwnd)) {
-                    StartVisibilityTimer(hwnd);
-                }
             } else if (wParam == ID_TIMER_VISIBILITY_CHECK) {
-                // Periodic check for window occlusion
-                UpdateJsVisibilityState(hwnd);
-                // Once the window is withdrawn only ShowMainWindow can bring
-                // it back, and that restarts the timer; stop polling until then.
-                if (!IsWindowVisible(hwnd)) {
-                    StopVisibilityTimer(hwnd);
-                }
+                KillTimer(hwnd, ID_TIMER_VISIBILITY_CHECK);
+                RunOcclusionCheck(site);
+            } else if (wParam == ID_TIMER_OCCLUSION_SAFETY) {
+                RunOcclusionCheck(site);
+            } else if (wParam == ID_TIMER_PARTIAL_DELAY) {
+                KillTimer(hwnd, ID_TIMER_PARTIAL_DELAY);
+                if (site->partialCounting) site->partialDue = TRUE;
+                UpdateJsVisibilityState(site);
             } else if (wParam == ID_TIMER_WEBVIEW_PREWARM) {
                 KillTimer(hwnd, ID_TIMER_WEBVIEW_PREWARM);
-                InterlockedExchange(&g_webViewPrewarmActive, FALSE);
-                if (IsWindowActuallyVisible(hwnd)) {
-                    ActivateMainWebView();
-                } else {
-                    DeactivateMainWebView();
-                }
+                DispatchLifecycle(site, LC_EVENT_PREWARM_EXPIRED);
+            } else if (wParam == ID_TIMER_WEBVIEW_DWELL) {
+                KillTimer(hwnd, ID_TIMER_WEBVIEW_DWELL);
+                DispatchLifecycle(site, LC_EVENT_DWELL_EXPIRED);
+            } else if (wParam == ID_TIMER_WEBVIEW_DISCARD) {
+                KillTimer(hwnd, ID_TIMER_WEBVIEW_DISCARD);
+                DispatchLifecycle(site, LC_EVENT_DISCARD_DUE);
+            } else if (wParam == ID_TIMER_OPEN_FRAME) {
+                DebugPrint(L"[WARNING] Page did not answer within %d ms of opening\n", OPEN_FRAME_TIMEOUT_MS);
+                EndOpenCover(site, E_FAIL);
+            } else if (wParam == ID_TIMER_SNAPSHOT_FADE) {
+                StepSnapshotFade(site);
             } else if (wParam == ID_TIMER_WEBVIEW_PRELOAD) {
                 KillTimer(hwnd, ID_TIMER_WEBVIEW_PRELOAD);
-                // Initial preload has settled: suspend now if still hidden and
-                // not being kept warm by a tray-hover prewarm.
-                if (!IsWindowActuallyVisible(hwnd) &&
-                    InterlockedCompareExchange(&g_webViewPrewarmActive, TRUE, TRUE) != TRUE) {
-                    DeactivateMainWebView();
-                }
+                // Preload has settled: suspends if still hidden and not kept
+                // warm by a tray-hover prewarm.
+                DispatchLifecycle(site, LC_EVENT_PRELOAD_SETTLED);
             } else if (wParam == ID_TIMER_WEBVIEW_RECREATE) {
                 // BrowserProcessExited never arrived; rebuild anyway.
                 DebugPrint(L"[WARNING] Browser exit event not received; rebuilding WebView after timeout\n");
-                FinishMainWebViewRecreate(hwnd);
+                FinishMainWebViewRecreate();
             } else if (wParam == ID_TIMER_POWER_RESUME) {
                 KillTimer(hwnd, ID_TIMER_POWER_RESUME);
-                g_powerKickCount++;
-                KickWebViewAfterPowerResume(hwnd);
+                DispatchLifecycle(site, LC_EVENT_KICK_DUE);
             } else if (wParam == ID_TIMER_WEBVIEW_LIVENESS) {
                 KillTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS);
-                CheckMainWebViewLiveness(hwnd);
+                CheckMainWebViewLiveness(site);
             }
             return 0;
 
@@ -3313,38 +4873,30 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 // Going down: from here on, nothing we believe about the
                 // runtime's suspend/resume state can be trusted. The recovery
                 // sequence starts when a resume broadcast arrives.
-                InterlockedExchange(&g_powerResumePending, TRUE);
+                DispatchLifecycle(site, LC_EVENT_POWER_SUSPEND);
                 return TRUE;
             }
             if (wParam == PBT_APMQUERYSUSPENDFAILED) {
                 // The suspend was vetoed; there is nothing to recover from.
-                InterlockedExchange(&g_powerResumePending, FALSE);
+                DispatchLifecycle(site, LC_EVENT_POWER_ABORTED);
                 return TRUE;
             }
             if (wParam == PBT_APMRESUMEAUTOMATIC || wParam == PBT_APMRESUMESUSPEND ||
                 wParam == PBT_APMRESUMECRITICAL) {
-                // (Re)start the recovery sequence. Several resume broadcasts
-                // can arrive for a single resume; restarting is idempotent.
-                // Give the graphics stack a moment to come back up before the
-                // first kick (see KickWebViewAfterPowerResume).
-                KillTimer(hwnd, ID_TIMER_POWER_RESUME);
-                KillTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS);
-                InterlockedExchange(&g_webViewPingOutstanding, FALSE);
-                InterlockedExchange(&g_powerResumePending, TRUE);
-                g_powerKickCount = 0;
-                SetTimer(hwnd, ID_TIMER_POWER_RESUME, POWER_RESUME_KICK_DELAY_MS, NULL);
+                // (Re)start the recovery sequence of kicks and liveness pings.
+                DispatchLifecycle(site, LC_EVENT_POWER_RESUME);
             }
             return TRUE;
             
         case WM_SYSCOMMAND:
             if ((wParam & 0xFFF0) == SC_MINIMIZE) {
-                HideMainWindow();
+                HideMainWindow(site);
                 return 0;
             }
             break;
             
         case WM_CLOSE:
-            HideMainWindow();
+            HideMainWindow(site);
             return 0;
             
         case WM_DESTROY:
@@ -3352,6 +4904,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             KillTimer(hwnd, ID_TIMER_WEBVIEW_PRELOAD);
             KillTimer(hwnd, ID_TIMER_POWER_RESUME);
             KillTimer(hwnd, ID_TIMER_WEBVIEW_LIVENESS);
+            StopOcclusionTracking(site);
+            site->hwnd = NULL;
             PostQuitMessage(0);
             return 0;
             
@@ -3367,64 +4921,79 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             return 0;
 
+        case WM_APP_CONFIG_CHANGED: {
+            // Settings changed in the registry: apply what differs from the
+            // live configuration, as a dialog save would (minus the write).
+            Configuration* next = (Configuration*)lParam;
+            DWORD changed = config_diff(&site->config, next);
+            if (changed) {
+                DebugPrint(L"[INFO] Configuration of site %d reloaded from registry (changed fields: 0x%02lx)\n",
+                           site->index, (unsigned long)changed);
+                CommitConfiguration(site, next, changed);
+            } else {
+                config_release(next);
+            }
+            free(next);
+            return 0;
+        }
+
         case WM_APP_WEBVIEW_RECREATE:
             if (InterlockedCompareExchange(&g_webViewRecreatePending, TRUE, TRUE) == TRUE) {
                 // Deliberate rebuild (spell-check change): the browser was
                 // asked to exit and now has.
-                FinishMainWebViewRecreate(hwnd);
+                FinishMainWebViewRecreate();
             } else {
                 // Unsolicited: the browser process died or stopped resuming.
-                HandleUnexpectedBrowserExit(hwnd);
+                HandleUnexpectedBrowserExit();
             }
             return 0;
 
         case WM_TRAYICON:
             switch (lParam) {
-                case WM_MOUSEMOVE: PrewarmMainWebView(); break;
-                case WM_LBUTTONDBLCLK: ShowMainWindow(); break;
-                case WM_RBUTTONUP: ShowContextMenu(hwnd); break;
+                case WM_MOUSEMOVE: DispatchLifecycle(site, LC_EVENT_HOVER); break;
+                case WM_LBUTTONDBLCLK: ShowMainWindow(site); break;
+                case WM_RBUTTONUP: ShowContextMenu(site); break;
             }
             return 0;
             
         case WM_COMMAND:
             switch (wParam) {
                 case ID_TRAY_MENU_REFRESH:
-                    RebuildMainWebViewIfDead();
+                    RebuildMainWebViewIfDead(site);
                     // If window is already restored and visible, don't reposition it
-                    if (IsWindowVisible(g_hwnd) && !IsIconic(g_hwnd) && IsWindowActuallyVisible(g_hwnd)) {
-                        SetForegroundWindow(g_hwnd);
+                    if (IsWindowVisible(hwnd) && !IsIconic(hwnd) && IsWindowActuallyVisible(hwnd)) {
+                        SetForegroundWindow(hwnd);
                     } else {
-                        ShowMainWindow();
+                        ShowMainWindow(site);
                     }
-                    ReloadTargetPage();
+                    ReloadTargetPage(site);
                     return 0;
                 case ID_TRAY_MENU_CLEAR_CACHE:
-                    RebuildMainWebViewIfDead();
+                    RebuildMainWebViewIfDead(site);
                     // If window is already restored and visible, don't reposition it
-                    if (IsWindowVisible(g_hwnd) && !IsIconic(g_hwnd) && IsWindowActuallyVisible(g_hwnd)) {
-                        SetForegroundWindow(g_hwnd);
+                    if (IsWindowVisible(hwnd) && !IsIconic(hwnd) && IsWindowActuallyVisible(hwnd)) {
+                        SetForegroundWindow(hwnd);
                     } else {
-                        ShowMainWindow();
+                        ShowMainWindow(site);
                     }
-                    ClearWebViewCacheAndReload();
+                    ClearWebViewCacheAndReload(site);
                     return 0;
                 case ID_TRAY_MENU_OPEN:
-                    ShowMainWindow();
+                    ShowMainWindow(site);
                     return 0;
                 case ID_TRAY_MENU_RESTART:
                     RestartApplication();
                     return 0;
+                case ID_TRAY_MENU_SAVE_STATS:
+                    SaveWebViewStats();
+                    return 0;
                 case ID_TRAY_MENU_CONFIGURE:
                     g_cfgSaved = FALSE;
-                    ShowConfigWebViewDialog();
+                    ShowConfigWebViewDialog(site);
                     return 0;
                 case ID_TRAY_MENU_EXIT:
                     // Clean up tray icon resources before exit
-                    if (g_nid.hIcon) {
-                        DestroyIcon(g_nid.hIcon);
-                        g_nid.hIcon = NULL;
-                    }
-                    Shell_NotifyIconW(NIM_DELETE, &g_nid);
+                    RemoveTrayIcons();
                     PostQuitMessage(0);
                     return 0;
             }
@@ -3432,9 +5001,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             
         default:
             if (uMsg == g_WM_TASKBARCREATED) {
-                // Explorer restarted: re-add the icon. RefreshTrayIcon also
-                // destroys the old HICON, which a bare CreateTrayIcon leaks.
-                RefreshTrayIcon();
+                // Explorer restarted: re-add the icon (each site window gets
+                // the broadcast). RefreshTrayIcon also destroys the old
+                // HICON, which a bare CreateTrayIcon leaks.
+                RefreshTrayIcon(site);
                 return 0;
             }
     }
@@ -3454,6 +5024,68 @@ void DebugPrint(const wchar_t* format, ...) {
 }
 
 // Entry point
+// Load the additional sites: one subkey per site under REG_KEY_PATH\Sites,
+// holding the same values as the primary settings key. Read once at start;
+// sites added or removed while running take effect on the next launch.
+static void LoadExtraSites(void) {
+    HKEY hKey;
+    wchar_t sitesPath[MAX_PATH];
+    swprintf_s(sitesPath, MAX_PATH, L"%s\\%s", REG_KEY_PATH, REG_SITES_SUBKEY);
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, sitesPath, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+        return;
+    }
+
+    for (DWORD i = 0; g_siteCount < SITE_MAX; i++) {
+        wchar_t name[64];
+        DWORD nameLen = sizeof(name) / sizeof(name[0]);
+        LONG rc = RegEnumKeyExW(hKey, i, name, &nameLen, NULL, NULL, NULL, NULL);
+        if (rc == ERROR_NO_MORE_ITEMS) break;
+        if (rc != ERROR_SUCCESS) continue;  // name too long for a site
+
+        Site* site = &g_sites[g_siteCount];
+        ZeroMemory(site, sizeof(*site));
+        site->index = g_siteCount;
+        wcscpy_s(site->name, 64, name);
+        RegistryConfigStore_Init(&site->registryStore, name);
+        site->store = &site->registryStore.base;
+        if (!config_store_load(site->store, &site->config, NULL) || !site->config.blob) {
+            DebugPrint(L"[WARNING] Site '%s' could not be loaded; skipped\n", name);
+            config_release(&site->config);
+            continue;
+        }
+        if (!site->config.url[0]) {
+            DebugPrint(L"[WARNING] Site '%s' has no URL; skipped\n", name);
+            config_release(&site->config);
+            continue;
+        }
+        // Sites are provisioned in the registry, never through the
+        // first-launch dialog.
+        site->isConfigured = TRUE;
+        g_siteCount++;
+        DebugPrint(L"[INFO] Loaded site '%s': %s\n", name, site->config.url);
+    }
+    if (g_siteCount == SITE_MAX) {
+        DebugPrint(L"[WARNING] Only the first %d sites are loaded\n", SITE_MAX);
+    }
+    RegCloseKey(hKey);
+}
+
+// The INI profile named on the command line (--profile=NAME), or NULL.
+static const wchar_t* GetIniProfileArg(void) {
+    static wchar_t profile[64];
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return NULL;
+    BOOL found = FALSE;
+    for (int i = 1; i < argc; i++) {
+        if (wcsncmp(argv[i], L"--profile=", 10) == 0 && argv[i][10] != L'\0') {
+            found = wcscpy_s(profile, sizeof(profile) / sizeof(profile[0]), argv[i] + 10) == 0;
+        }
+    }
+    LocalFree(argv);
+    return found ? profile : NULL;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     g_hInstance = hInstance;
     
@@ -3501,29 +5133,48 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     wcscpy_s(g_iniPath, MAX_PATH, exePath);
     PathAppendW(g_iniPath, CONFIG_FILENAME);
 
-    // Check if this is the first launch
-    BOOL isFirstLaunch = IsFirstLaunch();
-
-    // Try to load config from registry first
-    if (!LoadConfigFromRegistry(&g_config)) {
+    // Load the primary site from the registry first; the same read tells
+    // whether this is the first launch.
+    Site* primary = &g_sites[0];
+    primary->index = 0;
+    RegistryConfigStore_Init(&primary->registryStore, NULL);
+    primary->store = &primary->registryStore.base;
+    g_siteCount = 1;
+    const wchar_t* iniProfile = GetIniProfileArg();
+    if (!config_store_load(primary->store, &primary->config, &primary->isConfigured)) {
         // Fallback to INI file (for migration or first launch)
-        LoadConfiguration(g_iniPath, &g_config);
+        FileConfigStore iniStore;
+        FileConfigStore_Init(&iniStore, g_iniPath, iniProfile);
+        config_store_load(&iniStore.base, &primary->config, NULL);
+    } else if (iniProfile) {
+        DebugPrint(L"[INFO] Settings are in the registry; INI profile %s not read\n", iniProfile);
+    }
+    BOOL isFirstLaunch = !primary->isConfigured;
+    if (!primary->config.blob) {
+        CoUninitialize();
+        if (g_hMutex) {
+            ReleaseMutex(g_hMutex);
+            CloseHandle(g_hMutex);
+        }
+        return 1;
     }
-    {
-        // Sanitize hand-edited registry/INI values so the JSON patch and
-        // Chromium both see well-formed language tags.
-        wchar_t rawLangs[512];
-        wcscpy_s(rawLangs, 512, g_config.spellcheckLanguages);
-        NormalizeSpellcheckLanguages(rawLangs, g_config.spellcheckLanguages, 512);
+    LoadExtraSites();
+    for (int i = 0; i < g_siteCount; i++) {
+        Site* site = &g_sites[i];
+        site->jsVisibility = JS_VISIBILITY_UNKNOWN;
+        site->shadow.sinceTick = GetTickCount64();
+        site->tier = -1;
+        site->idleSinceTick = site->shadow.sinceTick;
+        NormalizeConfigSpellcheckLanguages(&site->config);
+        lifecycle_init(&site->lifecycle, site->config.sleepWhenInactive, site->config.suspendDelay > 0,
+                       POWER_RESUME_MAX_KICKS);
+        InterlockedExchange(&site->openNewWindowsExternally, site->config.openNewWindowsExternally ? TRUE : FALSE);
     }
-    wcscpy_s(g_initialUrl, 2048, g_config.url);
-    InterlockedExchange(&g_sleepWhenInactive, g_config.sleepWhenInactive ? TRUE : FALSE);
-    InterlockedExchange(&g_openNewWindowsExternally, g_config.openNewWindowsExternally ? TRUE : FALSE);
 
     // On first launch, show configuration dialog
     if (isFirstLaunch) {
         g_cfgSaved = FALSE;
-        ShowConfigWebViewDialog();
+        ShowConfigWebViewDialog(primary);
         // Nested message loop — runs until config dialog is closed
         MSG cfgMsg;
         while (g_cfgHwnd && GetMessage(&cfgMsg, NULL, 0, 0)) {
@@ -3539,14 +5190,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
             }
             return 0;
         }
-        wcscpy_s(g_initialUrl, 2048, g_config.url);
     }
 
-    // Apply spell-check languages to the WebView2 profile before the browser
-    // process launches (the Preferences file can only be edited while the
+    // Apply spell-check languages and managed preferences to the WebView2
+    // profile before the browser process launches (the Preferences file can only be edited while the
     // profile is not in use). The config dialog above uses a separate user
     // data folder, so it does not conflict with this.
-    PatchSpellcheckPreferences();
+    PatchProfilePreferences();
 
     // Register invisible owner window class (prevents taskbar appearance)
     WNDCLASSEXW ownerWc = {0};
@@ -3582,20 +5232,32 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         return 1;
     }
     
-    // Create main window with invisible owner (prevents taskbar appearance)
-    g_hwnd = CreateWindowExW(0, L"SystrayLauncherClass", g_config.windowTitle,
-                            WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
-                            1024, 768, g_hwndOwner, NULL, hInstance, NULL);
-    if (!g_hwnd) {
-        MessageBoxW(NULL, L"Failed to create window", L"Error", MB_OK | MB_ICONERROR);
-        return 1;
+    // Create one window per site, all with the invisible owner (prevents
+    // taskbar appearance). WindowProc binds each window to its site.
+    for (int i = 0; i < g_siteCount; i++) {
+        Site* site = &g_sites[i];
+        CreateWindowExW(0, L"SystrayLauncherClass", site->config.windowTitle,
+                        WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
+                        1024, 768, g_hwndOwner, NULL, hInstance, site);
+        if (!site->hwnd) {
+            if (i == 0) {
+                MessageBoxW(NULL, L"Failed to create window", L"Error", MB_OK | MB_ICONERROR);
+                return 1;
+            }
+            DebugPrint(L"[WARNING] Failed to create the window for site '%s'\n", site->name);
+        }
     }
     
     // Register for taskbar restart notifications
     g_WM_TASKBARCREATED = RegisterWindowMessageW(L"TaskbarCreated");
     
-    // Create tray icon (loads embedded icon)
-    CreateTrayIcon(g_hwnd);
+    // Create tray icons (loads embedded icon)
+    for (int i = 0; i < g_siteCount; i++) {
+        if (g_sites[i].hwnd) CreateTrayIcon(&g_sites[i]);
+    }
+
+    // Pick up settings pushed to the registry while running
+    StartConfigWatcher();
     
     // Message loop
     MSG msg;
@@ -3604,25 +5266,30 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         DispatchMessage(&msg);
     }
     
+    StopConfigWatcher();
+
     // Cleanup. Close() the controller (as the rebuild paths do) so the
     // browser process shuts down and flushes its profile promptly instead of
     // waiting to notice the host process disappear.
-    if (g_webView) g_webView->lpVtbl->Release(g_webView);
-    if (g_webViewController) {
-        g_webViewController->lpVtbl->Close(g_webViewController);
-        g_webViewController->lpVtbl->Release(g_webViewController);
+    for (int i = 0; i < g_siteCount; i++) {
+        Site* site = &g_sites[i];
+        if (site->webView) site->webView->lpVtbl->Release(site->webView);
+        if (site->webViewController) {
+            site->webViewController->lpVtbl->Close(site->webViewController);
+            site->webViewController->lpVtbl->Release(site->webViewController);
+        }
     }
     if (g_webViewEnv) {
         UnregisterBrowserExitedFromCurrentEnv();
         g_webViewEnv->lpVtbl->Release(g_webViewEnv);
     }
     
-    // Clean up tray icon and its resources
-    if (g_nid.hIcon) {
-        DestroyIcon(g_nid.hIcon);
-        g_nid.hIcon = NULL;
+    // Clean up tray icons and their resources
+    RemoveTrayIcons();
+    for (int i = 0; i < g_siteCount; i++) {
+        config_release(&g_sites[i].config);
+        SetSiteSnapshot(&g_sites[i], NULL, 0, 0);
     }
-    Shell_NotifyIconW(NIM_DELETE, &g_nid);
     
     CoUninitialize();
     if (g_hwndOwner) {
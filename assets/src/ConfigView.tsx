@@ -24,6 +24,9 @@ export default function ConfigView({ config }: Props) {
   const [openNewWindowsExternally, setOpenNewWindowsExternally] = useState(
     config.openNewWindowsExternally ?? false
   );
+  const [suspendDelay, setSuspendDelay] = useState(
+    String(config.suspendDelay ?? 30)
+  );
   const [urlError, setUrlError] = useState("");
 
   function handleSave() {
@@ -41,6 +44,7 @@ export default function ConfigView({ config }: Props) {
       sleepWhenInactive,
       spellcheckLanguages: spellcheckLanguages.trim(),
       openNewWindowsExternally,
+      suspendDelay: Math.max(0, parseInt(suspendDelay, 10) || 0),
     });
   }
 
@@ -148,6 +152,25 @@ export default function ConfigView({ config }: Props) {
         </div>
       </div>
 
+      {sleepWhenInactive && (
+        <div className="space-y-1 pl-6">
+          <Label htmlFor="suspendDelay">Sleep after (seconds hidden)</Label>
+          <Input
+            id="suspendDelay"
+            type="number"
+            min={0}
+            max={3600}
+            className="w-24"
+            value={suspendDelay}
+            onChange={(e) => setSuspendDelay(e.target.value)}
+          />
+          <p className="text-neutral-500 text-[11px] leading-snug">
+            Reopening the window within this time finds the page still
+            running. 0 sleeps as soon as the window is hidden.
+          </p>
+        </div>
+      )}
+
       <div className="flex justify-end gap-2 pt-1">
         <Button variant="outline" size="sm" className="min-w-[5rem]" onClick={closeDialog}>
           Cancel
@@ -6,6 +6,7 @@ export interface ConfigData {
   sleepWhenInactive: boolean;
   spellcheckLanguages: string;
   openNewWindowsExternally: boolean;
+  suspendDelay: number;
 }
 
 export interface InitData {
@@ -40,6 +41,7 @@ export function saveSettings(config: ConfigData) {
       sleepWhenInactive: config.sleepWhenInactive,
       spellcheckLanguages: config.spellcheckLanguages,
       openNewWindowsExternally: config.openNewWindowsExternally,
+      suspendDelay: config.suspendDelay,
     })
   );
 }
@@ -0,0 +1,81 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Shared by the native check-and-time tools: occlusion_bench.c (make bench),
+// config_bench.c, json_bench.c and msg_bench.c (make config-bench,
+// json-bench, msg-bench). Each builds and runs anywhere, no Windows needed,
+// and takes the same arguments:
+//
+//   <tool> [-q]    check, then time (-q: check only)
+//
+// The checks run first and count failures; the tool exits non-zero if any
+// failed (bench_finish), and only times code that passed them.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// xorshift32: the same inputs on every run and platform. Tools reseed g_rng
+// where a check must see the same sequence more than once.
+static unsigned g_rng = 0x9E3779B9u;
+
+static inline unsigned rnd(unsigned n) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return g_rng % n;
+}
+
+static int g_failures;
+
+#define CHECK(cond, what)                                   \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            printf("  FAILED: %s (line %d)\n", what, __LINE__); \
+            g_failures++;                                   \
+        }                                                   \
+    } while (0)
+
+// Timing: repeat the body until BENCH_MIN_CLOCKS of CPU time have passed,
+// counting what each round did, then report the cost of one.
+//
+//   BenchTimer t;
+//   bench_start(&t);
+//   do { ...1000 calls... } while (bench_more(&t, 1000));
+//   double ns = bench_ns(&t);
+#define BENCH_MIN_CLOCKS (CLOCKS_PER_SEC / 5)
+
+typedef struct {
+    clock_t start;
+    clock_t now;
+    double done;
+} BenchTimer;
+
+static inline void bench_start(BenchTimer* t) {
+    t->done = 0;
+    t->start = t->now = clock();
+}
+
+static inline int bench_more(BenchTimer* t, long done) {
+    t->done += (double)done;
+    t->now = clock();
+    return t->now - t->start < BENCH_MIN_CLOCKS;
+}
+
+// Nanoseconds per unit counted by bench_more.
+static inline double bench_ns(const BenchTimer* t) {
+    return (double)(t->now - t->start) / CLOCKS_PER_SEC * 1e9 / t->done;
+}
+
+static inline int bench_quick(int argc, char** argv) {
+    return argc > 1 && strcmp(argv[1], "-q") == 0;
+}
+
+// failures: those counted outside CHECK. Returns the exit status.
+static inline int bench_finish(int failures) {
+    failures += g_failures;
+    if (failures) printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,876 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Settings model shared by every backend: the refcounted Configuration, the
+// builder that produces it, and the merge of raw registry-typed values into
+// it (config_builder_put) and back out (config_write_values), the
+// spell-check language normalization and the INI text parser. A ConfigStore
+// only moves raw values. Nothing below needs Win32 beyond its type names, so
+// config_bench.c loads, merges, saves and parses through the same code on
+// any platform, against the in-memory store at the end of this file.
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#ifdef _WIN32
+#include <windows.h>
+void DebugPrint(const wchar_t* format, ...);
+#else
+// Native builds (the dev tools, which define _POSIX_C_SOURCE 200809L for
+// wcscasecmp and wcsnlen): the Win32 names this file uses
+#include <stdint.h>
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+#define TRUE 1
+#define FALSE 0
+#define MAXDWORD 0xffffffffu
+#define REG_SZ 1
+#define REG_EXPAND_SZ 2
+#define REG_DWORD 4
+#define REG_MULTI_SZ 7
+#define ERROR_SUCCESS 0
+#define ERROR_OUTOFMEMORY 14
+#define ERROR_INVALID_PARAMETER 87
+#define InterlockedIncrement(p) __sync_add_and_fetch((p), 1)
+#define InterlockedDecrement(p) __sync_sub_and_fetch((p), 1)
+#define DebugPrint(...) ((void)0)
+#define _wcsicmp wcscasecmp
+#endif
+
+// Registry value names
+#define REG_VALUE_URL L"URL"
+#define REG_VALUE_TITLE L"WindowTitle"
+#define REG_VALUE_ONHIDEJS L"OnHideJS"
+#define REG_VALUE_ONSHOWJS L"OnShowJS"
+#define REG_VALUE_SLEEP L"SleepWhenInactive"
+#define REG_VALUE_SPELLCHECK L"SpellcheckLanguages"
+#define REG_VALUE_NEWWINDOW L"OpenNewWindowsExternally"
+#define REG_VALUE_SUSPENDDELAY L"SuspendDelay"
+#define REG_VALUE_STOPRENDERDELAY L"StopRenderDelay"
+#define REG_VALUE_TRIMMEMORYDELAY L"TrimMemoryDelay"
+#define REG_VALUE_DISCARDAFTER L"DiscardAfter"
+#define REG_VALUE_PARTIALPERCENT L"PartialPercent"
+#define REG_VALUE_PARTIALDELAY L"PartialDelay"
+#define REG_VALUE_MANAGEDPREFS L"ManagedPreferences"
+#define REG_VALUE_CONFIGURED L"Configured"
+
+// Defaults and upper bounds of the numeric settings (seconds, hours or
+// percent, as suffixed); SystrayLauncher.c describes what each one does.
+#define SUSPEND_DELAY_DEFAULT_S 30
+#define STOP_RENDER_DELAY_DEFAULT_S 5
+#define TRIM_MEMORY_DELAY_DEFAULT_S 15
+#define SUSPEND_DELAY_MAX_S 3600
+#define DISCARD_AFTER_MAX_H 168
+#define PARTIAL_PERCENT_MAX 100
+#define PARTIAL_DELAY_DEFAULT_S 10
+
+// String settings, by index into a ConfigBlob.
+typedef enum {
+    CFG_STR_URL,
+    CFG_STR_WINDOW_TITLE,
+    CFG_STR_ON_HIDE_JS,
+    CFG_STR_ON_SHOW_JS,
+    CFG_STR_SPELLCHECK_LANGUAGES,
+    CFG_STR_MANAGED_PREFS,
+    CFG_STR_COUNT
+} CfgStr;
+
+// Bits of a config diff (see config_diff): one per string, then the flags.
+typedef enum {
+    CFG_CHANGED_URL = 1 << CFG_STR_URL,
+    CFG_CHANGED_WINDOW_TITLE = 1 << CFG_STR_WINDOW_TITLE,
+    CFG_CHANGED_ON_HIDE_JS = 1 << CFG_STR_ON_HIDE_JS,
+    CFG_CHANGED_ON_SHOW_JS = 1 << CFG_STR_ON_SHOW_JS,
+    CFG_CHANGED_SPELLCHECK_LANGUAGES = 1 << CFG_STR_SPELLCHECK_LANGUAGES,
+    CFG_CHANGED_MANAGED_PREFS = 1 << CFG_STR_MANAGED_PREFS,
+    CFG_CHANGED_SLEEP_WHEN_INACTIVE = 1 << CFG_STR_COUNT,
+    CFG_CHANGED_OPEN_NEW_WINDOWS_EXTERNALLY = 1 << (CFG_STR_COUNT + 1),
+    CFG_CHANGED_SUSPEND_DELAY = 1 << (CFG_STR_COUNT + 2),
+    CFG_CHANGED_STOP_RENDER_DELAY = 1 << (CFG_STR_COUNT + 3),
+    CFG_CHANGED_TRIM_MEMORY_DELAY = 1 << (CFG_STR_COUNT + 4),
+    CFG_CHANGED_DISCARD_AFTER = 1 << (CFG_STR_COUNT + 5),
+    CFG_CHANGED_PARTIAL_PERCENT = 1 << (CFG_STR_COUNT + 6),
+    CFG_CHANGED_PARTIAL_DELAY = 1 << (CFG_STR_COUNT + 7),
+    CFG_CHANGED_ALL = (1 << (CFG_STR_COUNT + 8)) - 1
+} CfgChange;
+
+// All strings of one configuration live in a single refcounted allocation,
+// each stored once with its length in front: identical values (typically the
+// empty ones) share one copy. A blob is never modified after it is built, so
+// a change builds a new one (see ConfigBuilder) and readers holding the old
+// one keep a consistent snapshot.
+typedef struct {
+    volatile LONG refCount;
+    DWORD cch;                 // characters of text following the header
+    DWORD len[CFG_STR_COUNT];  // length of each string, terminator excluded
+    DWORD off[CFG_STR_COUNT];  // start of each string in the text
+    // text follows
+} ConfigBlob;
+
+// The string members point into blob. Copy a Configuration only through
+// config_snapshot() so the blob reference is counted.
+typedef struct {
+    ConfigBlob* blob;
+    const wchar_t* url;
+    const wchar_t* windowTitle;
+    const wchar_t* onHideJs;
+    const wchar_t* onShowJs;
+    // Comma-separated BCP-47 tags (e.g. L"en-US,pl"); empty = don't manage
+    // the WebView2 profile's spell-check settings at all.
+    const wchar_t* spellcheckLanguages;
+    // Chromium profile prefs written before browser start, one per line:
+    // "path=json" sets root.<path> (e.g. "net.network_prediction_options=2"),
+    // "!path" removes it. Stored as REG_MULTI_SZ.
+    const wchar_t* managedPrefs;
+    BOOL sleepWhenInactive;
+    BOOL openNewWindowsExternally;
+    DWORD suspendDelay;        // Seconds hidden before a sleeping page suspends
+    DWORD stopRenderDelay;     // ...before it stops rendering
+    DWORD trimMemoryDelay;     // ...before its memory target is lowered
+    DWORD discardAfter;        // Hours hidden before its WebView is discarded; 0 = never
+    DWORD partialPercent;      // Shown but less visible than this counts as covered; 0 = off
+    DWORD partialDelay;        // ...once it has lasted this many seconds
+} Configuration;
+
+// Collects the strings of a new configuration in one growable buffer. Fields
+// that are never set keep the base configuration's values (or the defaults
+// when there is no base), so a partial update copies nothing it doesn't
+// change.
+typedef struct {
+    const Configuration* base;
+    wchar_t* buf;
+    size_t used, cap;
+    size_t off[CFG_STR_COUNT];
+    size_t len[CFG_STR_COUNT];
+    BOOL set[CFG_STR_COUNT];
+    BOOL failed;
+    BOOL sleepWhenInactive;
+    BOOL openNewWindowsExternally;
+    DWORD suspendDelay;
+    DWORD stopRenderDelay;
+    DWORD trimMemoryDelay;
+    DWORD discardAfter;
+    DWORD partialPercent;
+    DWORD partialDelay;
+} ConfigBuilder;
+
+// Stored setting values, by index into k_cfgValueNames. The string values
+// share the CfgStr numbering, and the other settings follow them in the
+// same order as their CFG_CHANGED_* bits.
+typedef enum {
+    CFG_VALUE_SLEEP_WHEN_INACTIVE = CFG_STR_COUNT,
+    CFG_VALUE_OPEN_NEW_WINDOWS_EXTERNALLY,
+    CFG_VALUE_SUSPEND_DELAY,
+    CFG_VALUE_STOP_RENDER_DELAY,
+    CFG_VALUE_TRIM_MEMORY_DELAY,
+    CFG_VALUE_DISCARD_AFTER,
+    CFG_VALUE_PARTIAL_PERCENT,
+    CFG_VALUE_PARTIAL_DELAY,
+    CFG_VALUE_CONFIGURED,  // First-launch setup done; not a setting
+    CFG_VALUE_COUNT
+} CfgValue;
+
+// Where the configuration is kept. Backends only move raw values, typed as
+// in the registry; the defaults and the merge are shared (config_store_load).
+typedef struct ConfigStore ConfigStore;
+typedef struct {
+    // Merge every stored value into b. Returns FALSE when the store holds no
+    // configuration; *configured is set when the first-launch marker is.
+    BOOL (*Load)(ConfigStore* This, ConfigBuilder* b, BOOL* configured);
+    // Write the values selected by changed (CFG_CHANGED_* bits).
+    BOOL (*Save)(ConfigStore* This, const Configuration* config, DWORD changed);
+    void (*MarkConfigured)(ConfigStore* This);
+} ConfigStoreVtbl;
+
+struct ConfigStore {
+    const ConfigStoreVtbl* lpVtbl;
+};
+
+static const wchar_t* const k_cfgDefaults[CFG_STR_COUNT] = {
+    L"https://www.google.com/",  // url
+    L"Systray Launcher",         // windowTitle
+    L"", L"", L"", L""
+};
+
+static const wchar_t* config_str(const Configuration* c, CfgStr id) {
+    return (const wchar_t*)(c->blob + 1) + c->blob->off[id];
+}
+
+static inline size_t config_str_len(const Configuration* c, CfgStr id) {
+    return c->blob->len[id];
+}
+
+static inline BOOL config_str_equal(const Configuration* a, const Configuration* b, CfgStr id) {
+    if (a->blob == b->blob) return TRUE;
+    size_t len = a->blob->len[id];
+    return len == b->blob->len[id] && wmemcmp(config_str(a, id), config_str(b, id), len) == 0;
+}
+
+// The set of CFG_CHANGED_* bits for the settings that differ between a and b.
+static inline DWORD config_diff(const Configuration* a, const Configuration* b) {
+    DWORD changed = 0;
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        if (!config_str_equal(a, b, (CfgStr)i)) changed |= 1u << i;
+    }
+    if (!a->sleepWhenInactive != !b->sleepWhenInactive) {
+        changed |= CFG_CHANGED_SLEEP_WHEN_INACTIVE;
+    }
+    if (!a->openNewWindowsExternally != !b->openNewWindowsExternally) {
+        changed |= CFG_CHANGED_OPEN_NEW_WINDOWS_EXTERNALLY;
+    }
+    if (a->suspendDelay != b->suspendDelay) {
+        changed |= CFG_CHANGED_SUSPEND_DELAY;
+    }
+    if (a->stopRenderDelay != b->stopRenderDelay) {
+        changed |= CFG_CHANGED_STOP_RENDER_DELAY;
+    }
+    if (a->trimMemoryDelay != b->trimMemoryDelay) {
+        changed |= CFG_CHANGED_TRIM_MEMORY_DELAY;
+    }
+    if (a->discardAfter != b->discardAfter) {
+        changed |= CFG_CHANGED_DISCARD_AFTER;
+    }
+    if (a->partialPercent != b->partialPercent) {
+        changed |= CFG_CHANGED_PARTIAL_PERCENT;
+    }
+    if (a->partialDelay != b->partialDelay) {
+        changed |= CFG_CHANGED_PARTIAL_DELAY;
+    }
+    return changed;
+}
+
+static inline void config_bind(Configuration* c) {
+    c->url = config_str(c, CFG_STR_URL);
+    c->windowTitle = config_str(c, CFG_STR_WINDOW_TITLE);
+    c->onHideJs = config_str(c, CFG_STR_ON_HIDE_JS);
+    c->onShowJs = config_str(c, CFG_STR_ON_SHOW_JS);
+    c->spellcheckLanguages = config_str(c, CFG_STR_SPELLCHECK_LANGUAGES);
+    c->managedPrefs = config_str(c, CFG_STR_MANAGED_PREFS);
+}
+
+static inline void config_release(Configuration* c) {
+    if (c->blob && InterlockedDecrement(&c->blob->refCount) == 0) free(c->blob);
+    c->blob = NULL;
+}
+
+// Make dst a snapshot of src: it shares src's strings and is unaffected by
+// later changes to src. Release it with config_release().
+static inline void config_snapshot(Configuration* dst, const Configuration* src) {
+    *dst = *src;
+    if (dst->blob) InterlockedIncrement(&dst->blob->refCount);
+}
+
+static inline void config_builder_init(ConfigBuilder* b, const Configuration* base) {
+    memset(b, 0, sizeof(*b));
+    b->base = (base && base->blob) ? base : NULL;
+    if (b->base) {
+        b->sleepWhenInactive = base->sleepWhenInactive;
+        b->openNewWindowsExternally = base->openNewWindowsExternally;
+        b->suspendDelay = base->suspendDelay;
+        b->stopRenderDelay = base->stopRenderDelay;
+        b->trimMemoryDelay = base->trimMemoryDelay;
+        b->discardAfter = base->discardAfter;
+        b->partialPercent = base->partialPercent;
+        b->partialDelay = base->partialDelay;
+    } else {
+        b->suspendDelay = SUSPEND_DELAY_DEFAULT_S;
+        b->stopRenderDelay = STOP_RENDER_DELAY_DEFAULT_S;
+        b->trimMemoryDelay = TRIM_MEMORY_DELAY_DEFAULT_S;
+        b->partialDelay = PARTIAL_DELAY_DEFAULT_S;
+    }
+}
+
+// Room for cch characters plus a terminator at the end of the buffer, to be
+// claimed with config_builder_commit(). NULL when out of memory.
+static inline wchar_t* config_builder_reserve(ConfigBuilder* b, size_t cch) {
+    if (b->failed) return NULL;
+    if (b->used + cch + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 1024;
+        while (cap < b->used + cch + 1) cap *= 2;
+        wchar_t* buf = (wchar_t*)realloc(b->buf, cap * sizeof(wchar_t));
+        if (!buf) {
+            b->failed = TRUE;
+            return NULL;
+        }
+        b->buf = buf;
+        b->cap = cap;
+    }
+    return b->buf + b->used;
+}
+
+// The last reserved space now holds field id, len characters long.
+static inline void config_builder_commit(ConfigBuilder* b, CfgStr id, size_t len) {
+    b->buf[b->used + len] = L'\0';
+    b->off[id] = b->used;
+    b->len[id] = len;
+    b->set[id] = TRUE;
+    b->used += len + 1;
+}
+
+static inline void config_builder_set(ConfigBuilder* b, CfgStr id, const wchar_t* s, size_t len) {
+    wchar_t* dst = config_builder_reserve(b, len);
+    if (!dst) return;
+    wmemcpy(dst, s, len);
+    config_builder_commit(b, id, len);
+}
+
+// Build the blob and swap it into out, releasing out's previous strings (out
+// may be the builder's base). Frees the builder. On failure out is untouched
+// and FALSE is returned.
+static inline BOOL config_builder_finish(ConfigBuilder* b, Configuration* out) {
+    const wchar_t* src[CFG_STR_COUNT];
+    size_t len[CFG_STR_COUNT];
+    int same[CFG_STR_COUNT];
+    size_t cch = 0;
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        if (b->set[i]) {
+            src[i] = b->buf + b->off[i];
+            len[i] = b->len[i];
+        } else if (b->base) {
+            src[i] = config_str(b->base, (CfgStr)i);
+            len[i] = config_str_len(b->base, (CfgStr)i);
+        } else {
+            src[i] = k_cfgDefaults[i];
+            len[i] = wcslen(k_cfgDefaults[i]);
+        }
+        same[i] = i;
+        for (int j = 0; j < i; j++) {
+            if (same[j] == j && len[j] == len[i] && wmemcmp(src[j], src[i], len[i]) == 0) {
+                same[i] = j;
+                break;
+            }
+        }
+        if (same[i] == i) cch += len[i] + 1;
+    }
+
+    ConfigBlob* blob = NULL;
+    if (!b->failed && cch <= MAXDWORD) {
+        blob = (ConfigBlob*)malloc(sizeof(ConfigBlob) + cch * sizeof(wchar_t));
+    }
+    if (!blob) {
+        free(b->buf);
+        b->buf = NULL;
+        DebugPrint(L"[WARNING] Out of memory building the configuration\n");
+        return FALSE;
+    }
+    blob->refCount = 1;
+    blob->cch = (DWORD)cch;
+    wchar_t* text = (wchar_t*)(blob + 1);
+    size_t pos = 0;
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        blob->len[i] = (DWORD)len[i];
+        if (same[i] != i) {
+            blob->off[i] = blob->off[same[i]];
+            continue;
+        }
+        blob->off[i] = (DWORD)pos;
+        wmemcpy(text + pos, src[i], len[i]);
+        pos += len[i];
+        text[pos++] = L'\0';
+    }
+    free(b->buf);
+    b->buf = NULL;
+
+    Configuration next = {0};
+    next.blob = blob;
+    next.sleepWhenInactive = b->sleepWhenInactive;
+    next.openNewWindowsExternally = b->openNewWindowsExternally;
+    next.suspendDelay = b->suspendDelay;
+    next.stopRenderDelay = b->stopRenderDelay;
+    next.trimMemoryDelay = b->trimMemoryDelay;
+    next.discardAfter = b->discardAfter;
+    next.partialPercent = b->partialPercent;
+    next.partialDelay = b->partialDelay;
+    config_bind(&next);
+    config_release(out);
+    *out = next;
+    return TRUE;
+}
+
+// Normalize a comma-separated list of spell-check language tags: trim
+// whitespace, drop tokens with characters other than letters/digits/hyphens
+// (they would be invalid tags and must not reach the JSON patch), dedupe, and
+// fix the usual BCP-47 casing (en-us -> en-US, pt-br -> pt-BR) so the tags
+// match Chromium's dictionary names.
+static inline void config_normalize_languages(const wchar_t* in, wchar_t* out, size_t outLen) {
+    size_t o = 0;
+    if (outLen == 0) return;
+    out[0] = L'\0';
+    if (!in) return;
+
+    const wchar_t* p = in;
+    while (*p) {
+        while (*p == L',' || *p == L';' || iswspace(*p)) p++;
+        if (!*p) break;
+
+        wchar_t token[32];
+        size_t t = 0;
+        BOOL valid = TRUE;
+        while (*p && *p != L',' && *p != L';' && !iswspace(*p)) {
+            wchar_t c = (*p == L'_') ? L'-' : *p;
+            if (!iswalnum(c) && c != L'-') valid = FALSE;
+            if (t < 31) token[t++] = c; else valid = FALSE;
+            p++;
+        }
+        token[t] = L'\0';
+        if (!valid || t == 0) continue;
+
+        // Casing per subtag: primary lowercase, 2-letter region UPPER,
+        // 4-letter script Titlecase.
+        size_t start = 0;
+        for (size_t i = 0; i <= t && valid; i++) {
+            if (token[i] == L'-' || token[i] == L'\0') {
+                size_t len = i - start;
+                if (len == 0) { valid = FALSE; break; }
+                if (start == 0) {
+                    for (size_t j = start; j < i; j++) token[j] = towlower(token[j]);
+                } else if (len == 2) {
+                    for (size_t j = start; j < i; j++) token[j] = towupper(token[j]);
+                } else if (len == 4) {
+                    token[start] = towupper(token[start]);
+                    for (size_t j = start + 1; j < i; j++) token[j] = towlower(token[j]);
+                } else {
+                    for (size_t j = start; j < i; j++) token[j] = towlower(token[j]);
+                }
+                start = i + 1;
+            }
+        }
+        if (!valid) continue;
+
+        // Skip duplicates
+        BOOL dup = FALSE;
+        const wchar_t* q = out;
+        while (*q) {
+            const wchar_t* e = wcschr(q, L',');
+            size_t len = e ? (size_t)(e - q) : wcslen(q);
+            if (len == t && wcsncmp(q, token, t) == 0) { dup = TRUE; break; }
+            q = e ? e + 1 : q + len;
+        }
+        if (dup) continue;
+
+        size_t need = t + (o > 0 ? 1 : 0);
+        if (o + need + 1 > outLen) break;
+        if (o > 0) out[o++] = L',';
+        wmemcpy(out + o, token, t);
+        o += t;
+        out[o] = L'\0';
+    }
+}
+
+static const wchar_t* const k_cfgValueNames[CFG_VALUE_COUNT] = {
+    REG_VALUE_URL,
+    REG_VALUE_TITLE,
+    REG_VALUE_ONHIDEJS,
+    REG_VALUE_ONSHOWJS,
+    REG_VALUE_SPELLCHECK,
+    REG_VALUE_MANAGEDPREFS,
+    REG_VALUE_SLEEP,
+    REG_VALUE_NEWWINDOW,
+    REG_VALUE_SUSPENDDELAY,
+    REG_VALUE_STOPRENDERDELAY,
+    REG_VALUE_TRIMMEMORYDELAY,
+    REG_VALUE_DISCARDAFTER,
+    REG_VALUE_PARTIALPERCENT,
+    REG_VALUE_PARTIALDELAY,
+    REG_VALUE_CONFIGURED
+};
+
+// Value names are case-insensitive, as in the registry. -1 if not ours.
+static inline int config_value_lookup(const wchar_t* name) {
+    for (int i = 0; i < CFG_VALUE_COUNT; i++) {
+        if (_wcsicmp(name, k_cfgValueNames[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// Merge one stored value into b. Strings are read whole; REG_MULTI_SZ lists
+// are kept as newline-separated lines. Values of an unexpected type are
+// ignored, so the default (or base) stays in place.
+static inline void config_builder_put(ConfigBuilder* b, int value, DWORD type,
+                                      const BYTE* data, DWORD size, BOOL* configured) {
+    if (value < CFG_STR_COUNT) {
+        if (type != REG_SZ && type != REG_EXPAND_SZ && type != REG_MULTI_SZ) return;
+        size_t n = size / sizeof(wchar_t);
+        wchar_t* dst = config_builder_reserve(b, n);
+        if (!dst) return;
+        memcpy(dst, data, n * sizeof(wchar_t));
+        if (type == REG_MULTI_SZ) {
+            for (size_t i = 0; i < n; i++) {
+                if (dst[i] == L'\0') dst[i] = L'\n';
+            }
+            while (n > 0 && dst[n - 1] == L'\n') n--;
+        } else {
+            // REG_SZ data is not guaranteed to be null-terminated
+            n = wcsnlen(dst, n);
+        }
+        config_builder_commit(b, (CfgStr)value, n);
+        return;
+    }
+
+    if (type != REG_DWORD || size < sizeof(DWORD)) return;
+    DWORD v;
+    memcpy(&v, data, sizeof(v));
+    switch (value) {
+        case CFG_VALUE_SLEEP_WHEN_INACTIVE: b->sleepWhenInactive = (v != 0); break;
+        case CFG_VALUE_OPEN_NEW_WINDOWS_EXTERNALLY: b->openNewWindowsExternally = (v != 0); break;
+        case CFG_VALUE_SUSPEND_DELAY: b->suspendDelay = v < SUSPEND_DELAY_MAX_S ? v : SUSPEND_DELAY_MAX_S; break;
+        case CFG_VALUE_STOP_RENDER_DELAY: b->stopRenderDelay = v < SUSPEND_DELAY_MAX_S ? v : SUSPEND_DELAY_MAX_S; break;
+        case CFG_VALUE_TRIM_MEMORY_DELAY: b->trimMemoryDelay = v < SUSPEND_DELAY_MAX_S ? v : SUSPEND_DELAY_MAX_S; break;
+        case CFG_VALUE_DISCARD_AFTER: b->discardAfter = v < DISCARD_AFTER_MAX_H ? v : DISCARD_AFTER_MAX_H; break;
+        case CFG_VALUE_PARTIAL_PERCENT: b->partialPercent = v < PARTIAL_PERCENT_MAX ? v : PARTIAL_PERCENT_MAX; break;
+        case CFG_VALUE_PARTIAL_DELAY: b->partialDelay = v < SUSPEND_DELAY_MAX_S ? v : SUSPEND_DELAY_MAX_S; break;
+        case CFG_VALUE_CONFIGURED: if (configured) *configured = (v != 0); break;
+    }
+}
+
+typedef LONG (*ConfigValueWriter)(void* ctx, const wchar_t* name, DWORD type,
+                                  const BYTE* data, DWORD size);
+
+// Serialize the settings selected by changed (CFG_CHANGED_* bits) as
+// registry-typed values and hand each to write. FALSE if any write failed.
+static inline BOOL config_write_values(const Configuration* config, DWORD changed,
+                                       ConfigValueWriter write, void* ctx) {
+    BOOL ok = TRUE;
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        if (!(changed & (1u << i))) continue;
+        const wchar_t* s = config_str(config, (CfgStr)i);
+        size_t len = config_str_len(config, (CfgStr)i);
+        if (i != CFG_STR_MANAGED_PREFS) {
+            ok &= write(ctx, k_cfgValueNames[i], REG_SZ, (const BYTE*)s,
+                        (DWORD)((len + 1) * sizeof(wchar_t))) == ERROR_SUCCESS;
+            continue;
+        }
+
+        // Lines -> REG_MULTI_SZ, empty lines dropped
+        wchar_t* multiSz = (wchar_t*)malloc((len + 2) * sizeof(wchar_t));
+        if (!multiSz) {
+            ok = FALSE;
+            continue;
+        }
+        size_t m = 0;
+        for (const wchar_t* c = s; *c; c++) {
+            if (*c != L'\n') {
+                multiSz[m++] = *c;
+            } else if (m > 0 && multiSz[m - 1] != L'\0') {
+                multiSz[m++] = L'\0';
+            }
+        }
+        if (m > 0 && multiSz[m - 1] != L'\0') multiSz[m++] = L'\0';
+        multiSz[m++] = L'\0';
+        ok &= write(ctx, k_cfgValueNames[i], REG_MULTI_SZ, (const BYTE*)multiSz,
+                    (DWORD)(m * sizeof(wchar_t))) == ERROR_SUCCESS;
+        free(multiSz);
+    }
+    if (changed & CFG_CHANGED_SLEEP_WHEN_INACTIVE) {
+        DWORD sleepVal = config->sleepWhenInactive ? 1 : 0;
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_SLEEP_WHEN_INACTIVE], REG_DWORD,
+                    (const BYTE*)&sleepVal, sizeof(sleepVal)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_OPEN_NEW_WINDOWS_EXTERNALLY) {
+        DWORD newWinVal = config->openNewWindowsExternally ? 1 : 0;
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_OPEN_NEW_WINDOWS_EXTERNALLY], REG_DWORD,
+                    (const BYTE*)&newWinVal, sizeof(newWinVal)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_SUSPEND_DELAY) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_SUSPEND_DELAY], REG_DWORD,
+                    (const BYTE*)&config->suspendDelay, sizeof(config->suspendDelay)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_STOP_RENDER_DELAY) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_STOP_RENDER_DELAY], REG_DWORD,
+                    (const BYTE*)&config->stopRenderDelay, sizeof(config->stopRenderDelay)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_TRIM_MEMORY_DELAY) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_TRIM_MEMORY_DELAY], REG_DWORD,
+                    (const BYTE*)&config->trimMemoryDelay, sizeof(config->trimMemoryDelay)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_DISCARD_AFTER) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_DISCARD_AFTER], REG_DWORD,
+                    (const BYTE*)&config->discardAfter, sizeof(config->discardAfter)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_PARTIAL_PERCENT) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_PARTIAL_PERCENT], REG_DWORD,
+                    (const BYTE*)&config->partialPercent, sizeof(config->partialPercent)) == ERROR_SUCCESS;
+    }
+    if (changed & CFG_CHANGED_PARTIAL_DELAY) {
+        ok &= write(ctx, k_cfgValueNames[CFG_VALUE_PARTIAL_DELAY], REG_DWORD,
+                    (const BYTE*)&config->partialDelay, sizeof(config->partialDelay)) == ERROR_SUCCESS;
+    }
+    return ok;
+}
+
+// INI text
+
+// INI keys are matched ASCII case-insensitively through a perfect hash on the
+// length and the (lower-cased) first and third bytes; ids are CfgValue.
+#define INI_KEY_SLOTS 16
+
+static const struct {
+    const char* name;
+    int id;
+} k_iniKeySlots[INI_KEY_SLOTS] = {
+    [0]  = { "partialpercent", CFG_VALUE_PARTIAL_PERCENT },
+    [3]  = { "url", CFG_STR_URL },
+    [5]  = { "windowtitle", CFG_STR_WINDOW_TITLE },
+    [12] = { "onhidejs", CFG_STR_ON_HIDE_JS },
+    [7]  = { "onshowjs", CFG_STR_ON_SHOW_JS },
+    [4]  = { "spellchecklanguages", CFG_STR_SPELLCHECK_LANGUAGES },
+    [13] = { "managedpref", CFG_STR_MANAGED_PREFS },
+    [2]  = { "sleepwheninactive", CFG_VALUE_SLEEP_WHEN_INACTIVE },
+    [9]  = { "opennewwindowsexternally", CFG_VALUE_OPEN_NEW_WINDOWS_EXTERNALLY },
+    [11] = { "suspenddelay", CFG_VALUE_SUSPEND_DELAY },
+    [10] = { "stoprenderdelay", CFG_VALUE_STOP_RENDER_DELAY },
+    [8]  = { "trimmemorydelay", CFG_VALUE_TRIM_MEMORY_DELAY },
+    [15] = { "discardafter", CFG_VALUE_DISCARD_AFTER },
+    [14] = { "partialdelay", CFG_VALUE_PARTIAL_DELAY },
+};
+
+static inline char ini_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
+static inline BOOL ini_name_equal(const char* s, size_t len, const char* name, size_t nameLen) {
+    if (len != nameLen) return FALSE;
+    for (size_t i = 0; i < len; i++) {
+        if (ini_lower(s[i]) != ini_lower(name[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+static inline int ini_key_lookup(const char* s, size_t len) {
+    if (len < 3) return -1;
+    unsigned h = (unsigned)(len + (unsigned char)ini_lower(s[0]) * 4 +
+                            (unsigned char)ini_lower(s[2])) & (INI_KEY_SLOTS - 1);
+    const char* name = k_iniKeySlots[h].name;
+    return (name && ini_name_equal(s, len, name, strlen(name))) ? k_iniKeySlots[h].id : -1;
+}
+
+static inline BOOL ini_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Convert an n-byte INI value into dst (room for n characters). Values are
+// UTF-8; one that is not is taken as ANSI, as older editors saved it.
+// Returns the length, or -1.
+#ifdef _WIN32
+static inline int ini_decode(const char* v, size_t n, wchar_t* dst) {
+    if (n == 0) return 0;
+    int wlen = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, v, (int)n, dst, (int)n);
+    if (wlen <= 0) wlen = MultiByteToWideChar(CP_ACP, 0, v, (int)n, dst, (int)n);
+    return wlen > 0 ? wlen : -1;
+}
+#else
+// Native builds decode UTF-8 themselves (wchar_t holds a whole code point
+// there) and stand in Latin-1 for ANSI.
+static inline int ini_decode(const char* v, size_t n, wchar_t* dst) {
+    static const unsigned k_min[4] = { 0, 0x80, 0x800, 0x10000 };
+    const unsigned char* s = (const unsigned char*)v;
+    size_t i = 0;
+    int wlen = 0;
+    while (i < n) {
+        unsigned c = s[i];
+        int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 :
+                    (c & 0xF8) == 0xF0 ? 3 : -1;
+        if (extra < 0 || (size_t)extra >= n - i) break;
+        unsigned cp = extra ? c & (0x3Fu >> extra) : c;
+        int k = 1;
+        for (; k <= extra && (s[i + k] & 0xC0) == 0x80; k++) cp = cp << 6 | (s[i + k] & 0x3F);
+        if (k <= extra || cp < k_min[extra] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) break;
+        dst[wlen++] = (wchar_t)cp;
+        i += (size_t)extra + 1;
+    }
+    if (i == n) return wlen;
+    for (i = 0; i < n; i++) dst[i] = (wchar_t)s[i];
+    return (int)n;
+}
+#endif
+
+// Parse INI text in one pass: "key=value" lines, '#'/';' comments and
+// "[...]" section headers. Keys apply wherever they are, except in a
+// "[profile NAME]" section: its keys apply only when NAME is profile
+// (case-insensitive; NULL selects none). Any other header, such as
+// "[Settings]", ends a profile section. text is UTF-8 without a BOM.
+static inline void ini_parse(const char* text, size_t len, const char* profile, ConfigBuilder* b) {
+    size_t profileLen = profile ? strlen(profile) : 0;
+    wchar_t* prefs = NULL;
+    size_t prefsLen = 0, prefsCap = 0;
+    const char* p = text;
+    const char* end = text + len;
+    BOOL active = TRUE;
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const char* s = p;
+        const char* e = nl ? nl : end;
+        p = nl ? nl + 1 : end;
+
+        while (s < e && ini_is_space(*s)) s++;
+        while (e > s && ini_is_space(e[-1])) e--;
+        if (s == e || *s == '#' || *s == ';') continue;
+
+        if (*s == '[') {
+            if (e[-1] != ']' || e - s < 2) continue;
+            const char* ns = s + 1;
+            const char* ne = e - 1;
+            while (ns < ne && ini_is_space(*ns)) ns++;
+            while (ne > ns && ini_is_space(ne[-1])) ne--;
+            active = TRUE;
+            if (ne - ns > 7 && ini_name_equal(ns, 7, "profile", 7) && ini_is_space(ns[7])) {
+                const char* name = ns + 8;
+                while (name < ne && ini_is_space(*name)) name++;
+                active = profile && ini_name_equal(name, (size_t)(ne - name), profile, profileLen);
+            }
+            continue;
+        }
+        if (!active) continue;
+
+        const char* eq = (const char*)memchr(s, '=', (size_t)(e - s));
+        if (!eq) continue;
+        const char* ke = eq;
+        while (ke > s && ini_is_space(ke[-1])) ke--;
+        const char* vs = eq + 1;
+        while (vs < e && ini_is_space(*vs)) vs++;
+        size_t vlen = (size_t)(e - vs);
+
+        int id = ini_key_lookup(s, (size_t)(ke - s));
+        if (id < 0) continue;
+        if (id == CFG_STR_MANAGED_PREFS) {
+            // May repeat; each line adds one entry. The entries are gathered
+            // here and stored once at the end.
+            if (vlen == 0) continue;
+            if (prefsLen + vlen + 1 > prefsCap) {
+                size_t cap = prefsCap ? prefsCap * 2 : 1024;
+                while (cap < prefsLen + vlen + 1) cap *= 2;
+                wchar_t* grown = (wchar_t*)realloc(prefs, cap * sizeof(wchar_t));
+                if (!grown) continue;
+                prefs = grown;
+                prefsCap = cap;
+            }
+            size_t at = prefsLen ? prefsLen + 1 : 0;
+            int wlen = ini_decode(vs, vlen, prefs + at);
+            if (wlen <= 0) continue;
+            if (prefsLen) prefs[prefsLen] = L'\n';
+            prefsLen = at + (size_t)wlen;
+        } else if (id < CFG_STR_COUNT) {
+            wchar_t* dst = config_builder_reserve(b, vlen);
+            int wlen = dst ? ini_decode(vs, vlen, dst) : -1;
+            if (wlen >= 0) config_builder_commit(b, (CfgStr)id, (size_t)wlen);
+        } else if (id == CFG_VALUE_SUSPEND_DELAY || id == CFG_VALUE_STOP_RENDER_DELAY ||
+                   id == CFG_VALUE_TRIM_MEMORY_DELAY || id == CFG_VALUE_DISCARD_AFTER ||
+                   id == CFG_VALUE_PARTIAL_PERCENT || id == CFG_VALUE_PARTIAL_DELAY) {
+            DWORD max = id == CFG_VALUE_DISCARD_AFTER ? DISCARD_AFTER_MAX_H :
+                        id == CFG_VALUE_PARTIAL_PERCENT ? PARTIAL_PERCENT_MAX : SUSPEND_DELAY_MAX_S;
+            DWORD n = 0;
+            for (size_t i = 0; i < vlen && vs[i] >= '0' && vs[i] <= '9'; i++) {
+                n = n * 10 + (DWORD)(vs[i] - '0');
+                if (n > max) n = max;
+            }
+            if (id == CFG_VALUE_SUSPEND_DELAY) {
+                b->suspendDelay = n;
+            } else if (id == CFG_VALUE_STOP_RENDER_DELAY) {
+                b->stopRenderDelay = n;
+            } else if (id == CFG_VALUE_TRIM_MEMORY_DELAY) {
+                b->trimMemoryDelay = n;
+            } else if (id == CFG_VALUE_DISCARD_AFTER) {
+                b->discardAfter = n;
+            } else if (id == CFG_VALUE_PARTIAL_PERCENT) {
+                b->partialPercent = n;
+            } else {
+                b->partialDelay = n;
+            }
+        } else {
+            char c = vlen > 0 ? ini_lower(*vs) : '\0';
+            BOOL on = (c == '1' || c == 't' || c == 'y');
+            if (id == CFG_VALUE_SLEEP_WHEN_INACTIVE) {
+                b->sleepWhenInactive = on;
+            } else {
+                b->openNewWindowsExternally = on;
+            }
+        }
+    }
+    if (prefsLen > 0) config_builder_set(b, CFG_STR_MANAGED_PREFS, prefs, prefsLen);
+    free(prefs);
+}
+
+// Config stores
+
+// Load a configuration from store: the defaults, overlaid with every value
+// the store holds. Returns FALSE, leaving out untouched, when the store holds
+// none. configured may be NULL.
+static inline BOOL config_store_load(ConfigStore* store, Configuration* out, BOOL* configured) {
+    BOOL isConfigured = FALSE;
+    ConfigBuilder b;
+    config_builder_init(&b, NULL);
+    if (!store->lpVtbl->Load(store, &b, &isConfigured)) {
+        free(b.buf);
+        return FALSE;
+    }
+    if (configured) *configured = isConfigured;
+    return config_builder_finish(&b, out);
+}
+
+// In-memory backend: raw values exactly as the registry would hold them, so
+// the load, merge and save paths can be exercised (and benchmarked) without
+// a registry. Release with MemoryConfigStore_Clear.
+typedef struct {
+    ConfigStore base;
+    BYTE* data[CFG_VALUE_COUNT];
+    DWORD size[CFG_VALUE_COUNT];
+    DWORD type[CFG_VALUE_COUNT];
+} MemoryConfigStore;
+
+static inline LONG MemoryConfigStore_WriteValue(void* ctx, const wchar_t* name, DWORD type,
+                                                const BYTE* data, DWORD size) {
+    MemoryConfigStore* store = (MemoryConfigStore*)ctx;
+    int value = config_value_lookup(name);
+    if (value < 0) return ERROR_INVALID_PARAMETER;
+    BYTE* copy = (BYTE*)malloc(size ? size : 1);
+    if (!copy) return ERROR_OUTOFMEMORY;
+    memcpy(copy, data, size);
+    free(store->data[value]);
+    store->data[value] = copy;
+    store->size[value] = size;
+    store->type[value] = type;
+    return ERROR_SUCCESS;
+}
+
+static inline BOOL MemoryConfigStore_Load(ConfigStore* This, ConfigBuilder* b, BOOL* configured) {
+    MemoryConfigStore* store = (MemoryConfigStore*)This;
+    BOOL any = FALSE;
+    for (int i = 0; i < CFG_VALUE_COUNT; i++) {
+        if (!store->data[i]) continue;
+        config_builder_put(b, i, store->type[i], store->data[i], store->size[i], configured);
+        any = TRUE;
+    }
+    return any;
+}
+
+static inline BOOL MemoryConfigStore_Save(ConfigStore* This, const Configuration* config, DWORD changed) {
+    return config_write_values(config, changed, MemoryConfigStore_WriteValue, This);
+}
+
+static inline void MemoryConfigStore_MarkConfigured(ConfigStore* This) {
+    DWORD configured = 1;
+    MemoryConfigStore_WriteValue(This, REG_VALUE_CONFIGURED, REG_DWORD,
+                                 (const BYTE*)&configured, sizeof(configured));
+}
+
+static const ConfigStoreVtbl k_memoryConfigStoreVtbl = {
+    MemoryConfigStore_Load,
+    MemoryConfigStore_Save,
+    MemoryConfigStore_MarkConfigured
+};
+
+static inline void MemoryConfigStore_Init(MemoryConfigStore* store) {
+    memset(store, 0, sizeof(*store));
+    store->base.lpVtbl = &k_memoryConfigStoreVtbl;
+}
+
+static inline void MemoryConfigStore_Clear(MemoryConfigStore* store) {
+    for (int i = 0; i < CFG_VALUE_COUNT; i++) free(store->data[i]);
+    MemoryConfigStore_Init(store);
+}
+
+#endif
@@ -0,0 +1,483 @@
+// Config bench: checks the settings merge and the INI parser in config.h,
+// and times loading and saving a full configuration and parsing INI files
+// of 1000 to 100000 lines (make config-bench; see bench.h).
+//
+// The in-memory store holds raw registry-typed values, so the store checks
+// go through the same config_builder_put and config_write_values the
+// registry backend uses: defaults under a partial store, clamping, values of
+// the wrong type, name case, REG_MULTI_SZ lines, unterminated REG_SZ data
+// and the shared copy of equal strings. The INI checks cover section
+// headers and profiles, comments, repeated managedpref lines and non-UTF-8
+// values. Random configurations, some with hooks of 50000+ characters, must
+// survive a round trip through the store and through INI text.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "config.h"
+
+static void put_sz(MemoryConfigStore* store, const wchar_t* name, const wchar_t* s) {
+    MemoryConfigStore_WriteValue(store, name, REG_SZ, (const BYTE*)s,
+                                 (DWORD)((wcslen(s) + 1) * sizeof(wchar_t)));
+}
+
+static void put_dword(MemoryConfigStore* store, const wchar_t* name, DWORD v) {
+    MemoryConfigStore_WriteValue(store, name, REG_DWORD, (const BYTE*)&v, sizeof(v));
+}
+
+// REG_MULTI_SZ data from a string whose lines are separated by '|'
+static void put_multi_sz(MemoryConfigStore* store, const wchar_t* name, const wchar_t* lines) {
+    wchar_t buf[1024];
+    size_t n = 0;
+    for (const wchar_t* c = lines; *c && n < 1022; c++) buf[n++] = *c == L'|' ? L'\0' : *c;
+    buf[n++] = L'\0';
+    buf[n++] = L'\0';
+    MemoryConfigStore_WriteValue(store, name, REG_MULTI_SZ, (const BYTE*)buf,
+                                 (DWORD)(n * sizeof(wchar_t)));
+}
+
+static void check_load(void) {
+    MemoryConfigStore store;
+    MemoryConfigStore_Init(&store);
+    Configuration config = {0};
+    BOOL configured = TRUE;
+
+    CHECK(!config_store_load(&store.base, &config, &configured), "empty store loads nothing");
+    CHECK(config.blob == NULL && configured, "empty store leaves the output alone");
+
+    put_sz(&store, L"url", L"https://example.com/");
+    put_dword(&store, REG_VALUE_SUSPENDDELAY, 99999);
+    put_dword(&store, REG_VALUE_DISCARDAFTER, 1000);
+    put_dword(&store, REG_VALUE_PARTIALPERCENT, 250);
+    put_dword(&store, REG_VALUE_CONFIGURED, 1);
+    CHECK(config_store_load(&store.base, &config, &configured), "partial store loads");
+    CHECK(configured, "first-launch marker is read");
+    CHECK(wcscmp(config.url, L"https://example.com/") == 0, "URL (name in lower case)");
+    CHECK(wcscmp(config.windowTitle, L"Systray Launcher") == 0, "title keeps its default");
+    CHECK(config.suspendDelay == SUSPEND_DELAY_MAX_S, "suspend delay is clamped");
+    CHECK(config.discardAfter == DISCARD_AFTER_MAX_H, "discard delay is clamped");
+    CHECK(config.partialPercent == PARTIAL_PERCENT_MAX, "partial percent is clamped");
+    CHECK(config.stopRenderDelay == STOP_RENDER_DELAY_DEFAULT_S, "stop-render delay default");
+    CHECK(config.trimMemoryDelay == TRIM_MEMORY_DELAY_DEFAULT_S, "trim-memory delay default");
+    CHECK(config.partialDelay == PARTIAL_DELAY_DEFAULT_S, "partial delay default");
+    CHECK(config.onHideJs == config.onShowJs && config.onShowJs == config.managedPrefs,
+          "empty strings share one copy");
+
+    // Wrong types keep the previous value in place
+    put_dword(&store, REG_VALUE_TITLE, 7);
+    put_sz(&store, REG_VALUE_SLEEP, L"1");
+    CHECK(config_store_load(&store.base, &config, NULL), "store with wrong types loads");
+    CHECK(wcscmp(config.windowTitle, L"Systray Launcher") == 0, "REG_DWORD title is ignored");
+    CHECK(!config.sleepWhenInactive, "REG_SZ sleep flag is ignored");
+
+    // REG_SZ without its terminator, and a list of lines
+    static const wchar_t title[] = { L'T', L'i', L't', L'l', L'e' };
+    MemoryConfigStore_WriteValue(&store, REG_VALUE_TITLE, REG_SZ, (const BYTE*)title,
+                                 sizeof(title));
+    put_multi_sz(&store, REG_VALUE_MANAGEDPREFS, L"a.b=1|!c.d|e=\"x\"");
+    CHECK(config_store_load(&store.base, &config, NULL), "store with lists loads");
+    CHECK(wcscmp(config.windowTitle, L"Title") == 0, "unterminated REG_SZ");
+    CHECK(wcscmp(config.managedPrefs, L"a.b=1\n!c.d\ne=\"x\"") == 0, "REG_MULTI_SZ lines");
+
+    CHECK(MemoryConfigStore_WriteValue(&store, L"NotASetting", REG_DWORD, (const BYTE*)&configured,
+                                       sizeof(configured)) == ERROR_INVALID_PARAMETER,
+          "unknown value names are refused");
+
+    // A merge over a base copies only what it sets
+    Configuration snapshot;
+    config_snapshot(&snapshot, &config);
+    ConfigBuilder b;
+    config_builder_init(&b, &config);
+    config_builder_set(&b, CFG_STR_ON_SHOW_JS, L"resume()", 8);
+    b.sleepWhenInactive = TRUE;
+    CHECK(config_builder_finish(&b, &config), "merge over a base");
+    CHECK(config_diff(&snapshot, &config) ==
+          (CFG_CHANGED_ON_SHOW_JS | CFG_CHANGED_SLEEP_WHEN_INACTIVE), "merge changes what it set");
+    CHECK(wcscmp(snapshot.onShowJs, L"") == 0, "the snapshot keeps the old strings");
+
+    // Saving writes only the changed values
+    MemoryConfigStore saved;
+    MemoryConfigStore_Init(&saved);
+    CHECK(saved.base.lpVtbl->Save(&saved.base, &config, config_diff(&snapshot, &config)),
+          "save");
+    int written = 0;
+    for (int i = 0; i < CFG_VALUE_COUNT; i++) written += saved.data[i] != NULL;
+    CHECK(written == 2 && saved.data[CFG_STR_ON_SHOW_JS] && saved.data[CFG_VALUE_SLEEP_WHEN_INACTIVE],
+          "save writes the changed values only");
+    saved.base.lpVtbl->MarkConfigured(&saved.base);
+    CHECK(config_store_load(&saved.base, &snapshot, &configured) && configured,
+          "mark configured");
+
+    MemoryConfigStore_Clear(&saved);
+    MemoryConfigStore_Clear(&store);
+    CHECK(!config_store_load(&store.base, &config, NULL), "a cleared store is empty");
+    config_release(&snapshot);
+    config_release(&config);
+    printf("check load, merge and save through MemoryConfigStore\n");
+}
+
+static void parse(Configuration* out, const char* text, const char* profile) {
+    ConfigBuilder b;
+    config_builder_init(&b, NULL);
+    ini_parse(text, strlen(text), profile, &b);
+    config_builder_finish(&b, out);
+}
+
+static void check_ini(void) {
+    Configuration c = {0};
+
+    // A header line is only a header: the keys under it still apply
+    parse(&c, "[Settings]\nurl=https://example.com/\nsleepwheninactive=yes\n", NULL);
+    CHECK(wcscmp(c.url, L"https://example.com/") == 0, "URL under a leading [Settings]");
+    CHECK(c.sleepWhenInactive, "flag under a leading [Settings]");
+
+    static const char profiles[] =
+        "# comment\r\n"
+        "  ; another\r\n"
+        "URL = https://global.example/ \r\n"
+        "windowtitle=Global\r\n"
+        "[profile Work]\r\n"
+        "url=https://work.example/\r\n"
+        "suspenddelay=120\r\n"
+        "[ profile  home ]\r\n"
+        "url=https://home.example/\r\n"
+        "[Settings]\r\n"
+        "partialpercent=40\r\n";
+    parse(&c, profiles, NULL);
+    CHECK(wcscmp(c.url, L"https://global.example/") == 0, "no profile: profile sections skipped");
+    CHECK(wcscmp(c.windowTitle, L"Global") == 0, "no profile: keys before the sections");
+    CHECK(c.suspendDelay == SUSPEND_DELAY_DEFAULT_S, "no profile: profile delay skipped");
+    CHECK(c.partialPercent == 40, "a plain header ends the profile section");
+    parse(&c, profiles, "work");
+    CHECK(wcscmp(c.url, L"https://work.example/") == 0, "profile Work, matched case-insensitively");
+    CHECK(c.suspendDelay == 120 && c.partialPercent == 40, "profile Work delays");
+    parse(&c, profiles, "Home");
+    CHECK(wcscmp(c.url, L"https://home.example/") == 0, "profile home, spaces in the header");
+    CHECK(c.suspendDelay == SUSPEND_DELAY_DEFAULT_S, "profile home skips Work's keys");
+    parse(&c, profiles, "School");
+    CHECK(wcscmp(c.url, L"https://global.example/") == 0, "unknown profile: global keys only");
+
+    parse(&c, "managedpref=a=1\nmanagedpref=\nmanagedpref=!b\nsuspenddelay=99999x\n"
+              "partialdelay=abc\nopennewwindowsexternally=True\nnosuchkey=1\nnot a key\n", NULL);
+    CHECK(wcscmp(c.managedPrefs, L"a=1\n!b") == 0, "managedpref lines");
+    CHECK(c.suspendDelay == SUSPEND_DELAY_MAX_S, "numbers are clamped");
+    CHECK(c.partialDelay == 0, "a value without digits is 0");
+    CHECK(c.openNewWindowsExternally, "boolean spelled True");
+
+    parse(&c, "windowtitle=Za\xc5\xbc\xc3\xb3\xc5\x82\xc4\x87\nonshowjs=caf\xe9\n", NULL);
+    CHECK(wcscmp(c.windowTitle, L"Za\u017c\u00f3\u0142\u0107") == 0, "UTF-8 value");
+    CHECK(wcscmp(c.onShowJs, L"caf\u00e9") == 0, "non-UTF-8 value falls back");
+
+    config_release(&c);
+    printf("check INI sections, profiles and values\n");
+}
+
+// len random characters, non-ASCII and INI syntax included; single newlines
+// only when multiline. Never blank at either end, which INI values cannot be,
+// and never an empty line, which a REG_MULTI_SZ list cannot hold.
+static void rnd_string(wchar_t* dst, size_t len, int multiline) {
+    static const wchar_t k_pool[] = L"abcXYZ019 .,=;#[]\"\\/\u00e9\u0142\u4e2d\U0001F600\n";
+    size_t poolLen = sizeof(k_pool) / sizeof(k_pool[0]) - (multiline ? 1 : 2);
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = k_pool[rnd((unsigned)poolLen)];
+        if (i > 0 && dst[i] == L'\n' && dst[i - 1] == L'\n') dst[i] = L'n';
+    }
+    if (len > 0 && (dst[0] == L' ' || dst[0] == L'\n')) dst[0] = L'a';
+    if (len > 0 && (dst[len - 1] == L' ' || dst[len - 1] == L'\n')) dst[len - 1] = L'z';
+}
+
+// A configuration with every setting random: some strings repeat another,
+// some are empty, and a JS hook is 50000+ characters one time in eight.
+static void rnd_config(Configuration* out, wchar_t* scratch, int multiline) {
+    ConfigBuilder b;
+    config_builder_init(&b, NULL);
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        if (i > 0 && rnd(4) == 0) {
+            int j = (int)rnd((unsigned)i);
+            config_builder_set(&b, (CfgStr)i, b.set[j] ? b.buf + b.off[j] : L"", b.set[j] ? b.len[j] : 0);
+            continue;
+        }
+        size_t len = rnd(3) == 0 ? 0 : 1 + rnd(60);
+        if ((i == CFG_STR_ON_HIDE_JS || i == CFG_STR_ON_SHOW_JS) && rnd(8) == 0) {
+            len = 50000 + rnd(10000);
+        }
+        rnd_string(scratch, len, multiline);
+        if (i == CFG_STR_MANAGED_PREFS) {
+            // Lines, none empty
+            for (size_t k = 1; k + 1 < len; k++) {
+                if (rnd(10) == 0 && scratch[k - 1] != L'\n') scratch[k] = L'\n';
+                else if (scratch[k] == L'\n') scratch[k] = L'x';
+            }
+            for (size_t k = 1; k + 1 < len; k++) {
+                if (scratch[k] == L'\n' && (scratch[k - 1] == L' ' || scratch[k + 1] == L' ')) {
+                    scratch[k] = L'x';
+                }
+            }
+        }
+        config_builder_set(&b, (CfgStr)i, scratch, len);
+    }
+    b.sleepWhenInactive = rnd(2);
+    b.openNewWindowsExternally = rnd(2);
+    b.suspendDelay = rnd(SUSPEND_DELAY_MAX_S + 1);
+    b.stopRenderDelay = rnd(SUSPEND_DELAY_MAX_S + 1);
+    b.trimMemoryDelay = rnd(SUSPEND_DELAY_MAX_S + 1);
+    b.discardAfter = rnd(DISCARD_AFTER_MAX_H + 1);
+    b.partialPercent = rnd(PARTIAL_PERCENT_MAX + 1);
+    b.partialDelay = rnd(SUSPEND_DELAY_MAX_S + 1);
+    config_builder_finish(&b, out);
+}
+
+static size_t put_utf8(char* dst, const wchar_t* s, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned c = (unsigned)s[i];
+        if (c < 0x80) {
+            dst[n++] = (char)c;
+        } else if (c < 0x800) {
+            dst[n++] = (char)(0xC0 | c >> 6);
+            dst[n++] = (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            dst[n++] = (char)(0xE0 | c >> 12);
+            dst[n++] = (char)(0x80 | (c >> 6 & 0x3F));
+            dst[n++] = (char)(0x80 | (c & 0x3F));
+        } else {
+            dst[n++] = (char)(0xF0 | c >> 18);
+            dst[n++] = (char)(0x80 | (c >> 12 & 0x3F));
+            dst[n++] = (char)(0x80 | (c >> 6 & 0x3F));
+            dst[n++] = (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return n;
+}
+
+static size_t put_ini_line(char* dst, int id, const wchar_t* s, size_t len) {
+    const char* key = NULL;
+    for (int i = 0; i < INI_KEY_SLOTS; i++) {
+        if (k_iniKeySlots[i].name && k_iniKeySlots[i].id == id) key = k_iniKeySlots[i].name;
+    }
+    size_t n = (size_t)sprintf(dst, "%s=", key);
+    n += put_utf8(dst + n, s, len);
+    dst[n++] = '\n';
+    return n;
+}
+
+// config as an INI file, written the way a user would
+static char* write_ini(const Configuration* config, size_t* len) {
+    size_t cch = config->blob->cch * 2 + 64 * CFG_STR_COUNT;  // Repeats, managedpref= per line
+    for (int i = 0; i < CFG_STR_COUNT; i++) cch += config_str_len(config, (CfgStr)i);
+    char* text = (char*)malloc(cch * 4 + 1024);
+    if (!text) return NULL;
+    size_t n = 0;
+    for (int i = 0; i < CFG_STR_COUNT; i++) {
+        const wchar_t* s = config_str(config, (CfgStr)i);
+        size_t l = config_str_len(config, (CfgStr)i);
+        if (i != CFG_STR_MANAGED_PREFS) {
+            n += put_ini_line(text + n, i, s, l);
+            continue;
+        }
+        for (const wchar_t* line = s; line < s + l;) {
+            const wchar_t* nl = wmemchr(line, L'\n', (size_t)(s + l - line));
+            const wchar_t* e = nl ? nl : s + l;
+            n += put_ini_line(text + n, i, line, (size_t)(e - line));
+            line = e + 1;
+        }
+    }
+    n += (size_t)sprintf(text + n,
+                         "sleepwheninactive=%s\nopennewwindowsexternally=%s\nsuspenddelay=%u\n"
+                         "stoprenderdelay=%u\ntrimmemorydelay=%u\ndiscardafter=%u\n"
+                         "partialpercent=%u\npartialdelay=%u\n",
+                         config->sleepWhenInactive ? "true" : "false",
+                         config->openNewWindowsExternally ? "yes" : "no",
+                         (unsigned)config->suspendDelay, (unsigned)config->stopRenderDelay,
+                         (unsigned)config->trimMemoryDelay, (unsigned)config->discardAfter,
+                         (unsigned)config->partialPercent, (unsigned)config->partialDelay);
+    *len = n;
+    return text;
+}
+
+// Random configurations saved to the in-memory store (the registry's value
+// types) and read back, and written as INI text and parsed, must come back
+// unchanged, long hooks included, with their repeated strings shared again.
+static void check_round_trip(void) {
+    enum { TRIALS = 300 };
+    wchar_t* scratch = (wchar_t*)malloc(60000 * sizeof(wchar_t));
+    if (!scratch) return;
+    int registryBad = 0, iniBad = 0, iniTrials = 0;
+    for (int t = 0; t < TRIALS; t++) {
+        int multiline = t % 2;  // INI values are single lines
+        Configuration config = {0}, loaded = {0};
+        rnd_config(&config, scratch, multiline);
+
+        MemoryConfigStore store;
+        MemoryConfigStore_Init(&store);
+        BOOL ok = store.base.lpVtbl->Save(&store.base, &config, CFG_CHANGED_ALL) &&
+                  config_store_load(&store.base, &loaded, NULL);
+        if (!ok || config_diff(&config, &loaded) != 0 || loaded.blob->cch != config.blob->cch) {
+            if (registryBad++ == 0) printf("  store round trip %d changed 0x%x\n", t,
+                                           ok ? (unsigned)config_diff(&config, &loaded) : ~0u);
+        }
+        MemoryConfigStore_Clear(&store);
+
+        if (!multiline) {
+            size_t len = 0;
+            char* text = write_ini(&config, &len);
+            if (text) {
+                ConfigBuilder b;
+                config_builder_init(&b, NULL);
+                ini_parse(text, len, NULL, &b);
+                ok = config_builder_finish(&b, &loaded);
+                if (!ok || config_diff(&config, &loaded) != 0 || loaded.blob->cch != config.blob->cch) {
+                    if (iniBad++ == 0) printf("  INI round trip %d changed 0x%x\n", t,
+                                              ok ? (unsigned)config_diff(&config, &loaded) : ~0u);
+                }
+                free(text);
+                iniTrials++;
+            }
+        }
+        config_release(&loaded);
+        config_release(&config);
+    }
+    CHECK(registryBad == 0, "store round trips");
+    CHECK(iniBad == 0, "INI round trips");
+    free(scratch);
+    printf("check round trips: %d through the store, %d through INI text\n", TRIALS, iniTrials);
+}
+
+// An INI file of about the given number of lines: comments, blank lines,
+// every key, managedpref runs and a profile section every 500 lines.
+static char* make_ini(int lines, size_t* len) {
+    static const char* const k_lines[] = {
+        "# SystrayLauncher Configuration File\n",
+        "url=https://mail.example.com/inbox?view=compact&lang=en\n",
+        "windowtitle=Mail\n",
+        "onhidejs=window.app && app.pause(); console.log('hidden');\n",
+        "onshowjs=window.app && app.resume(); console.log('shown');\n",
+        "\n",
+        "SpellcheckLanguages = en-US,pl,de\n",
+        "managedpref=net.network_prediction_options=2\n",
+        "managedpref=!session.restore_on_startup\n",
+        "sleepwheninactive=1\n",
+        "suspenddelay=60\n",
+        "; tiers\n",
+        "stoprenderdelay=5\n",
+        "trimmemorydelay=20\n",
+        "discardafter=8\n",
+        "partialpercent=30\n",
+        "partialdelay=10\n",
+        "opennewwindowsexternally=false\n",
+        "unknownkey=ignored\n",
+    };
+    size_t cap = (size_t)lines * 64 + 64, n = 0;
+    char* text = (char*)malloc(cap);
+    if (!text) return NULL;
+    for (int i = 0; i < lines; i++) {
+        const char* line = k_lines[i % (sizeof(k_lines) / sizeof(k_lines[0]))];
+        char header[32];
+        if (i % 500 == 499) {
+            snprintf(header, sizeof(header), "[profile p%d]\n", i / 500);
+            line = header;
+        }
+        size_t l = strlen(line);
+        memcpy(text + n, line, l);
+        n += l;
+    }
+    *len = n;
+    return text;
+}
+
+static void bench_ini(int lines) {
+    size_t len = 0;
+    char* text = make_ini(lines, &len);
+    if (!text) return;
+    Configuration c = {0};
+    BenchTimer t;
+    bench_start(&t);
+    do {
+        ConfigBuilder b;
+        config_builder_init(&b, NULL);
+        ini_parse(text, len, "p1", &b);
+        config_builder_finish(&b, &c);
+    } while (bench_more(&t, 1));
+    double ns = bench_ns(&t);
+    printf("time  ini n=%-6d %8zu bytes %10.0f ns  %6.1f ns/line  %6.0f MB/s\n", lines, len, ns,
+           ns / lines, (double)len / ns * 1e3);
+    config_release(&c);
+    free(text);
+}
+
+// A store holding every setting, with strings the size of real ones
+static void fill_store(MemoryConfigStore* store) {
+    wchar_t js[512], prefs[1024];
+    size_t n = 0;
+    for (int i = 0; i < 12; i++) {
+        n += (size_t)swprintf(js + n, 512 - n, L"window.app%d && app%d.pause();", i, i);
+    }
+    n = 0;
+    for (int i = 0; i < 20; i++) {
+        n += (size_t)swprintf(prefs + n, 1024 - n, L"profile.setting_%d.enabled=%s|", i,
+                              i % 2 ? L"true" : L"false");
+    }
+    put_sz(store, REG_VALUE_URL, L"https://mail.example.com/inbox?view=compact&lang=en");
+    put_sz(store, REG_VALUE_TITLE, L"Mail");
+    put_sz(store, REG_VALUE_ONHIDEJS, js);
+    put_sz(store, REG_VALUE_ONSHOWJS, js);
+    put_sz(store, REG_VALUE_SPELLCHECK, L"en-US,pl,de");
+    put_multi_sz(store, REG_VALUE_MANAGEDPREFS, prefs);
+    put_dword(store, REG_VALUE_SLEEP, 1);
+    put_dword(store, REG_VALUE_NEWWINDOW, 1);
+    put_dword(store, REG_VALUE_SUSPENDDELAY, 60);
+    put_dword(store, REG_VALUE_STOPRENDERDELAY, 5);
+    put_dword(store, REG_VALUE_TRIMMEMORYDELAY, 20);
+    put_dword(store, REG_VALUE_DISCARDAFTER, 8);
+    put_dword(store, REG_VALUE_PARTIALPERCENT, 30);
+    put_dword(store, REG_VALUE_PARTIALDELAY, 10);
+    put_dword(store, REG_VALUE_CONFIGURED, 1);
+}
+
+static double time_load(MemoryConfigStore* store) {
+    Configuration config = {0};
+    BenchTimer t;
+    bench_start(&t);
+    do {
+        for (int i = 0; i < 1000; i++) config_store_load(&store->base, &config, NULL);
+    } while (bench_more(&t, 1000));
+    config_release(&config);
+    return bench_ns(&t);
+}
+
+static double time_save(MemoryConfigStore* store, const Configuration* config) {
+    BenchTimer t;
+    bench_start(&t);
+    do {
+        for (int i = 0; i < 1000; i++) store->base.lpVtbl->Save(&store->base, config, CFG_CHANGED_ALL);
+    } while (bench_more(&t, 1000));
+    return bench_ns(&t);
+}
+
+static void bench(void) {
+    MemoryConfigStore store, out;
+    MemoryConfigStore_Init(&store);
+    MemoryConfigStore_Init(&out);
+    fill_store(&store);
+    Configuration config = {0};
+    config_store_load(&store.base, &config, NULL);
+    printf("time  load full store %8.0f ns\n", time_load(&store));
+    printf("time  save all values %8.0f ns\n", time_save(&out, &config));
+    config_release(&config);
+    MemoryConfigStore_Clear(&out);
+    MemoryConfigStore_Clear(&store);
+}
+
+int main(int argc, char** argv) {
+    int quick = bench_quick(argc, argv);
+    check_load();
+    check_ini();
+    check_round_trip();
+    if (!quick) {
+        bench();
+        for (int lines = 1000; lines <= 100000; lines *= 10) bench_ini(lines);
+    }
+    return bench_finish(0);
+}
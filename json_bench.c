@@ -0,0 +1,672 @@
+// JSON bench: checks the structural scanner and the batched Preferences
+// patcher in prefs_json.h against the byte-wise and three-pass code they
+// replaced, and times both on synthetic Preferences files of 10 KB to 32 MB
+// (make json-bench; see bench.h).
+//
+// First the scanner: the SSE2 and AVX2 classifiers (where the CPU has them)
+// must produce the scalar classifier's masks on random blocks, and
+// json_skip_string and json_skip_value must return exactly what the
+// original byte-wise walk does (bar the scalar terminators added since), on
+// each classifier, for random spans of nested JSON and of noise. The timing
+// runs json_skip_value over whole profiles on each.
+// json_check_value, which guards managed preference values, must accept
+// well-formed values and reject malformed, truncated and trailing text.
+//
+// The three-pass path is the original json_set_nested, kept here verbatim as
+// the reference: one call per spell-check key, each rescanning the document
+// byte by byte from the root and splicing a full copy. Every file is patched
+// four ways: with the keys already there, with their parents but not the
+// keys, with no parents, and with a parent that is not an object. The
+// in-memory and streaming patchers must both produce exactly the reference
+// output.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "prefs_json.h"
+
+#define DICT_JSON "[\"en-US\",\"pl\"]"
+#define ACCEPT_JSON "\"en-US,pl\""
+
+static const JsonEdit k_spellcheckEdits[] = {
+    { "spellcheck.dictionaries", DICT_JSON },
+    { "intl.accept_languages", ACCEPT_JSON },
+    { "intl.selected_languages", ACCEPT_JSON },
+};
+#define SPELLCHECK_EDIT_COUNT 3
+
+enum { VAR_PRESENT, VAR_NO_KEYS, VAR_NO_PARENTS, VAR_SCALAR_PARENT, VAR_COUNT };
+static const char* const k_varNames[VAR_COUNT] = { "present", "no-keys", "no-parents", "scalar" };
+static const size_t k_sizes[] = { 10 << 10, 100 << 10, 1 << 20, 8 << 20, 32 << 20 };
+
+// --- The three-pass reference ----------------------------------------------
+
+static const char* ref_skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+static const char* ref_skip_string(const char* p, const char* end) {
+    p++;
+    while (p < end) {
+        if (*p == '\\') { p += 2; continue; }
+        if (*p == '"') return p + 1;
+        p++;
+    }
+    return NULL;
+}
+
+static const char* ref_skip_value(const char* p, const char* end) {
+    p = ref_skip_ws(p, end);
+    if (p >= end) return NULL;
+    if (*p == '"') return ref_skip_string(p, end);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = ref_skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                depth--;
+                if (depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+        p++;
+    }
+    return p;
+}
+
+static const char* ref_object_find(const char* obj, const char* end,
+                                   const char* key, const char** valEnd) {
+    if (obj >= end || *obj != '{') return NULL;
+    size_t klen = strlen(key);
+    const char* p = obj + 1;
+    for (;;) {
+        p = ref_skip_ws(p, end);
+        if (p >= end || *p == '}') return NULL;
+        if (*p != '"') return NULL;
+        const char* ks = p + 1;
+        const char* kq = ref_skip_string(p, end);
+        if (!kq) return NULL;
+        const char* ke = kq - 1;
+        p = ref_skip_ws(kq, end);
+        if (p >= end || *p != ':') return NULL;
+        const char* vs = ref_skip_ws(p + 1, end);
+        const char* ve = ref_skip_value(vs, end);
+        if (!ve) return NULL;
+        if ((size_t)(ke - ks) == klen && strncmp(ks, key, klen) == 0) {
+            *valEnd = ve;
+            return vs;
+        }
+        p = ref_skip_ws(ve, end);
+        if (p >= end) return NULL;
+        if (*p == ',') { p++; continue; }
+        return NULL;
+    }
+}
+
+static char* ref_splice(const char* buf, size_t len, const char* from,
+                        const char* to, const char* insert, size_t* newLen) {
+    size_t pre = (size_t)(from - buf);
+    size_t post = len - (size_t)(to - buf);
+    size_t ins = strlen(insert);
+    char* result = (char*)malloc(pre + ins + post + 1);
+    if (!result) return NULL;
+    memcpy(result, buf, pre);
+    memcpy(result + pre, insert, ins);
+    memcpy(result + pre + ins, to, post);
+    result[pre + ins + post] = '\0';
+    *newLen = pre + ins + post;
+    return result;
+}
+
+static char* ref_set_nested(const char* json, size_t len,
+                            const char* parentKey, const char* childKey,
+                            const char* valueJson, size_t* newLen) {
+    const char* end = json + len;
+    const char* root = ref_skip_ws(json, end);
+    if (root >= end || *root != '{') return NULL;
+    const char* rootEnd = ref_skip_value(root, end);
+    if (!rootEnd) return NULL;
+
+    char insert[2048];
+    const char* pve = NULL;
+    const char* pv = ref_object_find(root, rootEnd, parentKey, &pve);
+    if (pv && *pv == '{') {
+        const char* cve = NULL;
+        const char* cv = ref_object_find(pv, pve, childKey, &cve);
+        if (cv) {
+            return ref_splice(json, len, cv, cve, valueJson, newLen);
+        }
+        const char* inner = ref_skip_ws(pv + 1, pve);
+        int emptyObj = (inner < pve && *inner == '}');
+        snprintf(insert, sizeof(insert), "%s\"%s\":%s",
+                 emptyObj ? "" : ",", childKey, valueJson);
+        return ref_splice(json, len, pve - 1, pve - 1, insert, newLen);
+    }
+    if (pv) {
+        snprintf(insert, sizeof(insert), "{\"%s\":%s}", childKey, valueJson);
+        return ref_splice(json, len, pv, pve, insert, newLen);
+    }
+    const char* innerRoot = ref_skip_ws(root + 1, rootEnd);
+    int rootEmpty = (innerRoot < rootEnd && *innerRoot == '}');
+    snprintf(insert, sizeof(insert), "%s\"%s\":{\"%s\":%s}",
+             rootEmpty ? "" : ",", parentKey, childKey, valueJson);
+    return ref_splice(json, len, rootEnd - 1, rootEnd - 1, insert, newLen);
+}
+
+// The patch as PatchSpellcheckPreferences made it: one full pass and copy
+// per key. NULL when the document is not understood.
+static char* ref_patch(const char* json, size_t len, size_t* outLen) {
+    char* cur = NULL;
+    size_t curLen = len;
+    for (int i = 0; i < SPELLCHECK_EDIT_COUNT; i++) {
+        const char* path = k_spellcheckEdits[i].path;
+        const char* dot = strchr(path, '.');
+        char parent[32];
+        memcpy(parent, path, (size_t)(dot - path));
+        parent[dot - path] = '\0';
+        char* next = ref_set_nested(cur ? cur : json, curLen, parent, dot + 1,
+                                    k_spellcheckEdits[i].value, &curLen);
+        free(cur);
+        if (!next) return NULL;
+        cur = next;
+    }
+    *outLen = curLen;
+    return cur;
+}
+
+// --- Synthetic Preferences --------------------------------------------------
+
+typedef struct {
+    char* p;
+    size_t len, cap;
+} Buf;
+
+static void put(Buf* b, const char* s) {
+    size_t n = strlen(s);
+    if (b->len + n + 1 > b->cap) {
+        while (b->len + n + 1 > b->cap) b->cap = b->cap ? b->cap * 2 : 4096;
+        b->p = (char*)realloc(b->p, b->cap);
+        if (!b->p) exit(1);
+    }
+    memcpy(b->p + b->len, s, n + 1);
+    b->len += n;
+}
+
+static void put_base64(Buf* b, size_t n) {
+    static const char k_alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char chunk[65];
+    while (n > 0) {
+        size_t k = n < 64 ? n : 64;
+        for (size_t i = 0; i < k; i++) chunk[i] = k_alphabet[rnd(64)];
+        chunk[k] = '\0';
+        put(b, chunk);
+        n -= k;
+    }
+}
+
+// One extension's settings, as Chromium writes them: a manifest with
+// escaped strings, arrays of permissions and a base64 icon most of the size.
+static void put_extension(Buf* b, int i) {
+    char s[512];
+    char id[33];
+    for (int k = 0; k < 32; k++) id[k] = (char)('a' + rnd(16));
+    id[32] = '\0';
+    snprintf(s, sizeof(s),
+             "%s\"%s\":{\"active_permissions\":{\"api\":[\"storage\",\"tabs\",\"alarms\"],"
+             "\"explicit_host\":[\"https://*.example.com/*\"],\"manifest_permissions\":[]},"
+             "\"creation_flags\":%d,\"from_webstore\":%s,\"install_time\":\"1334%08u\","
+             "\"manifest\":{\"name\":\"Extension \\\"%d\\\" caf\\u00e9\",\"version\":\"%u.%u\","
+             "\"description\":\"C:\\\\Users\\\\me\\\\ext\\\\%d [beta] {x}\"},"
+             "\"path\":\"%s\\\\1.0_0\",\"state\":1,\"icon\":\"data:image/png;base64,",
+             i ? "," : "", id, (int)rnd(256), rnd(2) ? "true" : "false", rnd(100000000u), i,
+             rnd(20), rnd(100), i, id);
+    put(b, s);
+    put_base64(b, 1024 + rnd(8192));
+    put(b, "\"}");
+}
+
+// A Preferences file of about size bytes. Keys are sorted, as Chromium
+// writes them, so the big extensions object comes before intl and
+// spellcheck.
+static char* make_prefs(size_t size, int variant, size_t* len) {
+    Buf b = {0};
+    put(&b, "{\"account_info\":[],\"autofill\":{\"enabled\":true,\"profile_enabled\":true},"
+            "\"browser\":{\"has_seen_welcome_page\":true,\"window_placement\":{\"bottom\":1050,"
+            "\"left\":10,\"maximized\":false,\"right\":1910,\"top\":10}},"
+            "\"extensions\":{\"alerts\":{\"initialized\":true},\"settings\":{");
+    for (int i = 0; b.len < size; i++) put_extension(&b, i);
+    put(&b, "}},");
+    switch (variant) {
+        case VAR_PRESENT:
+            put(&b, "\"intl\":{\"accept_languages\":\"en-US,en\",\"selected_languages\":\"en-US,en\"},");
+            break;
+        case VAR_NO_KEYS:
+            put(&b, "\"intl\":{\"app_locale\":\"en\"},");
+            break;
+        case VAR_SCALAR_PARENT:
+            put(&b, "\"intl\":\"en-US\",");
+            break;
+    }
+    put(&b, "\"profile\":{\"avatar_index\":26,\"content_settings\":{\"exceptions\":{}},"
+            "\"exit_type\":\"Normal\",\"name\":\"Person 1\"}");
+    if (variant == VAR_PRESENT) {
+        put(&b, ",\"spellcheck\":{\"dictionaries\":[\"en-US\"],\"dictionary\":\"\"}");
+    } else if (variant == VAR_NO_KEYS) {
+        put(&b, ",\"spellcheck\":{\"dictionary\":\"\"}");
+    }
+    put(&b, "}");
+    *len = b.len;
+    return b.p;
+}
+
+// --- Scanner differential tests ---------------------------------------------
+
+typedef struct {
+    const char* name;
+    PFN_JsonClassifyBlock classify;
+} Classifier;
+
+static Classifier g_classifiers[3];
+static int g_classifierCount;
+
+static void init_classifiers(void) {
+    g_classifiers[g_classifierCount++] = (Classifier){ "scalar", json_classify_block_scalar };
+#ifdef JSON_SCAN_X86
+    g_classifiers[g_classifierCount++] = (Classifier){ "sse2", json_classify_block_sse2 };
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        g_classifiers[g_classifierCount++] = (Classifier){ "avx2", json_classify_block_avx2 };
+    }
+#endif
+}
+
+// json_skip_ws, json_skip_string and json_skip_value as they were before
+// the scanner (the baseline's SystrayLauncher.c, copied verbatim): one byte
+// at a time, with their own terminator list.
+static const char* byte_skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+static const char* byte_skip_string(const char* p, const char* end) {
+    p++;
+    while (p < end) {
+        if (*p == '\\') { p += 2; continue; }
+        if (*p == '"') return p + 1;
+        p++;
+    }
+    return NULL;
+}
+
+static const char* byte_skip_value(const char* p, const char* end) {
+    p = byte_skip_ws(p, end);
+    if (p >= end) return NULL;
+    if (*p == '"') return byte_skip_string(p, end);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = byte_skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                depth--;
+                if (depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+        p++;
+    }
+    return p;
+}
+
+// What json_skip_value should return now: the byte-wise answer, except for
+// the one deliberate change since (json_is_scalar_end), a bare value that
+// also ends at the start of a string or container.
+static const char* expected_skip_value(const char* p, const char* end) {
+    const char* q = byte_skip_value(p, end);
+    const char* v = byte_skip_ws(p, end);
+    if (q && *v != '"' && *v != '{' && *v != '[') {
+        for (const char* c = v; c < q; c++) {
+            if (*c == '"' || *c == '{' || *c == '[') return c;
+        }
+    }
+    return q;
+}
+
+// Random bytes, mostly the ones the scanner looks for; runs of escapes and
+// high bytes included, since those are where a vector compare could go wrong.
+static void fill_noise(char* p, size_t n) {
+    static const char k_hot[] = "\"\\{}[]:, a0";
+    for (size_t i = 0; i < n; i++) {
+        unsigned r = rnd(16);
+        p[i] = r < 11 ? k_hot[r] : r < 13 ? (char)(0x80 | rnd(128)) : (char)rnd(256);
+    }
+}
+
+// Well-formed JSON values, nested, with escaped quotes and backslashes and
+// strings long enough to span several blocks.
+static void put_value(Buf* b, int depth) {
+    unsigned kind = depth > 5 ? rnd(3) : rnd(5);
+    char s[64];
+    switch (kind) {
+        case 0:
+            snprintf(s, sizeof(s), "%d", (int)rnd(200000) - 100000);
+            put(b, s);
+            break;
+        case 1: {
+            static const char* const k_lits[] = { "true", "false", "null", "-1.5e3" };
+            put(b, k_lits[rnd(4)]);
+            break;
+        }
+        case 2: {
+            put(b, "\"");
+            int parts = (int)rnd(rnd(8) ? 6 : 60);
+            for (int i = 0; i < parts; i++) {
+                static const char* const k_parts[] = {
+                    "abc", "\\\"", "\\\\", "\\\\\\\"", "{[", "]}", " ", "\\u00e9", "x\\n"
+                };
+                put(b, k_parts[rnd(9)]);
+            }
+            put(b, "\"");
+            break;
+        }
+        case 3: {
+            put(b, "[");
+            int n = (int)rnd(5);
+            for (int i = 0; i < n; i++) {
+                if (i) put(b, rnd(2) ? "," : " , ");
+                put_value(b, depth + 1);
+            }
+            put(b, "]");
+            break;
+        }
+        default: {
+            put(b, "{");
+            int n = (int)rnd(5);
+            for (int i = 0; i < n; i++) {
+                snprintf(s, sizeof(s), "%s\"k%u\\\"q\":", i ? "," : "", rnd(100));
+                put(b, s);
+                put_value(b, depth + 1);
+            }
+            put(b, "}");
+            break;
+        }
+    }
+}
+
+static int check_classifiers(void) {
+    int failures = 0;
+    char block[JSON_BLOCK];
+    for (int t = 0; t < 200000; t++) {
+        fill_noise(block, sizeof(block));
+        JsonBlockMasks want, got;
+        json_classify_block_scalar(block, &want);
+        for (int c = 1; c < g_classifierCount; c++) {
+            g_classifiers[c].classify(block, &got);
+            if (memcmp(&want, &got, sizeof(want)) != 0) {
+                if (failures++ == 0) printf("  %s masks differ from scalar\n", g_classifiers[c].name);
+            }
+        }
+    }
+    printf("check classifier masks on 200000 random blocks:");
+    for (int c = 0; c < g_classifierCount; c++) printf(" %s", g_classifiers[c].name);
+    printf("\n");
+    return failures;
+}
+
+// Every classifier must give json_skip_string and json_skip_value the
+// answers of the original byte-wise versions: on well-formed values, on the
+// same cut short at every length class, and on noise.
+static int check_skips(void) {
+    int failures = 0;
+    Buf doc = {0};
+    while (doc.len < 1 << 20) {
+        put_value(&doc, 0);
+        put(&doc, rnd(2) ? "," : " \n");
+    }
+    Buf noise = {0};
+    put(&noise, "");
+    char chunk[4096];
+    for (int i = 0; i < 64; i++) {
+        fill_noise(chunk, sizeof(chunk) - 1);
+        chunk[sizeof(chunk) - 1] = '\0';
+        for (size_t k = 0; k < sizeof(chunk) - 1; k++) if (!chunk[k]) chunk[k] = ' ';
+        put(&noise, chunk);
+    }
+    const Buf* inputs[2] = { &doc, &noise };
+    long calls = 0;
+    for (int c = 0; c < g_classifierCount; c++) {
+        json_use_classifier(g_classifiers[c].classify);
+        g_rng = 0x2545F491u;
+        int wrong = 0;
+        for (int in = 0; in < 2; in++) {
+            const char* base = inputs[in]->p;
+            size_t len = inputs[in]->len;
+            for (int t = 0; t < 100000; t++) {
+                size_t at = rnd((unsigned)len);
+                size_t span = rnd(8) ? rnd(256) : rnd(1 << 16);
+                const char* p = base + at;
+                const char* end = base + (at + span < len ? at + span : len);
+                if (expected_skip_value(p, end) != json_skip_value(p, end)) wrong++;
+                if (*p == '"' && byte_skip_string(p, end) != json_skip_string(p, end)) wrong++;
+                calls++;
+            }
+        }
+        if (wrong) {
+            printf("  %s: %d skips differ from the byte-wise scan\n", g_classifiers[c].name, wrong);
+            failures += wrong;
+        }
+    }
+    json_use_classifier(NULL);
+    printf("check skip_value/skip_string against the byte-wise scan: %ld calls\n", calls);
+    free(doc.p);
+    free(noise.p);
+    return failures;
+}
+
+// json_check_value must take exactly one well-formed value and nothing else:
+// the lists below, every generated value, and none of those cut short when
+// they are strings or containers (whose last byte closes them).
+static int check_validate(void) {
+    static const char* const k_valid[] = {
+        "0", "-0", "12", "-1.5e3", "1E+2", "0.25", "true", "false", "null", "\"\"",
+        "\"a\\u00E9\\n\\/\"", "[]", "{}", " [ 1 , \"x\" , [ ] ] ", "{\"a\":{\"b\":[null]}}",
+        "\t{ \"a\" : 1 }\n",
+    };
+    static const char* const k_invalid[] = {
+        "", " ", "{foo}", "[}", "[1,,2]", "{\"a\":}", "-", "1-e", "01", "1.", ".5", "1e",
+        "+1", "tru", "truex", "nul", "[1,]", "[,1]", "{\"a\"}", "{\"a\":1,}", "{a:1}",
+        "{\"a\" 1}", "\"\\x\"", "\"\\u12g4\"", "\"a", "\"tab\there\"", "1 2", "[] []",
+        "[1]]", "{}}", "\"a\"\"b\"",
+    };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(k_valid) / sizeof(k_valid[0]); i++) {
+        const char* v = k_valid[i];
+        if (!json_check_value(v, v + strlen(v))) {
+            printf("  rejected valid %s\n", v);
+            failures++;
+        }
+    }
+    for (size_t i = 0; i < sizeof(k_invalid) / sizeof(k_invalid[0]); i++) {
+        const char* v = k_invalid[i];
+        if (json_check_value(v, v + strlen(v))) {
+            printf("  accepted invalid %s\n", v);
+            failures++;
+        }
+    }
+    char deep[2 * JSON_CHECK_MAX_DEPTH + 2] = {0};
+    memset(deep, '[', JSON_CHECK_MAX_DEPTH + 1);
+    memset(deep + JSON_CHECK_MAX_DEPTH + 1, ']', JSON_CHECK_MAX_DEPTH + 1);
+    if (json_check_value(deep, deep + 2 * JSON_CHECK_MAX_DEPTH + 2)) {
+        printf("  accepted nesting beyond %d\n", JSON_CHECK_MAX_DEPTH);
+        failures++;
+    }
+    g_rng = 0x1B873593u;
+    int generated = 0;
+    for (int t = 0; t < 20000; t++) {
+        Buf b = {0};
+        put_value(&b, 0);
+        generated++;
+        if (!json_check_value(b.p, b.p + b.len)) {
+            if (failures++ < 5) printf("  rejected generated %.60s\n", b.p);
+        } else if (b.len > 1 && (*b.p == '"' || *b.p == '[' || *b.p == '{')) {
+            size_t cut = 1 + rnd((unsigned)b.len - 1);
+            if (json_check_value(b.p, b.p + cut)) {
+                if (failures++ < 5) printf("  accepted truncated %.*s\n", (int)cut, b.p);
+            }
+        }
+        free(b.p);
+    }
+    printf("check value validation: %d listed, %d generated\n",
+           (int)(sizeof(k_valid) / sizeof(k_valid[0]) + sizeof(k_invalid) / sizeof(k_invalid[0])),
+           generated);
+    return failures;
+}
+
+// --- Checks and timing ------------------------------------------------------
+
+// The streaming patcher's output, or NULL on failure
+static char* stream_patch(const char* json, size_t len, size_t* outLen) {
+    FILE* in = tmpfile();
+    FILE* out = tmpfile();
+    char* result = NULL;
+    int changed = 0;
+    uint64_t inHash, outHash;
+    if (in && out && fwrite(json, 1, len, in) == len && fseek(in, 0, SEEK_SET) == 0 &&
+        json_stream_apply_edits(in, out, k_spellcheckEdits, SPELLCHECK_EDIT_COUNT, &changed,
+                                &inHash, &outHash)) {
+        long n = ftell(out);
+        result = (char*)malloc((size_t)n + 1);
+        if (result && (fseek(out, 0, SEEK_SET) != 0 || fread(result, 1, (size_t)n, out) != (size_t)n)) {
+            free(result);
+            result = NULL;
+        }
+        *outLen = (size_t)n;
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return result;
+}
+
+static int check(size_t size) {
+    int failures = 0;
+    printf("check %6zu KB:", size >> 10);
+    for (int v = 0; v < VAR_COUNT; v++) {
+        size_t len, refLen = 0, outLen = 0, streamLen = 0;
+        char* json = make_prefs(size, v, &len);
+        char* ref = ref_patch(json, len, &refLen);
+        char* out = NULL;
+        int ok = json_apply_edits(json, len, k_spellcheckEdits, SPELLCHECK_EDIT_COUNT, &out, &outLen);
+        char* streamed = stream_patch(json, len, &streamLen);
+        if (!ok || !out || !ref || outLen != refLen || memcmp(out, ref, refLen) != 0) {
+            printf("\n  %s: in-memory patch differs from the three-pass one", k_varNames[v]);
+            failures++;
+        }
+        if (!streamed || !ref || streamLen != refLen || memcmp(streamed, ref, refLen) != 0) {
+            printf("\n  %s: streamed patch differs from the three-pass one", k_varNames[v]);
+            failures++;
+        }
+        printf(" %s", k_varNames[v]);
+        free(json);
+        free(ref);
+        free(out);
+        free(streamed);
+    }
+    printf("\n");
+    return failures;
+}
+
+typedef char* (*PatchFn)(const char* json, size_t len, size_t* outLen);
+
+static char* batched_patch(const char* json, size_t len, size_t* outLen) {
+    char* out = NULL;
+    json_apply_edits(json, len, k_spellcheckEdits, SPELLCHECK_EDIT_COUNT, &out, outLen);
+    return out;
+}
+
+static double time_patch(PatchFn patch, const char* json, size_t len) {
+    BenchTimer t;
+    bench_start(&t);
+    do {
+        size_t outLen;
+        free(patch(json, len, &outLen));
+    } while (bench_more(&t, 1));
+    return bench_ns(&t) / 1e6;
+}
+
+static void bench(size_t size) {
+    size_t len;
+    char* json = make_prefs(size, VAR_PRESENT, &len);
+    double three = time_patch(ref_patch, json, len);
+    double one = time_patch(batched_patch, json, len);
+    double mb = (double)len / (1 << 20);
+    printf("time  %6zu KB  three-pass %9.3f ms %6.0f MB/s   batched %9.3f ms %6.0f MB/s  %5.1fx\n",
+           size >> 10, three, mb / three * 1e3, one, mb / one * 1e3, three / one);
+    free(json);
+}
+
+typedef const char* (*SkipFn)(const char* p, const char* end);
+
+static double time_skip(SkipFn skip, const char* json, size_t len) {
+    volatile const char* sink;
+    BenchTimer t;
+    bench_start(&t);
+    do {
+        sink = skip(json, json + len);
+    } while (bench_more(&t, 1));
+    (void)sink;
+    return bench_ns(&t) / 1e6;
+}
+
+// Skipping a whole profile, the walk every patch does over the values it
+// does not touch: byte-wise, then json_skip_value on each classifier.
+static void bench_scan(size_t size) {
+    size_t len;
+    char* json = make_prefs(size, VAR_PRESENT, &len);
+    double mb = (double)len / (1 << 20);
+    printf("time  %6zu KB  skip_value  bytewise %6.0f MB/s", size >> 10,
+           mb / time_skip(byte_skip_value, json, len) * 1e3);
+    for (int c = 0; c < g_classifierCount; c++) {
+        json_use_classifier(g_classifiers[c].classify);
+        printf("  %s %6.0f MB/s", g_classifiers[c].name, mb / time_skip(json_skip_value, json, len) * 1e3);
+    }
+    json_use_classifier(NULL);
+    printf("\n");
+    free(json);
+}
+
+int main(int argc, char** argv) {
+    int quick = bench_quick(argc, argv);
+    int failures = 0;
+    init_classifiers();
+    failures += check_classifiers();
+    failures += check_skips();
+    failures += check_validate();
+    for (size_t i = 0; i < sizeof(k_sizes) / sizeof(k_sizes[0]); i++) failures += check(k_sizes[i]);
+    if (!quick) {
+        for (size_t i = 0; i < sizeof(k_sizes) / sizeof(k_sizes[0]); i++) bench_scan(k_sizes[i]);
+        for (size_t i = 0; i < sizeof(k_sizes) / sizeof(k_sizes[0]); i++) bench(k_sizes[i]);
+    }
+    return bench_finish(failures);
+}
@@ -0,0 +1,355 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include <stddef.h>
+
+// WebView lifecycle state machine.
+//
+// One Lifecycle per site. Host code reports what happened (LifecycleEvent)
+// and gets back the WebView2 work to do as a bit set of LC_CMD_* commands;
+// the machine itself never touches Win32 or WebView2, so the same table runs
+// in the app and in lifecycle_sim.c on any platform. All events must come
+// from one thread (the UI thread in the app).
+//
+// Every state says exactly what the runtime and the controller are doing, so
+// an event that would not change that finds no rule and costs nothing - the
+// hidden-window ticks, repeated hovers and duplicate completions that used
+// to re-issue Resume/put_IsVisible each time.
+
+typedef enum {
+    LC_STATE_NONE,        // No WebView (not created yet, or closed for a rebuild)
+    LC_STATE_LOADING,     // Initial navigation running; rendering off-screen
+    LC_STATE_SHOWN,       // Host window visible; running and rendering
+    LC_STATE_WARM,        // Hidden; running and rendering (sleep off, or settling)
+    LC_STATE_PREWARM,     // Hidden; kept warm by a tray hover until the timer ends
+    LC_STATE_COOLING,     // Just hidden; still rendering until its dwell time ends
+    LC_STATE_UNRENDERED,  // Hidden a while; running but not rendering
+    LC_STATE_TRIMMED,     // Hidden longer; not rendering, memory target level LOW
+    LC_STATE_SUSPENDING,  // Hidden; not rendering, TrySuspend in flight
+    LC_STATE_SUSPENDED,   // Hidden; not rendering, runtime suspended
+    LC_STATE_RECOVERING,  // Power transition; state unknown until a ping answers
+    LC_STATE_DISCARDED,   // Hidden for hours; WebView torn down until wanted again
+    LC_STATE_PARTIAL,     // Shown but mostly covered a while; not rendering, memory LOW
+    LC_STATE_CAPTURING,   // Leaving the rendering tiers; still rendering, CapturePreview in flight
+    LC_STATE_COUNT
+} LifecycleState;
+
+typedef enum {
+    LC_EVENT_CREATED,          // Controller ready, initial navigation started
+    LC_EVENT_NAV_COMPLETED,    // A navigation finished
+    LC_EVENT_SHOW,             // Host window is (still) visible
+    LC_EVENT_HIDE,             // Host window is (still) hidden, minimized or covered
+    LC_EVENT_HOVER,            // Pointer over the tray icon
+    LC_EVENT_PREWARM_EXPIRED,  // Hover prewarm timeout
+    LC_EVENT_PRELOAD_SETTLED,  // A finished load had time to render
+    LC_EVENT_DWELL_EXPIRED,    // The window stayed hidden for the current tier's dwell time
+    LC_EVENT_SLEEP_CHANGED,    // The sleep setting was toggled
+    LC_EVENT_SUSPEND_DONE,     // TrySuspend completed and the runtime is suspended
+    LC_EVENT_SUSPEND_FAILED,   // TrySuspend failed or was refused
+    LC_EVENT_RESUME_FAILED,    // Resume() returned an error
+    LC_EVENT_POWER_SUSPEND,    // The machine is going to sleep
+    LC_EVENT_POWER_ABORTED,    // ...but the suspend was vetoed
+    LC_EVENT_POWER_RESUME,     // The machine woke up
+    LC_EVENT_KICK_DUE,         // Time for the next post-resume kick
+    LC_EVENT_LIVENESS_OK,      // The liveness ping was answered
+    LC_EVENT_LIVENESS_SILENT,  // The liveness ping went unanswered
+    LC_EVENT_RENDERER_FAILED,  // Renderer crashed or hung; browser still fine
+    LC_EVENT_BROWSER_FAILED,   // Browser process gone
+    LC_EVENT_CLOSED,           // Controller closed (rebuild or shutdown)
+    LC_EVENT_DISCARD_DUE,      // Suspended and untouched for the discard time
+    LC_EVENT_PARTIAL,          // Host window visible, but too little of it for too long
+    LC_EVENT_SNAPSHOT_DONE,    // CapturePreview completed, failed, or could not start
+    LC_EVENT_COUNT
+} LifecycleEvent;
+
+// Commands, run by the host in ascending bit order (timers first, the
+// runtime resumed before it renders, captured while it still renders,
+// hidden before it is suspended).
+#define LC_CMD_STOP_TIMERS  0x0001  // Kill the prewarm, settle, dwell and discard timers
+#define LC_CMD_ARM_PREWARM  0x0002  // (Re)arm the prewarm timeout
+#define LC_CMD_ARM_SETTLE   0x0004  // Arm the preload-settle timer
+#define LC_CMD_ARM_DWELL    0x0008  // Arm the dwell time of the hidden tier just entered
+#define LC_CMD_ARM_KICK     0x0010  // Arm the first post-resume kick
+#define LC_CMD_RETRY_KICK   0x0020  // Arm another kick after a silent ping
+#define LC_CMD_ARM_DISCARD  0x0040  // Arm the long-idle discard, if enabled
+#define LC_CMD_RESUME       0x0080  // ICoreWebView2_3::Resume
+#define LC_CMD_RENDER       0x0100  // Sync bounds, normal memory target, put_IsVisible(TRUE)
+#define LC_CMD_REATTACH     0x0200  // Bounds, IsVisible off/on, NotifyParentWindowPositionChanged
+#define LC_CMD_SNAPSHOT     0x0400  // CapturePreview of the rendering page; reports SNAPSHOT_DONE
+#define LC_CMD_UNRENDER     0x0800  // put_IsVisible(FALSE)
+#define LC_CMD_MEMORY_LOW   0x1000  // put_MemoryUsageTargetLevel(LOW)
+#define LC_CMD_SUSPEND      0x2000  // ICoreWebView2_3::TrySuspend
+#define LC_CMD_RELOAD       0x4000  // Reload the page in place
+#define LC_CMD_PING         0x8000  // Liveness ping (ExecuteScript) + its timer
+#define LC_CMD_REBUILD     0x10000  // Tear down and rebuild every WebView
+#define LC_CMD_DISCARD     0x20000  // Close this site's WebView (and the runtime, if unused)
+#define LC_CMD_RECREATE    0x40000  // Build this site's WebView again after a discard
+
+typedef struct {
+    LifecycleState state;
+    int sleep;       // "Sleep when inactive" setting
+    int grace;       // Hidden tiers (COOLING..TRIMMED) come before the suspend
+    int preloaded;   // The first navigation has completed
+    int visible;     // Last SHOW/HIDE reported
+    int kicks;       // Post-resume kicks so far
+    int maxKicks;    // Kicks before a silent runtime is rebuilt
+} Lifecycle;
+
+// Guards, checked against the context before a rule applies.
+typedef enum {
+    LC_IF_ALWAYS,
+    LC_IF_VISIBLE,      // Last reported visibility was SHOW
+    LC_IF_CAN_SLEEP,    // Sleep enabled and the first load is done
+    LC_IF_GRACE,        // CAN_SLEEP, with hidden tiers before the suspend
+    LC_IF_SLEEP,        // Sleep enabled
+    LC_IF_NO_SLEEP,     // Sleep disabled
+    LC_IF_KICKS_LEFT    // Fewer than maxKicks kicks so far
+} LifecycleGuard;
+
+typedef struct {
+    unsigned char state;   // LifecycleState, or LC_ANY
+    unsigned char event;   // LifecycleEvent
+    unsigned char guard;   // LifecycleGuard
+    unsigned char next;    // LifecycleState
+    unsigned cmds;         // LC_CMD_* bits
+} LifecycleRule;
+
+#define LC_ANY 0xFF
+
+// The states x events table. The first rule whose state, event and guard
+// match wins; no match means the event changes nothing and issues nothing.
+// Rules for LC_ANY come last so every state can override them.
+static const LifecycleRule k_lifecycleRules[] = {
+    // Fresh controller: keep it rendering (IsVisible = TRUE) while the host
+    // stays hidden, the documented way to keep a WebView warm - the page
+    // loads and renders off-screen so the first open is instant.
+    { LC_STATE_NONE,       LC_EVENT_CREATED,         LC_IF_ALWAYS,     LC_STATE_LOADING,    LC_CMD_RENDER },
+
+    // Only settle the sleep state once the first navigation finishes, so a
+    // half-loaded page is never suspended.
+    { LC_STATE_LOADING,    LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS },
+    { LC_STATE_LOADING,    LC_EVENT_NAV_COMPLETED,   LC_IF_VISIBLE,    LC_STATE_SHOWN,      0 },
+    { LC_STATE_LOADING,    LC_EVENT_NAV_COMPLETED,   LC_IF_SLEEP,      LC_STATE_WARM,       LC_CMD_ARM_SETTLE },
+    { LC_STATE_LOADING,    LC_EVENT_NAV_COMPLETED,   LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_LOADING,    LC_EVENT_HOVER,           LC_IF_SLEEP,      LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM },
+
+    // Closing the window (or having it covered) only starts the grace
+    // period: reopening within it, or an occluder that moves away again,
+    // costs no suspend/resume cycle. Waking stays immediate, so the two
+    // directions have different thresholds and flapping settles on awake.
+    // Without a grace period the page goes straight to sleep, by way of the
+    // snapshot (CAPTURING below).
+    { LC_STATE_SHOWN,      LC_EVENT_HIDE,            LC_IF_GRACE,      LC_STATE_COOLING,    LC_CMD_ARM_DWELL },
+    { LC_STATE_SHOWN,      LC_EVENT_HIDE,            LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_SHOWN,      LC_EVENT_HIDE,            LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_SHOWN,      LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_RESUME },
+
+    // A window that only peeks out from under others (the partial-
+    // visibility setting) is throttled like a hidden one, with the snapshot
+    // standing in for the live page in the part that shows: it is captured
+    // first, and rendering stops once it has landed (CAPTURING below).
+    // Uncovering it renders again at once; hiding it carries on from the
+    // trimmed tier.
+    { LC_STATE_SHOWN,      LC_EVENT_PARTIAL,         LC_IF_ALWAYS,     LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_PARTIAL,    LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_RENDER },
+    { LC_STATE_PARTIAL,    LC_EVENT_HIDE,            LC_IF_GRACE,      LC_STATE_TRIMMED,    LC_CMD_ARM_DWELL },
+    { LC_STATE_PARTIAL,    LC_EVENT_HIDE,            LC_IF_CAN_SLEEP,  LC_STATE_SUSPENDING, LC_CMD_SUSPEND },
+    { LC_STATE_PARTIAL,    LC_EVENT_HIDE,            LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RENDER },
+    { LC_STATE_PARTIAL,    LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_PARTIAL,    LC_CMD_RESUME },
+
+    { LC_STATE_WARM,       LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS },
+    { LC_STATE_WARM,       LC_EVENT_HIDE,            LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_WARM,       LC_EVENT_HOVER,           LC_IF_SLEEP,      LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM },
+    { LC_STATE_WARM,       LC_EVENT_NAV_COMPLETED,   LC_IF_SLEEP,      LC_STATE_WARM,       LC_CMD_ARM_SETTLE },
+    { LC_STATE_WARM,       LC_EVENT_PRELOAD_SETTLED, LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_WARM,       LC_EVENT_SLEEP_CHANGED,   LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_WARM,       LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RESUME },
+
+    // Repeated hovers only push the timeout out; the page is already warm.
+    { LC_STATE_PREWARM,    LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS },
+    { LC_STATE_PREWARM,    LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM },
+    { LC_STATE_PREWARM,    LC_EVENT_PREWARM_EXPIRED, LC_IF_VISIBLE,    LC_STATE_SHOWN,      0 },
+    { LC_STATE_PREWARM,    LC_EVENT_PREWARM_EXPIRED, LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_PREWARM,    LC_EVENT_PREWARM_EXPIRED, LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_PREWARM,    LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_STOP_TIMERS },
+    { LC_STATE_PREWARM,    LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_RESUME },
+
+    // The grace period steps down through cheaper hidden tiers, each held
+    // for its own dwell time: still rendering, then running but not
+    // rendering, then running with the memory target lowered, and only then
+    // suspended. Each step back up is one call away. Further hidden ticks
+    // leave the dwell timer running.
+    { LC_STATE_COOLING,    LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS },
+    { LC_STATE_COOLING,    LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_STOP_TIMERS | LC_CMD_ARM_PREWARM },
+    { LC_STATE_COOLING,    LC_EVENT_DWELL_EXPIRED,   LC_IF_VISIBLE,    LC_STATE_SHOWN,      0 },
+    { LC_STATE_COOLING,    LC_EVENT_DWELL_EXPIRED,   LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_COOLING,    LC_EVENT_DWELL_EXPIRED,   LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_COOLING,    LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_STOP_TIMERS },
+    { LC_STATE_COOLING,    LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_COOLING,    LC_CMD_RESUME },
+
+    // The page stops rendering only once it has been captured, while it
+    // still renders: the next open, or a rebuild, paints that snapshot until
+    // the live page is back. Every way out of the rendering tiers comes
+    // through here - a close, a settled preload, a prewarm running out, sleep
+    // turned on, a power transition - and a hidden page then steps down
+    // like one just closed. Capturing on the way out rather than on every
+    // hide leaves quick reopens and occlusion flaps free; the step down
+    // waits for the capture to land, since unrendering or suspending under
+    // it would capture a blank or frozen page. Waking
+    // abandons the step (a late completion finds no rule). A window still
+    // showing was captured on its way to PARTIAL.
+    { LC_STATE_CAPTURING,  LC_EVENT_SNAPSHOT_DONE,   LC_IF_VISIBLE,    LC_STATE_PARTIAL,    LC_CMD_UNRENDER | LC_CMD_MEMORY_LOW },
+    { LC_STATE_CAPTURING,  LC_EVENT_SNAPSHOT_DONE,   LC_IF_GRACE,      LC_STATE_UNRENDERED, LC_CMD_ARM_DWELL | LC_CMD_UNRENDER },
+    { LC_STATE_CAPTURING,  LC_EVENT_SNAPSHOT_DONE,   LC_IF_CAN_SLEEP,  LC_STATE_SUSPENDING, LC_CMD_UNRENDER | LC_CMD_SUSPEND },
+    { LC_STATE_CAPTURING,  LC_EVENT_SNAPSHOT_DONE,   LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_CAPTURING,  LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS },
+    { LC_STATE_CAPTURING,  LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM },
+    { LC_STATE_CAPTURING,  LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       0 },
+    { LC_STATE_CAPTURING,  LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_CAPTURING,  LC_CMD_RESUME },
+
+    { LC_STATE_UNRENDERED, LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS | LC_CMD_RENDER },
+    { LC_STATE_UNRENDERED, LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_STOP_TIMERS | LC_CMD_ARM_PREWARM | LC_CMD_RENDER },
+    { LC_STATE_UNRENDERED, LC_EVENT_DWELL_EXPIRED,   LC_IF_VISIBLE,    LC_STATE_SHOWN,      LC_CMD_RENDER },
+    { LC_STATE_UNRENDERED, LC_EVENT_DWELL_EXPIRED,   LC_IF_CAN_SLEEP,  LC_STATE_TRIMMED,    LC_CMD_ARM_DWELL | LC_CMD_MEMORY_LOW },
+    { LC_STATE_UNRENDERED, LC_EVENT_DWELL_EXPIRED,   LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RENDER },
+    { LC_STATE_UNRENDERED, LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_STOP_TIMERS | LC_CMD_RENDER },
+    { LC_STATE_UNRENDERED, LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_UNRENDERED, LC_CMD_RESUME },
+
+    { LC_STATE_TRIMMED,    LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS | LC_CMD_RENDER },
+    { LC_STATE_TRIMMED,    LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_STOP_TIMERS | LC_CMD_ARM_PREWARM | LC_CMD_RENDER },
+    { LC_STATE_TRIMMED,    LC_EVENT_DWELL_EXPIRED,   LC_IF_VISIBLE,    LC_STATE_SHOWN,      LC_CMD_RENDER },
+    { LC_STATE_TRIMMED,    LC_EVENT_DWELL_EXPIRED,   LC_IF_CAN_SLEEP,  LC_STATE_SUSPENDING, LC_CMD_SUSPEND },
+    { LC_STATE_TRIMMED,    LC_EVENT_DWELL_EXPIRED,   LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RENDER },
+    { LC_STATE_TRIMMED,    LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_STOP_TIMERS | LC_CMD_RENDER },
+    { LC_STATE_TRIMMED,    LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_TRIMMED,    LC_CMD_RESUME },
+
+    // A suspend still in flight is overtaken by the wake-up; if it lands
+    // anyway, the SUSPEND_DONE rules of the awake states undo it.
+    { LC_STATE_SUSPENDING, LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_SUSPENDED,  LC_CMD_ARM_DISCARD },
+    { LC_STATE_SUSPENDING, LC_EVENT_SUSPEND_FAILED,  LC_IF_ALWAYS,     LC_STATE_SUSPENDED,  LC_CMD_ARM_DISCARD },
+    { LC_STATE_SUSPENDING, LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS | LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDING, LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM | LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDING, LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDING, LC_EVENT_RENDERER_FAILED, LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RESUME | LC_CMD_RENDER | LC_CMD_RELOAD },
+
+    // SUSPENDED also covers a refused suspend: the page is hidden and not
+    // rendering either way, and waking it resumes unconditionally.
+    { LC_STATE_SUSPENDED,  LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_SHOWN,      LC_CMD_STOP_TIMERS | LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDED,  LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_PREWARM,    LC_CMD_ARM_PREWARM | LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDED,  LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_WARM,       LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_SUSPENDED,  LC_EVENT_RENDERER_FAILED, LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RESUME | LC_CMD_RENDER | LC_CMD_RELOAD },
+    { LC_STATE_SUSPENDED,  LC_EVENT_DISCARD_DUE,     LC_IF_ALWAYS,     LC_STATE_DISCARDED,  LC_CMD_DISCARD },
+
+    // A discarded site has no WebView, so it ignores power and browser
+    // events until a hover, an open or turning sleep off asks for it again.
+    // It then waits in NONE, like at startup, and loads like a fresh one.
+    { LC_STATE_DISCARDED,  LC_EVENT_SHOW,            LC_IF_ALWAYS,     LC_STATE_NONE,       LC_CMD_RECREATE },
+    { LC_STATE_DISCARDED,  LC_EVENT_HOVER,           LC_IF_ALWAYS,     LC_STATE_NONE,       LC_CMD_RECREATE },
+    { LC_STATE_DISCARDED,  LC_EVENT_SLEEP_CHANGED,   LC_IF_NO_SLEEP,   LC_STATE_NONE,       LC_CMD_RECREATE },
+    { LC_STATE_DISCARDED,  LC_EVENT_CLOSED,          LC_IF_ALWAYS,     LC_STATE_DISCARDED,  0 },
+    { LC_STATE_DISCARDED,  LC_EVENT_POWER_SUSPEND,   LC_IF_ALWAYS,     LC_STATE_DISCARDED,  0 },
+    { LC_STATE_DISCARDED,  LC_EVENT_POWER_RESUME,    LC_IF_ALWAYS,     LC_STATE_DISCARDED,  0 },
+    { LC_STATE_DISCARDED,  LC_EVENT_BROWSER_FAILED,  LC_IF_ALWAYS,     LC_STATE_DISCARDED,  0 },
+
+    // Power recovery. After a resume the GPU surfaces behind the WebView can
+    // be gone and the runtime may not answer at all, so a few kicks (wake,
+    // re-assert bounds, drop and re-add the visual tree) each end in a
+    // ping. The page is never put to sleep until a ping answers, so a
+    // possibly-broken page is not frozen into a suspend snapshot. A vetoed
+    // suspend leaves the page in whatever tier it was, so it is woken and
+    // rendering again before the capture.
+    { LC_STATE_RECOVERING, LC_EVENT_POWER_RESUME,    LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_ARM_KICK },
+    { LC_STATE_RECOVERING, LC_EVENT_KICK_DUE,        LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_RESUME | LC_CMD_REATTACH | LC_CMD_PING },
+    { LC_STATE_RECOVERING, LC_EVENT_LIVENESS_OK,     LC_IF_VISIBLE,    LC_STATE_SHOWN,      0 },
+    { LC_STATE_RECOVERING, LC_EVENT_LIVENESS_OK,     LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_SNAPSHOT },
+    { LC_STATE_RECOVERING, LC_EVENT_LIVENESS_OK,     LC_IF_ALWAYS,     LC_STATE_WARM,       0 },
+    { LC_STATE_RECOVERING, LC_EVENT_LIVENESS_SILENT, LC_IF_KICKS_LEFT, LC_STATE_RECOVERING, LC_CMD_RETRY_KICK },
+    { LC_STATE_RECOVERING, LC_EVENT_LIVENESS_SILENT, LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_REBUILD },
+    { LC_STATE_RECOVERING, LC_EVENT_POWER_ABORTED,   LC_IF_VISIBLE,    LC_STATE_SHOWN,      LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_RECOVERING, LC_EVENT_POWER_ABORTED,   LC_IF_CAN_SLEEP,  LC_STATE_CAPTURING,  LC_CMD_RESUME | LC_CMD_RENDER | LC_CMD_SNAPSHOT },
+    { LC_STATE_RECOVERING, LC_EVENT_POWER_ABORTED,   LC_IF_ALWAYS,     LC_STATE_WARM,       LC_CMD_RESUME | LC_CMD_RENDER },
+    { LC_STATE_RECOVERING, LC_EVENT_SUSPEND_DONE,    LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_RESUME },
+    // The liveness check decides about a runtime that will not resume.
+    { LC_STATE_RECOVERING, LC_EVENT_RESUME_FAILED,   LC_IF_ALWAYS,     LC_STATE_RECOVERING, 0 },
+
+    // Any state with a WebView (NONE has no rules beyond CREATED; CLOSED
+    // below is harmless there).
+    { LC_ANY,              LC_EVENT_POWER_SUSPEND,   LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_STOP_TIMERS },
+    { LC_ANY,              LC_EVENT_POWER_RESUME,    LC_IF_ALWAYS,     LC_STATE_RECOVERING, LC_CMD_STOP_TIMERS | LC_CMD_ARM_KICK },
+    // An awake runtime only needs the page reloaded in place.
+    { LC_ANY,              LC_EVENT_RENDERER_FAILED, LC_IF_ALWAYS,     LC_ANY,              LC_CMD_RELOAD },
+    // Runtime still suspended: the next wake-up retries the resume.
+    { LC_ANY,              LC_EVENT_RESUME_FAILED,   LC_IF_ALWAYS,     LC_STATE_SUSPENDED,  0 },
+    { LC_ANY,              LC_EVENT_BROWSER_FAILED,  LC_IF_ALWAYS,     LC_ANY,              LC_CMD_REBUILD },
+    { LC_ANY,              LC_EVENT_CLOSED,          LC_IF_ALWAYS,     LC_STATE_NONE,       LC_CMD_STOP_TIMERS },
+};
+
+static void lifecycle_init(Lifecycle* lc, int sleep, int grace, int maxKicks) {
+    lc->state = LC_STATE_NONE;
+    lc->sleep = sleep ? 1 : 0;
+    lc->grace = grace ? 1 : 0;
+    lc->preloaded = 0;
+    lc->visible = 0;
+    lc->kicks = 0;
+    lc->maxKicks = maxKicks;
+}
+
+static int lifecycle_guard(const Lifecycle* lc, unsigned guard) {
+    switch (guard) {
+        case LC_IF_VISIBLE:    return lc->visible;
+        case LC_IF_CAN_SLEEP:  return lc->sleep && lc->preloaded;
+        case LC_IF_GRACE:      return lc->sleep && lc->preloaded && lc->grace;
+        case LC_IF_SLEEP:      return lc->sleep;
+        case LC_IF_NO_SLEEP:   return !lc->sleep;
+        case LC_IF_KICKS_LEFT: return lc->kicks < lc->maxKicks;
+        default:               return 1;
+    }
+}
+
+// Apply one event: update the context the guards read, take the first
+// matching rule, and return the commands the host must run.
+static unsigned lifecycle_step(Lifecycle* lc, LifecycleEvent event) {
+    switch (event) {
+        case LC_EVENT_NAV_COMPLETED: lc->preloaded = 1; break;
+        case LC_EVENT_SHOW:
+        case LC_EVENT_PARTIAL:       lc->visible = 1; break;
+        case LC_EVENT_HIDE:          lc->visible = 0; break;
+        case LC_EVENT_POWER_RESUME:  lc->kicks = 0; break;
+        case LC_EVENT_KICK_DUE:      lc->kicks++; break;
+        case LC_EVENT_CLOSED:        lc->preloaded = 0; lc->kicks = 0; break;
+        default: break;
+    }
+    if (lc->state == LC_STATE_NONE && event != LC_EVENT_CREATED) return 0;
+
+    for (size_t i = 0; i < sizeof(k_lifecycleRules) / sizeof(k_lifecycleRules[0]); i++) {
+        const LifecycleRule* rule = &k_lifecycleRules[i];
+        if (rule->event != event) continue;
+        if (rule->state != LC_ANY && rule->state != lc->state) continue;
+        if (!lifecycle_guard(lc, rule->guard)) continue;
+        if (rule->next != LC_ANY) lc->state = (LifecycleState)rule->next;
+        return rule->cmds;
+    }
+    return 0;
+}
+
+static const char* lifecycle_state_name(LifecycleState state) {
+    static const char* const names[LC_STATE_COUNT] = {
+        "none", "loading", "shown", "warm", "prewarm", "cooling", "unrendered", "trimmed",
+        "suspending", "suspended", "recovering", "discarded", "partial", "capturing"
+    };
+    return (unsigned)state < LC_STATE_COUNT ? names[state] : "?";
+}
+
+static const char* lifecycle_event_name(LifecycleEvent event) {
+    static const char* const names[LC_EVENT_COUNT] = {
+        "created", "nav-completed", "show", "hide", "hover", "prewarm-expired",
+        "preload-settled", "dwell-expired", "sleep-changed", "suspend-done",
+        "suspend-failed", "resume-failed", "power-suspend", "power-aborted",
+        "power-resume", "kick-due", "liveness-ok", "liveness-silent",
+        "renderer-failed", "browser-failed", "closed", "discard-due", "partial",
+        "snapshot-done"
+    };
+    return (unsigned)event < LC_EVENT_COUNT ? names[event] : "?";
+}
+
+#endif
@@ -0,0 +1,356 @@
+// Lifecycle simulator: replays event scripts through the table in
+// lifecycle.h and counts the WebView2 calls each one issues. Builds and runs
+// anywhere (make sim); no Windows or WebView2 needed.
+//
+//   lifecycle_sim [-v]                     run the built-in scenarios
+//   lifecycle_sim [-v] [-s] "script" ...   run your own (-s: sleep enabled)
+//
+// A script is a list of event names (see lifecycle_event_name), each
+// optionally repeated with *N. Async completions the commands would cause
+// (a CapturePreview or TrySuspend finishing, a rebuild or discard closing or
+// re-creating the WebView) are queued and delivered at the next "." - so
+// "hide show ." shows the window while the capture is still in flight.
+// "+sleep"/"-sleep" change the setting, and "+grace"/"-grace" the hidden
+// tiers before a suspend (on by default, as in the app); "dwell-expired"
+// moves on to the next tier.
+//
+// Each built-in scenario lists the final state and the calls it expects;
+// any difference, or more completions queued than SIM_QUEUE_MAX, fails the
+// run (exit 1).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lifecycle.h"
+
+#define SIM_MAX_KICKS 3
+#define SIM_QUEUE_MAX 16
+
+enum {
+    CALL_RESUME, CALL_TRY_SUSPEND, CALL_IS_VISIBLE, CALL_BOUNDS,
+    CALL_NOTIFY_PARENT, CALL_MEMORY_TARGET, CALL_EXECUTE_SCRIPT, CALL_RELOAD,
+    CALL_CAPTURE_PREVIEW,
+    CALL_REBUILD, CALL_DISCARD, CALL_RECREATE,  // Not WebView2 calls; counted apart
+    CALL_COUNT
+};
+
+static const char* const k_callNames[CALL_COUNT] = {
+    "Resume", "TrySuspend", "put_IsVisible", "put_Bounds",
+    "NotifyParentWindowPositionChanged", "put_MemoryUsageTargetLevel", "ExecuteScript",
+    "Reload", "CapturePreview", "rebuild", "discard", "recreate"
+};
+
+typedef struct {
+    Lifecycle lc;
+    int verbose;
+    int calls[CALL_COUNT];
+    int memoryLow;       // The app's shadow only restores a lowered target
+    int transitions;
+    LifecycleEvent queue[SIM_QUEUE_MAX];
+    int queued;
+    int overflowed;      // A completion did not fit in the queue
+} Sim;
+
+static void sim_queue(Sim* sim, LifecycleEvent event) {
+    if (sim->queued < SIM_QUEUE_MAX) {
+        sim->queue[sim->queued++] = event;
+    } else {
+        sim->overflowed = 1;
+    }
+}
+
+// Mirror of RunLifecycleCommands in SystrayLauncher.c: same order, same
+// WebView2 calls per command. Timers cost no WebView2 calls.
+static void sim_run(Sim* sim, unsigned cmds) {
+    if (cmds & LC_CMD_RESUME) sim->calls[CALL_RESUME]++;
+    if (cmds & LC_CMD_RENDER) {
+        sim->calls[CALL_BOUNDS]++;
+        if (sim->memoryLow) sim->calls[CALL_MEMORY_TARGET]++;
+        sim->memoryLow = 0;
+        sim->calls[CALL_IS_VISIBLE]++;
+    }
+    if (cmds & LC_CMD_REATTACH) {
+        sim->calls[CALL_BOUNDS]++;
+        sim->calls[CALL_IS_VISIBLE] += 2;
+        sim->calls[CALL_NOTIFY_PARENT]++;
+    }
+    if (cmds & LC_CMD_SNAPSHOT) {
+        sim->calls[CALL_CAPTURE_PREVIEW]++;
+        sim_queue(sim, LC_EVENT_SNAPSHOT_DONE);
+    }
+    if (cmds & LC_CMD_UNRENDER) sim->calls[CALL_IS_VISIBLE]++;
+    if (cmds & LC_CMD_MEMORY_LOW) {
+        sim->calls[CALL_MEMORY_TARGET]++;
+        sim->memoryLow = 1;
+    }
+    if (cmds & LC_CMD_SUSPEND) {
+        sim->calls[CALL_TRY_SUSPEND]++;
+        sim_queue(sim, LC_EVENT_SUSPEND_DONE);
+    }
+    if (cmds & LC_CMD_RELOAD) sim->calls[CALL_RELOAD]++;
+    if (cmds & LC_CMD_PING) sim->calls[CALL_EXECUTE_SCRIPT]++;
+    if (cmds & LC_CMD_REBUILD) {
+        sim->calls[CALL_REBUILD]++;
+        sim_queue(sim, LC_EVENT_CLOSED);
+        sim_queue(sim, LC_EVENT_CREATED);
+    }
+    if (cmds & LC_CMD_DISCARD) {
+        sim->calls[CALL_DISCARD]++;
+        sim_queue(sim, LC_EVENT_CLOSED);
+    }
+    if (cmds & LC_CMD_RECREATE) {
+        sim->calls[CALL_RECREATE]++;
+        sim_queue(sim, LC_EVENT_CREATED);
+    }
+}
+
+static void sim_step(Sim* sim, LifecycleEvent event) {
+    LifecycleState before = sim->lc.state;
+    unsigned cmds = lifecycle_step(&sim->lc, event);
+    if (sim->lc.state != before) sim->transitions++;
+    if (sim->verbose) {
+        printf("    %-16s %-10s -> %-10s cmds 0x%05x\n", lifecycle_event_name(event),
+               lifecycle_state_name(before), lifecycle_state_name(sim->lc.state), cmds);
+    }
+    sim_run(sim, cmds);
+}
+
+static void sim_flush(Sim* sim) {
+    // Completions can queue more completions (a rebuild re-creates); deliver
+    // until quiet, in order.
+    for (int i = 0; i < sim->queued; i++) sim_step(sim, sim->queue[i]);
+    sim->queued = 0;
+}
+
+static int sim_parse_event(const char* name, size_t len, LifecycleEvent* out) {
+    for (int e = 0; e < LC_EVENT_COUNT; e++) {
+        const char* candidate = lifecycle_event_name((LifecycleEvent)e);
+        if (strlen(candidate) == len && strncmp(candidate, name, len) == 0) {
+            *out = (LifecycleEvent)e;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    const char* title;
+    int sleep;
+    const char* script;
+    LifecycleState final;   // Expected once every completion is delivered
+    int calls[CALL_COUNT];  // Expected calls; unlisted ones none
+} Scenario;
+
+// Run one script; with an expectation, compare against it. Returns the
+// number of failures.
+static int sim_script(const char* title, int sleep, const char* script, const Scenario* expect,
+                      int verbose) {
+    Sim sim;
+    memset(&sim, 0, sizeof(sim));
+    sim.verbose = verbose;
+    lifecycle_init(&sim.lc, sleep, 1, SIM_MAX_KICKS);
+
+    printf("%s (sleep %s)\n", title, sleep ? "on" : "off");
+    if (verbose) printf("  %s\n", script);
+
+    const char* p = script;
+    while (*p) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        const char* start = p;
+        while (*p && *p != ' ' && *p != '*') p++;
+        size_t len = (size_t)(p - start);
+        int repeat = 1;
+        if (*p == '*') {
+            repeat = atoi(p + 1);
+            while (*p && *p != ' ') p++;
+        }
+
+        if (len == 1 && *start == '.') {
+            sim_flush(&sim);
+            continue;
+        }
+        if (len == 6 && (*start == '+' || *start == '-') && strncmp(start + 1, "sleep", 5) == 0) {
+            sim.lc.sleep = *start == '+';
+            continue;
+        }
+        if (len == 6 && (*start == '+' || *start == '-') && strncmp(start + 1, "grace", 5) == 0) {
+            sim.lc.grace = *start == '+';
+            continue;
+        }
+        LifecycleEvent event;
+        if (!sim_parse_event(start, len, &event)) {
+            printf("  FAIL: unknown event %.*s\n", (int)len, start);
+            return 1;
+        }
+        for (int i = 0; i < repeat; i++) sim_step(&sim, event);
+    }
+    sim_flush(&sim);
+
+    int total = 0;
+    for (int i = 0; i < CALL_COUNT; i++) {
+        if (i < CALL_REBUILD) total += sim.calls[i];
+    }
+    printf("  final state %s, %d transitions, %d WebView2 calls\n",
+           lifecycle_state_name(sim.lc.state), sim.transitions, total);
+    for (int i = 0; i < CALL_COUNT; i++) {
+        if (sim.calls[i]) printf("    %-34s %d\n", k_callNames[i], sim.calls[i]);
+    }
+
+    int failures = 0;
+    if (sim.overflowed) {
+        printf("  FAIL: more than %d completions queued at once\n", SIM_QUEUE_MAX);
+        failures++;
+    }
+    if (!expect) return failures;
+    if (sim.lc.state != expect->final) {
+        printf("  FAIL: final state %s, expected %s\n", lifecycle_state_name(sim.lc.state),
+               lifecycle_state_name(expect->final));
+        failures++;
+    }
+    for (int i = 0; i < CALL_COUNT; i++) {
+        if (sim.calls[i] != expect->calls[i]) {
+            printf("  FAIL: %s %d, expected %d\n", k_callNames[i], sim.calls[i], expect->calls[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+// Hidden ticks are occlusion checks while the window is up: one per burst of
+// window events, and the safety poll every 5 s.
+static const Scenario k_scenarios[] = {
+    { "preload, stay hidden", 0,
+      "created nav-completed hide*8",
+      LC_STATE_WARM, { [CALL_IS_VISIBLE] = 1, [CALL_BOUNDS] = 1 } },
+    { "preload, settle, sleep", 1,
+      "created nav-completed preload-settled . dwell-expired dwell-expired .",
+      LC_STATE_SUSPENDED, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 2, [CALL_BOUNDS] = 1,
+        [CALL_MEMORY_TARGET] = 1, [CALL_CAPTURE_PREVIEW] = 1 } },
+    { "open 5 s, close, hidden through every tier", 1,
+      "created nav-completed preload-settled . show show*20 hide hide*4 dwell-expired . hide*4 "
+      "dwell-expired hide*4 dwell-expired .",
+      LC_STATE_SUSPENDED, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 4, [CALL_BOUNDS] = 2,
+        [CALL_MEMORY_TARGET] = 1, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "reopen from the unrendered tier", 1,
+      "created nav-completed preload-settled . show hide dwell-expired . hide*4 show show*4 hide",
+      LC_STATE_COOLING, { [CALL_IS_VISIBLE] = 5, [CALL_BOUNDS] = 3, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "reopen from the low-memory tier", 1,
+      "created nav-completed preload-settled . show hide dwell-expired . dwell-expired hide*4 "
+      "show show*4 hide",
+      LC_STATE_COOLING, { [CALL_IS_VISIBLE] = 5, [CALL_BOUNDS] = 3, [CALL_MEMORY_TARGET] = 2,
+        [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "hover in the low-memory tier, then timeout", 1,
+      "created nav-completed preload-settled . show hide dwell-expired . dwell-expired "
+      "hover*20 prewarm-expired .",
+      LC_STATE_UNRENDERED, { [CALL_IS_VISIBLE] = 6, [CALL_BOUNDS] = 3, [CALL_MEMORY_TARGET] = 2,
+        [CALL_CAPTURE_PREVIEW] = 3 } },
+    { "open 5 s, close, no grace period", 1,
+      "-grace created nav-completed preload-settled . show show*20 hide hide*4 .",
+      LC_STATE_SUSPENDED, { [CALL_RESUME] = 1, [CALL_TRY_SUSPEND] = 2, [CALL_IS_VISIBLE] = 4,
+        [CALL_BOUNDS] = 2, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "close and reopen 10 times within the grace period", 1,
+      "created nav-completed preload-settled . show show*8 hide hide*8 show show*8 hide hide*8 "
+      "show show*8 hide hide*8 show show*8 hide hide*8 show show*8 hide hide*8 "
+      "show show*8 hide hide*8 show show*8 hide hide*8 show show*8 hide hide*8 "
+      "show show*8 hide hide*8 show show*8 hide hide*8 dwell-expired . dwell-expired "
+      "dwell-expired .",
+      LC_STATE_SUSPENDED, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 4, [CALL_BOUNDS] = 2,
+        [CALL_MEMORY_TARGET] = 1, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "close and reopen 10 times, no grace period", 1,
+      "-grace created nav-completed preload-settled . show show*8 hide . show show*8 hide . "
+      "show show*8 hide . show show*8 hide . show show*8 hide . show show*8 hide . "
+      "show show*8 hide . show show*8 hide . show show*8 hide . show show*8 hide .",
+      LC_STATE_SUSPENDED, { [CALL_RESUME] = 10, [CALL_TRY_SUSPEND] = 11, [CALL_IS_VISIBLE] = 22,
+        [CALL_BOUNDS] = 11, [CALL_CAPTURE_PREVIEW] = 11 } },
+    { "occlusion flapping", 1,
+      "created nav-completed show show*4 hide show hide show hide show hide show show*4",
+      LC_STATE_SHOWN, { [CALL_IS_VISIBLE] = 1, [CALL_BOUNDS] = 1 } },
+    { "mostly covered, uncovered before the snapshot lands", 1,
+      "created nav-completed preload-settled . show partial show .",
+      LC_STATE_SHOWN, { [CALL_IS_VISIBLE] = 3, [CALL_BOUNDS] = 2, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "open, mostly covered for a while, uncovered, closed", 1,
+      "created nav-completed preload-settled . show show*4 partial . partial*20 show show*4 "
+      "partial . partial*8 hide hide*4 dwell-expired .",
+      LC_STATE_SUSPENDED, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 6, [CALL_BOUNDS] = 3,
+        [CALL_MEMORY_TARGET] = 3, [CALL_CAPTURE_PREVIEW] = 3 } },
+    { "mostly covered with sleep off, then closed", 0,
+      "created nav-completed show partial . partial*20 hide hide*4",
+      LC_STATE_WARM, { [CALL_IS_VISIBLE] = 3, [CALL_BOUNDS] = 2, [CALL_MEMORY_TARGET] = 2,
+        [CALL_CAPTURE_PREVIEW] = 1 } },
+    { "open 5 s, close", 0,
+      "created nav-completed show show*20 hide hide*4",
+      LC_STATE_WARM, { [CALL_IS_VISIBLE] = 1, [CALL_BOUNDS] = 1 } },
+    { "hover storm, then timeout", 1,
+      "created nav-completed preload-settled . hover*200 prewarm-expired .",
+      LC_STATE_UNRENDERED, { [CALL_IS_VISIBLE] = 4, [CALL_BOUNDS] = 2,
+        [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "hover, then open", 1,
+      "created nav-completed preload-settled . hover*30 show show*8 hide .",
+      LC_STATE_COOLING, { [CALL_IS_VISIBLE] = 3, [CALL_BOUNDS] = 2, [CALL_CAPTURE_PREVIEW] = 1 } },
+    { "reopen while the snapshot is in flight", 1,
+      "-grace created nav-completed show hide show .",
+      LC_STATE_SHOWN, { [CALL_IS_VISIBLE] = 1, [CALL_BOUNDS] = 1, [CALL_CAPTURE_PREVIEW] = 1 } },
+    { "reopen while suspend in flight", 1,
+      "created nav-completed show hide dwell-expired . dwell-expired dwell-expired show .",
+      LC_STATE_SHOWN, { [CALL_RESUME] = 2, [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 3,
+        [CALL_BOUNDS] = 2, [CALL_MEMORY_TARGET] = 2, [CALL_CAPTURE_PREVIEW] = 1 } },
+    { "power cycle while asleep", 1,
+      "created nav-completed preload-settled . dwell-expired dwell-expired . hide power-suspend "
+      "power-resume power-resume kick-due liveness-ok .",
+      LC_STATE_UNRENDERED, { [CALL_RESUME] = 1, [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 5,
+        [CALL_BOUNDS] = 2, [CALL_NOTIFY_PARENT] = 1, [CALL_MEMORY_TARGET] = 1,
+        [CALL_EXECUTE_SCRIPT] = 1, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "power cycle, runtime wedged", 1,
+      "created nav-completed preload-settled . power-suspend power-resume "
+      "kick-due liveness-silent kick-due liveness-silent kick-due liveness-silent .",
+      LC_STATE_LOADING, { [CALL_RESUME] = 3, [CALL_IS_VISIBLE] = 9, [CALL_BOUNDS] = 5,
+        [CALL_NOTIFY_PARENT] = 3, [CALL_EXECUTE_SCRIPT] = 3, [CALL_CAPTURE_PREVIEW] = 1,
+        [CALL_REBUILD] = 1 } },
+    { "renderer crash while shown and asleep", 1,
+      "-grace created nav-completed show renderer-failed hide . renderer-failed nav-completed "
+      "preload-settled .",
+      LC_STATE_SUSPENDED, { [CALL_RESUME] = 1, [CALL_TRY_SUSPEND] = 2, [CALL_IS_VISIBLE] = 4,
+        [CALL_BOUNDS] = 2, [CALL_RELOAD] = 2, [CALL_CAPTURE_PREVIEW] = 2 } },
+    { "discarded after a long idle, rebuilt on hover", 1,
+      "created nav-completed preload-settled . dwell-expired dwell-expired . discard-due . "
+      "hover*20 . nav-completed preload-settled .",
+      LC_STATE_UNRENDERED, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 4, [CALL_BOUNDS] = 2,
+        [CALL_MEMORY_TARGET] = 2, [CALL_CAPTURE_PREVIEW] = 2, [CALL_DISCARD] = 1,
+        [CALL_RECREATE] = 1 } },
+    { "discarded, then opened", 1,
+      "created nav-completed preload-settled . dwell-expired dwell-expired . discard-due . "
+      "power-suspend power-resume show . nav-completed show*8",
+      LC_STATE_SHOWN, { [CALL_TRY_SUSPEND] = 1, [CALL_IS_VISIBLE] = 3, [CALL_BOUNDS] = 2,
+        [CALL_MEMORY_TARGET] = 2, [CALL_CAPTURE_PREVIEW] = 1, [CALL_DISCARD] = 1,
+        [CALL_RECREATE] = 1 } },
+    { "sleep toggled while hidden", 0,
+      "created nav-completed hide +sleep sleep-changed . -sleep sleep-changed",
+      LC_STATE_WARM, { [CALL_IS_VISIBLE] = 3, [CALL_BOUNDS] = 2, [CALL_CAPTURE_PREVIEW] = 1 } },
+};
+
+int main(int argc, char** argv) {
+    int verbose = 0;
+    int sleep = 0;
+    int ran = 0;
+    int failures = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            sleep = 1;
+        } else {
+            failures += sim_script("script", sleep, argv[i], NULL, verbose);
+            ran++;
+        }
+    }
+
+    for (size_t i = 0; !ran && i < sizeof(k_scenarios) / sizeof(k_scenarios[0]); i++) {
+        const Scenario* s = &k_scenarios[i];
+        failures += sim_script(s->title, s->sleep, s->script, s, verbose);
+    }
+    if (failures) printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
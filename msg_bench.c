@@ -0,0 +1,337 @@
+// Message bench: replays recorded config dialog sessions through the
+// tokenizer and the saveSettings decode in webmsg.h, checks what every
+// message decodes to, and counts the heap allocations each one makes
+// (make msg-bench; see bench.h).
+//
+// The corpus is what the page sends (JSON.stringify output, see
+// assets/src/lib/bridge.ts): a first run, a save with escaped hooks,
+// non-ASCII text and a language list to normalize, a cancelled dialog, a
+// burst of resizes (one with the height quoted, as older pages sent it),
+// malformed and padded messages, and a save with a 30000-character hook and
+// a language list too long for the arena's inline block. Only the save
+// allocates - the builder's buffer, the config blob and, for that last one,
+// an arena block - and everything must be released once the message has
+// been handled.
+
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+// Every allocation webmsg.h and config.h make goes through these.
+static long g_allocs, g_live;
+static size_t g_allocBytes;
+
+static void* count_malloc(size_t n) {
+    void* p = malloc(n);
+    if (p) {
+        g_allocs++;
+        g_live++;
+        g_allocBytes += n;
+    }
+    return p;
+}
+
+static void* count_realloc(void* old, size_t n) {
+    void* p = realloc(old, n);
+    if (p) {
+        g_allocs++;
+        if (!old) g_live++;
+        g_allocBytes += n;
+    }
+    return p;
+}
+
+static void count_free(void* p) {
+    if (p) g_live--;
+    free(p);
+}
+
+#define malloc count_malloc
+#define realloc count_realloc
+#define free count_free
+#include "webmsg.h"
+#undef malloc
+#undef realloc
+#undef free
+#include "bench.h"
+
+// --- Corpus -----------------------------------------------------------------
+
+typedef struct {
+    const wchar_t* url;
+    const wchar_t* title;
+    const wchar_t* onHideJs;
+    const wchar_t* onShowJs;
+    const wchar_t* langs;       // as stored, normalized
+    BOOL sleepWhenInactive;
+    BOOL openNewWindowsExternally;
+    DWORD suspendDelay;
+} Saved;
+
+typedef struct {
+    const wchar_t* text;
+    BOOL wellFormed;
+    CfgAction action;
+    int height;                 // resize
+    const Saved* saved;         // saveSettings
+} Recorded;
+
+typedef struct {
+    const char* name;
+    const Recorded* msgs;
+    int count;
+} Session;
+
+static const Saved k_firstRunSaved = {
+    L"https://mail.example.com/", L"Mail", L"", L"", L"", FALSE, FALSE, 30,
+};
+
+static const Recorded k_firstRun[] = {
+    { L"{\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL },
+    { L"{\"action\":\"resize\",\"height\":180}", TRUE, CFG_ACTION_RESIZE, 180, NULL },
+    { L"{\"action\":\"resize\",\"height\":412}", TRUE, CFG_ACTION_RESIZE, 412, NULL },
+    { L"{\"action\":\"saveSettings\",\"url\":\"https://mail.example.com/\",\"windowTitle\":\"Mail\","
+      L"\"onHideJs\":\"\",\"onShowJs\":\"\",\"sleepWhenInactive\":false,\"spellcheckLanguages\":\"\","
+      L"\"openNewWindowsExternally\":false,\"suspendDelay\":30}",
+      TRUE, CFG_ACTION_SAVE_SETTINGS, 0, &k_firstRunSaved },
+};
+
+static const Saved k_hooksSaved = {
+    L"https://chat.example.com/?room=a&b=\"c\"",
+    L"Poczta \u2013 Za\u017c\u00f3\u0142\u0107 \xd83d\xde00\x01",
+    L"document.title = \"away\";\n\twindow.__paused = true; // C:\\tmp",
+    L"window.__paused = false;\r\n",
+    L"en-US,pl,de-DE,sr-Latn-RS",
+    TRUE, TRUE, 120,
+};
+
+static const Recorded k_hooks[] = {
+    { L"{\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL },
+    { L"{\"action\":\"resize\",\"height\":412}", TRUE, CFG_ACTION_RESIZE, 412, NULL },
+    { L"{\"action\":\"resize\",\"height\":436}", TRUE, CFG_ACTION_RESIZE, 436, NULL },
+    { L"{\"action\":\"saveSettings\",\"url\":\"https://chat.example.com/?room=a&b=\\\"c\\\"\","
+      L"\"windowTitle\":\"Poczta \u2013 Za\u017c\u00f3\u0142\u0107 \\ud83d\\ude00\\u0001\","
+      L"\"onHideJs\":\"document.title = \\\"away\\\";\\n\\twindow.__paused = true; // C:\\\\tmp\","
+      L"\"onShowJs\":\"window.__paused = false;\\r\\n\",\"sleepWhenInactive\":true,"
+      L"\"spellcheckLanguages\":\"en_us, PL;de-de,en-US, sr-latn-rs, bad!tag\","
+      L"\"openNewWindowsExternally\":true,\"suspendDelay\":120}",
+      TRUE, CFG_ACTION_SAVE_SETTINGS, 0, &k_hooksSaved },
+};
+
+static const Recorded k_cancel[] = {
+    { L"{\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL },
+    { L"{\"action\":\"resize\",\"height\":412}", TRUE, CFG_ACTION_RESIZE, 412, NULL },
+    { L"{\"action\":\"close\"}", TRUE, CFG_ACTION_CLOSE, 0, NULL },
+};
+
+static const Recorded k_resizes[] = {
+    { L"{\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL },
+    { L"{\"action\":\"resize\",\"height\":96}", TRUE, CFG_ACTION_RESIZE, 96, NULL },
+    { L"{\"action\":\"resize\",\"height\":180}", TRUE, CFG_ACTION_RESIZE, 180, NULL },
+    { L"{\"action\":\"resize\",\"height\":297.5}", TRUE, CFG_ACTION_RESIZE, 297, NULL },
+    { L"{\"action\":\"resize\",\"height\":\"412\"}", TRUE, CFG_ACTION_RESIZE, 412, NULL },
+    { L"{\"action\":\"resize\",\"height\":436}", TRUE, CFG_ACTION_RESIZE, 436, NULL },
+    { L"{\"action\":\"resize\",\"height\":512}", TRUE, CFG_ACTION_RESIZE, 512, NULL },
+    { L"{\"action\":\"resize\",\"height\":99999999999}", TRUE, CFG_ACTION_RESIZE, INT_MAX, NULL },
+    { L"{\"action\":\"resize\",\"height\":-40}", TRUE, CFG_ACTION_RESIZE, -40, NULL },
+    { L"{\"action\":\"close\"}", TRUE, CFG_ACTION_CLOSE, 0, NULL },
+};
+
+static const Recorded k_odd[] = {
+    { L"", FALSE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"[\"getInit\"]", FALSE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{\"action\":\"saveSettings\",\"url\":\"https://x", FALSE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{\"action\":\"getInit\",}", FALSE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{}", TRUE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{\"action\":\"reboot\"}", TRUE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{\"action\":\"getIni\"}", TRUE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L"{\"action\":7}", TRUE, CFG_ACTION_UNKNOWN, 0, NULL },
+    { L" { \"extra\" : { \"a\" : [1, {\"b\":\"}]\"}] } ,\n \"action\" : \"close\" } ",
+      TRUE, CFG_ACTION_CLOSE, 0, NULL },
+    { L"{\"action\":\"resize\",\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL },
+};
+
+// The large save is generated: a hook of 30000 characters with an escape
+// every line, and a language list whose raw text overflows the arena's
+// inline block.
+#define LARGE_HOOK_LINES 2500
+#define LARGE_LANGS 700
+
+static wchar_t g_largeMsg[LARGE_HOOK_LINES * 16 + LARGE_LANGS * 8 + 512];
+static wchar_t g_largeHook[LARGE_HOOK_LINES * 12 + 1];
+static wchar_t g_largeLangs[LARGE_LANGS * 6 + 1];
+static Saved g_largeSaved;
+static Recorded g_large[2];
+
+static void append(wchar_t* dst, size_t* n, const wchar_t* s) {
+    size_t l = wcslen(s);
+    wmemcpy(dst + *n, s, l + 1);
+    *n += l;
+}
+
+static void make_large(void) {
+    size_t n = 0, h = 0, l = 0;
+    append(g_largeMsg, &n, L"{\"action\":\"saveSettings\",\"url\":\"https://big.example.com/\","
+                           L"\"windowTitle\":\"Big\",\"onHideJs\":\"\",\"onShowJs\":\"");
+    for (int i = 0; i < LARGE_HOOK_LINES; i++) {
+        append(g_largeMsg, &n, L"tick(\\\"a\\\");\\n");
+        append(g_largeHook, &h, L"tick(\"a\");\n");
+    }
+    append(g_largeMsg, &n, L"\",\"sleepWhenInactive\":true,\"spellcheckLanguages\":\"");
+    for (int i = 0; i < LARGE_LANGS; i++) {
+        wchar_t raw[16], tag[16];
+        swprintf(raw, 16, L"%lsL%03d", i ? (i % 2 ? L", " : L";") : L"", i);
+        swprintf(tag, 16, L"%lsl%03d", i ? L"," : L"", i);
+        append(g_largeMsg, &n, raw);
+        append(g_largeLangs, &l, tag);
+    }
+    append(g_largeMsg, &n, L"\",\"openNewWindowsExternally\":false,\"suspendDelay\":99999}");
+    g_largeSaved = (Saved){ L"https://big.example.com/", L"Big", L"", g_largeHook, g_largeLangs,
+                            TRUE, FALSE, SUSPEND_DELAY_MAX_S };
+    g_large[0] = (Recorded){ L"{\"action\":\"getInit\"}", TRUE, CFG_ACTION_GET_INIT, 0, NULL };
+    g_large[1] = (Recorded){ g_largeMsg, TRUE, CFG_ACTION_SAVE_SETTINGS, 0, &g_largeSaved };
+}
+
+static const Session g_sessions[] = {
+    { "first-run", k_firstRun, sizeof(k_firstRun) / sizeof(k_firstRun[0]) },
+    { "hooks", k_hooks, sizeof(k_hooks) / sizeof(k_hooks[0]) },
+    { "cancel", k_cancel, sizeof(k_cancel) / sizeof(k_cancel[0]) },
+    { "resizes", k_resizes, sizeof(k_resizes) / sizeof(k_resizes[0]) },
+    { "odd", k_odd, sizeof(k_odd) / sizeof(k_odd[0]) },
+    { "large", g_large, sizeof(g_large) / sizeof(g_large[0]) },
+};
+#define SESSION_COUNT (int)(sizeof(g_sessions) / sizeof(g_sessions[0]))
+
+// --- Replay -----------------------------------------------------------------
+
+typedef struct {
+    BOOL wellFormed;
+    CfgAction action;
+    int height;
+    BOOL saved;
+    BOOL spilled;               // the arena left its inline block
+} Handled;
+
+// What CfgMsgReceived_Invoke does with a message, short of the window and
+// the store. The saved configuration is left in next for the caller.
+static Handled handle(const wchar_t* text, const Configuration* base, Configuration* next) {
+    Handled h = {0};
+    WebMessage m;
+    MsgArena arena;
+    msg_arena_init(&arena);
+    h.wellFormed = json_msg_parse(text, wcslen(text), &m);
+    h.action = json_msg_action(&m);
+    switch (h.action) {
+        case CFG_ACTION_SAVE_SETTINGS:
+            h.saved = cfg_msg_settings(&m, base, &arena, next);
+            break;
+        case CFG_ACTION_RESIZE:
+            h.height = json_msg_int(&m, MSG_FIELD_HEIGHT, 0);
+            break;
+        default:
+            break;
+    }
+    h.spilled = arena.blocks != NULL;
+    msg_arena_free(&arena);
+    return h;
+}
+
+static void check_saved(const Configuration* c, const Saved* want) {
+    CHECK(wcscmp(c->url, want->url) == 0, "url");
+    CHECK(wcscmp(c->windowTitle, want->title) == 0, "window title");
+    CHECK(wcscmp(c->onHideJs, want->onHideJs) == 0, "hide hook");
+    CHECK(wcscmp(c->onShowJs, want->onShowJs) == 0, "show hook");
+    CHECK(wcscmp(c->spellcheckLanguages, want->langs) == 0, "languages");
+    CHECK(c->sleepWhenInactive == want->sleepWhenInactive, "sleep when inactive");
+    CHECK(c->openNewWindowsExternally == want->openNewWindowsExternally, "open externally");
+    CHECK(c->suspendDelay == want->suspendDelay, "suspend delay");
+}
+
+typedef struct {
+    long msgs, allocs;
+    size_t bytes;
+} Tally;
+
+// Replay every session once against base, checking each message and
+// counting what it allocates.
+static void check(const Configuration* base, Tally tally[SESSION_COUNT]) {
+    int msgs = 0;
+    for (int s = 0; s < SESSION_COUNT; s++) {
+        const Session* session = &g_sessions[s];
+        memset(&tally[s], 0, sizeof(tally[s]));
+        for (int i = 0; i < session->count; i++) {
+            const Recorded* r = &session->msgs[i];
+            long allocs = g_allocs, live = g_live;
+            size_t bytes = g_allocBytes;
+            Configuration next = {0};
+            Handled h = handle(r->text, base, &next);
+            tally[s].msgs++;
+            tally[s].allocs += g_allocs - allocs;
+            tally[s].bytes += g_allocBytes - bytes;
+            msgs++;
+
+            CHECK(h.wellFormed == r->wellFormed, session->name);
+            CHECK(h.action == r->action, session->name);
+            if (r->action == CFG_ACTION_RESIZE) CHECK(h.height == r->height, session->name);
+            if (r->saved) {
+                CHECK(h.saved, session->name);
+                if (h.saved) check_saved(&next, r->saved);
+                CHECK(wcscmp(next.managedPrefs, base->managedPrefs) == 0, "unsent values kept");
+                // Only the language list goes through the arena.
+                CHECK(h.spilled == (r->saved == &g_largeSaved), "arena spill");
+            } else {
+                CHECK(g_allocs == allocs, "only a save allocates");
+            }
+            config_release(&next);
+            CHECK(g_live == live, "everything released after the message");
+        }
+    }
+    printf("check %d sessions, %d messages: decode, actions, allocations released\n",
+           SESSION_COUNT, msgs);
+}
+
+static void bench(const Configuration* base, const Tally tally[SESSION_COUNT]) {
+    for (int s = 0; s < SESSION_COUNT; s++) {
+        const Session* session = &g_sessions[s];
+        BenchTimer t;
+        bench_start(&t);
+        do {
+            for (int k = 0; k < 100; k++) {
+                for (int i = 0; i < session->count; i++) {
+                    Configuration next = {0};
+                    handle(session->msgs[i].text, base, &next);
+                    config_release(&next);
+                }
+            }
+        } while (bench_more(&t, 100L * session->count));
+        double ns = bench_ns(&t);
+        printf("time  %-10s %3ld msgs  %5.2f allocs/msg  %9.0f bytes/msg  %9.0f ns/msg\n",
+               session->name, tally[s].msgs, (double)tally[s].allocs / (double)tally[s].msgs,
+               (double)tally[s].bytes / (double)tally[s].msgs, ns);
+    }
+}
+
+int main(int argc, char** argv) {
+    int quick = bench_quick(argc, argv);
+    make_large();
+
+    // The dialog edits the site's current configuration.
+    Configuration base = {0};
+    ConfigBuilder b;
+    config_builder_init(&b, NULL);
+    config_builder_set(&b, CFG_STR_URL, L"https://old.example.com/", 24);
+    config_builder_set(&b, CFG_STR_MANAGED_PREFS, L"net.network_prediction_options=2", 32);
+    config_builder_finish(&b, &base);
+
+    Tally tally[SESSION_COUNT];
+    check(&base, tally);
+    if (!quick) bench(&base, tally);
+    config_release(&base);
+    CHECK(g_live == 0, "nothing leaked");
+    return bench_finish(0);
+}
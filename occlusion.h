@@ -0,0 +1,221 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) && !defined(OCC_NO_SIMD)
+#include <emmintrin.h>
+#define OCC_SIMD 1
+#endif
+
+// Occlusion test on plain rectangles: is any part of a window left once
+// every window above it is taken away? The host snapshots the z-order
+// (rects and cloak flags, front to back) and asks occ_any_visible; nothing
+// here touches Win32, so occlusion_bench.c checks and times the same code
+// on any platform.
+//
+// The visible remainder is kept as a set of disjoint rectangles. Each
+// occluder splits the pieces it overlaps into at most four, and the test
+// stops as soon as nothing is left. Windows are read in blocks, and those
+// that miss what is left are dropped in one pass per block (occ_filter, SSE2
+// when available), so a deep z-order costs little more than reading it.
+
+typedef struct {
+    int32_t left, top, right, bottom;  // Right and bottom exclusive, as RECT
+} OccRect;
+
+#define OCC_CLOAKED 0x1  // Drawn by nothing (DWM-cloaked); never occludes
+
+typedef struct {
+    OccRect rect;
+    uint32_t flags;
+} OccWindow;
+
+// Pieces the remainder may split into before the test gives up and answers
+// "visible" - wrong only towards keeping a page awake.
+#define OCC_MAX_PIECES 256
+
+// Windows filtered per pass; after each the remainder is checked, so a
+// covered window stops reading the z-order at the block that covers it.
+#define OCC_BLOCK 64
+
+// What is left of the target so far, as disjoint rectangles.
+typedef struct {
+    OccRect pieces[2][OCC_MAX_PIECES];
+    int cur;          // Which pieces[] holds the remainder
+    size_t count;     // 0: fully covered
+    OccRect bounds;   // Of the remainder; occluders outside it are skipped
+    int overflowed;   // Too fragmented to follow; stays "visible"
+} OccRegion;
+
+static inline int occ_intersects(const OccRect* a, const OccRect* b) {
+    return a->left < b->right && b->left < a->right && a->top < b->bottom && b->top < a->bottom;
+}
+
+static inline int occ_empty(const OccRect* r) {
+    return r->right <= r->left || r->bottom <= r->top;
+}
+
+// Copy the occluders that can matter to out (room for count), keeping their
+// order: not cloaked, not empty, overlapping bounds. Returns how many.
+static inline size_t occ_filter_scalar(const OccWindow* windows, size_t count, OccRect bounds,
+                                       OccRect* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const OccRect* r = &windows[i].rect;
+        if (windows[i].flags & OCC_CLOAKED) continue;
+        if (occ_empty(r) || !occ_intersects(r, &bounds)) continue;
+        out[n++] = *r;
+    }
+    return n;
+}
+
+#ifdef OCC_SIMD
+// Same test, one rect per vector: lanes 0-1 check left/top against the
+// bounds' right/bottom, lanes 2-3 right/bottom against its left/top, and the
+// swapped copy checks the rect itself is not empty.
+static inline size_t occ_filter_sse2(const OccWindow* windows, size_t count, OccRect bounds,
+                                     OccRect* out) {
+    const __m128i edges = _mm_setr_epi32(bounds.right, bounds.bottom, bounds.left, bounds.top);
+    const __m128i low = _mm_setr_epi32(-1, -1, 0, 0);
+    const __m128i high = _mm_setr_epi32(0, 0, -1, -1);
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (windows[i].flags & OCC_CLOAKED) continue;
+        __m128i r = _mm_loadu_si128((const __m128i*)&windows[i].rect);
+        __m128i swapped = _mm_shuffle_epi32(r, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i overlap = _mm_or_si128(_mm_and_si128(_mm_cmplt_epi32(r, edges), low),
+                                       _mm_and_si128(_mm_cmpgt_epi32(r, edges), high));
+        __m128i nonEmpty = _mm_or_si128(_mm_cmpgt_epi32(swapped, r), high);
+        if (_mm_movemask_epi8(_mm_and_si128(overlap, nonEmpty)) == 0xFFFF) {
+            out[n++] = windows[i].rect;
+        }
+    }
+    return n;
+}
+#define occ_filter occ_filter_sse2
+#else
+#define occ_filter occ_filter_scalar
+#endif
+
+// p minus o (which overlaps it) as up to four disjoint pieces: the bands
+// above and below o, then the parts left and right of it in between.
+static inline size_t occ_cut(const OccRect* p, const OccRect* o, OccRect* out) {
+    size_t n = 0;
+    int32_t top = p->top, bottom = p->bottom;
+    if (o->top > top) {
+        OccRect r = { p->left, top, p->right, o->top };
+        out[n++] = r;
+        top = o->top;
+    }
+    if (o->bottom < bottom) {
+        OccRect r = { p->left, o->bottom, p->right, bottom };
+        out[n++] = r;
+        bottom = o->bottom;
+    }
+    if (o->left > p->left) {
+        OccRect r = { p->left, top, o->left, bottom };
+        out[n++] = r;
+    }
+    if (o->right < p->right) {
+        OccRect r = { o->right, top, p->right, bottom };
+        out[n++] = r;
+    }
+    return n;
+}
+
+static inline void occ_region_init(OccRegion* rgn, OccRect target) {
+    rgn->cur = 0;
+    rgn->count = occ_empty(&target) ? 0 : 1;
+    rgn->pieces[0][0] = target;
+    rgn->bounds = target;
+    rgn->overflowed = 0;
+}
+
+// Take occluders away from the remainder. Nonzero while any of it is left.
+static inline int occ_region_subtract(OccRegion* rgn, const OccRect* occluders, size_t count) {
+    for (size_t i = 0; i < count && rgn->count && !rgn->overflowed; i++) {
+        const OccRect* o = &occluders[i];
+        if (!occ_intersects(o, &rgn->bounds)) continue;
+
+        const OccRect* cur = rgn->pieces[rgn->cur];
+        OccRect* next = rgn->pieces[rgn->cur ^ 1];
+        size_t m = 0;
+        for (size_t j = 0; j < rgn->count; j++) {
+            if (m + 4 > OCC_MAX_PIECES) {
+                rgn->overflowed = 1;
+                return 1;
+            }
+            if (occ_intersects(&cur[j], o)) m += occ_cut(&cur[j], o, next + m);
+            else next[m++] = cur[j];
+        }
+        rgn->cur ^= 1;
+        rgn->count = m;
+        if (!m) break;
+
+        OccRect bounds = next[0];
+        for (size_t j = 1; j < m; j++) {
+            if (next[j].left < bounds.left) bounds.left = next[j].left;
+            if (next[j].top < bounds.top) bounds.top = next[j].top;
+            if (next[j].right > bounds.right) bounds.right = next[j].right;
+            if (next[j].bottom > bounds.bottom) bounds.bottom = next[j].bottom;
+        }
+        rgn->bounds = bounds;
+    }
+    return rgn->count != 0;
+}
+
+// Fingerprint of a z-order snapshot: 64-bit FNV-1a over every value that
+// could change the answer, folded in one at a time from
+// OCC_FINGERPRINT_SEED. Equal fingerprints mean the same answer, barring a
+// one-in-2^64 collision.
+#define OCC_FINGERPRINT_SEED 0xcbf29ce484222325ull
+
+static inline uint64_t occ_fingerprint_mix(uint64_t h, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ (v & 0xFF)) * 0x100000001b3ull;
+        v >>= 8;
+    }
+    return h;
+}
+
+static inline uint64_t occ_fingerprint_rect(uint64_t h, const OccRect* r) {
+    h = occ_fingerprint_mix(h, (uint32_t)r->left | (uint64_t)(uint32_t)r->top << 32);
+    return occ_fingerprint_mix(h, (uint32_t)r->right | (uint64_t)(uint32_t)r->bottom << 32);
+}
+
+// Area of what is left. Exact once occ_any_visible has seen every window
+// and the region has not overflowed (its pieces then no longer cover it).
+static inline uint64_t occ_region_area(const OccRegion* rgn) {
+    const OccRect* pieces = rgn->pieces[rgn->cur];
+    uint64_t area = 0;
+    for (size_t i = 0; i < rgn->count; i++) {
+        area += (uint64_t)(pieces[i].right - pieces[i].left) * (uint64_t)(pieces[i].bottom - pieces[i].top);
+    }
+    return area;
+}
+
+typedef size_t (*OccFilterFn)(const OccWindow*, size_t, OccRect, OccRect*);
+
+// Nonzero if any part of target survives the windows above it (front to
+// back). Each block is filtered against what is left, not the whole target;
+// rgn is left holding the visible part (see occ_region_area).
+static inline int occ_any_visible_using(OccFilterFn filter, OccRect target,
+                                        const OccWindow* windows, size_t count, OccRegion* rgn) {
+    OccRect candidates[OCC_BLOCK];
+    occ_region_init(rgn, target);
+    for (size_t i = 0; i < count && rgn->count; i += OCC_BLOCK) {
+        size_t block = count - i < OCC_BLOCK ? count - i : OCC_BLOCK;
+        size_t n = filter(windows + i, block, rgn->bounds, candidates);
+        if (!occ_region_subtract(rgn, candidates, n)) return 0;
+    }
+    return rgn->count != 0;
+}
+
+static inline int occ_any_visible(OccRect target, const OccWindow* windows, size_t count,
+                                  OccRegion* rgn) {
+    return occ_any_visible_using(occ_filter, target, windows, count, rgn);
+}
+
+#endif
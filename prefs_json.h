@@ -0,0 +1,1080 @@
+#ifndef PREFS_JSON_H
+#define PREFS_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define JSON_SCAN_X86 1
+#endif
+
+// Minimal JSON surgery on Chromium's Preferences file (string- and
+// nesting-aware, never guesses): the structural scanner, the batched
+// in-memory and streaming patchers, and the content hash the patch
+// fingerprint is built on. Plain C on byte buffers and stdio streams, so
+// json_bench.c checks and times the same code on any platform; the file
+// handling around it stays in SystrayLauncher.c.
+
+static inline const char* json_skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+// Structural scanner: classifies 64-byte blocks into quote, backslash,
+// open- and close-bracket bitmasks (bit i = byte i) so the skip functions can
+// jump straight to the next byte that matters. Long base64 blobs and
+// extension state make up most of a big Preferences file and used to be
+// walked a byte at a time. SSE2 is the x86-64 baseline; AVX2 is picked at
+// runtime where the CPU and OS support it; other targets scan byte by byte
+// (json_scan_bytes). All three classifiers produce identical masks.
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open;   // '{' or '['
+    uint64_t close;  // '}' or ']'
+} JsonBlockMasks;
+
+#define JSON_BLOCK 64
+#define JSON_SCAN_QUOTE     0x1
+#define JSON_SCAN_BACKSLASH 0x2
+#define JSON_SCAN_OPEN      0x4
+#define JSON_SCAN_CLOSE     0x8
+
+static inline void json_classify_block_scalar(const char* p, JsonBlockMasks* m) {
+    m->quote = m->backslash = m->open = m->close = 0;
+    for (int i = 0; i < JSON_BLOCK; i++) {
+        uint64_t bit = 1ULL << i;
+        switch (p[i]) {
+            case '"':  m->quote |= bit; break;
+            case '\\': m->backslash |= bit; break;
+            case '{': case '[': m->open |= bit; break;
+            case '}': case ']': m->close |= bit; break;
+        }
+    }
+}
+
+#ifdef JSON_SCAN_X86
+// '[' / '{' and ']' / '}' differ only in bit 0x20, so OR-ing it in folds
+// each bracket pair into a single compare.
+static inline void json_classify_block_sse2(const char* p, JsonBlockMasks* m) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    m->quote = m->backslash = m->open = m->close = 0;
+    for (int i = 0; i < JSON_BLOCK / 16; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        __m128i folded = _mm_or_si128(v, fold);
+        int shift = 16 * i;
+        m->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        m->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << shift;
+        m->open |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)) << shift;
+        m->close |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void json_classify_block_avx2(const char* p, JsonBlockMasks* m) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i fold = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    m->quote = m->backslash = m->open = m->close = 0;
+    for (int i = 0; i < JSON_BLOCK / 32; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + 32 * i));
+        __m256i folded = _mm256_or_si256(v, fold);
+        int shift = 32 * i;
+        m->quote |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << shift;
+        m->backslash |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << shift;
+        m->open |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, open)) << shift;
+        m->close |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, close)) << shift;
+    }
+}
+#endif
+
+typedef void (*PFN_JsonClassifyBlock)(const char*, JsonBlockMasks*);
+
+// The classifier json_scan uses: the widest the CPU supports, unless one is
+// picked with json_use_classifier (json_bench compares and times each).
+static PFN_JsonClassifyBlock g_jsonClassify;
+
+static inline void json_use_classifier(PFN_JsonClassifyBlock classify) {
+    g_jsonClassify = classify;
+}
+
+static inline PFN_JsonClassifyBlock json_block_classifier(void) {
+    if (!g_jsonClassify) {
+#ifdef JSON_SCAN_X86
+        __builtin_cpu_init();
+        g_jsonClassify = __builtin_cpu_supports("avx2") ? json_classify_block_avx2
+                                                        : json_classify_block_sse2;
+#else
+        g_jsonClassify = json_classify_block_scalar;
+#endif
+    }
+    return g_jsonClassify;
+}
+
+static inline uint64_t json_select_masks(const JsonBlockMasks* m, int kinds) {
+    uint64_t sel = 0;
+    if (kinds & JSON_SCAN_QUOTE) sel |= m->quote;
+    if (kinds & JSON_SCAN_BACKSLASH) sel |= m->backslash;
+    if (kinds & JSON_SCAN_OPEN) sel |= m->open;
+    if (kinds & JSON_SCAN_CLOSE) sel |= m->close;
+    return sel;
+}
+
+// The scalar classifier is the reference the vector ones are tested against;
+// to find one byte, a plain loop is several times faster than its masks.
+static inline const char* json_scan_bytes(const char* p, const char* end, int kinds) {
+    for (; p < end; p++) {
+        char c = *p;
+        if (((kinds & JSON_SCAN_QUOTE) && c == '"') ||
+            ((kinds & JSON_SCAN_BACKSLASH) && c == '\\') ||
+            ((kinds & JSON_SCAN_OPEN) && (c == '{' || c == '[')) ||
+            ((kinds & JSON_SCAN_CLOSE) && (c == '}' || c == ']'))) {
+            return p;
+        }
+    }
+    return end;
+}
+
+// Returns the first byte in [p,end) of one of the JSON_SCAN_* kinds, or end.
+// A partial final block is classified from a zero-padded copy, so every byte
+// goes through the same classifier.
+static inline const char* json_scan(const char* p, const char* end, int kinds) {
+    if (p >= end) return end;
+    PFN_JsonClassifyBlock classify = json_block_classifier();
+    if (classify == json_classify_block_scalar) return json_scan_bytes(p, end, kinds);
+    JsonBlockMasks m;
+    while (end - p >= JSON_BLOCK) {
+        classify(p, &m);
+        uint64_t sel = json_select_masks(&m, kinds);
+        if (sel) return p + __builtin_ctzll(sel);
+        p += JSON_BLOCK;
+    }
+    if (p < end) {
+        char tail[JSON_BLOCK] = {0};
+        memcpy(tail, p, (size_t)(end - p));
+        classify(tail, &m);
+        uint64_t sel = json_select_masks(&m, kinds) & ((1ULL << (end - p)) - 1);
+        if (sel) return p + __builtin_ctzll(sel);
+    }
+    return end;
+}
+
+// p points at the opening quote; returns one past the closing quote.
+static inline const char* json_skip_string(const char* p, const char* end) {
+    p++;
+    while (p < end) {
+        p = json_scan(p, end, JSON_SCAN_QUOTE | JSON_SCAN_BACKSLASH);
+        if (p >= end) break;
+        if (*p == '\\') { p += 2; continue; }
+        return p + 1;
+    }
+    return NULL;
+}
+
+// Bare values (numbers, true/false/null) end at a delimiter, whitespace, or
+// the start of a string or container - the latter never belong to one, and
+// stopping there keeps a member walk in step with json_skip_value's bracket
+// counting on malformed input.
+static inline int json_is_scalar_end(char c) {
+    return c == ',' || c == '}' || c == ']' || c == '"' || c == '{' || c == '[' ||
+           c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Returns one past the end of the value starting at p (string, object,
+// array, number, bool or null), or NULL if the input is malformed/truncated.
+static inline const char* json_skip_value(const char* p, const char* end) {
+    p = json_skip_ws(p, end);
+    if (p >= end) return NULL;
+    if (*p == '"') return json_skip_string(p, end);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            p = json_scan(p, end, JSON_SCAN_QUOTE | JSON_SCAN_OPEN | JSON_SCAN_CLOSE);
+            if (p >= end) break;
+            if (*p == '"') {
+                p = json_skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else {
+                depth--;
+                if (depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    while (p < end && !json_is_scalar_end(*p)) p++;
+    return p;
+}
+
+// --- Validation -------------------------------------------------------------
+//
+// json_skip_value trusts the file it walks and only balances brackets and
+// quotes. Text that is spliced into the file (managed preference values) is
+// checked against the full grammar first: each of these returns one past the
+// value starting at p, or NULL where the text stops being JSON.
+
+#define JSON_CHECK_MAX_DEPTH 64
+
+static inline int json_is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static inline int json_is_hex(char c) {
+    return json_is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline const char* json_check_string(const char* p, const char* end) {
+    for (p++; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') return p + 1;
+        if (c < 0x20) return NULL;
+        if (c != '\\') continue;
+        if (++p >= end) return NULL;
+        if (*p == 'u') {
+            for (int i = 0; i < 4; i++)
+                if (++p >= end || !json_is_hex(*p)) return NULL;
+        } else if (*p == '\0' || !strchr("\"\\/bfnrt", *p)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static inline const char* json_check_digits(const char* p, const char* end) {
+    const char* start = p;
+    while (p < end && json_is_digit(*p)) p++;
+    return p > start ? p : NULL;
+}
+
+static inline const char* json_check_number(const char* p, const char* end) {
+    if (p < end && *p == '-') p++;
+    if (p < end && *p == '0') p++;
+    else if (!(p = json_check_digits(p, end))) return NULL;
+    if (p < end && *p == '.' && !(p = json_check_digits(p + 1, end))) return NULL;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        p = json_check_digits(p, end);
+    }
+    return p;
+}
+
+static inline const char* json_check_literal(const char* p, const char* end, const char* lit) {
+    size_t n = strlen(lit);
+    return (size_t)(end - p) >= n && memcmp(p, lit, n) == 0 ? p + n : NULL;
+}
+
+static inline const char* json_check_value_at(const char* p, const char* end, int depth) {
+    p = json_skip_ws(p, end);
+    if (p >= end) return NULL;
+    switch (*p) {
+    case '"': return json_check_string(p, end);
+    case 't': return json_check_literal(p, end, "true");
+    case 'f': return json_check_literal(p, end, "false");
+    case 'n': return json_check_literal(p, end, "null");
+    case '{':
+    case '[': {
+        int object = *p == '{';
+        char close = object ? '}' : ']';
+        if (depth >= JSON_CHECK_MAX_DEPTH) return NULL;
+        p = json_skip_ws(p + 1, end);
+        if (p < end && *p == close) return p + 1;
+        for (;;) {
+            if (object) {
+                if (p >= end || *p != '"' || !(p = json_check_string(p, end))) return NULL;
+                p = json_skip_ws(p, end);
+                if (p >= end || *p != ':') return NULL;
+                p++;
+            }
+            if (!(p = json_check_value_at(p, end, depth + 1))) return NULL;
+            p = json_skip_ws(p, end);
+            if (p >= end) return NULL;
+            if (*p == close) return p + 1;
+            if (*p != ',') return NULL;
+            p = json_skip_ws(p + 1, end);
+        }
+    }
+    default: return json_check_number(p, end);
+    }
+}
+
+// Whether [p, end) holds exactly one JSON value, whitespace aside.
+static inline int json_check_value(const char* p, const char* end) {
+    p = json_check_value_at(p, end, 0);
+    return p && json_skip_ws(p, end) == end;
+}
+
+// --- Batched edits ----------------------------------------------------------
+//
+// Every edit of a patch is applied in one structural pass: each object on an
+// edit path is walked once, each target span is recorded as a splice, and the
+// output is assembled with a single gather of the untouched spans and the new
+// values. The Preferences file of a long-lived profile runs to tens of MB, so
+// rescanning and copying the whole document once per key used to dominate the
+// patch.
+
+#define JSON_EDIT_MAX 32
+#define JSON_PATH_MAX_DEPTH 8
+
+typedef struct {
+    const char* path;   // dotted member path below the root, e.g. "intl.accept_languages"
+    const char* value;  // replacement value, already JSON-encoded; NULL removes the member
+} JsonEdit;
+
+typedef struct {
+    const char* seg[JSON_PATH_MAX_DEPTH];
+    size_t segLen[JSON_PATH_MAX_DEPTH];
+    int depth;
+} JsonEditPath;
+
+typedef struct {
+    const char* from;   // source span [from,to) replaced by the text below
+    const char* to;
+    size_t textOff;     // replacement bytes, in JsonPatch.text
+    size_t textLen;
+} JsonSplice;
+
+typedef struct {
+    const JsonEdit* edits;
+    const JsonEditPath* paths;
+    JsonSplice* splices;
+    size_t count, cap;
+    char* text;
+    size_t textLen, textCap;
+} JsonPatch;
+
+// Split every edit path into its segments. Rejects empty or over-deep paths,
+// and edit sets where one path is a prefix of another (or repeats it): those
+// would need two overlapping splices of the same value.
+static inline int json_edit_paths_prepare(const JsonEdit* edits, int count, JsonEditPath* paths) {
+    if (count <= 0 || count > JSON_EDIT_MAX) return 0;
+    for (int i = 0; i < count; i++) {
+        JsonEditPath* ep = &paths[i];
+        ep->depth = 0;
+        const char* s = edits[i].path;
+        for (;;) {
+            const char* dot = strchr(s, '.');
+            size_t len = dot ? (size_t)(dot - s) : strlen(s);
+            if (len == 0 || ep->depth == JSON_PATH_MAX_DEPTH) return 0;
+            ep->seg[ep->depth] = s;
+            ep->segLen[ep->depth] = len;
+            ep->depth++;
+            if (!dot) break;
+            s = dot + 1;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            int common = paths[i].depth < paths[j].depth ? paths[i].depth : paths[j].depth;
+            int k = 0;
+            while (k < common && paths[i].segLen[k] == paths[j].segLen[k] &&
+                   memcmp(paths[i].seg[k], paths[j].seg[k], paths[i].segLen[k]) == 0) {
+                k++;
+            }
+            if (k == common) return 0;
+        }
+    }
+    return 1;
+}
+
+static inline int json_patch_append(JsonPatch* jp, const char* s, size_t n) {
+    if (jp->textLen + n > jp->textCap) {
+        size_t cap = jp->textCap ? jp->textCap * 2 : 1024;
+        while (cap < jp->textLen + n) cap *= 2;
+        char* grown = (char*)realloc(jp->text, cap);
+        if (!grown) return 0;
+        jp->text = grown;
+        jp->textCap = cap;
+    }
+    memcpy(jp->text + jp->textLen, s, n);
+    jp->textLen += n;
+    return 1;
+}
+
+// Record that [from,to) becomes the text appended since textOff. Splices are
+// produced in document order by the walk, which the gather relies on.
+static inline int json_patch_add_splice(JsonPatch* jp, const char* from, const char* to, size_t textOff) {
+    if (jp->count == jp->cap) {
+        size_t cap = jp->cap ? jp->cap * 2 : 8;
+        JsonSplice* grown = (JsonSplice*)realloc(jp->splices, cap * sizeof(JsonSplice));
+        if (!grown) return 0;
+        jp->splices = grown;
+        jp->cap = cap;
+    }
+    JsonSplice* sp = &jp->splices[jp->count++];
+    sp->from = from;
+    sp->to = to;
+    sp->textOff = textOff;
+    sp->textLen = jp->textLen - textOff;
+    return 1;
+}
+
+// 1 when any of the edits idx[0..n) sets a value (rather than removing one),
+// i.e. when a missing object on their paths has to be created.
+static inline int json_patch_any_set(const JsonPatch* jp, const int* idx, int n) {
+    for (int i = 0; i < n; i++) {
+        if (jp->edits[idx[i]].value) return 1;
+    }
+    return 0;
+}
+
+// Emit "key":value members for the edits idx[0..n) that are missing below the
+// current object, nesting the ones that share their next segment so that
+// "intl.accept_languages" and "intl.selected_languages" create one "intl".
+// Removals have nothing to remove there and emit nothing.
+static inline int json_patch_emit_members(JsonPatch* jp, const int* idx, int n, int depth, int leadingComma) {
+    int done[JSON_EDIT_MAX] = {0};
+    int first = !leadingComma;
+    for (int i = 0; i < n; i++) {
+        if (done[i]) continue;
+        const JsonEditPath* ep = &jp->paths[idx[i]];
+        int group[JSON_EDIT_MAX];
+        int ng = 0;
+        for (int j = i; j < n; j++) {
+            const JsonEditPath* other = &jp->paths[idx[j]];
+            if (!done[j] && other->segLen[depth] == ep->segLen[depth] &&
+                memcmp(other->seg[depth], ep->seg[depth], ep->segLen[depth]) == 0) {
+                done[j] = 1;
+                group[ng++] = idx[j];
+            }
+        }
+        if (!json_patch_any_set(jp, group, ng)) continue;
+        if (!json_patch_append(jp, first ? "\"" : ",\"", first ? 1 : 2) ||
+            !json_patch_append(jp, ep->seg[depth], ep->segLen[depth]) ||
+            !json_patch_append(jp, "\":", 2)) {
+            return 0;
+        }
+        first = 0;
+        if (depth + 1 == ep->depth) {
+            // A leaf; prepare guarantees it is the only edit of its group.
+            const char* value = jp->edits[idx[i]].value;
+            if (!json_patch_append(jp, value, strlen(value))) return 0;
+        } else if (!json_patch_append(jp, "{", 1) ||
+                   !json_patch_emit_members(jp, group, ng, depth + 1, 0) ||
+                   !json_patch_append(jp, "}", 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// obj points at the '{' reached by the first `depth` segments of the edits
+// idx[0..n). Walks the object's own members once, recursing only into members
+// that are on an edit path. Duplicate keys resolve to their first occurrence,
+// except for removals, which drop every occurrence.
+//
+// A removed member takes one neighbouring comma with it: the one before it
+// when an earlier member stays, otherwise the one after it (the span then
+// runs to the next key, so that splice is only recorded once that key is
+// reached).
+static inline int json_patch_object(JsonPatch* jp, const char* obj, const char* end,
+                                    const int* idx, int n, int depth) {
+    int matched[JSON_EDIT_MAX] = {0};
+    int kept = 0;                  // an earlier member stays
+    const char* prevEnd = NULL;         // end of the previous member's value
+    const char* dropFrom = NULL;        // removal still waiting for its end
+    const char* dropTo = NULL;
+    const char* p = obj + 1;
+    for (;;) {
+        p = json_skip_ws(p, end);
+        if (p >= end) return 0;
+        if (*p == '}') break;
+        if (*p != '"') return 0;
+        if (dropFrom) {
+            if (!json_patch_add_splice(jp, dropFrom, p, jp->textLen)) return 0;
+            dropFrom = NULL;
+        }
+        const char* ks = p + 1;
+        const char* kq = json_skip_string(p, end);
+        if (!kq) return 0;
+        size_t klen = (size_t)(kq - 1 - ks);
+        p = json_skip_ws(kq, end);
+        if (p >= end || *p != ':') return 0;
+        const char* vs = json_skip_ws(p + 1, end);
+        const char* ve = json_skip_value(vs, end);
+        if (!ve) return 0;
+
+        int sub[JSON_EDIT_MAX];
+        int nsub = 0;
+        int remove = 0;
+        for (int i = 0; i < n; i++) {
+            const JsonEditPath* ep = &jp->paths[idx[i]];
+            if (matched[i] || ep->segLen[depth] != klen ||
+                memcmp(ep->seg[depth], ks, klen) != 0) {
+                continue;
+            }
+            const char* value = jp->edits[idx[i]].value;
+            if (depth + 1 == ep->depth && !value) {
+                remove = 1;
+                continue;
+            }
+            matched[i] = 1;
+            if (depth + 1 == ep->depth) {
+                size_t off = jp->textLen;
+                if (!json_patch_append(jp, value, strlen(value)) ||
+                    !json_patch_add_splice(jp, vs, ve, off)) {
+                    return 0;
+                }
+            } else {
+                sub[nsub++] = idx[i];
+            }
+        }
+        if (remove) {
+            if (kept) {
+                if (!json_patch_add_splice(jp, prevEnd, ve, jp->textLen)) return 0;
+            } else {
+                dropFrom = ks - 1;
+                dropTo = ve;
+            }
+        } else {
+            kept = 1;
+        }
+        if (nsub > 0) {
+            if (*vs == '{') {
+                if (!json_patch_object(jp, vs, ve, sub, nsub, depth + 1)) return 0;
+            } else if (json_patch_any_set(jp, sub, nsub)) {
+                // On the path but not an object: replace it wholesale.
+                size_t off = jp->textLen;
+                if (!json_patch_append(jp, "{", 1) ||
+                    !json_patch_emit_members(jp, sub, nsub, depth + 1, 0) ||
+                    !json_patch_append(jp, "}", 1) ||
+                    !json_patch_add_splice(jp, vs, ve, off)) {
+                    return 0;
+                }
+            }
+        }
+        prevEnd = ve;
+
+        p = json_skip_ws(ve, end);
+        if (p >= end) return 0;
+        if (*p == ',') { p++; continue; }
+        if (*p == '}') break;
+        return 0;
+    }
+    if (dropFrom && !json_patch_add_splice(jp, dropFrom, dropTo, jp->textLen)) return 0;
+
+    // p is at this object's '}'. Missing members are appended there so they
+    // win under Chromium's last-key-wins parsing even in pathological
+    // duplicate-key files.
+    int missing[JSON_EDIT_MAX];
+    int nmissing = 0;
+    for (int i = 0; i < n; i++) {
+        if (!matched[i]) missing[nmissing++] = idx[i];
+    }
+    if (!json_patch_any_set(jp, missing, nmissing)) return 1;
+    size_t off = jp->textLen;
+    return json_patch_emit_members(jp, missing, nmissing, depth, kept) &&
+           json_patch_add_splice(jp, p, p, off);
+}
+
+// Apply edits (set root.<path> = value, creating missing objects, or remove
+// root.<path>) to a JSON document whose root is an object. Returns 0 when the document isn't a
+// JSON object we can understand - the caller then leaves the file untouched.
+// On success *out is a new heap buffer of *outLen bytes, or NULL when every
+// edit already held and the document is unchanged.
+static inline int json_apply_edits(const char* json, size_t len, const JsonEdit* edits, int count,
+                                   char** out, size_t* outLen) {
+    *out = NULL;
+    *outLen = 0;
+
+    JsonEditPath paths[JSON_EDIT_MAX];
+    if (!json_edit_paths_prepare(edits, count, paths)) return 0;
+
+    const char* end = json + len;
+    const char* root = json_skip_ws(json, end);
+    if (root >= end || *root != '{') return 0;
+    const char* rootEnd = json_skip_value(root, end);
+    if (!rootEnd) return 0;
+
+    JsonPatch jp = {0};
+    jp.edits = edits;
+    jp.paths = paths;
+    int idx[JSON_EDIT_MAX];
+    for (int i = 0; i < count; i++) idx[i] = i;
+
+    int ok = json_patch_object(&jp, root, rootEnd, idx, count, 0);
+    if (ok) {
+        int changed = 0;
+        size_t total = len;
+        for (size_t i = 0; i < jp.count; i++) {
+            const JsonSplice* sp = &jp.splices[i];
+            size_t span = (size_t)(sp->to - sp->from);
+            if (span != sp->textLen || memcmp(sp->from, jp.text + sp->textOff, span) != 0) {
+                changed = 1;
+            }
+            total = total - span + sp->textLen;
+        }
+        if (changed) {
+            char* result = (char*)malloc(total + 1);
+            if (result) {
+                // One gather: untouched span, new text, untouched span, ...
+                char* w = result;
+                const char* r = json;
+                for (size_t i = 0; i < jp.count; i++) {
+                    const JsonSplice* sp = &jp.splices[i];
+                    memcpy(w, r, (size_t)(sp->from - r));
+                    w += sp->from - r;
+                    memcpy(w, jp.text + sp->textOff, sp->textLen);
+                    w += sp->textLen;
+                    r = sp->to;
+                }
+                memcpy(w, r, (size_t)(end - r));
+                result[total] = '\0';
+                *out = result;
+                *outLen = total;
+            } else {
+                ok = 0;
+            }
+        }
+    }
+
+    free(jp.splices);
+    free(jp.text);
+    return ok;
+}
+
+// --- Content hash ----------------------------------------------------------
+
+// Word-at-a-time multiply/rotate hash; only has to tell our own output apart
+// from a rewritten file, and must cost far less than parsing it. Incremental,
+// so the streaming patch can hash what it reads and writes as it goes.
+typedef struct {
+    uint64_t h;
+    uint64_t total;
+    unsigned char tail[8];
+    size_t tailLen;
+} PrefsHash;
+
+static inline void prefs_hash_init(PrefsHash* hs) {
+    hs->h = 0x9E3779B97F4A7C15ULL;
+    hs->total = 0;
+    hs->tailLen = 0;
+}
+
+static inline uint64_t prefs_hash_word(uint64_t h, uint64_t w) {
+    h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+    return (h << 29) | (h >> 35);
+}
+
+static inline void prefs_hash_update(PrefsHash* hs, const char* p, size_t n) {
+    hs->total += n;
+    if (hs->tailLen > 0) {
+        size_t take = 8 - hs->tailLen < n ? 8 - hs->tailLen : n;
+        memcpy(hs->tail + hs->tailLen, p, take);
+        hs->tailLen += take;
+        p += take;
+        n -= take;
+        if (hs->tailLen < 8) return;
+        uint64_t w;
+        memcpy(&w, hs->tail, 8);
+        hs->h = prefs_hash_word(hs->h, w);
+        hs->tailLen = 0;
+    }
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        hs->h = prefs_hash_word(hs->h, w);
+        p += 8;
+        n -= 8;
+    }
+    memcpy(hs->tail, p, n);
+    hs->tailLen = n;
+}
+
+static inline uint64_t prefs_hash_final(const PrefsHash* hs) {
+    uint64_t w = 0;
+    memcpy(&w, hs->tail, hs->tailLen);
+    uint64_t h = (hs->h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    h = (h ^ hs->total) * 0xFF51AFD7ED558CCDULL;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t prefs_content_hash(const char* p, size_t n) {
+    PrefsHash hs;
+    prefs_hash_init(&hs);
+    prefs_hash_update(&hs, p, n);
+    return prefs_hash_final(&hs);
+}
+
+// --- Streaming edits ------------------------------------------------------------
+//
+// Profiles too large to load are patched through a fixed-size window instead:
+// the same member walk as json_patch_object runs over the window, which is
+// refilled from the file as it is used up. Untouched bytes are copied to the
+// output as the window slides, and a replaced value is compared against its
+// replacement while it is dropped. Nesting depth and string state live in the
+// walk's locals, so they carry across refills. Peak memory is the window plus
+// the edit set, whatever the size of the file, and the output is byte for
+// byte what json_apply_edits would produce.
+
+#define JSON_STREAM_CHUNK (64 * 1024)
+#define JSON_STREAM_KEY_MAX 256
+
+// Where consumed bytes go when they are passed on.
+typedef enum {
+    JSON_SINK_OUT,      // copied to the output
+    JSON_SINK_COMPARE,  // replaced value, compared against its replacement
+    JSON_SINK_HOLD,     // gap and key of a member that may be removed
+    JSON_SINK_DROP      // removed member
+} JsonStreamSink;
+
+typedef struct {
+    FILE* in;
+    FILE* out;
+    char* buf;
+    size_t pos, len;    // window; buf[pos] is the next unread byte
+    size_t mark;        // consumed bytes buf[mark,pos) not passed on yet
+    JsonStreamSink sink;
+    const char* cmp;    // replacement the dropped value is compared against
+    size_t cmpLen, cmpPos;
+    int cmpDiffers;
+    int changed;
+    int ioError;
+    char* hold;
+    size_t holdLen, holdCap;
+    JsonPatch scratch;  // text of inserted members and replacement objects
+    PrefsHash inHash, outHash;
+} JsonStream;
+
+static inline int json_stream_write(JsonStream* s, const char* p, size_t n) {
+    if (n == 0) return 1;
+    if (fwrite(p, 1, n, s->out) != n) {
+        s->ioError = 1;
+        return 0;
+    }
+    prefs_hash_update(&s->outHash, p, n);
+    return 1;
+}
+
+// Pass on the bytes consumed since the last flush to the current sink.
+static inline int json_stream_flush(JsonStream* s) {
+    const char* p = s->buf + s->mark;
+    size_t n = s->pos - s->mark;
+    s->mark = s->pos;
+    switch (s->sink) {
+        case JSON_SINK_OUT:
+            return json_stream_write(s, p, n);
+        case JSON_SINK_COMPARE:
+            if (!s->cmpDiffers) {
+                if (s->cmpPos + n > s->cmpLen || memcmp(s->cmp + s->cmpPos, p, n) != 0) {
+                    s->cmpDiffers = 1;
+                } else {
+                    s->cmpPos += n;
+                }
+            }
+            return 1;
+        case JSON_SINK_HOLD:
+            if (s->holdLen + n > s->holdCap) {
+                size_t cap = s->holdCap ? s->holdCap * 2 : 256;
+                while (cap < s->holdLen + n) cap *= 2;
+                char* grown = (char*)realloc(s->hold, cap);
+                if (!grown) {
+                    s->ioError = 1;
+                    return 0;
+                }
+                s->hold = grown;
+                s->holdCap = cap;
+            }
+            memcpy(s->hold + s->holdLen, p, n);
+            s->holdLen += n;
+            return 1;
+        case JSON_SINK_DROP:
+            return 1;
+    }
+    return 1;
+}
+
+static inline int json_stream_set_sink(JsonStream* s, JsonStreamSink sink) {
+    if (!json_stream_flush(s)) return 0;
+    s->sink = sink;
+    if (sink == JSON_SINK_HOLD) s->holdLen = 0;
+    return 1;
+}
+
+// Slide the window once it is used up. 0 at end of input or on error.
+static inline int json_stream_fill(JsonStream* s) {
+    if (s->pos < s->len) return 1;
+    if (!json_stream_flush(s)) return 0;
+    size_t n = fread(s->buf, 1, JSON_STREAM_CHUNK, s->in);
+    if (n == 0) {
+        if (ferror(s->in)) s->ioError = 1;
+        return 0;
+    }
+    prefs_hash_update(&s->inHash, s->buf, n);
+    s->pos = s->mark = 0;
+    s->len = n;
+    return 1;
+}
+
+// Next byte without consuming it, or -1 at end of input.
+static inline int json_stream_peek(JsonStream* s) {
+    return json_stream_fill(s) ? (unsigned char)s->buf[s->pos] : -1;
+}
+
+static inline void json_stream_skip_ws(JsonStream* s) {
+    for (;;) {
+        int c = json_stream_peek(s);
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+        s->pos++;
+    }
+}
+
+// At the opening quote; consumes the string. When key is given, the first
+// keyCap raw bytes between the quotes are copied there and *keyLen receives
+// the full raw length.
+static inline int json_stream_skip_string(JsonStream* s, char* key, size_t keyCap, size_t* keyLen) {
+    size_t n = 0;
+    s->pos++;
+    for (;;) {
+        if (!json_stream_fill(s)) return 0;
+        const char* from = s->buf + s->pos;
+        const char* end = s->buf + s->len;
+        const char* q = json_scan(from, end, JSON_SCAN_QUOTE | JSON_SCAN_BACKSLASH);
+        size_t run = (size_t)(q - from);
+        if (q < end && *q == '\\') run++;
+        if (key && n < keyCap) memcpy(key + n, from, run < keyCap - n ? run : keyCap - n);
+        n += run;
+        s->pos += run;
+        if (q == end) continue;
+        if (*q == '"') {
+            s->pos++;
+            break;
+        }
+        // The escaped byte, which may only arrive with the next window.
+        if (!json_stream_fill(s)) return 0;
+        if (key && n < keyCap) key[n] = s->buf[s->pos];
+        n++;
+        s->pos++;
+    }
+    if (keyLen) *keyLen = n;
+    return 1;
+}
+
+// Consumes one value; same rules as json_skip_value.
+static inline int json_stream_skip_value(JsonStream* s) {
+    json_stream_skip_ws(s);
+    int c = json_stream_peek(s);
+    if (c < 0) return 0;
+    if (c == '"') return json_stream_skip_string(s, NULL, 0, NULL);
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        for (;;) {
+            if (!json_stream_fill(s)) return 0;
+            const char* q = json_scan(s->buf + s->pos, s->buf + s->len,
+                                      JSON_SCAN_QUOTE | JSON_SCAN_OPEN | JSON_SCAN_CLOSE);
+            s->pos = (size_t)(q - s->buf);
+            if (s->pos == s->len) continue;
+            if (*q == '"') {
+                if (!json_stream_skip_string(s, NULL, 0, NULL)) return 0;
+                continue;
+            }
+            s->pos++;
+            if (*q == '{' || *q == '[') {
+                depth++;
+            } else if (--depth == 0) {
+                return 1;
+            }
+        }
+    }
+    for (;;) {
+        c = json_stream_peek(s);
+        if (c < 0 || json_is_scalar_end((char)c)) return 1;
+        s->pos++;
+    }
+}
+
+// Drop the value at the read position and write text in its place.
+static inline int json_stream_replace_value(JsonStream* s, const char* text, size_t len) {
+    if (!json_stream_set_sink(s, JSON_SINK_COMPARE)) return 0;
+    s->cmp = text;
+    s->cmpLen = len;
+    s->cmpPos = 0;
+    s->cmpDiffers = 0;
+    if (!json_stream_skip_value(s) || !json_stream_set_sink(s, JSON_SINK_OUT)) return 0;
+    if (s->cmpDiffers || s->cmpPos != len) s->changed = 1;
+    return json_stream_write(s, text, len);
+}
+
+// Streaming json_patch_object: the read position is at the '{' reached by the
+// first `depth` segments of the edits idx[0..n); consumes through its '}'.
+// Where a member may be removed, the gap before each key and the key itself
+// are held back until the key is known, since the comma that goes with a
+// removed member can come before it.
+static inline int json_stream_patch_object(JsonStream* s, const int* idx, int n, int depth) {
+    JsonPatch* jp = &s->scratch;
+    int matched[JSON_EDIT_MAX] = {0};
+    int kept = 0;       // an earlier member stays
+    int dropping = 0;   // the gap up to the next key goes with a removal
+    int holdGaps = 0;
+    for (int i = 0; i < n; i++) {
+        if (depth + 1 == jp->paths[idx[i]].depth && !jp->edits[idx[i]].value) holdGaps = 1;
+    }
+    char key[JSON_STREAM_KEY_MAX];
+    s->pos++;
+    if (holdGaps && !json_stream_set_sink(s, JSON_SINK_HOLD)) return 0;
+    for (;;) {
+        json_stream_skip_ws(s);
+        int c = json_stream_peek(s);
+        if (c == '}') break;
+        if (c != '"') return 0;
+        if (!json_stream_flush(s)) return 0;
+        size_t keyOff = s->holdLen;
+        size_t klen;
+        if (!json_stream_skip_string(s, key, sizeof(key), &klen)) return 0;
+        json_stream_skip_ws(s);
+        if (json_stream_peek(s) != ':') return 0;
+        s->pos++;
+        json_stream_skip_ws(s);
+
+        int sub[JSON_EDIT_MAX];
+        int nsub = 0;
+        int leaf = -1;
+        int remove = 0;
+        for (int i = 0; i < n; i++) {
+            const JsonEditPath* ep = &jp->paths[idx[i]];
+            if (matched[i] || ep->segLen[depth] != klen ||
+                memcmp(ep->seg[depth], key, klen) != 0) {
+                continue;
+            }
+            if (depth + 1 == ep->depth && !jp->edits[idx[i]].value) {
+                remove = 1;
+                continue;
+            }
+            matched[i] = 1;
+            if (depth + 1 == ep->depth) {
+                leaf = idx[i];
+            } else {
+                sub[nsub++] = idx[i];
+            }
+        }
+        if (holdGaps) {
+            // Release what was held: the gap stays unless it goes with a
+            // removal, the key stays unless its member is removed.
+            if (!json_stream_set_sink(s, remove ? JSON_SINK_DROP : JSON_SINK_OUT)) return 0;
+            size_t from = dropping ? keyOff : 0;
+            size_t to = remove ? (kept ? 0 : keyOff) : s->holdLen;
+            if (from < to && !json_stream_write(s, s->hold + from, to - from)) return 0;
+            if (remove) {
+                s->changed = 1;
+                dropping = !kept;
+            } else {
+                dropping = 0;
+            }
+        }
+        if (!remove) kept = 1;
+
+        if (remove) {
+            if (!json_stream_skip_value(s) || !json_stream_set_sink(s, JSON_SINK_OUT)) return 0;
+        } else if (leaf >= 0) {
+            const char* value = jp->edits[leaf].value;
+            if (!json_stream_replace_value(s, value, strlen(value))) return 0;
+        } else if (nsub > 0 && json_stream_peek(s) == '{') {
+            if (!json_stream_patch_object(s, sub, nsub, depth + 1)) return 0;
+        } else if (nsub > 0 && json_patch_any_set(jp, sub, nsub)) {
+            // On the path but not an object: replace it wholesale.
+            jp->textLen = 0;
+            if (!json_patch_append(jp, "{", 1) ||
+                !json_patch_emit_members(jp, sub, nsub, depth + 1, 0) ||
+                !json_patch_append(jp, "}", 1) ||
+                !json_stream_replace_value(s, jp->text, jp->textLen)) {
+                return 0;
+            }
+        } else if (!json_stream_skip_value(s)) {
+            return 0;
+        }
+
+        if (holdGaps && !json_stream_set_sink(s, JSON_SINK_HOLD)) return 0;
+        json_stream_skip_ws(s);
+        c = json_stream_peek(s);
+        if (c == ',') {
+            s->pos++;
+            continue;
+        }
+        if (c == '}') break;
+        return 0;
+    }
+
+    // The read position is at this object's '}'; the gap before it stays.
+    if (holdGaps) {
+        if (!json_stream_set_sink(s, JSON_SINK_OUT) ||
+            !json_stream_write(s, s->hold, s->holdLen)) {
+            return 0;
+        }
+    }
+    int missing[JSON_EDIT_MAX];
+    int nmissing = 0;
+    for (int i = 0; i < n; i++) {
+        if (!matched[i]) missing[nmissing++] = idx[i];
+    }
+    if (json_patch_any_set(jp, missing, nmissing)) {
+        jp->textLen = 0;
+        if (!json_patch_emit_members(jp, missing, nmissing, depth, kept) ||
+            !json_stream_flush(s) ||
+            !json_stream_write(s, jp->text, jp->textLen)) {
+            return 0;
+        }
+        s->changed = 1;
+    }
+    s->pos++;
+    return 1;
+}
+
+// Streaming json_apply_edits: reads the document from in and writes the
+// edited document to out. *changed is 0 when the output equals the input;
+// the hashes cover everything read and written. Returns 0 when the
+// document isn't a JSON object we can understand or on an I/O error, leaving
+// out incomplete.
+static inline int json_stream_apply_edits(FILE* in, FILE* out, const JsonEdit* edits, int count,
+                                          int* changed, uint64_t* inHash, uint64_t* outHash) {
+    JsonEditPath paths[JSON_EDIT_MAX];
+    if (!json_edit_paths_prepare(edits, count, paths)) return 0;
+    for (int i = 0; i < count; i++) {
+        for (int k = 0; k < paths[i].depth; k++) {
+            if (paths[i].segLen[k] > JSON_STREAM_KEY_MAX) return 0;
+        }
+    }
+
+    JsonStream s = {0};
+    s.in = in;
+    s.out = out;
+    s.sink = JSON_SINK_OUT;
+    s.scratch.edits = edits;
+    s.scratch.paths = paths;
+    prefs_hash_init(&s.inHash);
+    prefs_hash_init(&s.outHash);
+    s.buf = (char*)malloc(JSON_STREAM_CHUNK);
+    if (!s.buf) return 0;
+
+    int idx[JSON_EDIT_MAX];
+    for (int i = 0; i < count; i++) idx[i] = i;
+
+    json_stream_skip_ws(&s);
+    int ok = json_stream_peek(&s) == '{' && json_stream_patch_object(&s, idx, count, 0);
+    if (ok) {
+        // Whatever follows the root object is passed through untouched.
+        while (json_stream_fill(&s)) s.pos = s.len;
+        ok = !s.ioError;
+    }
+    *changed = s.changed;
+    *inHash = prefs_hash_final(&s.inHash);
+    *outHash = prefs_hash_final(&s.outHash);
+
+    free(s.scratch.text);
+    free(s.hold);
+    free(s.buf);
+    return ok;
+}
+
+#endif
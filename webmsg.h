@@ -0,0 +1,414 @@
+#ifndef WEBMSG_H
+#define WEBMSG_H
+
+// Messages from the config dialog page: the tokenizer, the per-message arena
+// and the decode of a saveSettings message into a Configuration. Nothing
+// here touches Win32 or WebView2 beyond the message string itself, so
+// msg_bench.c replays recorded dialog sessions through the same code on any
+// platform and counts what they allocate.
+
+#include <limits.h>
+#include "config.h"
+
+// --- Tokenizer ---------------------------------------------------------------
+//
+// Messages from the config page are flat JSON objects ({"action":"...",
+// ...fields}). One pass over the UTF-16 string from TryGetWebMessageAsString
+// fills a table with a slot per known field; each slot is a view into that
+// string, decoded only when read - straight into its final storage, or into
+// the per-message arena for values that are processed further. Unknown keys,
+// and nested values under them, are skipped; a repeated key keeps its last
+// value, as JSON.parse would. Field and action names resolve through the same
+// perfect hash over (length, first and third character): every name has its
+// own slot below, so a lookup is one hash and one compare.
+
+typedef enum {
+    MSG_FIELD_ACTION,
+    MSG_FIELD_URL,
+    MSG_FIELD_WINDOW_TITLE,
+    MSG_FIELD_ON_HIDE_JS,
+    MSG_FIELD_ON_SHOW_JS,
+    MSG_FIELD_SPELLCHECK_LANGUAGES,
+    MSG_FIELD_SLEEP_WHEN_INACTIVE,
+    MSG_FIELD_OPEN_NEW_WINDOWS_EXTERNALLY,
+    MSG_FIELD_SUSPEND_DELAY,
+    MSG_FIELD_HEIGHT,
+    MSG_FIELD_COUNT
+} MsgField;
+
+typedef enum {
+    CFG_ACTION_UNKNOWN,
+    CFG_ACTION_GET_INIT,
+    CFG_ACTION_SAVE_SETTINGS,
+    CFG_ACTION_CLOSE,
+    CFG_ACTION_RESIZE
+} CfgAction;
+
+typedef enum {
+    MSG_VALUE_ABSENT,
+    MSG_VALUE_STRING,   // raw characters between the quotes, escapes not decoded
+    MSG_VALUE_NUMBER,
+    MSG_VALUE_TRUE,
+    MSG_VALUE_FALSE,
+    MSG_VALUE_OTHER     // null, object or array
+} MsgValueType;
+
+typedef struct {
+    MsgValueType type;
+    const wchar_t* text;
+    size_t len;
+} MsgValue;
+
+typedef struct {
+    MsgValue field[MSG_FIELD_COUNT];
+} WebMessage;
+
+typedef struct {
+    const char* name;
+    int id;
+} MsgName;
+
+#define MSG_NAME_SLOTS 16
+
+static inline unsigned msg_name_hash(const wchar_t* s, size_t len) {
+    return (unsigned)(len + (unsigned)s[0] * 4 + (unsigned)s[2]) & (MSG_NAME_SLOTS - 1);
+}
+
+static const MsgName k_msgFieldSlots[MSG_NAME_SLOTS] = {
+    [14] = { "action", MSG_FIELD_ACTION },
+    [3]  = { "url", MSG_FIELD_URL },
+    [5]  = { "windowTitle", MSG_FIELD_WINDOW_TITLE },
+    [12] = { "onHideJs", MSG_FIELD_ON_HIDE_JS },
+    [7]  = { "onShowJs", MSG_FIELD_ON_SHOW_JS },
+    [4]  = { "spellcheckLanguages", MSG_FIELD_SPELLCHECK_LANGUAGES },
+    [2]  = { "sleepWhenInactive", MSG_FIELD_SLEEP_WHEN_INACTIVE },
+    [9]  = { "openNewWindowsExternally", MSG_FIELD_OPEN_NEW_WINDOWS_EXTERNALLY },
+    [11] = { "suspendDelay", MSG_FIELD_SUSPEND_DELAY },
+    [15] = { "height", MSG_FIELD_HEIGHT },
+};
+
+static const MsgName k_cfgActionSlots[MSG_NAME_SLOTS] = {
+    [7]  = { "getInit", CFG_ACTION_GET_INIT },
+    [14] = { "saveSettings", CFG_ACTION_SAVE_SETTINGS },
+    [0]  = { "close", CFG_ACTION_CLOSE },
+    [1]  = { "resize", CFG_ACTION_RESIZE },
+};
+
+// Returns the id of name s[0..len) in slots, or -1.
+static inline int msg_name_lookup(const MsgName* slots, const wchar_t* s, size_t len) {
+    if (len < 3) return -1;
+    const MsgName* e = &slots[msg_name_hash(s, len)];
+    if (!e->name) return -1;
+    size_t i = 0;
+    while (i < len && e->name[i] && (wchar_t)(unsigned char)e->name[i] == s[i]) i++;
+    return (i == len && e->name[i] == '\0') ? e->id : -1;
+}
+
+// Per-message bump allocator: a small inline block, then heap blocks that
+// are all released together once the message has been handled.
+typedef struct MsgArenaBlock {
+    struct MsgArenaBlock* next;
+    size_t cap, used;
+    // data follows
+} MsgArenaBlock;
+
+typedef struct {
+    BYTE inlineData[2048];
+    size_t inlineUsed;
+    MsgArenaBlock* blocks;
+} MsgArena;
+
+static inline void msg_arena_init(MsgArena* a) {
+    a->inlineUsed = 0;
+    a->blocks = NULL;
+}
+
+static inline void* msg_arena_alloc(MsgArena* a, size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    if (a->inlineUsed + n <= sizeof(a->inlineData)) {
+        void* p = a->inlineData + a->inlineUsed;
+        a->inlineUsed += n;
+        return p;
+    }
+    MsgArenaBlock* b = a->blocks;
+    if (!b || b->used + n > b->cap) {
+        size_t cap = b ? b->cap * 2 : 16384;
+        if (cap < n) cap = n;
+        b = (MsgArenaBlock*)malloc(sizeof(MsgArenaBlock) + cap);
+        if (!b) return NULL;
+        b->next = a->blocks;
+        b->cap = cap;
+        b->used = 0;
+        a->blocks = b;
+    }
+    void* p = (BYTE*)(b + 1) + b->used;
+    b->used += n;
+    return p;
+}
+
+static inline void msg_arena_free(MsgArena* a) {
+    while (a->blocks) {
+        MsgArenaBlock* next = a->blocks->next;
+        free(a->blocks);
+        a->blocks = next;
+    }
+    a->inlineUsed = 0;
+}
+
+// p is just past an opening quote; returns the closing quote, or NULL.
+static inline const wchar_t* msg_scan_string(const wchar_t* p, const wchar_t* end) {
+    while (p < end && *p != L'"') {
+        if (*p == L'\\') p++;
+        p++;
+    }
+    return p < end ? p : NULL;
+}
+
+// Returns one past the value starting at p (string, object, array or bare
+// literal), or NULL if the message is malformed.
+static inline const wchar_t* msg_skip_value(const wchar_t* p, const wchar_t* end) {
+    if (p >= end) return NULL;
+    if (*p == L'"') {
+        const wchar_t* q = msg_scan_string(p + 1, end);
+        return q ? q + 1 : NULL;
+    }
+    if (*p == L'{' || *p == L'[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == L'"') {
+                p = msg_scan_string(p + 1, end);
+                if (!p) return NULL;
+            } else if (*p == L'{' || *p == L'[') {
+                depth++;
+            } else if (*p == L'}' || *p == L']') {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    const wchar_t* start = p;
+    while (p < end && *p != L',' && *p != L'}' && *p != L']' &&
+           *p != L' ' && *p != L'\t' && *p != L'\n' && *p != L'\r') {
+        p++;
+    }
+    return p > start ? p : NULL;
+}
+
+static inline const wchar_t* msg_skip_ws(const wchar_t* p, const wchar_t* end) {
+    while (p < end && (*p == L' ' || *p == L'\t' || *p == L'\n' || *p == L'\r')) p++;
+    return p;
+}
+
+// Tokenize a message into m. Returns FALSE (with m cleared) if it is not a
+// well-formed flat object; the fields found before the error are dropped.
+// m holds views into msg, which must outlive it.
+static inline BOOL json_msg_parse(const wchar_t* msg, size_t len, WebMessage* m) {
+    memset(m, 0, sizeof(*m));
+    const wchar_t* end = msg + len;
+    const wchar_t* p = msg_skip_ws(msg, end);
+    if (p >= end || *p != L'{') return FALSE;
+    p = msg_skip_ws(p + 1, end);
+    if (p < end && *p == L'}') return TRUE;
+    for (;;) {
+        if (p >= end || *p != L'"') break;
+        const wchar_t* ks = p + 1;
+        const wchar_t* ke = msg_scan_string(ks, end);
+        if (!ke) break;
+        p = msg_skip_ws(ke + 1, end);
+        if (p >= end || *p != L':') break;
+        const wchar_t* vs = msg_skip_ws(p + 1, end);
+        const wchar_t* ve = msg_skip_value(vs, end);
+        if (!ve) break;
+
+        int id = msg_name_lookup(k_msgFieldSlots, ks, (size_t)(ke - ks));
+        if (id >= 0) {
+            MsgValue* v = &m->field[id];
+            v->text = vs;
+            v->len = (size_t)(ve - vs);
+            if (*vs == L'"') {
+                v->type = MSG_VALUE_STRING;
+                v->text++;
+                v->len -= 2;
+            } else if (*vs == L'-' || (*vs >= L'0' && *vs <= L'9')) {
+                v->type = MSG_VALUE_NUMBER;
+            } else if (v->len == 4 && wcsncmp(vs, L"true", 4) == 0) {
+                v->type = MSG_VALUE_TRUE;
+            } else if (v->len == 5 && wcsncmp(vs, L"false", 5) == 0) {
+                v->type = MSG_VALUE_FALSE;
+            } else {
+                v->type = MSG_VALUE_OTHER;
+            }
+        }
+
+        p = msg_skip_ws(ve, end);
+        if (p >= end) break;
+        if (*p == L'}') return TRUE;
+        if (*p != L',') break;
+        p = msg_skip_ws(p + 1, end);
+    }
+    memset(m, 0, sizeof(*m));
+    return FALSE;
+}
+
+static inline int msg_hex4(const wchar_t* p, const wchar_t* end) {
+    if (end - p < 4) return -1;
+    int v = 0;
+    for (int k = 0; k < 4; k++) {
+        wchar_t c = p[k];
+        v <<= 4;
+        if (c >= L'0' && c <= L'9') v |= c - L'0';
+        else if (c >= L'a' && c <= L'f') v |= c - L'a' + 10;
+        else if (c >= L'A' && c <= L'F') v |= c - L'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+// Decode the raw string view into out, which has room for outLen characters
+// plus the terminator. Unescaped runs are copied in bulk; \uXXXX is already
+// a UTF-16 code unit, surrogate halves included. Returns the decoded length.
+static inline size_t msg_decode(const MsgValue* v, wchar_t* out, size_t outLen) {
+    const wchar_t* p = v->text;
+    const wchar_t* end = p + v->len;
+    size_t i = 0;
+    while (p < end && i < outLen) {
+        const wchar_t* bs = wmemchr(p, L'\\', (size_t)(end - p));
+        size_t run = (size_t)((bs ? bs : end) - p);
+        if (run > outLen - i) run = outLen - i;
+        wmemcpy(out + i, p, run);
+        i += run;
+        p += run;
+        if (p >= end || i >= outLen || *p != L'\\') continue;
+        if (p + 1 >= end) break;
+        wchar_t c = p[1];
+        p += 2;
+        switch (c) {
+            case L'n': out[i++] = L'\n'; break;
+            case L'r': out[i++] = L'\r'; break;
+            case L't': out[i++] = L'\t'; break;
+            case L'b': out[i++] = L'\b'; break;
+            case L'f': out[i++] = L'\f'; break;
+            case L'u': {
+                int cu = msg_hex4(p, end);
+                if (cu < 0) break;
+                p += 4;
+                out[i++] = (wchar_t)cu;
+                break;
+            }
+            default: out[i++] = c; break;  // \" \\ \/
+        }
+    }
+    out[i] = L'\0';
+    return i;
+}
+
+// Decode a string field into out (room for outLen characters including the
+// terminator; longer values are truncated). Returns FALSE and leaves out
+// empty when the field is absent or not a string.
+static inline BOOL json_msg_wstring(const WebMessage* m, MsgField id, wchar_t* out, size_t outLen) {
+    const MsgValue* v = &m->field[id];
+    out[0] = L'\0';
+    if (v->type != MSG_VALUE_STRING) return FALSE;
+    msg_decode(v, out, outLen - 1);
+    return TRUE;
+}
+
+// Decode a string field into the arena, whole. Returns L"" when the field is
+// absent or not a string, and NULL only when the arena is out of memory.
+static inline const wchar_t* json_msg_arena_wstring(const WebMessage* m, MsgField id, MsgArena* a) {
+    const MsgValue* v = &m->field[id];
+    if (v->type != MSG_VALUE_STRING) return L"";
+    // Escapes only ever shrink the text, so the raw length is enough.
+    wchar_t* out = (wchar_t*)msg_arena_alloc(a, (v->len + 1) * sizeof(wchar_t));
+    if (out) msg_decode(v, out, v->len);
+    return out;
+}
+
+// The integer at the start of a view, as _wtoi reads it: leading spaces, a
+// sign and the digits up to the first other character or the end of the
+// view (views are not terminated). Saturates instead of overflowing.
+static inline int msg_view_int(const MsgValue* v) {
+    const wchar_t* p = v->text;
+    const wchar_t* end = p + v->len;
+    while (p < end && (*p == L' ' || *p == L'\t' || *p == L'\n' || *p == L'\r')) p++;
+    int neg = p < end && *p == L'-';
+    if (p < end && (*p == L'-' || *p == L'+')) p++;
+    long long n = 0;
+    while (p < end && *p >= L'0' && *p <= L'9') {
+        if (n <= INT_MAX) n = n * 10 + (*p - L'0');
+        p++;
+    }
+    if (neg) n = -n;
+    if (n > INT_MAX) return INT_MAX;
+    if (n < INT_MIN) return INT_MIN;
+    return (int)n;
+}
+
+static inline BOOL json_msg_bool(const WebMessage* m, MsgField id, BOOL defVal) {
+    const MsgValue* v = &m->field[id];
+    if (v->type == MSG_VALUE_TRUE) return TRUE;
+    if (v->type == MSG_VALUE_FALSE) return FALSE;
+    if (v->type == MSG_VALUE_NUMBER) return msg_view_int(v) != 0;
+    return defVal;
+}
+
+// A number, or a string holding one (older pages sent the height quoted).
+static inline int json_msg_int(const WebMessage* m, MsgField id, int defVal) {
+    const MsgValue* v = &m->field[id];
+    if (v->type != MSG_VALUE_NUMBER && v->type != MSG_VALUE_STRING) return defVal;
+    return msg_view_int(v);
+}
+
+static inline CfgAction json_msg_action(const WebMessage* m) {
+    const MsgValue* v = &m->field[MSG_FIELD_ACTION];
+    if (v->type != MSG_VALUE_STRING) return CFG_ACTION_UNKNOWN;
+    int id = msg_name_lookup(k_cfgActionSlots, v->text, v->len);
+    return id < 0 ? CFG_ACTION_UNKNOWN : (CfgAction)id;
+}
+
+// --- saveSettings ------------------------------------------------------------
+
+// Decode a saveSettings message into next, on top of base. The page sends
+// every field; one that is missing reads as empty, false or the default
+// delay. The strings are decoded straight into the new config blob, and the
+// language list through the arena, since it is normalized before it is
+// stored. FALSE when out of memory, with next untouched.
+static inline BOOL cfg_msg_settings(const WebMessage* m, const Configuration* base,
+                                    MsgArena* a, Configuration* next) {
+    const wchar_t* rawSpellLangs = json_msg_arena_wstring(m, MSG_FIELD_SPELLCHECK_LANGUAGES, a);
+    if (!rawSpellLangs) return FALSE;
+
+    ConfigBuilder b;
+    config_builder_init(&b, base);
+    static const struct { MsgField msg; CfgStr cfg; } strFields[] = {
+        { MSG_FIELD_URL, CFG_STR_URL },
+        { MSG_FIELD_WINDOW_TITLE, CFG_STR_WINDOW_TITLE },
+        { MSG_FIELD_ON_HIDE_JS, CFG_STR_ON_HIDE_JS },
+        { MSG_FIELD_ON_SHOW_JS, CFG_STR_ON_SHOW_JS },
+    };
+    for (size_t i = 0; i < sizeof(strFields) / sizeof(strFields[0]); i++) {
+        const MsgValue* v = &m->field[strFields[i].msg];
+        size_t rawLen = v->type == MSG_VALUE_STRING ? v->len : 0;
+        wchar_t* dst = config_builder_reserve(&b, rawLen);
+        if (dst) {
+            json_msg_wstring(m, strFields[i].msg, dst, rawLen + 1);
+            config_builder_commit(&b, strFields[i].cfg, wcslen(dst));
+        }
+    }
+    size_t rawLangsLen = wcslen(rawSpellLangs);
+    wchar_t* langs = config_builder_reserve(&b, rawLangsLen);
+    if (langs) {
+        config_normalize_languages(rawSpellLangs, langs, rawLangsLen + 1);
+        config_builder_commit(&b, CFG_STR_SPELLCHECK_LANGUAGES, wcslen(langs));
+    }
+    b.sleepWhenInactive = json_msg_bool(m, MSG_FIELD_SLEEP_WHEN_INACTIVE, FALSE);
+    b.openNewWindowsExternally = json_msg_bool(m, MSG_FIELD_OPEN_NEW_WINDOWS_EXTERNALLY, FALSE);
+    int suspendDelay = json_msg_int(m, MSG_FIELD_SUSPEND_DELAY, SUSPEND_DELAY_DEFAULT_S);
+    if (suspendDelay < 0) suspendDelay = 0;
+    if (suspendDelay > SUSPEND_DELAY_MAX_S) suspendDelay = SUSPEND_DELAY_MAX_S;
+    b.suspendDelay = (DWORD)suspendDelay;
+    return config_builder_finish(&b, next);
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef WEBVIEW_STATS_H
+#define WEBVIEW_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Counts and latency histograms for the WebView2 calls that cross to the
+// browser process. The app records into one WvHistogram per call kind and
+// can save them all to a file (see "Save WebView2 Statistics" in the tray
+// menu); webview_stats_decode.c reads that file on any platform. Nothing
+// here touches Win32, so both sides share the layout and the bucket maths.
+//
+// Alongside the calls, time, CPU and working set are summed per hidden tier
+// (WvTier) so the tier dwell times can be tuned from real use.
+//
+// Histograms are HDR-style log-linear: values below 2*WVS_SUB_BUCKETS
+// microseconds get a bucket each, and every power of two above that is split
+// into WVS_SUB_BUCKETS equal buckets, so any recorded value is off by at
+// most 1/WVS_SUB_BUCKETS (~6%) from the truth, from 1 us up to over an hour.
+
+typedef enum {
+    WVS_RESUME,                // ICoreWebView2_3::Resume
+    WVS_TRY_SUSPEND,           // ICoreWebView2_3::TrySuspend, the call itself
+    WVS_TRY_SUSPEND_DONE,      // ...to its completion handler
+    WVS_PUT_IS_VISIBLE,
+    WVS_PUT_BOUNDS,
+    WVS_NOTIFY_PARENT,         // NotifyParentWindowPositionChanged
+    WVS_EXECUTE_SCRIPT,        // ExecuteJavaScript (onShow/onHide hooks)
+    WVS_EXECUTE_SCRIPT_DONE,
+    WVS_PING,                  // Liveness ping after a power resume
+    WVS_PING_DONE,
+    WVS_NAVIGATE,
+    WVS_NAVIGATE_DONE,         // ...to NavigationCompleted
+    WVS_RELOAD,
+    WVS_GET_SOURCE,
+    WVS_PUT_MEMORY_TARGET,     // ICoreWebView2_19::put_MemoryUsageTargetLevel
+    WVS_DISCARD_REBUILD,       // Rebuild after a discard, to its NavigationCompleted
+    WVS_CAPTURE_PREVIEW,       // CapturePreview (page snapshot on hide), the call itself
+    WVS_CAPTURE_PREVIEW_DONE,  // ...to its completion handler
+    WVS_OPEN_TO_FRAME,         // ShowMainWindow to the page answering again
+    WVS_OCCLUSION_CHECK,       // IsWindowActuallyVisible (not a WebView2 call)
+    WVS_OCCLUSION_CACHED,      // ...answered from an unchanged z-order fingerprint
+    WVS_COUNT
+} WvStatKind;
+
+#define WVS_SUB_BUCKET_BITS 4
+#define WVS_SUB_BUCKETS (1u << WVS_SUB_BUCKET_BITS)
+// Index of UINT32_MAX plus one: (32 - WVS_SUB_BUCKET_BITS) powers of two
+// past the linear range.
+#define WVS_BUCKETS ((32 - WVS_SUB_BUCKET_BITS + 1) * WVS_SUB_BUCKETS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t failures;      // Calls that returned a failure HRESULT
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t reserved;
+    uint32_t buckets[WVS_BUCKETS];
+} WvHistogram;
+
+// How far a site has stepped down while hidden (or, PARTIAL, while it only
+// peeks out from under other windows), coarser than the lifecycle states:
+// the warm-but-hidden states share one tier, as do SUSPENDING and SUSPENDED.
+typedef enum {
+    WVS_TIER_SHOWN,
+    WVS_TIER_HIDDEN_WARM,      // Hidden, still rendering
+    WVS_TIER_UNRENDERED,       // put_IsVisible(FALSE), still running
+    WVS_TIER_LOW_MEMORY,       // ...and memory target level LOW
+    WVS_TIER_SUSPENDED,
+    WVS_TIER_DISCARDED,        // No WebView; rebuilt when wanted
+    WVS_TIER_PARTIAL,          // Shown but mostly covered: not rendering, memory LOW
+    WVS_TIER_COUNT
+} WvTier;
+
+// Usage of the whole WebView2 runtime (every process it lists) while a site
+// sat in a tier. The runtime is shared, so with several sites the figures of
+// concurrent visits overlap.
+typedef struct {
+    uint32_t visits;
+    uint32_t samples;          // Visits with a usage sample at both ends
+    uint64_t timeMs;           // Wall time in the tier, all visits
+    uint64_t cpuMs;            // Runtime CPU time (user + kernel) over the sampled visits
+    uint64_t sampledMs;        // Wall time of the sampled visits
+    uint64_t workingSetSumKb;  // Runtime working set as each sampled visit ended
+    uint64_t workingSetMaxKb;
+} WvTierStats;
+
+// Stats file: a header, then kindCount records in WvStatKind order, then
+// tierCount records in WvTier order. All fields little-endian, naturally
+// aligned. Each record carries its WvStatKind or WvTier, which readers match
+// on, and the name it had when written, for display.
+#define WVS_FILE_MAGIC 0x54535657u  // "WVST"
+#define WVS_FILE_VERSION 1
+#define WVS_NAME_MAX 48             // Room for the longest name and its NUL
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kindCount;
+    uint32_t bucketCount;
+    uint64_t elapsedMs;     // Time covered by the counts
+    uint32_t tierCount;
+    uint32_t reserved;
+} WvStatsFileHeader;
+
+typedef struct {
+    uint32_t kind;          // WvStatKind
+    uint32_t reserved;
+    char name[WVS_NAME_MAX];
+    WvHistogram hist;
+} WvStatsRecord;
+
+typedef struct {
+    uint32_t tier;          // WvTier
+    uint32_t reserved;
+    char name[WVS_NAME_MAX];
+    WvTierStats stats;
+} WvTierRecord;
+
+static inline const char* wvstats_kind_name(WvStatKind kind) {
+    static const char* const names[WVS_COUNT] = {
+        "Resume", "TrySuspend", "TrySuspend completion", "put_IsVisible",
+        "put_Bounds", "NotifyParentWindowPositionChanged", "ExecuteScript",
+        "ExecuteScript completion", "Liveness ping", "Liveness ping completion",
+        "Navigate", "Navigate to NavigationCompleted", "Reload", "get_Source",
+        "put_MemoryUsageTargetLevel", "Rebuild after discard", "CapturePreview",
+        "CapturePreview completion", "Open to first frame", "Occlusion check",
+        "Occlusion check, cached"
+    };
+    return (unsigned)kind < WVS_COUNT ? names[kind] : "?";
+}
+
+static inline const char* wvstats_tier_name(WvTier tier) {
+    static const char* const names[WVS_TIER_COUNT] = {
+        "shown", "hidden, rendering", "hidden, not rendering", "hidden, low memory", "suspended",
+        "discarded", "shown, mostly covered"
+    };
+    return (unsigned)tier < WVS_TIER_COUNT ? names[tier] : "?";
+}
+
+static inline unsigned wvstats_bucket(uint32_t us) {
+    if (us < 2 * WVS_SUB_BUCKETS) return us;
+    unsigned msb = 31;
+    while (!(us & (1u << msb))) msb--;
+    unsigned shift = msb - WVS_SUB_BUCKET_BITS;
+    return (shift + 1) * WVS_SUB_BUCKETS + ((us >> shift) - WVS_SUB_BUCKETS);
+}
+
+// Smallest value that lands in bucket i.
+static inline uint64_t wvstats_bucket_floor(unsigned i) {
+    if (i < 2 * WVS_SUB_BUCKETS) return i;
+    unsigned shift = i / WVS_SUB_BUCKETS - 1;
+    return (uint64_t)(WVS_SUB_BUCKETS + i % WVS_SUB_BUCKETS) << shift;
+}
+
+static inline void wvstats_record(WvHistogram* h, uint64_t us, int failed) {
+    uint32_t v = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    h->count++;
+    if (failed) h->failures++;
+    h->totalUs += v;
+    if (v > h->maxUs) h->maxUs = v;
+    h->buckets[wvstats_bucket(v)]++;
+}
+
+// Upper bound of the bucket holding the given quantile (0..1), capped at the
+// largest value actually seen.
+static inline uint64_t wvstats_quantile(const WvHistogram* h, double q) {
+    if (!h->count) return 0;
+    uint64_t rank = (uint64_t)(q * h->count + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < WVS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = i + 1 < WVS_BUCKETS ? wvstats_bucket_floor(i + 1) - 1 : UINT32_MAX;
+            return upper < h->maxUs ? upper : h->maxUs;
+        }
+    }
+    return h->maxUs;
+}
+
+static inline void wvstats_make_record(WvStatsRecord* rec, WvStatKind kind, const WvHistogram* h) {
+    memset(rec, 0, sizeof(*rec));
+    rec->kind = (uint32_t)kind;
+    strncpy(rec->name, wvstats_kind_name(kind), sizeof(rec->name) - 1);
+    rec->hist = *h;
+}
+
+static inline void wvstats_make_tier_record(WvTierRecord* rec, WvTier tier, const WvTierStats* t) {
+    memset(rec, 0, sizeof(*rec));
+    rec->tier = (uint32_t)tier;
+    strncpy(rec->name, wvstats_tier_name(tier), sizeof(rec->name) - 1);
+    rec->stats = *t;
+}
+
+#endif
@@ -0,0 +1,163 @@
+// Reads the webview2-stats.bin file written by the tray menu's "Save WebView2
+// Statistics" and prints call counts and latency percentiles per WebView2
+// call, then the time, CPU and working set per hidden tier. Builds and runs
+// anywhere (make stats-decode).
+//
+//   webview_stats_decode [-b] webview2-stats.bin
+//
+// -b also prints the non-empty histogram buckets of every call.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "webview_stats.h"
+
+static uint32_t read_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_le64(const unsigned char* p) {
+    return (uint64_t)read_le32(p) | (uint64_t)read_le32(p + 4) << 32;
+}
+
+// Fields are decoded by offset, so the tool also works on big-endian hosts.
+static void decode_record(const unsigned char* raw, WvStatsRecord* rec) {
+    rec->kind = read_le32(raw + offsetof(WvStatsRecord, kind));
+    memcpy(rec->name, raw + offsetof(WvStatsRecord, name), sizeof(rec->name));
+    rec->name[sizeof(rec->name) - 1] = '\0';
+    const unsigned char* h = raw + offsetof(WvStatsRecord, hist);
+    rec->hist.count = read_le32(h + offsetof(WvHistogram, count));
+    rec->hist.failures = read_le32(h + offsetof(WvHistogram, failures));
+    rec->hist.totalUs = read_le64(h + offsetof(WvHistogram, totalUs));
+    rec->hist.maxUs = read_le32(h + offsetof(WvHistogram, maxUs));
+    for (unsigned i = 0; i < WVS_BUCKETS; i++) {
+        rec->hist.buckets[i] = read_le32(h + offsetof(WvHistogram, buckets) + 4 * i);
+    }
+}
+
+static void decode_tier_record(const unsigned char* raw, WvTierRecord* rec) {
+    rec->tier = read_le32(raw + offsetof(WvTierRecord, tier));
+    memcpy(rec->name, raw + offsetof(WvTierRecord, name), sizeof(rec->name));
+    rec->name[sizeof(rec->name) - 1] = '\0';
+    const unsigned char* t = raw + offsetof(WvTierRecord, stats);
+    rec->stats.visits = read_le32(t + offsetof(WvTierStats, visits));
+    rec->stats.samples = read_le32(t + offsetof(WvTierStats, samples));
+    rec->stats.timeMs = read_le64(t + offsetof(WvTierStats, timeMs));
+    rec->stats.cpuMs = read_le64(t + offsetof(WvTierStats, cpuMs));
+    rec->stats.sampledMs = read_le64(t + offsetof(WvTierStats, sampledMs));
+    rec->stats.workingSetSumKb = read_le64(t + offsetof(WvTierStats, workingSetSumKb));
+    rec->stats.workingSetMaxKb = read_le64(t + offsetof(WvTierStats, workingSetMaxKb));
+}
+
+static void print_us(uint64_t us) {
+    if (us < 1000) printf(" %7llu us", (unsigned long long)us);
+    else printf(" %7.2f ms", us / 1000.0);
+}
+
+int main(int argc, char** argv) {
+    int buckets = 0;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) buckets = 1;
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-b] webview2-stats.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    unsigned char raw[sizeof(WvStatsRecord)];
+    if (fread(raw, sizeof(WvStatsFileHeader), 1, f) != 1 ||
+        read_le32(raw + offsetof(WvStatsFileHeader, magic)) != WVS_FILE_MAGIC) {
+        fprintf(stderr, "%s: not a WebView2 statistics file\n", path);
+        fclose(f);
+        return 1;
+    }
+    uint32_t version = read_le32(raw + offsetof(WvStatsFileHeader, version));
+    uint32_t kinds = read_le32(raw + offsetof(WvStatsFileHeader, kindCount));
+    uint32_t bucketCount = read_le32(raw + offsetof(WvStatsFileHeader, bucketCount));
+    uint64_t elapsedMs = read_le64(raw + offsetof(WvStatsFileHeader, elapsedMs));
+    uint32_t tiers = read_le32(raw + offsetof(WvStatsFileHeader, tierCount));
+    if (version != WVS_FILE_VERSION || bucketCount != WVS_BUCKETS) {
+        fprintf(stderr, "%s: unsupported version %u (%u buckets)\n", path, version, bucketCount);
+        fclose(f);
+        return 1;
+    }
+
+    printf("%s: %.1f min of data\n\n", path, elapsedMs / 60000.0);
+    printf("%-34s %8s %6s %10s %10s %10s %10s %10s\n",
+           "call", "count", "fail", "mean", "p50", "p90", "p99", "max");
+
+    uint32_t occlusionHits = 0, occlusionMisses = 0;
+    for (uint32_t k = 0; k < kinds; k++) {
+        if (fread(raw, sizeof(raw), 1, f) != 1) {
+            fprintf(stderr, "%s: truncated after %u records\n", path, k);
+            fclose(f);
+            return 1;
+        }
+        WvStatsRecord rec;
+        decode_record(raw, &rec);
+        const WvHistogram* h = &rec.hist;
+        if (!h->count) continue;
+
+        if (rec.kind == WVS_OCCLUSION_CHECK) occlusionMisses = h->count;
+        if (rec.kind == WVS_OCCLUSION_CACHED) occlusionHits = h->count;
+
+        printf("%-34s %8u %6u", rec.name, h->count, h->failures);
+        print_us(h->totalUs / h->count);
+        print_us(wvstats_quantile(h, 0.50));
+        print_us(wvstats_quantile(h, 0.90));
+        print_us(wvstats_quantile(h, 0.99));
+        print_us(h->maxUs);
+        printf("\n");
+
+        if (buckets) {
+            for (unsigned i = 0; i < WVS_BUCKETS; i++) {
+                if (!h->buckets[i]) continue;
+                printf("    >= %10llu us  %u\n",
+                       (unsigned long long)wvstats_bucket_floor(i), h->buckets[i]);
+            }
+        }
+    }
+
+    if (occlusionHits) {
+        printf("\nocclusion cache: %u of %u checks hit (%.0f%%)\n", occlusionHits,
+               occlusionHits + occlusionMisses,
+               100.0 * occlusionHits / (occlusionHits + occlusionMisses));
+    }
+
+    if (tiers) {
+        printf("\n%-24s %8s %12s %8s %12s %12s\n",
+               "tier", "visits", "time", "cpu", "ws at exit", "ws max");
+    }
+    for (uint32_t k = 0; k < tiers; k++) {
+        if (fread(raw, sizeof(WvTierRecord), 1, f) != 1) {
+            fprintf(stderr, "%s: truncated after %u tiers\n", path, k);
+            fclose(f);
+            return 1;
+        }
+        WvTierRecord rec;
+        decode_tier_record(raw, &rec);
+        const WvTierStats* t = &rec.stats;
+        if (!t->visits) continue;
+
+        // CPU as a share of one core over the sampled time; the working set
+        // is the mean of the samples taken as each visit ended.
+        printf("%-24s %8u %10.1f m", rec.name, t->visits, t->timeMs / 60000.0);
+        if (t->samples && t->sampledMs) {
+            printf(" %7.2f%% %9.1f MB %9.1f MB\n", 100.0 * t->cpuMs / t->sampledMs,
+                   t->workingSetSumKb / 1024.0 / t->samples, t->workingSetMaxKb / 1024.0);
+        } else {
+            printf(" %8s %12s %12s\n", "-", "-", "-");
+        }
+    }
+
+    fclose(f);
+    return 0;
+}